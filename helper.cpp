@@ -14,17 +14,49 @@
  **********************************************************************/
 
 #include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDir>
 #include <QFile>
 #include <QFileInfo>
 #include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QProcess>
+#include <QRegularExpression>
 #include <QSet>
+#include <QtEndian>
 
+#include <cerrno>
 #include <cstdio>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <vector>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <linux/openat2.h>
+#include <sys/file.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "blockreader.h"
+#include "common.h"
+#include "rootfs.h"
 
 namespace
 {
 constexpr auto UEFI_MANAGER_LIB = "/usr/lib/uefi-manager/uefimanager-lib";
+// EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS
+constexpr quint32 EFI_VARIABLE_NON_VOLATILE = 0x1;
+constexpr quint32 ALLOWED_VARIABLE_ATTRIBUTES = 0x7;
+// Boot records of the ACPI FPDT, which the kernel makes readable by root only
+constexpr auto FPDT_BOOT_DIR = "/sys/firmware/acpi/fpdt/boot";
+constexpr qint64 MAX_FILE_BYTES = 1024 * 1024;
+// Serializes efivar batches from concurrent uefi-manager instances
+constexpr auto EFIVARS_LOCK_FILE = "/run/uefi-manager-efivars.lock";
 
 struct ProcessResult
 {
@@ -65,7 +97,6 @@ void printError(const QString &message)
         {"cryptsetup", {"/usr/sbin/cryptsetup", "/sbin/cryptsetup", "/usr/bin/cryptsetup", "/bin/cryptsetup"}},
         {"efibootmgr", {"/usr/sbin/efibootmgr", "/sbin/efibootmgr", "/usr/bin/efibootmgr", "/bin/efibootmgr"}},
         {"findmnt", {"/usr/bin/findmnt", "/bin/findmnt"}},
-        {"grep", {"/usr/bin/grep", "/bin/grep"}},
         {"lsblk", {"/usr/bin/lsblk", "/bin/lsblk"}},
         {"mkdir", {"/usr/bin/mkdir", "/bin/mkdir"}},
         {"mount", {"/usr/bin/mount", "/bin/mount"}},
@@ -86,6 +117,13 @@ void printError(const QString &message)
     return subcommands;
 }
 
+// Only the boot manager variables under the EFI global GUID may be changed
+[[nodiscard]] bool isAllowedVariable(const QString &name)
+{
+    static const QRegularExpression variableRegex("^(Boot[0-9A-F]{4}|BootOrder|BootNext|Timeout)$");
+    return variableRegex.match(name).hasMatch();
+}
+
 [[nodiscard]] QString resolveBinary(const QStringList &candidates)
 {
     for (const QString &candidate : candidates) {
@@ -159,6 +197,453 @@ void printError(const QString &message)
     return runAllowedCommand(args.constFirst(), args.mid(1), readHelperInput());
 }
 
+// Run several allowed commands under a single elevation. The commands are read
+// from stdin as a JSON array of argv arrays, e.g. [["efibootmgr","-o","0001,0002"]].
+// Everything is validated before the first command runs and execution stops at
+// the first failure.
+[[nodiscard]] int handleBatch(const QStringList &args)
+{
+    if (!args.isEmpty()) {
+        printError(QStringLiteral("batch reads its commands from stdin"));
+        return 1;
+    }
+
+    const QJsonDocument doc = QJsonDocument::fromJson(readHelperInput());
+    if (!doc.isArray() || doc.array().isEmpty()) {
+        printError(QStringLiteral("batch requires a JSON array of commands"));
+        return 1;
+    }
+
+    QList<QStringList> commands;
+    const QJsonArray entries = doc.array();
+    for (const QJsonValue &entry : entries) {
+        const QJsonArray argv = entry.toArray();
+        QStringList command;
+        for (const QJsonValue &arg : argv) {
+            if (!arg.isString()) {
+                printError(QStringLiteral("batch arguments must be strings"));
+                return 1;
+            }
+            command.append(arg.toString());
+        }
+        if (command.isEmpty()) {
+            printError(QStringLiteral("batch entries must be non-empty command arrays"));
+            return 1;
+        }
+        if (!allowedCommands().contains(command.constFirst())) {
+            printError(QString("Command is not allowed: %1").arg(command.constFirst()));
+            return 1;
+        }
+        commands.append(command);
+    }
+
+    for (const QStringList &command : std::as_const(commands)) {
+        const int exitCode = runAllowedCommand(command.constFirst(), command.mid(1));
+        if (exitCode != 0) {
+            return exitCode;
+        }
+    }
+    return 0;
+}
+
+struct VariableOperation
+{
+    bool remove = false;
+    QString name;
+    QByteArray contents; // 32-bit attributes followed by the data, as efivarfs expects
+    std::optional<QByteArray> expect; // SHA-256 hex of the current contents, empty if it must not exist
+};
+
+[[nodiscard]] QByteArray variablePath(const QString &name)
+{
+    return QString("%1/%2-%3").arg(EFIVARS_DIR, name, EFI_GLOBAL_GUID).toUtf8();
+}
+
+// Version of a variable as the application computes it, empty when the variable does not exist
+[[nodiscard]] QByteArray currentVersion(const QString &name)
+{
+    QFile file(QString::fromUtf8(variablePath(name)));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return {};
+    }
+    return QCryptographicHash::hash(file.readAll(), QCryptographicHash::Sha256).toHex();
+}
+
+// efivarfs marks most variables immutable, lift the flag before changing one
+[[nodiscard]] bool clearImmutable(const QByteArray &path)
+{
+    const int fd = ::open(path.constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return errno == ENOENT;
+    }
+    int flags = 0;
+    bool ok = true;
+    if (::ioctl(fd, FS_IOC_GETFLAGS, &flags) == 0 && (flags & FS_IMMUTABLE_FL)) {
+        flags &= ~FS_IMMUTABLE_FL;
+        ok = ::ioctl(fd, FS_IOC_SETFLAGS, &flags) == 0;
+    }
+    ::close(fd);
+    return ok;
+}
+
+[[nodiscard]] bool applyVariableOperation(const VariableOperation &operation)
+{
+    const QByteArray path = variablePath(operation.name);
+    if (!clearImmutable(path)) {
+        const int error = errno;
+        printError(QString("Failed to make %1 writable: %2").arg(operation.name, std::strerror(error)));
+        return false;
+    }
+
+    if (operation.remove) {
+        if (::unlink(path.constData()) != 0 && errno != ENOENT) {
+            const int error = errno;
+            printError(QString("Failed to delete %1: %2").arg(operation.name, std::strerror(error)));
+            return false;
+        }
+        return true;
+    }
+
+    const int fd = ::open(path.constData(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        const int error = errno;
+        printError(QString("Failed to open %1: %2").arg(operation.name, std::strerror(error)));
+        return false;
+    }
+    // efivarfs needs the attributes and the data in a single write() call
+    const ssize_t written = ::write(fd, operation.contents.constData(), static_cast<size_t>(operation.contents.size()));
+    const int writeErrno = errno;
+    ::close(fd);
+    if (written != operation.contents.size()) {
+        printError(QString("Failed to write %1: %2").arg(operation.name, std::strerror(writeErrno)));
+        return false;
+    }
+    return true;
+}
+
+// Write or delete boot manager variables directly through efivarfs. The operations
+// are read from stdin as a JSON array, e.g.
+// [{"op":"write","name":"Boot0001","attributes":7,"data":"<base64>"},{"op":"delete","name":"Boot0003"}].
+// An optional "expect" holds the SHA-256 hex of the contents the change was based on ("" when the
+// variable must not exist); if any no longer matches, nothing is written and the exit code is 3.
+// Everything is validated before the first change and execution stops at the first failure.
+[[nodiscard]] int handleEfivar(const QStringList &args)
+{
+    if (!args.isEmpty()) {
+        printError(QStringLiteral("efivar reads its operations from stdin"));
+        return 1;
+    }
+
+    const QJsonDocument doc = QJsonDocument::fromJson(readHelperInput());
+    if (!doc.isArray() || doc.array().isEmpty()) {
+        printError(QStringLiteral("efivar requires a JSON array of operations"));
+        return 1;
+    }
+
+    QList<VariableOperation> operations;
+    const QJsonArray entries = doc.array();
+    for (const QJsonValue &entry : entries) {
+        const QJsonObject object = entry.toObject();
+        VariableOperation operation;
+        operation.name = object.value("name").toString();
+        if (!isAllowedVariable(operation.name)) {
+            printError(QString("Variable is not allowed: %1").arg(operation.name));
+            return 1;
+        }
+
+        const QString op = object.value("op").toString();
+        if (op == QLatin1String("delete")) {
+            operation.remove = true;
+        } else if (op == QLatin1String("write")) {
+            const qint64 attributes = object.value("attributes").toInteger(-1);
+            if (attributes < 0 || (attributes & ~qint64(ALLOWED_VARIABLE_ATTRIBUTES)) != 0
+                || (attributes & EFI_VARIABLE_NON_VOLATILE) == 0) {
+                printError(QString("Unsupported variable attributes for %1").arg(operation.name));
+                return 1;
+            }
+            const auto decoded = QByteArray::fromBase64Encoding(object.value("data").toString().toLatin1(),
+                                                                QByteArray::AbortOnBase64DecodingErrors);
+            if (!decoded || decoded.decoded.isEmpty()) {
+                printError(QString("Invalid variable data for %1").arg(operation.name));
+                return 1;
+            }
+            operation.contents.resize(sizeof(quint32));
+            qToLittleEndian(static_cast<quint32>(attributes), operation.contents.data());
+            operation.contents += decoded.decoded;
+        } else {
+            printError(QString("Unsupported efivar operation: %1").arg(op));
+            return 1;
+        }
+        if (object.contains("expect")) {
+            static const QRegularExpression versionRegex("^([0-9a-f]{64})?$");
+            const QString expect = object.value("expect").toString();
+            if (!object.value("expect").isString() || !versionRegex.match(expect).hasMatch()) {
+                printError(QString("Invalid expected version for %1").arg(operation.name));
+                return 1;
+            }
+            operation.expect = expect.toLatin1();
+        }
+        operations.append(operation);
+    }
+
+    // Held until exit, so the version check and the writes are atomic for other instances
+    const int lockFd = ::open(EFIVARS_LOCK_FILE, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (lockFd < 0 || ::flock(lockFd, LOCK_EX) != 0) {
+        const int error = errno;
+        printError(QString("Failed to lock %1: %2").arg(EFIVARS_LOCK_FILE, std::strerror(error)));
+        return 1;
+    }
+    bool conflict = false;
+    for (const VariableOperation &operation : std::as_const(operations)) {
+        if (operation.expect && currentVersion(operation.name) != *operation.expect) {
+            printError(QString("Variable changed since it was read: %1").arg(operation.name));
+            conflict = true;
+        }
+    }
+    if (conflict) {
+        return EXIT_CODE_CONFLICT;
+    }
+
+    for (const VariableOperation &operation : std::as_const(operations)) {
+        if (!applyVariableOperation(operation)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Whole disks and partitions under /dev, given by name or through /dev/disk/by-* links
+[[nodiscard]] bool isBlockDevice(const QString &path)
+{
+    static const QRegularExpression pathRegex("^/dev/[A-Za-z0-9._:+@-]+(/[A-Za-z0-9._:+@-]+)*$");
+    if (!pathRegex.match(path).hasMatch() || path.contains("/../")) {
+        return false;
+    }
+    const QString target = QFileInfo(path).canonicalFilePath();
+    struct stat info {};
+    return target.startsWith("/dev/") && ::stat(target.toUtf8().constData(), &info) == 0 && S_ISBLK(info.st_mode);
+}
+
+// Run a read-only parser on the given devices, e.g. "gpt /dev/sda /dev/nvme0n1" for the partition
+// tables, "fat /dev/sda1" for an ESP's free space and EFI directory, "luks /dev/sda3" for a LUKS
+// header's identity, or "root /dev/sda2" for the kernels and boot configuration of an unmounted
+// Linux root. Prints a JSON object keyed by device: the parser's result, or {"error": "..."} for a
+// device it could not read.
+[[nodiscard]] int handleRead(const QString &reader, const QStringList &args)
+{
+    if (args.isEmpty()) {
+        printError(QString("%1 requires at least one device").arg(reader));
+        return 1;
+    }
+    for (const QString &device : args) {
+        if (!isBlockDevice(device)) {
+            printError(QString("Not a block device: %1").arg(device));
+            return 1;
+        }
+    }
+
+    QJsonObject results;
+    for (const QString &device : args) {
+        results.insert(device, blockreader::read(reader, device));
+    }
+    writeAndFlush(stdout, QJsonDocument(results).toJson(QJsonDocument::Compact) + '\n');
+    return 0;
+}
+
+// A file the file action may read: the directory it is confined to and its path relative to that
+struct AllowedFile {
+    QString root;
+    QString relativePath;
+};
+
+// Mount points as /proc/self/mountinfo lists them, with its octal escapes (e.g. "\040") undone
+[[nodiscard]] QStringList mountPoints()
+{
+    QFile mountinfo(QStringLiteral("/proc/self/mountinfo"));
+    if (!mountinfo.open(QIODevice::ReadOnly)) {
+        return {};
+    }
+    static const QRegularExpression escapeRegex(R"(\\([0-7]{3}))");
+    QStringList points;
+    const QList<QByteArray> lines = mountinfo.readAll().split('\n');
+    for (const QByteArray &line : lines) {
+        const QList<QByteArray> fields = line.split(' ');
+        if (fields.size() < 5) {
+            continue;
+        }
+        const QString escaped = QString::fromUtf8(fields.at(4));
+        QString point;
+        qsizetype end = 0;
+        for (const QRegularExpressionMatch &match : escapeRegex.globalMatch(escaped)) {
+            point += escaped.mid(end, match.capturedStart() - end) + QChar(match.captured(1).toUShort(nullptr, 8));
+            end = match.capturedEnd();
+        }
+        points.append(point + escaped.mid(end));
+    }
+    return points;
+}
+
+// The FPDT boot records, and the files rootfs reads from a Linux root (see rootfs::isProbedFile) below
+// a mount point, e.g. /mnt/root/etc/crypttab
+[[nodiscard]] std::optional<AllowedFile> allowedFile(const QString &path)
+{
+    static const QRegularExpression fpdtRegex(QString("^%1/([a-z_]+)$").arg(FPDT_BOOT_DIR));
+    if (const QRegularExpressionMatch match = fpdtRegex.match(path); match.hasMatch()) {
+        return AllowedFile {FPDT_BOOT_DIR, match.captured(1)};
+    }
+    if (!path.startsWith('/') || QDir::cleanPath(path) != path) {
+        return std::nullopt;
+    }
+    const QStringList points = mountPoints();
+    for (const QString &point : points) {
+        const QString relativePath = point == "/" ? path : path.mid(point.size());
+        if ((point == "/" || path.startsWith(point + '/')) && rootfs::isProbedFile(relativePath)) {
+            return AllowedFile {point, relativePath};
+        }
+    }
+    return std::nullopt;
+}
+
+// Opens the file inside root, resolving symlinks as if root were "/", so a link can't lead out of it
+[[nodiscard]] std::optional<QByteArray> readConfinedFile(const AllowedFile &file, QString *error)
+{
+    const int rootFd = ::open(file.root.toUtf8().constData(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+    if (rootFd < 0) {
+        *error = QString::fromLocal8Bit(std::strerror(errno));
+        return std::nullopt;
+    }
+    open_how how {};
+    how.flags = O_RDONLY | O_CLOEXEC | O_NOCTTY;
+    how.resolve = RESOLVE_IN_ROOT | RESOLVE_NO_MAGICLINKS;
+    const int fd = static_cast<int>(
+        ::syscall(SYS_openat2, rootFd, file.relativePath.toUtf8().constData(), &how, sizeof(how)));
+    const int openError = errno;
+    ::close(rootFd);
+    if (fd < 0) {
+        *error = QString::fromLocal8Bit(std::strerror(openError));
+        return std::nullopt;
+    }
+
+    struct stat info {};
+    QByteArray data;
+    if (::fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        *error = QStringLiteral("Not a regular file");
+        ::close(fd);
+        return std::nullopt;
+    }
+    // sysfs reports a nominal size, so read to the end rather than trusting st_size
+    char buffer[4096];
+    ssize_t count = 0;
+    while ((count = ::read(fd, buffer, sizeof(buffer))) > 0 && data.size() <= MAX_FILE_BYTES) {
+        data.append(buffer, count);
+    }
+    const int readError = errno;
+    ::close(fd);
+    if (count < 0) {
+        *error = QString::fromLocal8Bit(std::strerror(readError));
+        return std::nullopt;
+    }
+    if (data.size() > MAX_FILE_BYTES) {
+        *error = QStringLiteral("File too large");
+        return std::nullopt;
+    }
+    return data;
+}
+
+// Read files only root may read, e.g. "file /sys/firmware/acpi/fpdt/boot/reset_end" or "file
+// /mnt/root/boot/grub/grub.cfg" for a grub.cfg with mode 0600 in a mounted Linux root. Only the paths
+// allowedFile() accepts are read. Prints a JSON object keyed by path: {"data": "..."} with the raw
+// contents in base64, or {"error": "..."} for a file that could not be read.
+[[nodiscard]] int handleFile(const QStringList &args)
+{
+    if (args.isEmpty()) {
+        printError(QStringLiteral("file requires at least one path"));
+        return 1;
+    }
+    QList<AllowedFile> files;
+    for (const QString &path : args) {
+        const std::optional<AllowedFile> file = allowedFile(path);
+        if (!file) {
+            printError(QString("File is not allowed: %1").arg(path));
+            return 1;
+        }
+        files.append(*file);
+    }
+
+    QJsonObject results;
+    for (qsizetype i = 0; i < args.size(); ++i) {
+        QString error;
+        const std::optional<QByteArray> data = readConfinedFile(files.at(i), &error);
+        results.insert(args.at(i), data ? QJsonObject {{"data", QString::fromLatin1(data->toBase64())}}
+                                        : QJsonObject {{"error", error}});
+    }
+    writeAndFlush(stdout, QJsonDocument(results).toJson(QJsonDocument::Compact) + '\n');
+    return 0;
+}
+
+// Unlock LUKS containers with one passphrase read from stdin, e.g. "unlock /dev/sda2 luks-<uuid>
+// /dev/sda3 luks-<uuid>". A cryptsetup runs for every container at once, so their key derivations
+// overlap instead of adding up. Prints a JSON object keyed by device: {"opened": true}, or
+// {"error": "..."} for a container the passphrase did not open.
+[[nodiscard]] int handleUnlock(const QStringList &args)
+{
+    if (args.isEmpty() || args.size() % 2 != 0) {
+        printError(QStringLiteral("unlock requires pairs of a device and a mapping name"));
+        return 1;
+    }
+    static const QRegularExpression nameRegex("^luks-[A-Za-z0-9-]+$");
+    for (qsizetype i = 0; i < args.size(); i += 2) {
+        if (!isBlockDevice(args.at(i))) {
+            printError(QString("Not a block device: %1").arg(args.at(i)));
+            return 1;
+        }
+        if (!nameRegex.match(args.at(i + 1)).hasMatch()) {
+            printError(QString("Invalid mapping name: %1").arg(args.at(i + 1)));
+            return 1;
+        }
+    }
+    const QString program = resolveBinary(allowedCommands().value("cryptsetup"));
+    if (program.isEmpty()) {
+        printError(QStringLiteral("Command is not available: cryptsetup"));
+        return 127;
+    }
+    QByteArray passphrase = readHelperInput();
+    if (passphrase.isEmpty()) {
+        printError(QStringLiteral("unlock reads the passphrase from stdin"));
+        return 1;
+    }
+
+    std::vector<std::unique_ptr<QProcess>> processes;
+    for (qsizetype i = 0; i < args.size(); i += 2) {
+        auto &process = processes.emplace_back(std::make_unique<QProcess>());
+        process->start(program, {"luksOpen", "--allow-discards", args.at(i), args.at(i + 1), "-"});
+        if (process->waitForStarted()) {
+            process->write(passphrase);
+        }
+        process->closeWriteChannel();
+    }
+    passphrase.fill(SCRUB_BYTE);
+
+    QJsonObject results;
+    for (qsizetype i = 0; i < args.size(); i += 2) {
+        QProcess &process = *processes.at(static_cast<size_t>(i / 2));
+        process.waitForFinished(-1);
+        if (process.error() == QProcess::FailedToStart) {
+            results.insert(args.at(i), QJsonObject {{"error", QString("Failed to start %1").arg(program)}});
+        } else if (process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0) {
+            const QString message = QString::fromUtf8(process.readAllStandardError()).trimmed();
+            results.insert(args.at(i), QJsonObject {{"error", message.isEmpty()
+                                                                  ? QString("cryptsetup exited with %1")
+                                                                        .arg(process.exitCode())
+                                                                  : message}});
+        } else {
+            results.insert(args.at(i), QJsonObject {{"opened", true}});
+        }
+    }
+    writeAndFlush(stdout, QJsonDocument(results).toJson(QJsonDocument::Compact) + '\n');
+    return 0;
+}
+
 [[nodiscard]] int handleLib(const QStringList &args)
 {
     if (args.isEmpty()) {
@@ -200,6 +685,21 @@ int main(int argc, char *argv[])
     if (action == QLatin1String("lib")) {
         return handleLib(remainingArgs);
     }
+    if (action == QLatin1String("batch")) {
+        return handleBatch(remainingArgs);
+    }
+    if (action == QLatin1String("efivar")) {
+        return handleEfivar(remainingArgs);
+    }
+    if (action == QLatin1String("unlock")) {
+        return handleUnlock(remainingArgs);
+    }
+    if (action == QLatin1String("file")) {
+        return handleFile(remainingArgs);
+    }
+    if (blockreader::isReader(action)) {
+        return handleRead(action, remainingArgs);
+    }
 
     printError(QString("Unsupported helper action: %1").arg(action));
     return 1;
@@ -0,0 +1,251 @@
+#include "blockdevicemodel.h"
+
+#include <QJsonObject>
+#include <QRegularExpression>
+
+#include <algorithm>
+
+#include "common.h"
+#include "utils.h"
+
+namespace
+{
+constexpr qint64 ONE_GB = 1'073'741'824LL;
+constexpr qint64 SIX_GB = 6 * ONE_GB;
+// Wide enough for any number in a device name
+constexpr qsizetype SORT_KEY_DIGITS = 10;
+} // namespace
+
+BlockDeviceModel::BlockDeviceModel(QObject *parent)
+    : QAbstractItemModel(parent)
+{
+}
+
+QString BlockDeviceModel::Device::displayText() const
+{
+    const QString sizeText = formatSize(size);
+    if (isDrive()) {
+        return QString("%1 %2 %3 %4").arg(name, sizeText, label, model).trimmed();
+    }
+    return QString("%1 %2 %3 %4 %5").arg(name, sizeText, fstype, mountpoint, label).trimmed();
+}
+
+void BlockDeviceModel::load(const QJsonArray &blockDevices, const QString &rootPartition)
+{
+    // Physical disks and the partitions on them (sd*, hd*, vd*, xvd*, mmcblk*, nvme*)
+    static const QRegularExpression driveNameRegex("^x?[hsv]d[a-z]|^mmcblk|^nvme");
+    static const QRegularExpression partNameRegex("^x?[hsv]d[a-z]\\d|^mmcblk\\d+p|^nvme\\d+n\\d+p");
+
+    beginResetModel();
+    drives.clear();
+    children.clear();
+    rows.clear();
+
+    QList<Device> partitions;
+    for (const QJsonValue &value : blockDevices) {
+        const QJsonObject object = value.toObject();
+        Device device;
+        device.name = object.value("name").toString();
+        const QString type = object.value("type").toString();
+        const bool isDrive = type == "disk" && driveNameRegex.match(device.name).hasMatch();
+        const bool isPartition = type == "part" && partNameRegex.match(device.name).hasMatch();
+        if (!isDrive && !isPartition) {
+            continue;
+        }
+        device.size = object.value("size").toInteger();
+        device.fstype = object.value("fstype").toString();
+        device.label = object.value("label").toString();
+        device.parttype = object.value("parttype").toString().toLower();
+        device.sortKey = sortKey(device.name);
+        if (isDrive) {
+            device.mountpoint = object.value("mountpoint").toString();
+            device.model = object.value("model").toString();
+            drives.append(device);
+            continue;
+        }
+        device.mountpoint = device.name == rootPartition ? "/" : object.value("mountpoint").toString();
+        device.drive = object.value("pkname").toString();
+        if (device.drive.isEmpty()) {
+            device.drive = utils::extractDiskFromPartition(device.name);
+        }
+        partitions.append(device);
+    }
+
+    const auto byKey = [](const Device &a, const Device &b) { return a.sortKey < b.sortKey; };
+    std::sort(drives.begin(), drives.end(), byKey);
+    std::sort(partitions.begin(), partitions.end(), byKey);
+    children.resize(drives.size());
+    for (int driveRow = 0; driveRow < drives.size(); ++driveRow) {
+        rows.insert(drives.at(driveRow).name, {driveRow, -1});
+    }
+    for (Device &partition : partitions) {
+        const auto it = rows.constFind(partition.drive);
+        if (it != rows.constEnd()) {
+            children[it->drive].append(std::move(partition));
+        }
+    }
+    for (int driveRow = 0; driveRow < children.size(); ++driveRow) {
+        const QList<Device> &driveChildren = children.at(driveRow);
+        for (int partitionRow = 0; partitionRow < driveChildren.size(); ++partitionRow) {
+            rows.insert(driveChildren.at(partitionRow).name, {driveRow, partitionRow});
+        }
+    }
+    endResetModel();
+}
+
+const BlockDeviceModel::Device *BlockDeviceModel::device(const QString &name) const
+{
+    const auto it = rows.constFind(name);
+    if (it == rows.constEnd()) {
+        return nullptr;
+    }
+    return it->partition < 0 ? &drives.at(it->drive) : &children.at(it->drive).at(it->partition);
+}
+
+QModelIndex BlockDeviceModel::driveIndex(const QString &name) const
+{
+    const auto it = rows.constFind(name);
+    if (it == rows.constEnd() || it->partition >= 0) {
+        return {};
+    }
+    return createIndex(it->drive, 0, quintptr(0));
+}
+
+QList<const BlockDeviceModel::Device *> BlockDeviceModel::partitions(const QString &drive, Purpose purpose) const
+{
+    QList<const Device *> result;
+    const auto collect = [&result, purpose](const QList<Device> &driveChildren) {
+        for (const Device &partition : driveChildren) {
+            if (suits(partition, purpose)) {
+                result.append(&partition);
+            }
+        }
+    };
+    if (drive.isEmpty()) {
+        for (const QList<Device> &driveChildren : children) {
+            collect(driveChildren);
+        }
+        return result;
+    }
+    const auto it = rows.constFind(drive);
+    if (it != rows.constEnd() && it->partition < 0) {
+        collect(children.at(it->drive));
+    }
+    return result;
+}
+
+bool BlockDeviceModel::suits(const Device &partition, Purpose purpose)
+{
+    static const QStringList excludedLinuxFs = {"ntfs", "exfat", "vfat", "BitLocker", "swap"};
+    static const QStringList excludedFrugalFs = {"swap", "BitLocker"};
+
+    if (partition.isDrive()) {
+        return false;
+    }
+    switch (purpose) {
+    case Purpose::Esp:
+        return partition.fstype.compare("vfat", Qt::CaseInsensitive) == 0
+               && (partition.parttype == ESP_GUID_GPT || partition.parttype == ESP_TYPE_MBR);
+    case Purpose::Linux:
+        return partition.size >= SIX_GB && !partition.fstype.isEmpty()
+               && !excludedLinuxFs.contains(partition.fstype, Qt::CaseInsensitive);
+    case Purpose::Frugal:
+        return partition.size >= ONE_GB && !partition.fstype.isEmpty()
+               && !excludedFrugalFs.contains(partition.fstype, Qt::CaseInsensitive);
+    }
+    return false;
+}
+
+QString BlockDeviceModel::sortKey(const QString &name)
+{
+    QString key;
+    key.reserve(name.size() + SORT_KEY_DIGITS);
+    qsizetype pos = 0;
+    while (pos < name.size()) {
+        if (!name.at(pos).isDigit()) {
+            key += name.at(pos++);
+            continue;
+        }
+        qsizetype end = pos;
+        while (end < name.size() && name.at(end).isDigit()) {
+            ++end;
+        }
+        key += name.sliced(pos, end - pos).rightJustified(SORT_KEY_DIGITS, '0');
+        pos = end;
+    }
+    return key;
+}
+
+QString BlockDeviceModel::formatSize(qint64 bytes)
+{
+    if (bytes >= ONE_GB) {
+        return QString::number(static_cast<double>(bytes) / ONE_GB, 'f', 1) + "G";
+    }
+    return QString::number(static_cast<double>(bytes) / (1024 * 1024), 'f', 1) + "M";
+}
+
+// Drives carry 0 as their internal id, partitions their drive's row + 1
+QModelIndex BlockDeviceModel::index(int row, int column, const QModelIndex &parent) const
+{
+    if (row < 0 || column != 0) {
+        return {};
+    }
+    if (!parent.isValid()) {
+        return row < drives.size() ? createIndex(row, 0, quintptr(0)) : QModelIndex();
+    }
+    if (parent.internalId() != 0 || parent.row() >= children.size()) {
+        return {};
+    }
+    return row < children.at(parent.row()).size() ? createIndex(row, 0, quintptr(parent.row() + 1)) : QModelIndex();
+}
+
+QModelIndex BlockDeviceModel::parent(const QModelIndex &child) const
+{
+    if (!child.isValid() || child.internalId() == 0) {
+        return {};
+    }
+    return createIndex(static_cast<int>(child.internalId() - 1), 0, quintptr(0));
+}
+
+int BlockDeviceModel::rowCount(const QModelIndex &parent) const
+{
+    if (!parent.isValid()) {
+        return static_cast<int>(drives.size());
+    }
+    if (parent.column() != 0 || parent.internalId() != 0 || parent.row() >= children.size()) {
+        return 0;
+    }
+    return static_cast<int>(children.at(parent.row()).size());
+}
+
+int BlockDeviceModel::columnCount(const QModelIndex & /*parent*/) const
+{
+    return 1;
+}
+
+QVariant BlockDeviceModel::data(const QModelIndex &index, int role) const
+{
+    const Device *device = deviceAt(index);
+    if (!device) {
+        return {};
+    }
+    switch (role) {
+    case Qt::DisplayRole:
+        return device->displayText();
+    case NameRole:
+        return device->name;
+    default:
+        return {};
+    }
+}
+
+const BlockDeviceModel::Device *BlockDeviceModel::deviceAt(const QModelIndex &index) const
+{
+    if (!checkIndex(index, CheckIndexOption::IndexIsValid)) {
+        return nullptr;
+    }
+    if (index.internalId() == 0) {
+        return &drives.at(index.row());
+    }
+    return &children.at(static_cast<qsizetype>(index.internalId() - 1)).at(index.row());
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <QAbstractItemModel>
+#include <QHash>
+#include <QJsonArray>
+#include <QList>
+
+// Physical drives and their partitions from one lsblk scan, behind the drive and partition combo
+// boxes. Drives are the top-level rows and their partitions the children, both in natural order
+// ("sda2" before "sda10"); every row carries its device name in NameRole, so nothing has to be
+// parsed back out of the display text.
+class BlockDeviceModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    struct Device {
+        QString name;  // e.g. "sda1"
+        QString drive; // disk a partition is on, e.g. "sda"; empty for drives
+        qint64 size = 0;
+        QString fstype;
+        QString mountpoint;
+        QString label;
+        QString model;    // drives only
+        QString parttype; // lowercase
+        QString sortKey;
+
+        [[nodiscard]] bool isDrive() const { return drive.isEmpty(); }
+        // Name first, then size and whatever else identifies the device
+        [[nodiscard]] QString displayText() const;
+    };
+
+    // What a partition is offered for
+    enum class Purpose {
+        Esp,    // EFI System Partitions
+        Linux,  // roots for a stub install: at least 6 GB, no Windows or swap filesystems
+        Frugal, // frugal installs: at least 1 GB, anything but swap and BitLocker
+    };
+
+    // Qt::UserRole is also what QComboBox::currentData() returns by default
+    enum Role { NameRole = Qt::UserRole };
+
+    explicit BlockDeviceModel(QObject *parent = nullptr);
+
+    // Rebuilds the model from the "blockdevices" array of lsblk --json --bytes with the NAME,
+    // PKNAME, SIZE, FSTYPE, MOUNTPOINT, LABEL, MODEL, PARTTYPE and TYPE columns. rootPartition is
+    // shown as mounted on "/" whatever lsblk reports for it.
+    void load(const QJsonArray &blockDevices, const QString &rootPartition = {});
+
+    [[nodiscard]] const Device *device(const QString &name) const;
+    [[nodiscard]] QModelIndex driveIndex(const QString &name) const;
+    // The partitions of one drive, or of every drive when drive is empty, in display order
+    [[nodiscard]] QList<const Device *> partitions(const QString &drive, Purpose purpose) const;
+    [[nodiscard]] static bool suits(const Device &partition, Purpose purpose);
+
+    // Digit runs zero-padded so that a plain string comparison orders names like sort -V
+    [[nodiscard]] static QString sortKey(const QString &name);
+    [[nodiscard]] static QString formatSize(qint64 bytes);
+
+    [[nodiscard]] QModelIndex index(int row, int column, const QModelIndex &parent = {}) const override;
+    [[nodiscard]] QModelIndex parent(const QModelIndex &child) const override;
+    [[nodiscard]] int rowCount(const QModelIndex &parent = {}) const override;
+    [[nodiscard]] int columnCount(const QModelIndex &parent = {}) const override;
+    [[nodiscard]] QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+private:
+    struct Row {
+        int drive = -1;
+        int partition = -1; // -1 for the drive itself
+    };
+
+    QList<Device> drives;
+    QList<QList<Device>> children; // partitions, parallel to drives
+    QHash<QString, Row> rows;      // by device name
+
+    [[nodiscard]] const Device *deviceAt(const QModelIndex &index) const;
+};
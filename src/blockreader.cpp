@@ -0,0 +1,43 @@
+#include "blockreader.h"
+
+#include <QObject>
+
+#include "fatfs.h"
+#include "gpt.h"
+#include "luks.h"
+#include "rootfs.h"
+
+namespace blockreader
+{
+
+bool isReader(const QString &name)
+{
+    return name == "gpt" || name == "fat" || name == "luks" || name == "root";
+}
+
+QJsonObject read(const QString &name, const QString &device)
+{
+    QString error;
+    if (name == "gpt") {
+        if (const auto table = gpt::readDevice(device, &error)) {
+            return gpt::toJson(*table);
+        }
+    } else if (name == "fat") {
+        if (const auto summary = fatfs::inspectDevice(device, &error)) {
+            return fatfs::toJson(*summary);
+        }
+    } else if (name == "luks") {
+        if (const auto header = luks::readDevice(device, &error)) {
+            return luks::toJson(*header);
+        }
+    } else if (name == "root") {
+        if (const auto snapshot = rootfs::readDevice(device, &error)) {
+            return rootfs::toJson(*snapshot);
+        }
+    } else {
+        error = QObject::tr("Unknown reader: %1").arg(name);
+    }
+    return {{"error", error}};
+}
+
+} // namespace blockreader
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <QJsonObject>
+#include <QString>
+
+// Read-only parsers run straight on block devices: in-process when the device is readable,
+// otherwise through the helper's action of the same name (e.g. "helper gpt /dev/sda")
+namespace blockreader
+{
+
+[[nodiscard]] bool isReader(const QString &name);
+// The parser's result for the device as JSON, or {"error": "..."} when it has none
+[[nodiscard]] QJsonObject read(const QString &name, const QString &device);
+
+} // namespace blockreader
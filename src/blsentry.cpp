@@ -0,0 +1,118 @@
+#include "blsentry.h"
+
+#include <QSysInfo>
+
+namespace blsentry
+{
+
+namespace
+{
+const QString AMD_UCODE = QStringLiteral("amd-ucode.img");
+const QString INTEL_UCODE = QStringLiteral("intel-ucode.img");
+const QString INITRD = QStringLiteral("initrd");
+
+// Values may not contain line breaks; a stray one would end the key early
+QString oneLine(const QString &value)
+{
+    return value.simplified();
+}
+} // namespace
+
+QString bootLoaderFileName()
+{
+    const QString arch = QSysInfo::currentCpuArchitecture();
+    QString suffix = "x64";
+    if (arch == "arm64") {
+        suffix = "aa64";
+    } else if (arch == "i386") {
+        suffix = "ia32";
+    }
+    return "systemd-boot" + suffix + ".efi";
+}
+
+QString bootLoaderPath()
+{
+    return "\\EFI\\systemd\\" + bootLoaderFileName();
+}
+
+QString kernelDir(const Entry &entry)
+{
+    return '/' + entry.machineId + '/' + entry.version;
+}
+
+QString fileName(const Entry &entry)
+{
+    return entry.machineId + '-' + entry.version + ".conf";
+}
+
+QStringList initrdPaths(const Entry &entry)
+{
+    const QString dir = kernelDir(entry);
+    QStringList paths;
+    if (entry.hasAmdUcode) {
+        paths.append(dir + '/' + AMD_UCODE);
+    }
+    if (entry.hasIntelUcode) {
+        paths.append(dir + '/' + INTEL_UCODE);
+    }
+    paths.append(dir + '/' + INITRD);
+    return paths;
+}
+
+QString render(const Entry &entry)
+{
+    QString text;
+    text += "title " + oneLine(entry.title) + '\n';
+    text += "version " + entry.version + '\n';
+    text += "machine-id " + entry.machineId + '\n';
+    if (!entry.sortKey.isEmpty()) {
+        text += "sort-key " + entry.sortKey + '\n';
+    }
+    text += "linux " + kernelDir(entry) + "/linux\n";
+    const QStringList initrds = initrdPaths(entry);
+    for (const QString &initrd : initrds) {
+        text += "initrd " + initrd + '\n';
+    }
+    if (!oneLine(entry.options).isEmpty()) {
+        text += "options " + oneLine(entry.options) + '\n';
+    }
+    return text;
+}
+
+std::optional<Entry> parse(const QString &text)
+{
+    Entry entry;
+    bool hasLinux = false;
+    const QStringList lines = text.split('\n');
+    for (const QString &rawLine : lines) {
+        const QString line = rawLine.trimmed();
+        if (line.isEmpty() || line.startsWith('#')) {
+            continue;
+        }
+        const QString key = line.section(' ', 0, 0);
+        const QString value = line.section(' ', 1).trimmed();
+        if (key == "title") {
+            entry.title = value;
+        } else if (key == "version") {
+            entry.version = value;
+        } else if (key == "machine-id") {
+            entry.machineId = value;
+        } else if (key == "sort-key") {
+            entry.sortKey = value;
+        } else if (key == "linux") {
+            hasLinux = true;
+        } else if (key == "initrd") {
+            entry.hasAmdUcode |= value.endsWith('/' + AMD_UCODE);
+            entry.hasIntelUcode |= value.endsWith('/' + INTEL_UCODE);
+        } else if (key == "options") {
+            // Several options lines are concatenated
+            entry.options = entry.options.isEmpty() ? value : entry.options + ' ' + value;
+        }
+    }
+    if (!hasLinux || entry.version.isEmpty() || entry.machineId.isEmpty()) {
+        return std::nullopt;
+    }
+    return entry;
+}
+
+} // namespace blsentry
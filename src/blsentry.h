@@ -0,0 +1,44 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+
+#include <optional>
+
+// Boot Loader Specification Type #1 entries (loader/entries/*.conf on the ESP), read by
+// systemd-boot so that installing a kernel doesn't need a Boot#### variable of its own
+namespace blsentry
+{
+
+inline constexpr QLatin1StringView ENTRIES_DIR("/loader/entries");
+inline constexpr QLatin1StringView SYSTEMD_BOOT_SOURCE_DIR("/usr/lib/systemd/boot/efi");
+inline constexpr QLatin1StringView SYSTEMD_BOOT_LABEL("Linux Boot Manager");
+
+struct Entry {
+    QString title;
+    QString version;   // kernel release, also used to sort entries
+    QString machineId; // entry token: the file name prefix and the directory holding the kernel
+    QString sortKey;   // distribution ID
+    QString options;
+    bool hasAmdUcode = false;
+    bool hasIntelUcode = false;
+
+    bool operator==(const Entry &other) const = default;
+};
+
+// systemd-boot<arch>.efi for the CPU this runs on, e.g. systemd-bootx64.efi
+[[nodiscard]] QString bootLoaderFileName();
+// \EFI\systemd\systemd-boot<arch>.efi, the path the single NVRAM entry points to
+[[nodiscard]] QString bootLoaderPath();
+
+// ESP-relative locations, with forward slashes: /<machine-id>/<version> and its files
+[[nodiscard]] QString kernelDir(const Entry &entry);
+[[nodiscard]] QString fileName(const Entry &entry); // <machine-id>-<version>.conf
+// Microcode comes first, the firmware loads the initrd lines in order
+[[nodiscard]] QStringList initrdPaths(const Entry &entry);
+
+[[nodiscard]] QString render(const Entry &entry);
+// Reads back an entry written by render(); unknown keys are ignored
+[[nodiscard]] std::optional<Entry> parse(const QString &text);
+
+} // namespace blsentry
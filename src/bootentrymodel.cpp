@@ -0,0 +1,223 @@
+#include "bootentrymodel.h"
+
+#include <QBrush>
+#include <QIcon>
+#include <QRegularExpression>
+
+#include <algorithm>
+
+BootEntryModel::BootEntryModel(QObject *parent)
+    : QAbstractListModel(parent)
+{
+}
+
+QString BootEntryModel::Entry::text() const
+{
+    return QString("Boot%1%2 %3").arg(bootNum, active ? "*" : "", description);
+}
+
+std::optional<BootEntryModel::Entry> BootEntryModel::parseLine(const QString &line)
+{
+    static const QRegularExpression entryRegex(R"(^Boot([0-9A-Fa-f]{4})(\*?)\s+(.*)$)");
+    const QRegularExpressionMatch match = entryRegex.match(line);
+    if (!match.hasMatch()) {
+        return std::nullopt;
+    }
+    Entry entry;
+    entry.bootNum = match.captured(1);
+    entry.active = !match.capturedView(2).isEmpty();
+    entry.description = match.captured(3);
+    return entry;
+}
+
+void BootEntryModel::setEntries(const QList<Entry> &entries)
+{
+    beginResetModel();
+    entryList = entries;
+    rows.clear();
+    reindex(0, static_cast<int>(entryList.size()) - 1);
+    endResetModel();
+}
+
+QStringList BootEntryModel::bootOrder() const
+{
+    QStringList order;
+    order.reserve(entryList.size());
+    for (const Entry &entry : entryList) {
+        order.append(entry.bootNum);
+    }
+    return order;
+}
+
+void BootEntryModel::insertEntry(int position, const Entry &entry)
+{
+    if (rows.contains(entry.bootNum)) {
+        updateEntry(entry);
+        return;
+    }
+    position = std::clamp(position, 0, static_cast<int>(entryList.size()));
+    beginInsertRows({}, position, position);
+    entryList.insert(position, entry);
+    reindex(position, static_cast<int>(entryList.size()) - 1);
+    endInsertRows();
+}
+
+bool BootEntryModel::updateEntry(const Entry &entry)
+{
+    const int entryRow = row(entry.bootNum);
+    if (entryRow < 0) {
+        insertEntry(static_cast<int>(entryList.size()), entry);
+        return true;
+    }
+    entryList[entryRow] = entry;
+    emit dataChanged(index(entryRow), index(entryRow));
+    return false;
+}
+
+bool BootEntryModel::removeEntry(const QString &bootNum)
+{
+    const int entryRow = row(bootNum);
+    if (entryRow < 0) {
+        return false;
+    }
+    beginRemoveRows({}, entryRow, entryRow);
+    entryList.removeAt(entryRow);
+    rows.remove(bootNum);
+    reindex(entryRow, static_cast<int>(entryList.size()) - 1);
+    endRemoveRows();
+    return true;
+}
+
+bool BootEntryModel::setActive(const QString &bootNum, bool active)
+{
+    const int entryRow = row(bootNum);
+    if (entryRow < 0) {
+        return false;
+    }
+    if (entryList.at(entryRow).active != active) {
+        entryList[entryRow].active = active;
+        emit dataChanged(index(entryRow), index(entryRow), {Qt::DisplayRole, Qt::BackgroundRole, ActiveRole});
+    }
+    return true;
+}
+
+void BootEntryModel::sortByBootOrder(const QStringList &order)
+{
+    if (order.isEmpty()) {
+        return;
+    }
+    QList<int> oldRows; // by new row
+    oldRows.reserve(entryList.size());
+    QList<bool> placed(entryList.size(), false);
+    for (const QString &bootNum : order) {
+        const int entryRow = row(bootNum);
+        if (entryRow >= 0 && !placed.at(entryRow)) {
+            placed[entryRow] = true;
+            oldRows.append(entryRow);
+        }
+    }
+    for (int entryRow = 0; entryRow < entryList.size(); ++entryRow) {
+        if (!placed.at(entryRow)) {
+            oldRows.append(entryRow);
+        }
+    }
+
+    emit layoutAboutToBeChanged({}, QAbstractItemModel::VerticalSortHint);
+    QList<Entry> sorted;
+    sorted.reserve(entryList.size());
+    QList<int> newRows(entryList.size());
+    for (int newRow = 0; newRow < oldRows.size(); ++newRow) {
+        sorted.append(entryList.at(oldRows.at(newRow)));
+        newRows[oldRows.at(newRow)] = newRow;
+    }
+    entryList = std::move(sorted);
+    reindex(0, static_cast<int>(entryList.size()) - 1);
+
+    const QModelIndexList before = persistentIndexList();
+    QModelIndexList after;
+    after.reserve(before.size());
+    for (const QModelIndex &oldIndex : before) {
+        after.append(index(newRows.at(oldIndex.row())));
+    }
+    changePersistentIndexList(before, after);
+    emit layoutChanged({}, QAbstractItemModel::VerticalSortHint);
+}
+
+bool BootEntryModel::matches(int entryRow, const QString &text) const
+{
+    if (entryRow < 0 || entryRow >= entryList.size()) {
+        return false;
+    }
+    const Entry &entry = entryList.at(entryRow);
+    return entry.bootNum.contains(text, Qt::CaseInsensitive) || entry.label().contains(text, Qt::CaseInsensitive)
+           || entry.target.contains(text, Qt::CaseInsensitive);
+}
+
+int BootEntryModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : static_cast<int>(entryList.size());
+}
+
+QVariant BootEntryModel::data(const QModelIndex &index, int role) const
+{
+    if (!checkIndex(index, CheckIndexOption::IndexIsValid | CheckIndexOption::ParentIsInvalid)) {
+        return {};
+    }
+    const Entry &entry = entryList.at(index.row());
+    switch (role) {
+    case Qt::DisplayRole:
+        return entry.text();
+    case Qt::ToolTipRole:
+    case TargetRole:
+        return entry.target;
+    case Qt::BackgroundRole:
+        return entry.active ? QVariant() : QVariant(QBrush(Qt::gray));
+    case Qt::DecorationRole:
+        return entry.missing ? QVariant(QIcon::fromTheme("dialog-warning")) : QVariant();
+    case BootNumRole:
+        return entry.bootNum;
+    case ActiveRole:
+        return entry.active;
+    default:
+        return {};
+    }
+}
+
+// Rows are dragged between other rows, never dropped onto one
+Qt::ItemFlags BootEntryModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid()) {
+        return Qt::ItemIsDropEnabled;
+    }
+    return Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsDragEnabled | Qt::ItemNeverHasChildren;
+}
+
+bool BootEntryModel::moveRows(const QModelIndex &sourceParent, int sourceRow, int count,
+                              const QModelIndex &destinationParent, int destinationChild)
+{
+    const int size = static_cast<int>(entryList.size());
+    if (sourceParent.isValid() || destinationParent.isValid() || count <= 0 || sourceRow < 0
+        || sourceRow + count > size || destinationChild < 0 || destinationChild > size) {
+        return false;
+    }
+    if (!beginMoveRows({}, sourceRow, sourceRow + count - 1, {}, destinationChild)) {
+        return false;
+    }
+    // destinationChild counts the rows before the move
+    const int target = destinationChild > sourceRow ? destinationChild - count : destinationChild;
+    const QList<Entry> moved = entryList.mid(sourceRow, count);
+    entryList.remove(sourceRow, count);
+    for (int offset = 0; offset < count; ++offset) {
+        entryList.insert(target + offset, moved.at(offset));
+    }
+    reindex(std::min(sourceRow, target), std::max(sourceRow, target) + count - 1);
+    endMoveRows();
+    return true;
+}
+
+void BootEntryModel::reindex(int first, int last)
+{
+    for (int entryRow = first; entryRow <= last; ++entryRow) {
+        rows.insert(entryList.at(entryRow).bootNum, entryRow);
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <QAbstractListModel>
+#include <QHash>
+#include <QList>
+#include <QStringList>
+
+#include <optional>
+
+// The Boot#### entries listed by efibootmgr, in boot order, behind the list on the entries tab.
+// A hash from boot number to row lets a changed, added or removed entry patch its own row, so
+// menus with hundreds of network boot entries are never rebuilt or searched item by item.
+class BootEntryModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    struct Entry {
+        QString bootNum; // e.g. "0001", as efibootmgr prints it
+        bool active = false;
+        QString description; // what follows "Boot0001* ": the label, a tab, the device path
+        QString target;      // where the entry points, as shown below the list
+        bool missing = false; // the target partition is not on this system
+
+        [[nodiscard]] QString label() const { return description.section('\t', 0, 0); }
+        // The efibootmgr line, with the active mark as it is now
+        [[nodiscard]] QString text() const;
+    };
+
+    enum Role { BootNumRole = Qt::UserRole, TargetRole, ActiveRole };
+
+    explicit BootEntryModel(QObject *parent = nullptr);
+
+    // A "Boot0001* Label<TAB>path" line of efibootmgr output; nullopt for any other line
+    [[nodiscard]] static std::optional<Entry> parseLine(const QString &line);
+
+    void setEntries(const QList<Entry> &entries);
+    [[nodiscard]] const QList<Entry> &entries() const { return entryList; }
+    [[nodiscard]] int row(const QString &bootNum) const { return rows.value(bootNum, -1); }
+    [[nodiscard]] QStringList bootOrder() const;
+
+    // An entry already listed is updated in place instead
+    void insertEntry(int position, const Entry &entry);
+    // Updates the entry's row; returns true when it was new and appended
+    bool updateEntry(const Entry &entry);
+    bool removeEntry(const QString &bootNum);
+    bool setActive(const QString &bootNum, bool active);
+    // The listed entries first, in that order; the others follow in their current order
+    void sortByBootOrder(const QStringList &order);
+    // Whether the boot number, label or target contain text, ignoring case
+    [[nodiscard]] bool matches(int entryRow, const QString &text) const;
+
+    [[nodiscard]] int rowCount(const QModelIndex &parent = {}) const override;
+    [[nodiscard]] QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    [[nodiscard]] Qt::ItemFlags flags(const QModelIndex &index) const override;
+    [[nodiscard]] Qt::DropActions supportedDropActions() const override { return Qt::MoveAction; }
+    bool moveRows(const QModelIndex &sourceParent, int sourceRow, int count, const QModelIndex &destinationParent,
+                  int destinationChild) override;
+
+private:
+    QList<Entry> entryList;
+    QHash<QString, int> rows; // by boot number
+
+    void reindex(int first, int last);
+};
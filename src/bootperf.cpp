@@ -0,0 +1,399 @@
+#include "bootperf.h"
+
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QObject>
+#include <QSettings>
+#include <QtEndian>
+
+#include <algorithm>
+
+#include "bootsnapshot.h"
+#include "efivars.h"
+#include "loadoption.h"
+
+namespace bootperf
+{
+
+namespace
+{
+// ACPI table header; performance records follow it
+constexpr qsizetype ACPI_HEADER_SIZE = 36;
+constexpr qsizetype ACPI_LENGTH_OFFSET = 4;
+// Performance record header: Type (UINT16), Length (UINT8), Revision (UINT8)
+constexpr qsizetype RECORD_HEADER_SIZE = 4;
+constexpr quint16 FBPT_POINTER_RECORD = 0x0000;
+constexpr qsizetype FBPT_POINTER_SIZE = 16;
+constexpr qsizetype FBPT_POINTER_ADDRESS_OFFSET = 8;
+
+constexpr qsizetype ATTRIBUTES_SIZE = 4;
+constexpr int MAX_HISTORY = 100;
+constexpr quint64 NSEC_PER_USEC = 1000;
+
+template <typename T>
+std::optional<T> fail(QString *error, const QString &message)
+{
+    if (error) {
+        *error = message;
+    }
+    return std::nullopt;
+}
+
+// Records of a table, checked to stay inside it
+QList<QByteArray> records(const QByteArray &table, qsizetype headerSize)
+{
+    QList<QByteArray> result;
+    qsizetype pos = headerSize;
+    while (pos + RECORD_HEADER_SIZE <= table.size()) {
+        const auto length = static_cast<quint8>(table.at(pos + 2));
+        if (length < RECORD_HEADER_SIZE || pos + length > table.size()) {
+            break;
+        }
+        result.append(table.mid(pos, length));
+        pos += length;
+    }
+    return result;
+}
+
+quint16 recordType(const QByteArray &record)
+{
+    return qFromLittleEndian<quint16>(record.constData());
+}
+
+QString bootId()
+{
+    QFile file("/proc/sys/kernel/random/boot_id");
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return {};
+    }
+    return QString::fromLatin1(file.readAll()).trimmed();
+}
+
+QByteArray readEfiVariable(const QString &dir, const QString &name, const QString &guid)
+{
+    QFile file(QString("%1/%2-%3").arg(dir, name, guid));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return {};
+    }
+    return file.readAll().mid(ATTRIBUTES_SIZE);
+}
+
+std::optional<FirmwareTimes> timesFromValues(const QHash<QString, QString> &values)
+{
+    const auto value = [&values](const char *name) -> std::optional<quint64> {
+        bool ok = false;
+        const quint64 number = values.value(name).trimmed().toULongLong(&ok);
+        return ok ? std::optional(number) : std::nullopt;
+    };
+    const auto resetEnd = value("reset_end");
+    const auto loadImage = value("load_image_start");
+    const auto startImage = value("start_image_start");
+    const auto exitEntry = value("exitbootservice_start");
+    const auto exitDone = value("exitbootservice_end");
+    if (!resetEnd || !loadImage || !startImage || !exitEntry || !exitDone) {
+        return std::nullopt;
+    }
+    return FirmwareTimes {*resetEnd, *loadImage, *startImage, *exitEntry, *exitDone};
+}
+
+QString settingsKey()
+{
+    return "bootPerformance/" + efivars::machineId();
+}
+
+std::optional<double> average(quint64 sum, int count)
+{
+    return count > 0 ? std::optional(static_cast<double>(sum) / count / 1000.0) : std::nullopt;
+}
+} // namespace
+
+std::optional<quint64> fbptAddress(const QByteArray &fpdt, QString *error)
+{
+    if (fpdt.size() < ACPI_HEADER_SIZE || !fpdt.startsWith("FPDT")
+        || qFromLittleEndian<quint32>(fpdt.constData() + ACPI_LENGTH_OFFSET) != static_cast<quint32>(fpdt.size())) {
+        return fail<quint64>(error, QObject::tr("Not an ACPI FPDT table."));
+    }
+    quint8 checksum = 0;
+    for (const char byte : fpdt) {
+        checksum += static_cast<quint8>(byte);
+    }
+    if (checksum != 0) {
+        return fail<quint64>(error, QObject::tr("The FPDT table checksum is wrong."));
+    }
+    for (const QByteArray &record : records(fpdt, ACPI_HEADER_SIZE)) {
+        if (recordType(record) == FBPT_POINTER_RECORD && record.size() >= FBPT_POINTER_SIZE) {
+            return qFromLittleEndian<quint64>(record.constData() + FBPT_POINTER_ADDRESS_OFFSET);
+        }
+    }
+    return fail<quint64>(error, QObject::tr("The FPDT table has no boot performance record."));
+}
+
+std::optional<FirmwareTimes> readSysfsTimes(const QString &dir)
+{
+    QMap<QString, QByteArray> files;
+    const QStringList names = QDir(dir).entryList(QDir::Files);
+    for (const QString &name : names) {
+        QFile file(dir + '/' + name);
+        if (file.open(QIODevice::ReadOnly)) {
+            files.insert(name, file.readAll());
+        }
+    }
+    return parseSysfsFiles(files);
+}
+
+std::optional<FirmwareTimes> parseSysfsFiles(const QMap<QString, QByteArray> &files)
+{
+    QHash<QString, QString> values;
+    for (auto it = files.cbegin(); it != files.cend(); ++it) {
+        values.insert(it.key().section('/', -1), QString::fromLatin1(it.value()));
+    }
+    return timesFromValues(values);
+}
+
+std::optional<FirmwareTimes> readFirmwareTimes(const RootFileReader &readAsRoot, const QString &dir)
+{
+    if (auto times = readSysfsTimes(dir)) {
+        return times;
+    }
+    QStringList paths;
+    const QStringList names = QDir(dir).entryList(QDir::Files);
+    for (const QString &name : names) {
+        paths.append(dir + '/' + name);
+    }
+    if (paths.isEmpty()) {
+        return std::nullopt;
+    }
+    return parseSysfsFiles(readAsRoot(paths));
+}
+
+QString missingFirmwareReason(const QString &fpdtTable)
+{
+    QFile file(fpdtTable);
+    if (!file.exists()) {
+        return QObject::tr("The firmware doesn't publish an ACPI FPDT table.");
+    }
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QObject::tr("Reading the firmware boot performance table needs root.");
+    }
+    QString error;
+    if (!fbptAddress(file.readAll(), &error)) {
+        return error;
+    }
+    return QObject::tr("This kernel doesn't expose the firmware boot performance table (Linux 5.12 or later needed).");
+}
+
+std::optional<quint64> parseLoaderTime(const QByteArray &data)
+{
+    QString text;
+    for (qsizetype i = 0; i + 1 < data.size(); i += 2) {
+        const char16_t c = qFromLittleEndian<quint16>(data.constData() + i);
+        if (c == 0) {
+            break;
+        }
+        text.append(QChar(c));
+    }
+    bool ok = false;
+    const quint64 usec = text.toULongLong(&ok);
+    return ok ? std::optional(usec) : std::nullopt;
+}
+
+Sample measure(const std::optional<FirmwareTimes> &firmware, const QString &efivarsDir)
+{
+    Sample sample;
+    sample.bootId = bootId();
+    sample.time = QDateTime::currentDateTimeUtc();
+    sample.firmware = firmware;
+    sample.loaderInitUsec = parseLoaderTime(readEfiVariable(efivarsDir, "LoaderTimeInitUSec", LOADER_GUID));
+    sample.loaderExecUsec = parseLoaderTime(readEfiVariable(efivarsDir, "LoaderTimeExecUSec", LOADER_GUID));
+
+    if (const auto bootCurrent = bootsnapshot::readVariable("BootCurrent", efivarsDir)) {
+        const QList<quint16> numbers = bootsnapshot::decodeUint16List(bootCurrent->data);
+        if (!numbers.isEmpty()) {
+            const QString name = bootsnapshot::bootVariableName(numbers.constFirst());
+            sample.bootCurrent = name.mid(4);
+            if (const auto entry = bootsnapshot::readVariable(name, efivarsDir)) {
+                if (const auto option = loadoption::decode(entry->data)) {
+                    sample.label = option->description;
+                }
+            }
+        }
+    }
+    return sample;
+}
+
+Phases phases(const Sample &sample)
+{
+    // The FPDT covers firmware and stub alike; the loader variables only exist under systemd-boot
+    Phases result;
+    if (sample.firmware && sample.firmware->startImageStart >= sample.firmware->resetEnd
+        && sample.firmware->exitBootServicesEntry >= sample.firmware->startImageStart) {
+        result.firmwareUsec = (sample.firmware->startImageStart - sample.firmware->resetEnd) / NSEC_PER_USEC;
+        result.loaderUsec = (sample.firmware->exitBootServicesEntry - sample.firmware->startImageStart) / NSEC_PER_USEC;
+    } else if (sample.loaderInitUsec) {
+        result.firmwareUsec = sample.loaderInitUsec;
+        if (sample.loaderExecUsec && *sample.loaderExecUsec >= *sample.loaderInitUsec) {
+            result.loaderUsec = *sample.loaderExecUsec - *sample.loaderInitUsec;
+        }
+    }
+    return result;
+}
+
+QJsonObject toJson(const Sample &sample)
+{
+    QJsonObject object {{"bootId", sample.bootId},
+                        {"time", sample.time.toString(Qt::ISODate)},
+                        {"bootCurrent", sample.bootCurrent},
+                        {"label", sample.label}};
+    if (sample.firmware) {
+        // Nanoseconds fit a double exactly for the first 104 days of uptime
+        object.insert("firmware", QJsonObject {{"resetEnd", static_cast<qint64>(sample.firmware->resetEnd)},
+                                               {"loadImageStart", static_cast<qint64>(sample.firmware->loadImageStart)},
+                                               {"startImageStart", static_cast<qint64>(sample.firmware->startImageStart)},
+                                               {"exitBootServicesEntry",
+                                                static_cast<qint64>(sample.firmware->exitBootServicesEntry)},
+                                               {"exitBootServicesExit",
+                                                static_cast<qint64>(sample.firmware->exitBootServicesExit)}});
+    }
+    if (sample.loaderInitUsec) {
+        object.insert("loaderTimeInitUSec", static_cast<qint64>(*sample.loaderInitUsec));
+    }
+    if (sample.loaderExecUsec) {
+        object.insert("loaderTimeExecUSec", static_cast<qint64>(*sample.loaderExecUsec));
+    }
+    const Phases split = phases(sample);
+    if (split.firmwareUsec) {
+        object.insert("firmwareUSec", static_cast<qint64>(*split.firmwareUsec));
+    }
+    if (split.loaderUsec) {
+        object.insert("loaderUSec", static_cast<qint64>(*split.loaderUsec));
+    }
+    return object;
+}
+
+std::optional<Sample> fromJson(const QJsonObject &object)
+{
+    if (!object.value("bootId").isString()) {
+        return std::nullopt;
+    }
+    Sample sample;
+    sample.bootId = object.value("bootId").toString();
+    sample.time = QDateTime::fromString(object.value("time").toString(), Qt::ISODate);
+    sample.bootCurrent = object.value("bootCurrent").toString();
+    sample.label = object.value("label").toString();
+    if (object.value("firmware").isObject()) {
+        const QJsonObject firmware = object.value("firmware").toObject();
+        const auto field = [&firmware](const char *name) {
+            return static_cast<quint64>(firmware.value(name).toInteger());
+        };
+        sample.firmware = FirmwareTimes {field("resetEnd"), field("loadImageStart"), field("startImageStart"),
+                                         field("exitBootServicesEntry"), field("exitBootServicesExit")};
+    }
+    if (object.contains("loaderTimeInitUSec")) {
+        sample.loaderInitUsec = static_cast<quint64>(object.value("loaderTimeInitUSec").toInteger());
+    }
+    if (object.contains("loaderTimeExecUSec")) {
+        sample.loaderExecUsec = static_cast<quint64>(object.value("loaderTimeExecUSec").toInteger());
+    }
+    return sample;
+}
+
+QList<EntrySummary> summarize(const QList<Sample> &samples)
+{
+    struct Totals {
+        quint64 firmware = 0;
+        int firmwareCount = 0;
+        quint64 loader = 0;
+        int loaderCount = 0;
+    };
+    QList<EntrySummary> summaries;
+    QList<Totals> totals;
+    for (const Sample &sample : samples) {
+        auto it = std::find_if(summaries.begin(), summaries.end(), [&sample](const EntrySummary &summary) {
+            return summary.bootCurrent == sample.bootCurrent;
+        });
+        if (it == summaries.end()) {
+            summaries.append({sample.bootCurrent, {}, 0, {}, {}});
+            totals.append({});
+            it = summaries.end() - 1;
+        }
+        Totals &sums = totals[it - summaries.begin()];
+        it->label = sample.label;
+        ++it->boots;
+        const Phases split = phases(sample);
+        if (split.firmwareUsec) {
+            sums.firmware += *split.firmwareUsec;
+            ++sums.firmwareCount;
+        }
+        if (split.loaderUsec) {
+            sums.loader += *split.loaderUsec;
+            ++sums.loaderCount;
+        }
+    }
+    for (qsizetype i = 0; i < summaries.size(); ++i) {
+        summaries[i].firmwareMsec = average(totals.at(i).firmware, totals.at(i).firmwareCount);
+        summaries[i].loaderMsec = average(totals.at(i).loader, totals.at(i).loaderCount);
+    }
+    return summaries;
+}
+
+QJsonObject toJson(const EntrySummary &summary)
+{
+    QJsonObject object {{"bootCurrent", summary.bootCurrent}, {"label", summary.label}, {"boots", summary.boots}};
+    if (summary.firmwareMsec) {
+        object.insert("firmwareMsec", *summary.firmwareMsec);
+    }
+    if (summary.loaderMsec) {
+        object.insert("loaderMsec", *summary.loaderMsec);
+    }
+    return object;
+}
+
+QJsonObject report(const Sample &current, const QList<Sample> &samples)
+{
+    QJsonObject currentJson = toJson(current);
+    if (!current.firmware) {
+        currentJson.insert("firmwareUnavailable", missingFirmwareReason());
+    }
+    QJsonArray entries;
+    const QList<EntrySummary> summaries = summarize(samples);
+    for (const EntrySummary &summary : summaries) {
+        entries.append(toJson(summary));
+    }
+    QJsonArray history;
+    for (const Sample &sample : samples) {
+        history.append(toJson(sample));
+    }
+    return {{"current", currentJson}, {"entries", entries}, {"history", history}};
+}
+
+QList<Sample> history()
+{
+    QList<Sample> samples;
+    const QJsonArray array = QJsonDocument::fromJson(QSettings().value(settingsKey()).toByteArray()).array();
+    for (const QJsonValue &value : array) {
+        if (auto sample = fromJson(value.toObject())) {
+            samples.append(*std::move(sample));
+        }
+    }
+    return samples;
+}
+
+void record(const Sample &sample)
+{
+    QList<Sample> samples = history();
+    samples.removeIf([&sample](const Sample &old) { return old.bootId == sample.bootId; });
+    samples.append(sample);
+    if (samples.size() > MAX_HISTORY) {
+        samples.remove(0, samples.size() - MAX_HISTORY);
+    }
+    QJsonArray array;
+    for (const Sample &kept : std::as_const(samples)) {
+        array.append(toJson(kept));
+    }
+    QSettings().setValue(settingsKey(), QJsonDocument(array).toJson(QJsonDocument::Compact));
+}
+
+} // namespace bootperf
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QJsonObject>
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+
+#include <functional>
+#include <optional>
+
+#include "common.h"
+
+// Firmware and boot loader timings of the current boot, from the ACPI FPDT and the
+// LoaderTime* variables systemd-boot sets, kept per BootCurrent entry across boots
+namespace bootperf
+{
+
+inline constexpr QLatin1StringView FPDT_TABLE("/sys/firmware/acpi/tables/FPDT");
+// Firmware Basic Boot Performance Table as parsed by the kernel (Linux 5.12+, root only)
+inline constexpr QLatin1StringView FPDT_BOOT_DIR("/sys/firmware/acpi/fpdt/boot");
+// Vendor GUID of the systemd-boot variables
+inline constexpr QLatin1StringView LOADER_GUID("4a67b082-0a4c-41cf-b6c7-440b29bb8c4f");
+
+// Firmware Basic Boot Performance Data Record, in nanoseconds since the timer started
+struct FirmwareTimes {
+    quint64 resetEnd = 0;
+    quint64 loadImageStart = 0;  // OS loader LoadImage
+    quint64 startImageStart = 0; // OS loader StartImage
+    quint64 exitBootServicesEntry = 0;
+    quint64 exitBootServicesExit = 0;
+
+    bool operator==(const FirmwareTimes &other) const = default;
+};
+
+struct Sample {
+    QString bootId; // kernel boot_id, one sample per boot
+    QDateTime time;
+    QString bootCurrent; // four hex digits, empty when the firmware didn't set it
+    QString label;
+    std::optional<FirmwareTimes> firmware;
+    std::optional<quint64> loaderInitUsec; // systemd-boot started, since firmware start
+    std::optional<quint64> loaderExecUsec; // systemd-boot handed over to the kernel
+};
+
+// Time spent in the firmware and in the boot loader or stub, in microseconds
+struct Phases {
+    std::optional<quint64> firmwareUsec;
+    std::optional<quint64> loaderUsec;
+};
+
+struct EntrySummary {
+    QString bootCurrent;
+    QString label; // as of the most recent boot
+    int boots = 0;
+    std::optional<double> firmwareMsec; // averages over the boots that reported the phase
+    std::optional<double> loaderMsec;
+};
+
+// Address of the FBPT from the Basic Boot Performance Table Pointer record of an FPDT; the
+// table itself is left to the kernel, this only tells a firmware without one apart
+[[nodiscard]] std::optional<quint64> fbptAddress(const QByteArray &fpdt, QString *error = nullptr);
+// Raw contents of files only root may read, by path; files that could not be read are left out
+using RootFileReader = std::function<QMap<QString, QByteArray>(const QStringList &paths)>;
+
+// Files of FPDT_BOOT_DIR, keyed by path or file name
+[[nodiscard]] std::optional<FirmwareTimes> readSysfsTimes(const QString &dir = FPDT_BOOT_DIR);
+[[nodiscard]] std::optional<FirmwareTimes> parseSysfsFiles(const QMap<QString, QByteArray> &files);
+// readSysfsTimes(), or the same files through readAsRoot when the kernel keeps them to root
+[[nodiscard]] std::optional<FirmwareTimes> readFirmwareTimes(const RootFileReader &readAsRoot,
+                                                             const QString &dir = FPDT_BOOT_DIR);
+// Why readSysfsTimes() found nothing, judged from the raw FPDT table
+[[nodiscard]] QString missingFirmwareReason(const QString &fpdtTable = FPDT_TABLE);
+// LoaderTime*USec value: decimal microseconds as a NUL-terminated UCS-2 string
+[[nodiscard]] std::optional<quint64> parseLoaderTime(const QByteArray &data);
+
+// Everything about the current boot except the firmware times, which may need root to read
+[[nodiscard]] Sample measure(const std::optional<FirmwareTimes> &firmware, const QString &efivarsDir = EFIVARS_DIR);
+[[nodiscard]] Phases phases(const Sample &sample);
+
+[[nodiscard]] QJsonObject toJson(const Sample &sample);
+[[nodiscard]] std::optional<Sample> fromJson(const QJsonObject &object);
+
+// Per entry, in the order entries were first seen
+[[nodiscard]] QList<EntrySummary> summarize(const QList<Sample> &samples);
+[[nodiscard]] QJsonObject toJson(const EntrySummary &summary);
+
+// The current boot, the averages per entry and every recorded sample, as --boot-performance prints them
+[[nodiscard]] QJsonObject report(const Sample &current, const QList<Sample> &samples);
+
+// Samples recorded on this machine, oldest first
+[[nodiscard]] QList<Sample> history();
+// Adds the sample, replacing an earlier one from the same boot
+void record(const Sample &sample);
+
+} // namespace bootperf
@@ -0,0 +1,252 @@
+#include "bootsnapshot.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QJsonObject>
+#include <QObject>
+#include <QRegularExpression>
+#include <QtEndian>
+
+#include <algorithm>
+
+namespace bootsnapshot
+{
+
+namespace
+{
+constexpr quint32 MAGIC = 0x55454642; // "UEFB"
+constexpr quint16 FORMAT_VERSION = 1;
+constexpr qsizetype CHECKSUM_SIZE = 32;
+// efivarfs prefixes the variable data with its 32-bit attributes
+constexpr qsizetype ATTRIBUTES_SIZE = 4;
+// Boot0000-BootFFFF plus BootOrder and Timeout
+constexpr quint32 MAX_VARIABLES = 0x10000 + 2;
+
+bool isBootEntry(const QString &name)
+{
+    static const QRegularExpression bootEntryRegex("^Boot[0-9A-F]{4}$");
+    return bootEntryRegex.match(name).hasMatch();
+}
+
+bool byName(const Variable &a, const Variable &b)
+{
+    return a.name < b.name;
+}
+} // namespace
+
+const Variable *Snapshot::find(const QString &name) const
+{
+    const auto it = std::find_if(variables.cbegin(), variables.cend(),
+                                 [&name](const Variable &var) { return var.name == name; });
+    return it == variables.cend() ? nullptr : &*it;
+}
+
+bool isManagedVariable(const QString &name)
+{
+    return name == "BootOrder" || name == "Timeout" || isBootEntry(name);
+}
+
+QString bootVariableName(quint16 number)
+{
+    return QString("Boot%1").arg(number, 4, 16, QChar('0')).toUpper();
+}
+
+QList<quint16> decodeUint16List(const QByteArray &data)
+{
+    QList<quint16> values;
+    values.reserve(data.size() / 2);
+    for (qsizetype pos = 0; pos + 1 < data.size(); pos += 2) {
+        values.append(qFromLittleEndian<quint16>(data.constData() + pos));
+    }
+    return values;
+}
+
+QByteArray encodeUint16List(const QList<quint16> &values)
+{
+    QByteArray data(values.size() * 2, '\0');
+    for (qsizetype i = 0; i < values.size(); ++i) {
+        qToLittleEndian(values.at(i), data.data() + i * 2);
+    }
+    return data;
+}
+
+std::optional<Variable> readVariable(const QString &name, const QString &dir)
+{
+    QFile file(QString("%1/%2-%3").arg(dir, name, EFI_GLOBAL_GUID));
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Could not read" << file.fileName();
+        return std::nullopt;
+    }
+    const QByteArray contents = file.readAll();
+    if (contents.size() < ATTRIBUTES_SIZE) {
+        return std::nullopt;
+    }
+    return Variable {name, qFromLittleEndian<quint32>(contents.constData()), contents.mid(ATTRIBUTES_SIZE)};
+}
+
+Snapshot capture(const QString &dir)
+{
+    Snapshot snapshot;
+    const QString suffix = "-" + QString(EFI_GLOBAL_GUID);
+    const QStringList files = QDir(dir).entryList({'*' + suffix}, QDir::Files | QDir::Hidden | QDir::System);
+    for (const QString &fileName : files) {
+        const QString name = fileName.chopped(suffix.size());
+        if (!isManagedVariable(name)) {
+            continue;
+        }
+        if (const auto var = readVariable(name, dir)) {
+            snapshot.variables.append(*var);
+        }
+    }
+    std::sort(snapshot.variables.begin(), snapshot.variables.end(), byName);
+    return snapshot;
+}
+
+Snapshot captureWithBootNext(const QString &dir)
+{
+    Snapshot snapshot = capture(dir);
+    if (auto bootNext = readVariable("BootNext", dir)) {
+        snapshot.variables.append(*std::move(bootNext));
+        std::sort(snapshot.variables.begin(), snapshot.variables.end(), byName);
+    }
+    return snapshot;
+}
+
+QString version(const Variable *var)
+{
+    if (!var) {
+        return {};
+    }
+    QByteArray contents(ATTRIBUTES_SIZE, '\0');
+    qToLittleEndian(var->attributes, contents.data());
+    contents += var->data;
+    return QString::fromLatin1(QCryptographicHash::hash(contents, QCryptographicHash::Sha256).toHex());
+}
+
+QByteArray serialize(const Snapshot &snapshot)
+{
+    QByteArray bytes;
+    {
+        QDataStream out(&bytes, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_6_0);
+        out << MAGIC << FORMAT_VERSION << static_cast<quint32>(snapshot.variables.size());
+        for (const Variable &var : snapshot.variables) {
+            out << var.name.toLatin1() << var.attributes << var.data;
+        }
+    }
+    bytes += QCryptographicHash::hash(bytes, QCryptographicHash::Sha256);
+    return bytes;
+}
+
+bool deserialize(const QByteArray &bytes, Snapshot *snapshot, QString *error)
+{
+    auto fail = [error](const QString &message) {
+        if (error) {
+            *error = message;
+        }
+        return false;
+    };
+
+    if (bytes.size() <= CHECKSUM_SIZE) {
+        return fail(QObject::tr("The file is too short to be a boot configuration snapshot."));
+    }
+    const QByteArray payload = bytes.first(bytes.size() - CHECKSUM_SIZE);
+    if (QCryptographicHash::hash(payload, QCryptographicHash::Sha256) != bytes.last(CHECKSUM_SIZE)) {
+        return fail(QObject::tr("The snapshot checksum does not match, the file is damaged."));
+    }
+
+    QDataStream in(payload);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic = 0;
+    quint16 version = 0;
+    quint32 count = 0;
+    in >> magic >> version >> count;
+    if (magic != MAGIC) {
+        return fail(QObject::tr("The file is not a boot configuration snapshot."));
+    }
+    if (version != FORMAT_VERSION) {
+        return fail(QObject::tr("Unsupported snapshot version: %1").arg(version));
+    }
+    if (count > MAX_VARIABLES) {
+        return fail(QObject::tr("The snapshot lists too many variables."));
+    }
+
+    Snapshot result;
+    result.variables.reserve(count);
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        QByteArray name;
+        Variable var;
+        in >> name >> var.attributes >> var.data;
+        var.name = QString::fromLatin1(name);
+        if (in.status() == QDataStream::Ok && !isManagedVariable(var.name)) {
+            return fail(QObject::tr("Unexpected variable in snapshot: %1").arg(var.name));
+        }
+        result.variables.append(var);
+    }
+    if (in.status() != QDataStream::Ok || !in.atEnd()) {
+        return fail(QObject::tr("The snapshot is truncated or malformed."));
+    }
+    std::sort(result.variables.begin(), result.variables.end(), byName);
+    *snapshot = result;
+    return true;
+}
+
+QList<Change> diff(const Snapshot &current, const Snapshot &target)
+{
+    QHash<QString, const Variable *> existing;
+    for (const Variable &var : current.variables) {
+        existing.insert(var.name, &var);
+    }
+
+    QList<Change> entryWrites;
+    QList<Change> globalWrites;
+    for (const Variable &var : target.variables) {
+        const Variable *present = existing.take(var.name);
+        if (present && *present == var) {
+            continue;
+        }
+        (isBootEntry(var.name) ? entryWrites : globalWrites).append({Change::Kind::Write, var});
+    }
+
+    QList<Change> changes = entryWrites + globalWrites;
+    QStringList stale = existing.keys();
+    stale.sort();
+    for (const QString &name : std::as_const(stale)) {
+        changes.append({Change::Kind::Delete, {name, 0, {}}});
+    }
+    return changes;
+}
+
+QList<Change> versioned(QList<Change> changes, const Snapshot &base)
+{
+    for (Change &change : changes) {
+        change.expectedVersion = version(base.find(change.variable.name));
+    }
+    return changes;
+}
+
+QJsonArray toHelperOperations(const QList<Change> &changes)
+{
+    QJsonArray operations;
+    for (const Change &change : changes) {
+        QJsonObject operation {{"name", change.variable.name}};
+        if (change.kind == Change::Kind::Delete) {
+            operation.insert("op", "delete");
+        } else {
+            operation.insert("op", "write");
+            operation.insert("attributes", static_cast<qint64>(change.variable.attributes));
+            operation.insert("data", QString::fromLatin1(change.variable.data.toBase64()));
+        }
+        if (change.expectedVersion) {
+            operation.insert("expect", *change.expectedVersion);
+        }
+        operations.append(operation);
+    }
+    return operations;
+}
+
+} // namespace bootsnapshot
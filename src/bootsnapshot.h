@@ -0,0 +1,69 @@
+#pragma once
+
+#include <QByteArray>
+#include <QJsonArray>
+#include <QList>
+#include <QString>
+
+#include <optional>
+
+#include "common.h"
+
+// Saves and restores the raw Boot####, BootOrder and Timeout variables
+namespace bootsnapshot
+{
+
+// EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS | EFI_VARIABLE_RUNTIME_ACCESS
+inline constexpr quint32 BOOT_VARIABLE_ATTRIBUTES = 0x7;
+
+struct Variable {
+    QString name; // e.g. "Boot0001", always under the EFI global GUID
+    quint32 attributes = 0;
+    QByteArray data; // EFI_LOAD_OPTION for Boot####, UINT16 list for BootOrder, ...
+
+    bool operator==(const Variable &other) const = default;
+};
+
+struct Snapshot {
+    QList<Variable> variables; // sorted by name
+
+    [[nodiscard]] const Variable *find(const QString &name) const;
+};
+
+struct Change {
+    enum class Kind { Write, Delete };
+    Kind kind = Kind::Write;
+    Variable variable; // only the name is used for deletions
+    // Version the change was planned against; the helper refuses it if the variable moved on
+    std::optional<QString> expectedVersion;
+};
+
+// Variables covered by a snapshot
+[[nodiscard]] bool isManagedVariable(const QString &name);
+// "Boot" followed by the number in four uppercase hex digits
+[[nodiscard]] QString bootVariableName(quint16 number);
+// UINT16 arrays such as BootOrder, or a single UINT16 such as Timeout
+[[nodiscard]] QList<quint16> decodeUint16List(const QByteArray &data);
+[[nodiscard]] QByteArray encodeUint16List(const QList<quint16> &values);
+
+[[nodiscard]] std::optional<Variable> readVariable(const QString &name, const QString &dir = EFIVARS_DIR);
+[[nodiscard]] Snapshot capture(const QString &dir = EFIVARS_DIR);
+// capture() plus BootNext, the state live edits are based on
+[[nodiscard]] Snapshot captureWithBootNext(const QString &dir = EFIVARS_DIR);
+// SHA-256 hex of the efivarfs contents (attributes and data), empty for a missing variable
+[[nodiscard]] QString version(const Variable *var);
+
+// Compact binary form with a trailing SHA-256 of everything before it
+[[nodiscard]] QByteArray serialize(const Snapshot &snapshot);
+[[nodiscard]] bool deserialize(const QByteArray &bytes, Snapshot *snapshot, QString *error = nullptr);
+
+// Writes and deletions that turn current into target, in a safe order:
+// Boot#### entries first, then BootOrder and Timeout, then stale entries are removed
+[[nodiscard]] QList<Change> diff(const Snapshot &current, const Snapshot &target);
+// changes, each expecting the version its variable has in base (missing ones expected to stay missing)
+[[nodiscard]] QList<Change> versioned(QList<Change> changes, const Snapshot &base);
+
+// Operations in the format the helper's "efivar" action reads from stdin
+[[nodiscard]] QJsonArray toHelperOperations(const QList<Change> &changes);
+
+} // namespace bootsnapshot
@@ -0,0 +1,372 @@
+#include "cli.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QTextStream>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#include "bootperf.h"
+#include "bootsnapshot.h"
+#include "cmd.h"
+#include "common.h"
+#include "desiredstate.h"
+#include "efivars.h"
+#include "kernelslots.h"
+#include "loadoption.h"
+#include "variablestore.h"
+
+#ifndef VERSION
+    #define VERSION "?.?.?.?"
+#endif
+
+namespace cli
+{
+
+namespace
+{
+const char *const CLI_OPTIONS[] = {"--nvram-report", "--export-boot", "--import-boot", "--apply", "--list-boot",
+                                   "--boot-performance", "--promote-slot"};
+
+// Output of an operation on one store, kept apart so parallel runs don't interleave
+struct Report {
+    bool ok = true;
+    QString output;
+    QString error;
+};
+using Operation = std::function<Report(VariableStore &store)>;
+
+void printJson(const QJsonObject &object)
+{
+    QTextStream(stdout) << QJsonDocument(object).toJson(QJsonDocument::Indented);
+}
+
+void printError(const QString &message)
+{
+    QTextStream(stderr) << message << '\n';
+}
+
+Report failure(const QString &message)
+{
+    return {false, {}, message};
+}
+
+bool readFile(const QString &fileName, QByteArray *contents, QString *error)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *error = QObject::tr("Could not read %1: %2").arg(fileName, file.errorString());
+        return false;
+    }
+    *contents = file.readAll();
+    return true;
+}
+
+// Records this boot and prints it with the per-entry averages of the boots recorded so far
+int bootPerformance()
+{
+    Cmd cmd;
+    const std::optional<bootperf::FirmwareTimes> firmware
+        = bootperf::readFirmwareTimes([&cmd](const QStringList &paths) { return cmd.readFilesAsRoot(paths); });
+    const bootperf::Sample sample = bootperf::measure(firmware);
+    bootperf::record(sample);
+
+    printJson(bootperf::report(sample, bootperf::history()));
+    return EXIT_SUCCESS;
+}
+
+Report exportBoot(VariableStore &store, const QString &fileName)
+{
+    bootsnapshot::Snapshot snapshot;
+    QString error;
+    if (!store.read(&snapshot, &error)) {
+        return failure(error);
+    }
+
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly) || file.write(bootsnapshot::serialize(snapshot)) < 0 || !file.commit()) {
+        return failure(QObject::tr("Could not write %1: %2").arg(fileName, file.errorString()));
+    }
+    const int count = static_cast<int>(snapshot.variables.size());
+    return {true, QObject::tr("Saved %n boot variable(s) to %1", nullptr, count).arg(fileName) + '\n', {}};
+}
+
+// efibootmgr-like listing: BootOrder, Timeout, then one line per entry
+Report listBoot(VariableStore &store)
+{
+    bootsnapshot::Snapshot snapshot;
+    QString error;
+    if (!store.read(&snapshot, &error)) {
+        return failure(error);
+    }
+
+    QString output;
+    QTextStream out(&output);
+    if (const bootsnapshot::Variable *order = snapshot.find("BootOrder")) {
+        QStringList numbers;
+        for (quint16 number : bootsnapshot::decodeUint16List(order->data)) {
+            numbers.append(bootsnapshot::bootVariableName(number).mid(4));
+        }
+        out << "BootOrder: " << numbers.join(',') << '\n';
+    }
+    if (const bootsnapshot::Variable *timeout = snapshot.find("Timeout")) {
+        const QList<quint16> seconds = bootsnapshot::decodeUint16List(timeout->data);
+        out << "Timeout: " << (seconds.isEmpty() ? 0 : seconds.constFirst()) << " seconds\n";
+    }
+    for (const bootsnapshot::Variable &var : snapshot.variables) {
+        const auto option = var.name.startsWith("Boot") && var.name.size() == 8 ? loadoption::decode(var.data)
+                                                                                 : std::nullopt;
+        if (!option) {
+            continue;
+        }
+        out << var.name << (option->isActive() ? "* " : "  ") << option->description << '\t';
+        if (const auto media = loadoption::hardDriveMedia(option->filePathList)) {
+            out << QString("HD(%1,GPT,%2)/File(%3)").arg(media->partition).arg(media->partuuid, media->loaderPath);
+        } else {
+            out << option->filePathList.toHex();
+        }
+        bool isText = false;
+        const QString options = loadoption::optionalDataToString(option->optionalData, &isText);
+        if (isText && !options.isEmpty()) {
+            out << ' ' << options;
+        }
+        out << '\n';
+    }
+    out.flush();
+    return {true, output, {}};
+}
+
+// Writes only the variables that differ between current and target
+Report applySnapshot(VariableStore &store, const bootsnapshot::Snapshot &current,
+                     const bootsnapshot::Snapshot &target, bool dryRun)
+{
+    const QList<bootsnapshot::Change> changes = bootsnapshot::diff(current, target);
+    if (changes.isEmpty()) {
+        return {true, QObject::tr("The boot configuration is already up to date.") + '\n', {}};
+    }
+
+    QString output;
+    for (const bootsnapshot::Change &change : changes) {
+        output += (change.kind == bootsnapshot::Change::Kind::Delete ? "delete " : "write ") + change.variable.name
+                  + '\n';
+    }
+    if (dryRun) {
+        return {true, output, {}};
+    }
+
+    QString error;
+    if (!store.write(changes, &error)) {
+        return {false, output, error};
+    }
+    output += QObject::tr("Wrote %n variable(s)", nullptr, static_cast<int>(changes.size())) + '\n';
+    return {true, output, {}};
+}
+
+Report importBoot(VariableStore &store, const bootsnapshot::Snapshot &snapshot, bool dryRun)
+{
+    bootsnapshot::Snapshot current;
+    QString error;
+    if (!store.read(&current, &error)) {
+        return failure(error);
+    }
+    return applySnapshot(store, current, snapshot, dryRun);
+}
+
+Report applyState(VariableStore &store, const desiredstate::State &state, const desiredstate::PartitionLookup &lookup,
+                  bool dryRun)
+{
+    bootsnapshot::Snapshot current;
+    QString error;
+    if (!store.read(&current, &error)) {
+        return failure(error);
+    }
+    bootsnapshot::Snapshot target;
+    if (!desiredstate::plan(current, state, lookup, &target, &error)) {
+        return failure(error);
+    }
+    return applySnapshot(store, current, target, dryRun);
+}
+
+// Makes the kernel slot this system was started from the default, e.g. from a boot-complete service
+Report promoteSlot(VariableStore &store, quint16 bootCurrent, bool dryRun)
+{
+    bootsnapshot::Snapshot current;
+    QString error;
+    if (!store.read(&current, &error)) {
+        return failure(error);
+    }
+    const QList<kernelslots::Slot> slotEntries = kernelslots::findSlots(current, {});
+    if (std::none_of(slotEntries.cbegin(), slotEntries.cend(),
+                     [bootCurrent](const kernelslots::Slot &slot) { return slot.bootNumber == bootCurrent; })) {
+        return failure(QObject::tr("%1 is not a kernel slot entry.").arg(bootsnapshot::bootVariableName(bootCurrent)));
+    }
+    return applySnapshot(store, current, kernelslots::promote(current, bootCurrent), dryRun);
+}
+
+int runOnNvram(const Operation &operation)
+{
+    EfivarfsStore store;
+    const Report report = operation(store);
+    QTextStream(stdout) << report.output;
+    if (!report.ok) {
+        printError(report.error);
+    }
+    return report.ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Each image is independent, so they are processed on a thread pool; the reports are
+// printed afterwards in the order the files were given, each line prefixed with its file
+int runOnFiles(const QStringList &files, const Operation &operation)
+{
+    std::vector<Report> reports(files.size());
+    QThreadPool pool;
+    for (qsizetype i = 0; i < files.size(); ++i) {
+        pool.start([&files, &reports, &operation, i]() {
+            VarsFileStore store(files.at(i));
+            reports[i] = operation(store);
+        });
+    }
+    pool.waitForDone();
+
+    bool ok = true;
+    QTextStream out(stdout);
+    for (qsizetype i = 0; i < files.size(); ++i) {
+        const Report &report = reports.at(i);
+        const QStringList lines = report.output.split('\n', Qt::SkipEmptyParts);
+        for (const QString &line : lines) {
+            out << files.at(i) << ": " << line << '\n';
+        }
+        if (!report.ok) {
+            out.flush();
+            printError(files.at(i) + ": " + report.error);
+            ok = false;
+        }
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+} // namespace
+
+bool isCliInvocation(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        for (const char *option : CLI_OPTIONS) {
+            const size_t length = std::strlen(option);
+            if (std::strncmp(argv[i], option, length) == 0 && (argv[i][length] == '\0' || argv[i][length] == '=')) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+int run(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setOrganizationName("MX-Linux");
+    QCoreApplication::setApplicationVersion(VERSION);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QObject::tr("uefi-manager is a tool for managing UEFI boot entries"));
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addOption({"nvram-report", QObject::tr("Print UEFI variable store usage as JSON and exit.")});
+    parser.addOption({"export-boot", QObject::tr("Save the boot entries, BootOrder and Timeout to <file> and exit."),
+                      "file"});
+    parser.addOption({"import-boot",
+                      QObject::tr("Restore the boot configuration saved in <file>, rewriting only the variables "
+                                  "that differ, and exit."),
+                      "file"});
+    parser.addOption({"apply",
+                      QObject::tr("Bring the boot entries, their order and the timeout in line with the JSON "
+                                  "description in <file>, and exit."),
+                      "file"});
+    parser.addOption({"dry-run", QObject::tr("With --import-boot, --apply or --promote-slot, only list the "
+                                             "variables that would be written or deleted.")});
+    parser.addOption({"list-boot", QObject::tr("List the boot entries, BootOrder and Timeout, and exit.")});
+    parser.addOption({"boot-performance",
+                      QObject::tr("Record the firmware and boot loader timings of this boot, print them with the "
+                                  "averages per boot entry as JSON, and exit.")});
+    parser.addOption({"promote-slot",
+                      QObject::tr("Make the kernel slot this system was started from the default boot entry, "
+                                  "and exit.")});
+    parser.addOption({"vars-file",
+                      QObject::tr("Work on the edk2 variable store image <file> (e.g. a virtual machine's "
+                                  "OVMF_VARS.fd) instead of this machine's NVRAM. Repeat to process many images "
+                                  "in parallel."),
+                      "file"});
+    parser.process(app);
+
+    const QStringList varsFiles = parser.values("vars-file");
+    if (varsFiles.isEmpty() && !isUefi()) {
+        printError(QObject::tr("This system doesn't seem to support UEFI, or was not booted in UEFI mode."));
+        return EXIT_FAILURE;
+    }
+
+    if (parser.isSet("nvram-report")) {
+        printJson(efivars::toJson(efivars::readUsage()));
+        return EXIT_SUCCESS;
+    }
+    if (parser.isSet("boot-performance")) {
+        return bootPerformance();
+    }
+
+    const bool dryRun = parser.isSet("dry-run");
+    QString error;
+    Operation operation;
+    if (parser.isSet("list-boot")) {
+        operation = listBoot;
+    } else if (parser.isSet("export-boot")) {
+        if (varsFiles.size() > 1) {
+            printError(QObject::tr("--export-boot works on a single --vars-file."));
+            return EXIT_FAILURE;
+        }
+        operation = [fileName = parser.value("export-boot")](VariableStore &store) {
+            return exportBoot(store, fileName);
+        };
+    } else if (parser.isSet("import-boot")) {
+        QByteArray contents;
+        bootsnapshot::Snapshot snapshot;
+        if (!readFile(parser.value("import-boot"), &contents, &error)
+            || !bootsnapshot::deserialize(contents, &snapshot, &error)) {
+            printError(error);
+            return EXIT_FAILURE;
+        }
+        operation = [snapshot, dryRun](VariableStore &store) { return importBoot(store, snapshot, dryRun); };
+    } else if (parser.isSet("apply")) {
+        QByteArray contents;
+        desiredstate::State state;
+        if (!readFile(parser.value("apply"), &contents, &error) || !desiredstate::parse(contents, &state, &error)) {
+            printError(error);
+            return EXIT_FAILURE;
+        }
+        // Partitions of a virtual machine's disk can't be looked up on the host
+        const desiredstate::PartitionLookup lookup
+            = varsFiles.isEmpty() ? desiredstate::PartitionLookup(desiredstate::lookupPartition)
+                                  : [](const QString &) { return std::optional<desiredstate::PartitionInfo>(); };
+        operation = [state, lookup, dryRun](VariableStore &store) { return applyState(store, state, lookup, dryRun); };
+    } else if (parser.isSet("promote-slot")) {
+        const auto bootCurrent = bootsnapshot::readVariable("BootCurrent");
+        const QList<quint16> numbers
+            = bootCurrent ? bootsnapshot::decodeUint16List(bootCurrent->data) : QList<quint16>();
+        if (!varsFiles.isEmpty() || numbers.isEmpty()) {
+            printError(QObject::tr("--promote-slot needs the BootCurrent variable of a running system."));
+            return EXIT_FAILURE;
+        }
+        operation = [number = numbers.constFirst(), dryRun](VariableStore &store) {
+            return promoteSlot(store, number, dryRun);
+        };
+    } else {
+        return EXIT_FAILURE;
+    }
+    return varsFiles.isEmpty() ? runOnNvram(operation) : runOnFiles(varsFiles, operation);
+}
+
+} // namespace cli
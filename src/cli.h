@@ -0,0 +1,11 @@
+#pragma once
+
+// Command-line operations that run without the GUI (reports, scripted changes)
+namespace cli
+{
+
+// True when the arguments request one of the command-line operations
+[[nodiscard]] bool isCliInvocation(int argc, char *argv[]);
+int run(int argc, char *argv[]);
+
+} // namespace cli
@@ -26,6 +26,9 @@
 #include <QDebug>
 #include <QEventLoop>
 #include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QMessageBox>
 #include <QWidget>
 
@@ -125,6 +128,86 @@ bool Cmd::procAsRoot(const QString &cmd, const QStringList &args, QString *outpu
     return proc(cmd, args, output, input, quiet, Elevation::Yes);
 }
 
+// Run several commands with a single elevation; stops at the first failing command
+bool Cmd::procAsRootBatch(const QList<QStringList> &commands, QString *output, QuietMode quiet)
+{
+    if (commands.isEmpty()) {
+        return true;
+    }
+
+    QJsonArray batch;
+    for (const QStringList &command : commands) {
+        batch.append(QJsonArray::fromStringList(command));
+    }
+    if (quiet == QuietMode::No) {
+        qDebug() << "batch" << commands;
+    }
+    const QByteArray input = QJsonDocument(batch).toJson(QJsonDocument::Compact);
+    return helperProc({"batch"}, output, &input, quiet);
+}
+
+bool Cmd::procAsRootEfivars(const QJsonArray &operations, QString *output, QuietMode quiet)
+{
+    if (operations.isEmpty()) {
+        return true;
+    }
+
+    if (quiet == QuietMode::No) {
+        for (const QJsonValue &operation : operations) {
+            qDebug() << "efivar" << operation["op"].toString() << operation["name"].toString();
+        }
+    }
+    const QByteArray input = QJsonDocument(operations).toJson(QJsonDocument::Compact);
+    return helperProc({"efivar"}, output, &input, quiet);
+}
+
+// Runs one of the helper's read-only parsers (see blockreader.h); output is a JSON object keyed by device
+bool Cmd::procAsRootRead(const QString &reader, const QStringList &devices, QString *output, QuietMode quiet)
+{
+    if (quiet == QuietMode::No) {
+        qDebug() << reader << devices;
+    }
+    return helperProc(QStringList {reader} + devices, output, nullptr, quiet);
+}
+
+QMap<QString, QByteArray> Cmd::readFilesAsRoot(const QStringList &paths, QuietMode quiet)
+{
+    QMap<QString, QByteArray> files;
+    if (paths.isEmpty()) {
+        return files;
+    }
+    if (quiet == QuietMode::No) {
+        qDebug() << "file" << paths;
+    }
+    QString out;
+    if (!helperProc(QStringList {"file"} + paths, &out, nullptr, quiet)) {
+        return files;
+    }
+    const QJsonObject results = QJsonDocument::fromJson(out.toUtf8()).object();
+    for (auto it = results.constBegin(); it != results.constEnd(); ++it) {
+        const QJsonObject result = it.value().toObject();
+        if (result.contains("data")) {
+            files.insert(it.key(), QByteArray::fromBase64(result.value("data").toString().toLatin1()));
+        } else {
+            qDebug() << "Could not read" << it.key() << result.value("error").toString();
+        }
+    }
+    return files;
+}
+
+bool Cmd::procAsRootUnlock(const QList<QPair<QString, QString>> &targets, const QByteArray &passphrase,
+                           QString *output, QuietMode quiet)
+{
+    QStringList helperArgs {"unlock"};
+    for (const auto &[device, name] : targets) {
+        helperArgs << device << name;
+    }
+    if (quiet == QuietMode::No) {
+        qDebug() << helperArgs;
+    }
+    return helperProc(helperArgs, output, &passphrase, quiet);
+}
+
 bool Cmd::helperProc(const QStringList &helperArgs, QString *output, const QByteArray *input, QuietMode quiet)
 {
     if (elevationFailed) {
@@ -169,6 +252,10 @@ bool Cmd::procElevated(const QString &cmd, const QStringList &args, QString *out
 void Cmd::handleElevationError()
 {
     elevationFailed = true;
+    if (!qobject_cast<QApplication *>(QCoreApplication::instance())) {
+        qWarning().noquote() << tr("This operation requires administrator privileges.");
+        return;
+    }
     QWidget *parentWidget = qobject_cast<QWidget *>(qApp->activeWindow());
     QMessageBox::critical(parentWidget, tr("Administrator Access Required"),
                           tr("This operation requires administrator privileges."));
@@ -21,6 +21,8 @@
  **********************************************************************/
 #pragma once
 
+#include <QJsonArray>
+#include <QMap>
 #include <QProcess>
 
 class QTextStream;
@@ -37,6 +39,17 @@ public:
               const QByteArray *input = nullptr, QuietMode quiet = QuietMode::No, Elevation elevation = Elevation::No);
     bool procAsRoot(const QString &cmd, const QStringList &args = {}, QString *output = nullptr,
                     const QByteArray *input = nullptr, QuietMode quiet = QuietMode::No);
+    bool procAsRootBatch(const QList<QStringList> &commands, QString *output = nullptr,
+                         QuietMode quiet = QuietMode::No);
+    bool procAsRootEfivars(const QJsonArray &operations, QString *output = nullptr, QuietMode quiet = QuietMode::No);
+    bool procAsRootRead(const QString &reader, const QStringList &devices, QString *output = nullptr,
+                        QuietMode quiet = QuietMode::No);
+    // Raw contents of files only root may read, by path, through the helper's file action; files that
+    // could not be read are left out
+    QMap<QString, QByteArray> readFilesAsRoot(const QStringList &paths, QuietMode quiet = QuietMode::Yes);
+    // Opens each (device, mapping name) pair with the same passphrase, all at once
+    bool procAsRootUnlock(const QList<QPair<QString, QString>> &targets, const QByteArray &passphrase,
+                          QString *output = nullptr, QuietMode quiet = QuietMode::No);
     bool procElevated(const QString &cmd, const QStringList &args = {}, QString *output = nullptr,
                       QuietMode quiet = QuietMode::No);
     const QString &helperLibraryPath() const { return helperLibrary; }
@@ -28,6 +28,16 @@
 inline constexpr QLatin1StringView ESP_GUID_GPT("c12a7328-f81f-11d2-ba4b-00a0c93ec93b");
 inline constexpr QLatin1StringView ESP_TYPE_MBR("0xef");
 
+// efivarfs mount and the GUID of the EFI global variables (Boot####, BootOrder, ...)
+inline constexpr QLatin1StringView EFIVARS_DIR("/sys/firmware/efi/efivars");
+inline constexpr QLatin1StringView EFI_GLOBAL_GUID("8be4df61-93ca-11d2-aa0d-00e098032b8c");
+
+// Whether the system booted through UEFI and efivarfs lists its variables; defined in main.cpp
+[[nodiscard]] bool isUefi();
+
+// Exit code of the helper's efivar action when a variable changed since it was read; nothing was written
+inline constexpr int EXIT_CODE_CONFLICT = 3;
+
 // Base directory for temporary mounts
 inline constexpr QLatin1StringView MOUNT_BASE("/mnt/uefi-manager");
 
@@ -0,0 +1,331 @@
+#include "desiredstate.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QObject>
+#include <QSet>
+#include <QUuid>
+
+#include <algorithm>
+
+#include "loadoption.h"
+
+namespace desiredstate
+{
+
+namespace
+{
+constexpr quint64 SYSFS_SECTOR_SIZE = 512;
+
+struct ExistingEntry {
+    quint16 number = 0;
+    loadoption::LoadOption option;
+    std::optional<loadoption::HardDriveMedia> media;
+    bool claimed = false;
+};
+
+quint64 readSysfsNumber(const QString &path, bool *ok)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        *ok = false;
+        return 0;
+    }
+    return file.readAll().trimmed().toULongLong(ok);
+}
+
+bool matches(const ExistingEntry &entry, const EntrySpec &spec, bool compareLabel)
+{
+    return !entry.claimed && entry.media && entry.media->partuuid == spec.partuuid
+           && entry.media->loaderPath.compare(spec.loader, Qt::CaseInsensitive) == 0
+           && (!compareLabel || entry.option.description == spec.label);
+}
+
+// The optional data an existing entry should hold: the spec's options, unless it gives none or the
+// entry's data is binary (e.g. the BCD object of Windows Boot Manager), which is never rewritten as text
+QByteArray optionalData(const loadoption::LoadOption &option, const EntrySpec &spec)
+{
+    bool isText = false;
+    const QString options = loadoption::optionalDataToString(option.optionalData, &isText);
+    if (!spec.options || !isText || options == *spec.options) {
+        return option.optionalData;
+    }
+    return loadoption::optionalDataFromString(*spec.options);
+}
+
+bool isUpToDate(const loadoption::LoadOption &option, const EntrySpec &spec)
+{
+    return option.description == spec.label && option.isActive() == spec.active
+           && optionalData(option, spec) == option.optionalData;
+}
+
+quint32 withActiveFlag(quint32 attributes, bool active)
+{
+    return active ? attributes | loadoption::LOAD_OPTION_ACTIVE : attributes & ~loadoption::LOAD_OPTION_ACTIVE;
+}
+
+void setVariable(bootsnapshot::Snapshot *snapshot, const bootsnapshot::Variable &var)
+{
+    for (bootsnapshot::Variable &existing : snapshot->variables) {
+        if (existing.name == var.name) {
+            existing = var;
+            return;
+        }
+    }
+    snapshot->variables.append(var);
+}
+} // namespace
+
+bool parse(const QByteArray &json, State *state, QString *error)
+{
+    auto fail = [error](const QString &message) {
+        if (error) {
+            *error = message;
+        }
+        return false;
+    };
+
+    QJsonParseError parseError;
+    const QJsonDocument doc = QJsonDocument::fromJson(json, &parseError);
+    if (!doc.isObject()) {
+        return fail(QObject::tr("Invalid state file: %1").arg(parseError.errorString()));
+    }
+    const QJsonObject root = doc.object();
+
+    State result;
+    result.prune = root.value("prune").toBool(false);
+    if (root.contains("timeout")) {
+        const int timeout = root.value("timeout").toInt(-1);
+        if (timeout < 0 || timeout > 0xffff) {
+            return fail(QObject::tr("The timeout must be a number of seconds between 0 and 65535."));
+        }
+        result.timeout = timeout;
+    }
+
+    const QJsonArray entries = root.value("entries").toArray();
+    QSet<QString> labels;
+    for (const QJsonValue &value : entries) {
+        const QJsonObject object = value.toObject();
+        EntrySpec spec;
+        spec.label = object.value("label").toString().trimmed();
+        spec.loader = loadoption::normalizeLoaderPath(object.value("loader").toString());
+        spec.partuuid = object.value("partuuid").toString().trimmed().toLower();
+        if (object.contains("options")) {
+            spec.options = object.value("options").toString();
+        }
+        spec.active = object.value("active").toBool(true);
+        if (object.contains("partition")) {
+            const QJsonObject partition = object.value("partition").toObject();
+            const PartitionInfo info {static_cast<quint32>(partition.value("number").toInteger(0)),
+                                      static_cast<quint64>(partition.value("start").toInteger(0)),
+                                      static_cast<quint64>(partition.value("size").toInteger(0))};
+            if (info.number == 0 || info.size == 0) {
+                return fail(QObject::tr("Entry \"%1\" needs a partition number and size.").arg(spec.label));
+            }
+            spec.partition = info;
+        }
+        if (spec.label.isEmpty() || object.value("loader").toString().trimmed().isEmpty()) {
+            return fail(QObject::tr("Every entry needs a label and a loader path."));
+        }
+        if (QUuid::fromString(spec.partuuid).isNull()) {
+            return fail(QObject::tr("Entry \"%1\" has an invalid PARTUUID: %2").arg(spec.label, spec.partuuid));
+        }
+        if (labels.contains(spec.label)) {
+            return fail(QObject::tr("Duplicate entry label: %1").arg(spec.label));
+        }
+        labels.insert(spec.label);
+        result.entries.append(spec);
+    }
+    *state = result;
+    return true;
+}
+
+std::optional<PartitionInfo> lookupPartition(const QString &partuuid)
+{
+    const QString device = QFileInfo("/dev/disk/by-partuuid/" + partuuid.toLower()).canonicalFilePath();
+    if (device.isEmpty()) {
+        return std::nullopt;
+    }
+    // /sys/class/block/<part> links into the directory of its disk
+    const QString partitionDir = QFileInfo("/sys/class/block/" + QFileInfo(device).fileName()).canonicalFilePath();
+    if (partitionDir.isEmpty()) {
+        return std::nullopt;
+    }
+    const QString diskDir = QFileInfo(partitionDir).path();
+
+    bool ok = true;
+    bool blockSizeOk = true;
+    PartitionInfo info;
+    info.number = static_cast<quint32>(readSysfsNumber(partitionDir + "/partition", &ok));
+    const quint64 start = ok ? readSysfsNumber(partitionDir + "/start", &ok) : 0;
+    const quint64 size = ok ? readSysfsNumber(partitionDir + "/size", &ok) : 0;
+    quint64 blockSize = readSysfsNumber(diskDir + "/queue/logical_block_size", &blockSizeOk);
+    if (!ok || info.number == 0) {
+        return std::nullopt;
+    }
+    if (!blockSizeOk || blockSize == 0) {
+        blockSize = SYSFS_SECTOR_SIZE;
+    }
+    // sysfs counts 512-byte sectors, the HD() node counts logical blocks
+    info.start = start * SYSFS_SECTOR_SIZE / blockSize;
+    info.size = size * SYSFS_SECTOR_SIZE / blockSize;
+    return info;
+}
+
+bool plan(const bootsnapshot::Snapshot &current, const State &state, const PartitionLookup &lookup,
+          bootsnapshot::Snapshot *target, QString *error)
+{
+    bootsnapshot::Snapshot result = current;
+
+    QList<ExistingEntry> existing;
+    QSet<quint16> usedNumbers;
+    for (const bootsnapshot::Variable &var : current.variables) {
+        bool ok = false;
+        const quint16 number = var.name.mid(4).toUShort(&ok, 16);
+        if (!var.name.startsWith("Boot") || var.name.size() != 8 || !ok) {
+            continue;
+        }
+        usedNumbers.insert(number);
+        const auto option = loadoption::decode(var.data);
+        if (option) {
+            existing.append({number, *option, loadoption::hardDriveMedia(option->filePathList)});
+        }
+    }
+
+    auto claim = [&existing](const EntrySpec &spec) -> ExistingEntry * {
+        for (bool compareLabel : {true, false}) {
+            for (ExistingEntry &entry : existing) {
+                if (matches(entry, spec, compareLabel)) {
+                    entry.claimed = true;
+                    return &entry;
+                }
+            }
+        }
+        return nullptr;
+    };
+
+    QList<quint16> desiredOrder;
+    quint16 nextNumber = 0;
+    for (const EntrySpec &spec : state.entries) {
+        if (ExistingEntry *entry = claim(spec)) {
+            desiredOrder.append(entry->number);
+            if (isUpToDate(entry->option, spec)) {
+                continue;
+            }
+            loadoption::LoadOption option = entry->option;
+            option.description = spec.label;
+            option.attributes = withActiveFlag(option.attributes, spec.active);
+            option.optionalData = optionalData(entry->option, spec);
+            const bootsnapshot::Variable *var = current.find(bootsnapshot::bootVariableName(entry->number));
+            setVariable(&result, {var->name, var->attributes, loadoption::encode(option)});
+            continue;
+        }
+
+        const std::optional<PartitionInfo> partition = spec.partition ? spec.partition : lookup(spec.partuuid);
+        if (!partition) {
+            if (error) {
+                *error = QObject::tr("No partition found with PARTUUID %1 for entry \"%2\"")
+                             .arg(spec.partuuid, spec.label);
+            }
+            return false;
+        }
+        while (usedNumbers.contains(nextNumber)) {
+            if (nextNumber == 0xffff) {
+                if (error) {
+                    *error = QObject::tr("No free boot entry number left.");
+                }
+                return false;
+            }
+            ++nextNumber;
+        }
+        usedNumbers.insert(nextNumber);
+        loadoption::LoadOption option;
+        option.attributes = withActiveFlag(0, spec.active);
+        option.description = spec.label;
+        option.filePathList = loadoption::hardDriveFilePath(
+            {partition->number, partition->start, partition->size, spec.partuuid, spec.loader});
+        option.optionalData = loadoption::optionalDataFromString(spec.options.value_or(QString()));
+        setVariable(&result, {bootsnapshot::bootVariableName(nextNumber), bootsnapshot::BOOT_VARIABLE_ATTRIBUTES,
+                              loadoption::encode(option)});
+        desiredOrder.append(nextNumber);
+    }
+
+    QSet<quint16> removed;
+    if (state.prune) {
+        for (const ExistingEntry &entry : std::as_const(existing)) {
+            if (!entry.claimed && entry.media) {
+                removed.insert(entry.number);
+                const QString name = bootsnapshot::bootVariableName(entry.number);
+                result.variables.removeIf([&name](const bootsnapshot::Variable &var) { return var.name == name; });
+            }
+        }
+    }
+
+    // Listed entries first, then whatever else was already in BootOrder
+    const bootsnapshot::Variable *bootOrder = current.find("BootOrder");
+    QList<quint16> order = desiredOrder;
+    if (bootOrder) {
+        for (quint16 number : bootsnapshot::decodeUint16List(bootOrder->data)) {
+            if (!order.contains(number) && !removed.contains(number)) {
+                order.append(number);
+            }
+        }
+    }
+    const QByteArray orderData = bootsnapshot::encodeUint16List(order);
+    if (order.isEmpty()) {
+        result.variables.removeIf([](const bootsnapshot::Variable &var) { return var.name == "BootOrder"; });
+    } else if (!bootOrder || bootOrder->data != orderData) {
+        setVariable(&result,
+                    {"BootOrder", bootOrder ? bootOrder->attributes : bootsnapshot::BOOT_VARIABLE_ATTRIBUTES, orderData});
+    }
+
+    if (state.timeout) {
+        const bootsnapshot::Variable *timeout = current.find("Timeout");
+        const QByteArray timeoutData = bootsnapshot::encodeUint16List({static_cast<quint16>(*state.timeout)});
+        if (!timeout || timeout->data != timeoutData) {
+            setVariable(&result,
+                        {"Timeout", timeout ? timeout->attributes : bootsnapshot::BOOT_VARIABLE_ATTRIBUTES, timeoutData});
+        }
+    }
+
+    std::sort(result.variables.begin(), result.variables.end(),
+              [](const bootsnapshot::Variable &a, const bootsnapshot::Variable &b) { return a.name < b.name; });
+    *target = result;
+    return true;
+}
+
+std::optional<bootsnapshot::Change> editEntry(const bootsnapshot::Variable &var, const QString &description,
+                                              const QString &options, QString *error)
+{
+    auto fail = [error](const QString &message) {
+        if (error) {
+            *error = message;
+        }
+        return std::nullopt;
+    };
+
+    const std::optional<loadoption::LoadOption> option = loadoption::decode(var.data);
+    if (!option) {
+        return fail(QObject::tr("Could not read boot entry %1.").arg(var.name));
+    }
+    loadoption::LoadOption edited = *option;
+    edited.description = description.trimmed();
+    if (edited.description.isEmpty()) {
+        return fail(QObject::tr("The description can't be empty."));
+    }
+    // Unchanged text keeps its bytes, so an ASCII command line or a trailing NUL survive editing the description
+    EntrySpec spec;
+    spec.options = options.trimmed();
+    edited.optionalData = optionalData(*option, spec);
+    const QByteArray data = loadoption::encode(edited);
+    if (data == var.data) {
+        return std::nullopt;
+    }
+    return bootsnapshot::Change {bootsnapshot::Change::Kind::Write, {var.name, var.attributes, data},
+                                 bootsnapshot::version(&var)};
+}
+
+} // namespace desiredstate
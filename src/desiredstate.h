@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+#include <functional>
+#include <optional>
+
+#include "bootsnapshot.h"
+
+// Declarative boot configuration: the entries a machine should have, in order,
+// and the changes needed to get there from the current NVRAM contents
+namespace desiredstate
+{
+
+// GPT partition geometry needed for the HD() node of a new entry
+struct PartitionInfo {
+    quint32 number = 0;
+    quint64 start = 0; // in logical blocks
+    quint64 size = 0;
+};
+
+struct EntrySpec {
+    QString label;
+    QString loader;   // e.g. \EFI\MX\grubx64.efi
+    QString partuuid; // ESP holding the loader, lowercase
+    // Optional data, written as UCS-2 like efibootmgr --unicode; nullopt keeps what the entry has
+    std::optional<QString> options;
+    bool active = true;
+    // Geometry given in the state file, for disks this machine can't see (e.g. virtual machine images)
+    std::optional<PartitionInfo> partition;
+};
+
+struct State {
+    QList<EntrySpec> entries; // in boot order, ahead of any entry the state doesn't list
+    std::optional<int> timeout;
+    bool prune = false; // delete disk entries (HD + File paths) the state doesn't list
+};
+
+using PartitionLookup = std::function<std::optional<PartitionInfo>(const QString &partuuid)>;
+
+[[nodiscard]] bool parse(const QByteArray &json, State *state, QString *error = nullptr);
+
+// Looks the partition up through /dev/disk/by-partuuid and sysfs
+[[nodiscard]] std::optional<PartitionInfo> lookupPartition(const QString &partuuid);
+
+// Builds the variables the machine should end up with. Entries that already match a
+// spec keep their number and their bytes, so applying the same state twice writes nothing.
+[[nodiscard]] bool plan(const bootsnapshot::Snapshot &current, const State &state, const PartitionLookup &lookup,
+                        bootsnapshot::Snapshot *target, QString *error = nullptr);
+
+// The write that gives a Boot#### variable a new description and, when its optional data is text, new options.
+// It carries the variable's version, so the helper refuses it if another program changed the entry since.
+// nullopt with error set for an entry that can't be decoded or an empty description, and with error left
+// empty when nothing would change.
+[[nodiscard]] std::optional<bootsnapshot::Change> editEntry(const bootsnapshot::Variable &var,
+                                                            const QString &description, const QString &options,
+                                                            QString *error = nullptr);
+
+} // namespace desiredstate
@@ -0,0 +1,194 @@
+#include "devicepath.h"
+
+#include <QJsonObject>
+#include <QRegularExpression>
+
+namespace devicepath
+{
+
+namespace
+{
+NodeType nodeType(QStringView name)
+{
+    static const QHash<QString, NodeType> types {
+        {"HD", NodeType::HardDrive},   {"File", NodeType::File},     {"PciRoot", NodeType::PciRoot},
+        {"PcieRoot", NodeType::PciRoot}, {"Pci", NodeType::Pci},     {"NVMe", NodeType::NVMe},
+        {"Sata", NodeType::Sata},      {"USB", NodeType::Usb},       {"UsbClass", NodeType::Usb},
+        {"MAC", NodeType::Mac},        {"IPv4", NodeType::IPv4},     {"Uri", NodeType::Uri},
+        {"VenHw", NodeType::Vendor},   {"VenMsg", NodeType::Vendor}, {"VenMedia", NodeType::Vendor},
+        {"Vendor", NodeType::Vendor},
+    };
+    return types.value(name.toString(), NodeType::Other);
+}
+
+// Split on '/' outside of parentheses; Uri() arguments contain slashes
+QList<QStringView> splitNodes(QStringView text)
+{
+    QList<QStringView> nodes;
+    int depth = 0;
+    qsizetype start = 0;
+    for (qsizetype i = 0; i < text.size(); ++i) {
+        const QChar c = text.at(i);
+        if (c == '(') {
+            ++depth;
+        } else if (c == ')') {
+            depth = qMax(0, depth - 1);
+        } else if (c == '/' && depth == 0) {
+            if (i > start) {
+                nodes.append(text.mid(start, i - start));
+            }
+            start = i + 1;
+        }
+    }
+    if (start < text.size()) {
+        nodes.append(text.mid(start));
+    }
+    return nodes;
+}
+
+// Old efibootmgr versions append the optional data right after the last node,
+// so find the parenthesis closing the node instead of the last one in the text
+qsizetype closingParen(QStringView segment, qsizetype open)
+{
+    int depth = 0;
+    for (qsizetype i = open; i < segment.size(); ++i) {
+        if (segment.at(i) == '(') {
+            ++depth;
+        } else if (segment.at(i) == ')' && --depth == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+QString formatMac(const QString &hex)
+{
+    QString mac;
+    for (qsizetype i = 0; i + 1 < hex.size(); i += 2) {
+        if (!mac.isEmpty()) {
+            mac += ':';
+        }
+        mac += hex.mid(i, 2).toLower();
+    }
+    return mac;
+}
+
+quint64 toNumber(const QString &value)
+{
+    bool ok = false;
+    const quint64 number = value.toULongLong(&ok, 0);
+    return ok ? number : 0;
+}
+} // namespace
+
+DevicePath parse(QStringView text)
+{
+    static const QRegularExpression whitespaceRegex("\\s");
+    DevicePath path;
+    const QList<QStringView> segments = splitNodes(text.trimmed());
+    for (const QStringView segment : segments) {
+        Node node;
+        const qsizetype open = segment.indexOf('(');
+        const qsizetype close = open > 0 ? closingParen(segment, open) : -1;
+        if (open > 0 && close > open) {
+            node.name = segment.left(open).toString();
+            node.type = nodeType(node.name);
+            const QString inner = segment.mid(open + 1, close - open - 1).toString();
+            // Uri and File arguments are single values that may contain commas
+            if (node.type == NodeType::Uri || node.type == NodeType::File) {
+                node.args = {inner};
+            } else {
+                node.args = inner.split(',');
+            }
+        } else if (segment.startsWith('\\')) {
+            // Newer efibootmgr prints the media path without the File() wrapper
+            node.name = QStringLiteral("File");
+            node.type = NodeType::File;
+            node.args = {segment.toString().section(whitespaceRegex, 0, 0)};
+        } else {
+            node.name = segment.toString();
+        }
+
+        switch (node.type) {
+        case NodeType::HardDrive:
+            if (node.args.size() >= 3) {
+                HardDrive hd;
+                hd.partition = node.args.at(0).toInt();
+                hd.scheme = node.args.at(1).toUpper();
+                hd.signature = node.args.at(2).toLower();
+                hd.start = node.args.size() > 3 ? toNumber(node.args.at(3)) : 0;
+                hd.size = node.args.size() > 4 ? toNumber(node.args.at(4)) : 0;
+                path.hardDrive = hd;
+            }
+            break;
+        case NodeType::File:
+            path.file = node.args.value(0);
+            break;
+        case NodeType::NVMe:
+        case NodeType::Sata:
+        case NodeType::Usb:
+            path.bus = node.name;
+            break;
+        case NodeType::Pci:
+        case NodeType::PciRoot:
+            if (path.bus.isEmpty()) {
+                path.bus = QStringLiteral("PCI");
+            }
+            break;
+        case NodeType::Mac:
+            path.macAddress = formatMac(node.args.value(0));
+            break;
+        case NodeType::Uri:
+            path.uri = node.args.value(0);
+            break;
+        case NodeType::Vendor:
+            path.vendor = node.args.value(0).toLower();
+            break;
+        case NodeType::IPv4:
+        case NodeType::Other:
+            break;
+        }
+        path.nodes.append(node);
+    }
+    return path;
+}
+
+QString pathFromEntryLine(const QString &line)
+{
+    // efibootmgr separates label and device path with a tab
+    const qsizetype tab = line.indexOf('\t');
+    if (tab != -1) {
+        return line.mid(tab + 1).trimmed();
+    }
+
+    // Older versions use spaces; look for the first known node instead
+    static const QRegularExpression firstNodeRegex(
+        R"((?:HD|PciRoot|PcieRoot|Acpi|VenHw|VenMsg|VenMedia|Vendor|Fv|FvFile|MAC|Uri|BBS|USB|Sata|NVMe|File)\()");
+    const QRegularExpressionMatch match = firstNodeRegex.match(line);
+    return match.hasMatch() ? line.mid(match.capturedStart()).trimmed() : QString();
+}
+
+void PartuuidIndex::build(const QJsonArray &blockDevices)
+{
+    index.clear();
+    index.reserve(blockDevices.size());
+    for (const QJsonValue &val : blockDevices) {
+        const QJsonObject dev = val.toObject();
+        const QString partuuid = dev.value("partuuid").toString().toLower();
+        if (partuuid.isEmpty()) {
+            continue;
+        }
+        QString path = dev.value("path").toString();
+        if (path.isEmpty()) {
+            path = "/dev/" + dev.value("name").toString();
+        }
+        index.insert(partuuid, path);
+    }
+}
+
+QString PartuuidIndex::device(const QString &partuuid) const
+{
+    return index.value(partuuid.toLower());
+}
+
+} // namespace devicepath
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <QHash>
+#include <QJsonArray>
+#include <QList>
+#include <QStringList>
+
+#include <optional>
+
+namespace devicepath
+{
+
+enum class NodeType { HardDrive, File, PciRoot, Pci, NVMe, Sata, Usb, Mac, IPv4, Uri, Vendor, Other };
+
+struct Node {
+    NodeType type = NodeType::Other;
+    QString name; // node name as printed by efibootmgr, e.g. "HD" or "VenHw"
+    QStringList args;
+};
+
+// Partition addressed by an HD() node
+struct HardDrive {
+    int partition = 0;
+    QString scheme;    // "GPT" or "MBR"
+    QString signature; // lowercase PARTUUID for GPT, MBR disk signature otherwise
+    quint64 start = 0;
+    quint64 size = 0;
+};
+
+struct DevicePath {
+    QList<Node> nodes;
+    std::optional<HardDrive> hardDrive;
+    QString file;       // loader path from the File() node, e.g. \EFI\MX\grubx64.efi
+    QString bus;        // last bus node before the media node, e.g. "NVMe" or "USB"
+    QString macAddress; // for network boot entries
+    QString uri;        // for HTTP boot entries
+    QString vendor;     // vendor GUID for VenHw/VenMsg/VenMedia nodes
+
+    [[nodiscard]] bool isEmpty() const { return nodes.isEmpty(); }
+    [[nodiscard]] bool isNetwork() const { return !macAddress.isEmpty() || !uri.isEmpty(); }
+};
+
+// Parse the textual device path printed by efibootmgr for a boot entry, e.g.
+// "HD(1,GPT,<guid>,0x800,0x100000)/File(\EFI\MX\grubx64.efi)"
+[[nodiscard]] DevicePath parse(QStringView text);
+
+// Extract the device path part of an efibootmgr "BootXXXX* Label<TAB>path" line
+[[nodiscard]] QString pathFromEntryLine(const QString &line);
+
+// PARTUUID -> /dev partition lookup, built once from lsblk JSON output
+class PartuuidIndex
+{
+public:
+    void build(const QJsonArray &blockDevices);
+    void clear() { index.clear(); }
+    [[nodiscard]] QString device(const QString &partuuid) const;
+    [[nodiscard]] bool isEmpty() const { return index.isEmpty(); }
+
+private:
+    QHash<QString, QString> index;
+};
+
+} // namespace devicepath
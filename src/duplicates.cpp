@@ -0,0 +1,162 @@
+#include "duplicates.h"
+
+#include <QHash>
+#include <QRegularExpression>
+#include <QSet>
+
+#include <algorithm>
+
+#include "loadoption.h"
+
+namespace duplicates
+{
+
+namespace
+{
+struct Entry {
+    quint16 number = 0;
+    loadoption::LoadOption option;
+};
+
+QList<Entry> bootEntries(const bootsnapshot::Snapshot &snapshot)
+{
+    static const QRegularExpression bootEntryRegex("^Boot([0-9A-F]{4})$");
+    QList<Entry> entries;
+    for (const bootsnapshot::Variable &var : snapshot.variables) {
+        const QRegularExpressionMatch match = bootEntryRegex.match(var.name);
+        if (!match.hasMatch()) {
+            continue;
+        }
+        if (auto option = loadoption::decode(var.data)) {
+            entries.append({static_cast<quint16>(match.captured(1).toUShort(nullptr, 16)), *std::move(option)});
+        }
+    }
+    return entries;
+}
+
+QList<quint16> bootOrder(const bootsnapshot::Snapshot &snapshot)
+{
+    const bootsnapshot::Variable *order = snapshot.find("BootOrder");
+    return order ? bootsnapshot::decodeUint16List(order->data) : QList<quint16> {};
+}
+
+// Ordered entries rank by position, the rest after them by number
+qsizetype rank(const QList<quint16> &order, quint16 number)
+{
+    const qsizetype pos = order.indexOf(number);
+    return pos < 0 ? order.size() + number : pos;
+}
+
+QByteArray keyOf(const loadoption::LoadOption &option, bool includeOptionalData)
+{
+    QByteArray key;
+    if (const auto media = loadoption::hardDriveMedia(option.filePathList)) {
+        key = "hd:" + media->partuuid.toUtf8() + ':' + loadoption::normalizeLoaderPath(media->loaderPath).toLower().toUtf8();
+    } else {
+        key = "dp:" + option.filePathList.toHex();
+    }
+    if (includeOptionalData) {
+        key += "|" + option.optionalData.toHex();
+    }
+    return key;
+}
+} // namespace
+
+QByteArray entryKey(const QByteArray &loadOption, bool includeOptionalData)
+{
+    const auto option = loadoption::decode(loadOption);
+    return option ? keyOf(*option, includeOptionalData) : QByteArray {};
+}
+
+QList<Group> findDuplicates(const bootsnapshot::Snapshot &snapshot, bool includeOptionalData)
+{
+    const QList<quint16> order = bootOrder(snapshot);
+
+    QHash<QByteArray, QList<Entry>> byKey;
+    QList<QByteArray> keys; // first-seen order keeps the result stable
+    for (Entry &entry : bootEntries(snapshot)) {
+        const QByteArray key = keyOf(entry.option, includeOptionalData);
+        auto &group = byKey[key];
+        if (group.isEmpty()) {
+            keys.append(key);
+        }
+        group.append(std::move(entry));
+    }
+
+    QList<Group> groups;
+    for (const QByteArray &key : std::as_const(keys)) {
+        QList<Entry> &entries = byKey[key];
+        if (entries.size() < 2) {
+            continue;
+        }
+        std::sort(entries.begin(), entries.end(),
+                  [&order](const Entry &a, const Entry &b) { return rank(order, a.number) < rank(order, b.number); });
+        Group group {entries.constFirst().number, {}, entries.constFirst().option.description};
+        for (qsizetype i = 1; i < entries.size(); ++i) {
+            group.remove.append(entries.at(i).number);
+        }
+        groups.append(group);
+    }
+    std::sort(groups.begin(), groups.end(),
+              [&order](const Group &a, const Group &b) { return rank(order, a.keep) < rank(order, b.keep); });
+    return groups;
+}
+
+bootsnapshot::Snapshot withoutEntries(const bootsnapshot::Snapshot &snapshot, const QList<quint16> &numbers)
+{
+    QSet<QString> names;
+    for (quint16 number : numbers) {
+        names.insert(bootsnapshot::bootVariableName(number));
+    }
+
+    bootsnapshot::Snapshot result = snapshot;
+    result.variables.removeIf([&names](const bootsnapshot::Variable &var) { return names.contains(var.name); });
+
+    const bootsnapshot::Variable *next = snapshot.find("BootNext");
+    const QList<quint16> nextValue = next ? bootsnapshot::decodeUint16List(next->data) : QList<quint16> {};
+    if (!nextValue.isEmpty() && numbers.contains(nextValue.constFirst())) {
+        result.variables.removeIf([](const bootsnapshot::Variable &var) { return var.name == "BootNext"; });
+    }
+
+    QList<quint16> order = bootOrder(snapshot);
+    if (order.removeIf([&numbers](quint16 number) { return numbers.contains(number); }) > 0) {
+        for (bootsnapshot::Variable &var : result.variables) {
+            if (var.name == "BootOrder") {
+                var.data = bootsnapshot::encodeUint16List(order);
+            }
+        }
+        if (order.isEmpty()) {
+            result.variables.removeIf([](const bootsnapshot::Variable &var) { return var.name == "BootOrder"; });
+        }
+    }
+    return result;
+}
+
+std::optional<quint16> findEntry(const bootsnapshot::Snapshot &snapshot, const QString &partuuid,
+                                 const QString &loader, const QString &options)
+{
+    const QList<quint16> order = bootOrder(snapshot);
+    const QString wantedLoader = loadoption::normalizeLoaderPath(loader);
+    std::optional<quint16> found;
+    qsizetype foundRank = 0;
+    for (const Entry &entry : bootEntries(snapshot)) {
+        const auto media = loadoption::hardDriveMedia(entry.option.filePathList);
+        if (!media || media->partuuid.compare(partuuid, Qt::CaseInsensitive) != 0
+            || loadoption::normalizeLoaderPath(media->loaderPath).compare(wantedLoader, Qt::CaseInsensitive) != 0) {
+            continue;
+        }
+        bool isText = false;
+        const QString entryOptions = loadoption::optionalDataToString(entry.option.optionalData, &isText);
+        if (!isText || entryOptions.trimmed() != options.trimmed()) {
+            continue;
+        }
+        const qsizetype entryRank = rank(order, entry.number);
+        if (!found || entryRank < foundRank) {
+            found = entry.number;
+            foundRank = entryRank;
+        }
+    }
+    return found;
+}
+
+} // namespace duplicates
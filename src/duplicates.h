@@ -0,0 +1,35 @@
+#pragma once
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+#include <optional>
+
+#include "bootsnapshot.h"
+
+// Groups Boot#### entries that point at the same loader so repeated installs can be cleaned up
+namespace duplicates
+{
+
+// Identity of an entry: partition and loader path (case-insensitive) for disk entries,
+// the raw device path otherwise, plus the optional data when includeOptionalData is set
+[[nodiscard]] QByteArray entryKey(const QByteArray &loadOption, bool includeOptionalData);
+
+struct Group {
+    quint16 keep = 0; // first in BootOrder, or the lowest number when none is ordered
+    QList<quint16> remove;
+    QString description; // of the kept entry
+};
+
+[[nodiscard]] QList<Group> findDuplicates(const bootsnapshot::Snapshot &snapshot, bool includeOptionalData = true);
+
+// snapshot without the given entries; they are also dropped from BootOrder, and BootNext goes if it named one
+[[nodiscard]] bootsnapshot::Snapshot withoutEntries(const bootsnapshot::Snapshot &snapshot,
+                                                    const QList<quint16> &numbers);
+
+// Existing entry for loader on the partition with exactly these options, preferring the first in BootOrder
+[[nodiscard]] std::optional<quint16> findEntry(const bootsnapshot::Snapshot &snapshot, const QString &partuuid,
+                                               const QString &loader, const QString &options);
+
+} // namespace duplicates
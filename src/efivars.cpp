@@ -0,0 +1,146 @@
+#include "efivars.h"
+
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QRegularExpression>
+#include <QSettings>
+#include <QStorageInfo>
+
+#include <algorithm>
+
+namespace efivars
+{
+
+namespace
+{
+// efivarfs file names are "<Name>-<GUID>"
+constexpr qsizetype GUID_LENGTH = 36;
+// Authenticated variable header kept by the firmware for each variable
+constexpr qint64 VARIABLE_HEADER_SIZE = 60;
+// Keep some space free for the firmware's own variables and garbage collection
+constexpr qint64 MINIMUM_MARGIN = 8 * 1024;
+} // namespace
+
+QString machineId()
+{
+    QFile file("/etc/machine-id");
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return QStringLiteral("unknown");
+    }
+    const QString id = QString::fromLatin1(file.readAll()).trimmed();
+    return id.isEmpty() ? QStringLiteral("unknown") : id;
+}
+
+StoreUsage readUsage(const QString &dir, int largestCount)
+{
+    static const QRegularExpression bootEntryRegex("^Boot[0-9A-Fa-f]{4}$");
+
+    StoreUsage usage;
+    QList<Variable> variables;
+    const QFileInfoList files = QDir(dir).entryInfoList(QDir::Files | QDir::Hidden | QDir::System);
+    variables.reserve(files.size());
+    for (const QFileInfo &info : files) {
+        const QString fileName = info.fileName();
+        if (fileName.size() <= GUID_LENGTH + 1) {
+            continue;
+        }
+        Variable var;
+        var.name = fileName.left(fileName.size() - GUID_LENGTH - 1);
+        var.guid = fileName.right(GUID_LENGTH);
+        var.size = qMax<qint64>(0, info.size() - 4);
+        usage.usedBytes += var.size + (var.name.size() + 1) * 2 + VARIABLE_HEADER_SIZE;
+        if (var.guid == EFI_GLOBAL_GUID && bootEntryRegex.match(var.name).hasMatch()) {
+            ++usage.bootEntryCount;
+        }
+        variables.append(var);
+    }
+    usage.variableCount = static_cast<int>(variables.size());
+
+    const auto middle = variables.begin() + qMin<qsizetype>(largestCount, variables.size());
+    std::partial_sort(variables.begin(), middle, variables.end(),
+                      [](const Variable &a, const Variable &b) { return a.size > b.size; });
+    usage.largest = QList<Variable>(variables.begin(), middle);
+
+    // Since Linux 6.7 statfs on efivarfs reports QueryVariableInfo() results
+    const QStorageInfo storage(dir);
+    if (storage.isValid() && storage.bytesTotal() > 0) {
+        usage.totalBytes = storage.bytesTotal();
+        usage.freeBytes = storage.bytesAvailable();
+    }
+    return usage;
+}
+
+QJsonObject toJson(const StoreUsage &usage)
+{
+    QJsonArray largest;
+    for (const Variable &var : usage.largest) {
+        largest.append(QJsonObject {{"name", var.name}, {"guid", var.guid}, {"size", var.size}});
+    }
+    QJsonObject report {
+        {"used_bytes", usage.usedBytes},
+        {"variable_count", usage.variableCount},
+        {"boot_entry_count", usage.bootEntryCount},
+        {"largest_variables", largest},
+        {"nvram_writes", static_cast<qint64>(writeCount())},
+    };
+    if (usage.isCapacityKnown()) {
+        report.insert("total_bytes", usage.totalBytes);
+        report.insert("free_bytes", usage.freeBytes);
+    }
+    return report;
+}
+
+qint64 estimateLoadOptionSize(const QString &label, const QString &loaderPath, const QString &optionalData)
+{
+    // Attributes + path list length, UCS-2 description, HD() + File() + end nodes, UCS-2 options
+    constexpr qint64 fixedSize = 4 + 2;
+    constexpr qint64 hardDriveNodeSize = 42;
+    constexpr qint64 fileNodeHeaderSize = 4;
+    constexpr qint64 endNodeSize = 4;
+    const qint64 optionSize = fixedSize + (label.size() + 1) * 2 + hardDriveNodeSize + fileNodeHeaderSize
+                              + (loaderPath.size() + 1) * 2 + endNodeSize + optionalData.size() * 2;
+    return optionSize + (QStringLiteral("Boot0000").size() + 1) * 2 + VARIABLE_HEADER_SIZE;
+}
+
+std::optional<bool> hasHeadroom(const StoreUsage &usage, qint64 neededBytes)
+{
+    if (!usage.isCapacityKnown()) {
+        return std::nullopt; // nothing to go by on older kernels and some firmware
+    }
+    const qint64 margin = qMax(MINIMUM_MARGIN, usage.totalBytes / 20);
+    return usage.freeBytes - neededBytes >= margin;
+}
+
+quint64 writeCount()
+{
+    return QSettings().value("nvramWrites/" + machineId(), 0).toULongLong();
+}
+
+void recordWrites(int count)
+{
+    if (count <= 0) {
+        return;
+    }
+    QSettings settings;
+    const QString key = "nvramWrites/" + machineId();
+    settings.setValue(key, settings.value(key, 0).toULongLong() + static_cast<quint64>(count));
+}
+
+int variableWrites(const QStringList &efibootmgrArgs)
+{
+    int writes = 0;
+    for (const QString &arg : efibootmgrArgs) {
+        if (arg == "-c" || arg == "--create" || arg == "-B" || arg == "--delete-bootnum") {
+            writes += 2; // the entry itself plus BootOrder
+        } else if (arg == "-o" || arg == "--bootorder" || arg == "-O" || arg == "--delete-bootorder" || arg == "-n"
+                   || arg == "--bootnext" || arg == "-N" || arg == "--delete-bootnext" || arg == "-t"
+                   || arg == "--timeout" || arg == "-T" || arg == "--delete-timeout" || arg == "-a"
+                   || arg == "--active" || arg == "-A" || arg == "--inactive") {
+            ++writes;
+        }
+    }
+    return writes;
+}
+
+} // namespace efivars
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <QJsonObject>
+#include <QList>
+#include <QStringList>
+
+#include <optional>
+
+#include "common.h"
+
+namespace efivars
+{
+
+struct Variable {
+    QString name;
+    QString guid;
+    qint64 size = 0; // data size, without the 4-byte attribute prefix efivarfs adds
+};
+
+struct StoreUsage {
+    qint64 usedBytes = 0;  // estimated space taken in the firmware store, headers included
+    qint64 totalBytes = 0; // reported by the kernel through statfs (0 when unknown)
+    qint64 freeBytes = 0;
+    int variableCount = 0;
+    int bootEntryCount = 0;
+    QList<Variable> largest;
+
+    [[nodiscard]] bool isCapacityKnown() const { return totalBytes > 0; }
+};
+
+[[nodiscard]] StoreUsage readUsage(const QString &dir = EFIVARS_DIR, int largestCount = 10);
+[[nodiscard]] QJsonObject toJson(const StoreUsage &usage);
+
+// Rough size of a new Boot#### variable holding an EFI_LOAD_OPTION
+[[nodiscard]] qint64 estimateLoadOptionSize(const QString &label, const QString &loaderPath,
+                                            const QString &optionalData = {});
+// nullopt when the kernel doesn't report the store's capacity, so headroom can't be told
+[[nodiscard]] std::optional<bool> hasHeadroom(const StoreUsage &usage, qint64 neededBytes);
+
+// Contents of /etc/machine-id, keys per-machine settings
+[[nodiscard]] QString machineId();
+
+// Persisted count of NVRAM variable writes issued by this tool on this machine
+[[nodiscard]] quint64 writeCount();
+void recordWrites(int count);
+// Number of variables an efibootmgr invocation writes or deletes
+[[nodiscard]] int variableWrites(const QStringList &efibootmgrArgs);
+
+} // namespace efivars
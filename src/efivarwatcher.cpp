@@ -0,0 +1,85 @@
+#include "efivarwatcher.h"
+
+#include <QDir>
+#include <QFile>
+#include <QRegularExpression>
+
+namespace
+{
+const QRegularExpression watchedRegex("^(Boot[0-9A-F]{4}|BootOrder|BootNext|Timeout)$");
+} // namespace
+
+EfivarWatcher::EfivarWatcher(const QString &efivarsDir, QObject *parent)
+    : QObject(parent),
+      dir(efivarsDir)
+{
+    timer.setInterval(3000);
+    connect(&timer, &QTimer::timeout, this, &EfivarWatcher::poll);
+}
+
+void EfivarWatcher::start()
+{
+    baseline = scan(dir);
+    timer.start();
+}
+
+EfivarWatcher::Fingerprints EfivarWatcher::scan(const QString &dir)
+{
+    Fingerprints fingerprints;
+    const QString suffix = "-" + QString(EFI_GLOBAL_GUID);
+    const QFileInfoList files = QDir(dir).entryInfoList({"Boot*" + suffix, "Timeout" + suffix},
+                                                        QDir::Files | QDir::Hidden | QDir::System);
+    for (const QFileInfo &info : files) {
+        const QString name = info.fileName().chopped(suffix.size());
+        if (!watchedRegex.match(name).hasMatch()) {
+            continue;
+        }
+        // Boot variables are a few hundred bytes, reading them is cheaper than missing a same-size edit
+        QFile file(info.filePath());
+        if (!file.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+        const QByteArray contents = file.readAll();
+        fingerprints.insert(name, {contents.size(), qHash(contents, 0)});
+    }
+    return fingerprints;
+}
+
+QStringList EfivarWatcher::changedNames(const Fingerprints &before, const Fingerprints &after)
+{
+    QStringList names;
+    for (auto it = after.cbegin(); it != after.cend(); ++it) {
+        const auto previous = before.constFind(it.key());
+        if (previous == before.cend() || previous.value() != it.value()) {
+            names.append(it.key());
+        }
+    }
+    for (auto it = before.cbegin(); it != before.cend(); ++it) {
+        if (!after.contains(it.key())) {
+            names.append(it.key());
+        }
+    }
+    names.sort();
+    return names;
+}
+
+void EfivarWatcher::poll()
+{
+    Fingerprints current = scan(dir);
+    const QStringList names = changedNames(baseline, current);
+    baseline = std::move(current);
+    if (names.isEmpty()) {
+        return;
+    }
+
+    QStringList entries;
+    bool globalsChanged = false;
+    for (const QString &name : names) {
+        if (name == "BootOrder" || name == "BootNext" || name == "Timeout") {
+            globalsChanged = true;
+        } else {
+            entries.append(name.mid(4));
+        }
+    }
+    emit changed(entries, globalsChanged);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QStringList>
+#include <QTimer>
+
+#include "common.h"
+
+// Polls the Boot####, BootOrder, BootNext and Timeout variables in efivarfs and
+// reports which of them changed since the last poll, so views can be patched
+// instead of rebuilt when another tool edits NVRAM.
+class EfivarWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Fingerprint {
+        qint64 size = 0;
+        size_t hash = 0;
+
+        bool operator==(const Fingerprint &other) const = default;
+    };
+    using Fingerprints = QHash<QString, Fingerprint>; // keyed by variable name
+
+    explicit EfivarWatcher(const QString &efivarsDir = EFIVARS_DIR, QObject *parent = nullptr);
+
+    void setInterval(int msec) { timer.setInterval(msec); }
+    void start();
+    void stop() { timer.stop(); }
+    [[nodiscard]] bool isActive() const { return timer.isActive(); }
+
+    [[nodiscard]] static Fingerprints scan(const QString &dir);
+    // Names whose fingerprint differs, was added or was removed
+    [[nodiscard]] static QStringList changedNames(const Fingerprints &before, const Fingerprints &after);
+
+public slots:
+    void poll();
+
+signals:
+    // entries holds the changed boot numbers ("0001"); globalsChanged covers BootOrder, BootNext and Timeout
+    void changed(const QStringList &entries, bool globalsChanged);
+
+private:
+    QString dir;
+    Fingerprints baseline;
+    QTimer timer;
+};
@@ -0,0 +1,464 @@
+#include "fatfs.h"
+
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QObject>
+#include <QtEndian>
+
+#include <algorithm>
+#include <array>
+
+namespace fatfs
+{
+
+namespace
+{
+// BIOS parameter block in the boot sector
+constexpr qsizetype BOOT_SECTOR_SIZE = 512;
+constexpr qsizetype BYTES_PER_SECTOR_OFFSET = 11;
+constexpr qsizetype SECTORS_PER_CLUSTER_OFFSET = 13;
+constexpr qsizetype RESERVED_SECTORS_OFFSET = 14;
+constexpr qsizetype FAT_COUNT_OFFSET = 16;
+constexpr qsizetype ROOT_ENTRY_COUNT_OFFSET = 17;
+constexpr qsizetype TOTAL_SECTORS_16_OFFSET = 19;
+constexpr qsizetype FAT_SIZE_16_OFFSET = 22;
+constexpr qsizetype TOTAL_SECTORS_32_OFFSET = 32;
+constexpr qsizetype FAT_SIZE_32_OFFSET = 36;
+constexpr qsizetype ROOT_CLUSTER_OFFSET = 44;
+constexpr qsizetype BOOT_SIGNATURE_OFFSET = 510;
+
+// The cluster count alone decides the FAT type
+constexpr quint32 MAX_FAT12_CLUSTERS = 4084;
+constexpr quint32 MAX_FAT16_CLUSTERS = 65524;
+constexpr quint32 FIRST_DATA_CLUSTER = 2;
+constexpr quint32 FAT32_CLUSTER_MASK = 0x0fffffff;
+
+// Directory entries
+constexpr qsizetype DIR_ENTRY_SIZE = 32;
+constexpr qsizetype ATTR_OFFSET = 11;
+constexpr qsizetype NT_CASE_OFFSET = 12;
+constexpr qsizetype CLUSTER_HIGH_OFFSET = 20;
+constexpr qsizetype CLUSTER_LOW_OFFSET = 26;
+constexpr qsizetype SIZE_OFFSET = 28;
+constexpr quint8 ATTR_VOLUME_ID = 0x08;
+constexpr quint8 ATTR_DIRECTORY = 0x10;
+constexpr quint8 ATTR_LONG_NAME = 0x0f;
+constexpr quint8 NT_LOWER_BASE = 0x08;
+constexpr quint8 NT_LOWER_EXT = 0x10;
+constexpr uchar END_OF_DIRECTORY = 0x00;
+constexpr uchar DELETED = 0xe5;
+constexpr uchar ESCAPED_E5 = 0x05;
+
+// Long file name entries: 13 UCS-2 characters each, last one first
+constexpr uchar LFN_LAST = 0x40;
+constexpr uchar LFN_SEQUENCE_MASK = 0x1f;
+constexpr qsizetype LFN_CHECKSUM_OFFSET = 13;
+constexpr std::array<qsizetype, 13> LFN_CHAR_OFFSETS {1, 3, 5, 7, 9, 14, 16, 18, 20, 22, 24, 28, 30};
+
+// Keep a corrupt volume from making the scan read or list without end
+constexpr quint64 MAX_FAT_BYTES = 64 * 1024 * 1024;
+constexpr quint64 MAX_DIRECTORY_BYTES = 2 * 1024 * 1024;
+constexpr qsizetype MAX_TREE_ENTRIES = 10000;
+constexpr int MAX_DEPTH = 16;
+
+struct Volume {
+    Type type = Type::Fat32;
+    quint32 clusterSize = 0;
+    quint32 clusterCount = 0;
+    quint64 rootDirOffset = 0; // FAT12/16 fixed root directory
+    quint32 rootDirBytes = 0;
+    quint32 rootCluster = 0; // FAT32
+    quint64 dataOffset = 0;
+    QByteArray fat; // the first copy
+};
+
+struct DirEntry {
+    QString name;
+    bool isDirectory = false;
+    bool isLabel = false;
+    quint32 size = 0;
+    quint32 cluster = 0;
+};
+
+bool fail(QString *error, const QString &message)
+{
+    if (error) {
+        *error = message;
+    }
+    return false;
+}
+
+bool isPowerOfTwo(quint32 value)
+{
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+// FAT entry of a cluster: the next cluster of the chain, 0 when free, a marker at the end
+quint32 fatEntry(const Volume &volume, quint32 cluster)
+{
+    const char *fat = volume.fat.constData();
+    switch (volume.type) {
+    case Type::Fat12: {
+        const quint64 offset = cluster + cluster / 2;
+        if (offset + 2 > quint64(volume.fat.size())) {
+            return 0;
+        }
+        const quint16 pair = qFromLittleEndian<quint16>(fat + offset);
+        return (cluster & 1) ? pair >> 4 : pair & 0x0fff;
+    }
+    case Type::Fat16:
+        return quint64(cluster) * 2 + 2 <= quint64(volume.fat.size()) ? qFromLittleEndian<quint16>(fat + cluster * 2)
+                                                                       : 0;
+    case Type::Fat32:
+        return quint64(cluster) * 4 + 4 <= quint64(volume.fat.size())
+                   ? qFromLittleEndian<quint32>(fat + quint64(cluster) * 4) & FAT32_CLUSTER_MASK
+                   : 0;
+    }
+    return 0;
+}
+
+// End-of-chain and bad cluster markers all lie past the last data cluster
+bool isDataCluster(const Volume &volume, quint32 cluster)
+{
+    return cluster >= FIRST_DATA_CLUSTER && cluster < volume.clusterCount + FIRST_DATA_CLUSTER;
+}
+
+// The contents of a cluster chain, reading runs of consecutive clusters at once
+QByteArray readChain(const Volume &volume, const ByteReader &reader, quint32 first, quint64 maxBytes)
+{
+    QByteArray bytes;
+    quint32 cluster = first;
+    quint32 steps = 0;
+    while (isDataCluster(volume, cluster) && quint64(bytes.size()) < maxBytes) {
+        quint32 run = 1;
+        quint32 next = fatEntry(volume, cluster);
+        while (next == cluster + run && quint64(bytes.size()) + quint64(run + 1) * volume.clusterSize <= maxBytes) {
+            ++run;
+            next = fatEntry(volume, next);
+        }
+        steps += run;
+        if (steps > volume.clusterCount) {
+            break; // a loop in the chain
+        }
+        const quint64 offset = volume.dataOffset + quint64(cluster - FIRST_DATA_CLUSTER) * volume.clusterSize;
+        const QByteArray data = reader(offset, run * volume.clusterSize);
+        if (data.size() != qsizetype(run) * volume.clusterSize) {
+            return {};
+        }
+        bytes += data;
+        cluster = next;
+    }
+    return bytes;
+}
+
+QByteArray readDirectory(const Volume &volume, const ByteReader &reader, quint32 cluster)
+{
+    if (cluster == 0 && volume.type != Type::Fat32) {
+        return reader(volume.rootDirOffset, volume.rootDirBytes);
+    }
+    return readChain(volume, reader, cluster == 0 ? volume.rootCluster : cluster, MAX_DIRECTORY_BYTES);
+}
+
+quint8 shortNameChecksum(const char *name)
+{
+    quint8 sum = 0;
+    for (int i = 0; i < 11; ++i) {
+        sum = static_cast<quint8>(((sum & 1) << 7) + (sum >> 1) + static_cast<quint8>(name[i]));
+    }
+    return sum;
+}
+
+// 8.3 name, lowercased where the NT case flags say so
+QString shortName(const char *entry)
+{
+    QByteArray base = QByteArray(entry, 8).trimmed();
+    if (!base.isEmpty() && static_cast<uchar>(base.at(0)) == ESCAPED_E5) {
+        base[0] = static_cast<char>(DELETED);
+    }
+    QByteArray extension = QByteArray(entry + 8, 3).trimmed();
+    const auto caseFlags = static_cast<quint8>(entry[NT_CASE_OFFSET]);
+    QString name = QString::fromLatin1(base);
+    if (caseFlags & NT_LOWER_BASE) {
+        name = name.toLower();
+    }
+    if (!extension.isEmpty()) {
+        const QString ext = QString::fromLatin1(extension);
+        name += '.' + ((caseFlags & NT_LOWER_EXT) ? ext.toLower() : ext);
+    }
+    return name;
+}
+
+QList<DirEntry> parseDirectory(const QByteArray &bytes)
+{
+    QList<DirEntry> entries;
+    QList<QString> longParts; // by sequence number - 1
+    quint8 longChecksum = 0;
+    for (qsizetype pos = 0; pos + DIR_ENTRY_SIZE <= bytes.size(); pos += DIR_ENTRY_SIZE) {
+        const char *entry = bytes.constData() + pos;
+        const auto first = static_cast<uchar>(entry[0]);
+        if (first == END_OF_DIRECTORY) {
+            break;
+        }
+        const auto attributes = static_cast<quint8>(entry[ATTR_OFFSET]);
+        if (first == DELETED) {
+            longParts.clear();
+            continue;
+        }
+        if ((attributes & 0x3f) == ATTR_LONG_NAME) {
+            const int sequence = first & LFN_SEQUENCE_MASK;
+            if (first & LFN_LAST) {
+                longParts = QList<QString>(sequence);
+                longChecksum = static_cast<quint8>(entry[LFN_CHECKSUM_OFFSET]);
+            }
+            if (sequence == 0 || sequence > longParts.size()) {
+                longParts.clear();
+                continue;
+            }
+            QString part;
+            for (const qsizetype offset : LFN_CHAR_OFFSETS) {
+                const quint16 unit = qFromLittleEndian<quint16>(entry + offset);
+                if (unit == 0 || unit == 0xffff) {
+                    break;
+                }
+                part += QChar(unit);
+            }
+            longParts[sequence - 1] = part;
+            continue;
+        }
+
+        DirEntry dirEntry;
+        dirEntry.isLabel = (attributes & ATTR_VOLUME_ID) != 0;
+        dirEntry.isDirectory = (attributes & ATTR_DIRECTORY) != 0;
+        dirEntry.size = qFromLittleEndian<quint32>(entry + SIZE_OFFSET);
+        dirEntry.cluster = quint32(qFromLittleEndian<quint16>(entry + CLUSTER_HIGH_OFFSET)) << 16
+                           | qFromLittleEndian<quint16>(entry + CLUSTER_LOW_OFFSET);
+        // A long name only belongs to the short entry right after it, with the matching checksum
+        const QString longName = longParts.join(QString());
+        if (!longParts.isEmpty() && !longName.isEmpty() && longChecksum == shortNameChecksum(entry)) {
+            dirEntry.name = longName;
+        } else if (dirEntry.isLabel) {
+            dirEntry.name = QString::fromLatin1(QByteArray(entry, 11)).trimmed();
+        } else {
+            dirEntry.name = shortName(entry);
+        }
+        longParts.clear();
+        if (dirEntry.name != "." && dirEntry.name != "..") {
+            entries.append(dirEntry);
+        }
+    }
+    return entries;
+}
+
+std::optional<Volume> openVolume(const ByteReader &reader, QString *error)
+{
+    const QByteArray boot = reader(0, BOOT_SECTOR_SIZE);
+    if (boot.size() < BOOT_SECTOR_SIZE
+        || qFromLittleEndian<quint16>(boot.constData() + BOOT_SIGNATURE_OFFSET) != 0xaa55) {
+        fail(error, QObject::tr("No FAT boot sector was found."));
+        return std::nullopt;
+    }
+    const char *bpb = boot.constData();
+    const quint32 bytesPerSector = qFromLittleEndian<quint16>(bpb + BYTES_PER_SECTOR_OFFSET);
+    const auto sectorsPerCluster = static_cast<quint8>(bpb[SECTORS_PER_CLUSTER_OFFSET]);
+    const quint32 reservedSectors = qFromLittleEndian<quint16>(bpb + RESERVED_SECTORS_OFFSET);
+    const auto fatCount = static_cast<quint8>(bpb[FAT_COUNT_OFFSET]);
+    const quint32 rootEntryCount = qFromLittleEndian<quint16>(bpb + ROOT_ENTRY_COUNT_OFFSET);
+    const quint16 totalSectors16 = qFromLittleEndian<quint16>(bpb + TOTAL_SECTORS_16_OFFSET);
+    const quint16 fatSize16 = qFromLittleEndian<quint16>(bpb + FAT_SIZE_16_OFFSET);
+    const quint64 totalSectors
+        = totalSectors16 ? totalSectors16 : qFromLittleEndian<quint32>(bpb + TOTAL_SECTORS_32_OFFSET);
+    const quint64 fatSectors = fatSize16 ? fatSize16 : qFromLittleEndian<quint32>(bpb + FAT_SIZE_32_OFFSET);
+    if (bytesPerSector < 512 || bytesPerSector > 4096 || !isPowerOfTwo(bytesPerSector)
+        || !isPowerOfTwo(sectorsPerCluster) || reservedSectors == 0 || fatCount == 0 || fatSectors == 0) {
+        fail(error, QObject::tr("The boot sector does not describe a FAT file system."));
+        return std::nullopt;
+    }
+
+    Volume volume;
+    volume.clusterSize = bytesPerSector * sectorsPerCluster;
+    const quint64 rootDirSectors = (quint64(rootEntryCount) * DIR_ENTRY_SIZE + bytesPerSector - 1) / bytesPerSector;
+    const quint64 firstDataSector = reservedSectors + fatCount * fatSectors + rootDirSectors;
+    if (firstDataSector >= totalSectors) {
+        fail(error, QObject::tr("The FAT file system has no data area."));
+        return std::nullopt;
+    }
+    volume.clusterCount = static_cast<quint32>((totalSectors - firstDataSector) / sectorsPerCluster);
+    if (volume.clusterCount <= MAX_FAT12_CLUSTERS) {
+        volume.type = Type::Fat12;
+    } else if (volume.clusterCount <= MAX_FAT16_CLUSTERS) {
+        volume.type = Type::Fat16;
+    } else {
+        volume.type = Type::Fat32;
+        volume.rootCluster = qFromLittleEndian<quint32>(bpb + ROOT_CLUSTER_OFFSET);
+    }
+    volume.rootDirOffset = (reservedSectors + fatCount * fatSectors) * bytesPerSector;
+    volume.rootDirBytes = rootEntryCount * DIR_ENTRY_SIZE;
+    volume.dataOffset = firstDataSector * bytesPerSector;
+
+    // Only the entries that map clusters; the rest of the last FAT sector is padding
+    const quint64 entryBits = volume.type == Type::Fat12 ? 12 : volume.type == Type::Fat16 ? 16 : 32;
+    const quint64 fatBytes = ((quint64(volume.clusterCount) + FIRST_DATA_CLUSTER) * entryBits + 7) / 8;
+    if (fatBytes > fatSectors * bytesPerSector || fatBytes > MAX_FAT_BYTES) {
+        fail(error, QObject::tr("The FAT is smaller than the volume it maps."));
+        return std::nullopt;
+    }
+    volume.fat = reader(quint64(reservedSectors) * bytesPerSector, static_cast<quint32>(fatBytes));
+    if (volume.fat.size() != qsizetype(fatBytes)) {
+        fail(error, QObject::tr("Could not read the FAT."));
+        return std::nullopt;
+    }
+    return volume;
+}
+
+// Pre-order walk of a directory, so that every directory comes before its contents
+bool walk(const Volume &volume, const ByteReader &reader, quint32 cluster, const QString &path, int depth,
+          QList<Entry> *tree)
+{
+    if (depth > MAX_DEPTH) {
+        return true;
+    }
+    const QList<DirEntry> entries = parseDirectory(readDirectory(volume, reader, cluster));
+    for (const DirEntry &entry : entries) {
+        if (entry.isLabel) {
+            continue;
+        }
+        if (tree->size() >= MAX_TREE_ENTRIES) {
+            return false;
+        }
+        tree->append({path + '/' + entry.name, entry.isDirectory, entry.isDirectory ? 0 : entry.size});
+        if (entry.isDirectory && isDataCluster(volume, entry.cluster)
+            && !walk(volume, reader, entry.cluster, tree->constLast().path, depth + 1, tree)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+QString typeName(Type type)
+{
+    switch (type) {
+    case Type::Fat12:
+        return "fat12";
+    case Type::Fat16:
+        return "fat16";
+    case Type::Fat32:
+        return "fat32";
+    }
+    return {};
+}
+} // namespace
+
+std::optional<Summary> inspect(const ByteReader &reader, QString *error)
+{
+    const auto volume = openVolume(reader, error);
+    if (!volume) {
+        return std::nullopt;
+    }
+
+    Summary summary;
+    summary.type = volume->type;
+    summary.clusterSize = volume->clusterSize;
+    summary.clusterCount = volume->clusterCount;
+    for (quint32 cluster = FIRST_DATA_CLUSTER; cluster < volume->clusterCount + FIRST_DATA_CLUSTER; ++cluster) {
+        if (fatEntry(*volume, cluster) == 0) {
+            ++summary.freeClusters;
+        }
+    }
+
+    const QList<DirEntry> root = parseDirectory(readDirectory(*volume, reader, 0));
+    for (const DirEntry &entry : root) {
+        if (entry.isLabel && summary.label.isEmpty()) {
+            summary.label = entry.name;
+        } else if (entry.isDirectory && entry.name.compare("EFI", Qt::CaseInsensitive) == 0) {
+            const QString path = '/' + entry.name;
+            summary.efiTree.append({path, true, 0});
+            if (isDataCluster(*volume, entry.cluster)
+                && !walk(*volume, reader, entry.cluster, path, 1, &summary.efiTree)) {
+                qWarning() << "Stopped listing the EFI directory after" << summary.efiTree.size() << "entries";
+            }
+        }
+    }
+    return summary;
+}
+
+std::optional<Summary> inspectDevice(const QString &path, QString *error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        fail(error, QObject::tr("Could not open %1: %2").arg(path, file.errorString()));
+        return std::nullopt;
+    }
+    const ByteReader reader = [&file](quint64 offset, quint32 length) -> QByteArray {
+        if (!file.seek(static_cast<qint64>(offset))) {
+            return {};
+        }
+        return file.read(length);
+    };
+    return inspect(reader, error);
+}
+
+quint64 spaceNeeded(const QList<qint64> &sizes, quint32 clusterSize)
+{
+    quint64 total = 0;
+    for (const qint64 size : sizes) {
+        const auto bytes = static_cast<quint64>(std::max<qint64>(size, 0));
+        total += clusterSize ? (bytes + clusterSize - 1) / clusterSize * clusterSize : bytes;
+    }
+    return total;
+}
+
+quint64 spaceInDirectory(const Summary &summary, const QString &dir)
+{
+    QList<qint64> sizes;
+    for (const Entry &entry : summary.efiTree) {
+        if (!entry.isDirectory && entry.path.section('/', 0, -2).compare(dir, Qt::CaseInsensitive) == 0) {
+            sizes.append(entry.size);
+        }
+    }
+    return spaceNeeded(sizes, summary.clusterSize);
+}
+
+QJsonObject toJson(const Summary &summary)
+{
+    QJsonArray tree;
+    for (const Entry &entry : summary.efiTree) {
+        tree.append(QJsonObject {{"path", entry.path}, {"dir", entry.isDirectory}, {"size", qint64(entry.size)}});
+    }
+    return {
+        {"type", typeName(summary.type)},
+        {"label", summary.label},
+        {"clusterSize", qint64(summary.clusterSize)},
+        {"clusterCount", qint64(summary.clusterCount)},
+        {"freeClusters", qint64(summary.freeClusters)},
+        {"efi", tree},
+    };
+}
+
+std::optional<Summary> fromJson(const QJsonObject &object)
+{
+    Summary summary;
+    const QString type = object.value("type").toString();
+    if (type == typeName(Type::Fat12)) {
+        summary.type = Type::Fat12;
+    } else if (type == typeName(Type::Fat16)) {
+        summary.type = Type::Fat16;
+    } else if (type == typeName(Type::Fat32)) {
+        summary.type = Type::Fat32;
+    } else {
+        return std::nullopt;
+    }
+    summary.label = object.value("label").toString();
+    summary.clusterSize = static_cast<quint32>(object.value("clusterSize").toInteger());
+    summary.clusterCount = static_cast<quint32>(object.value("clusterCount").toInteger());
+    summary.freeClusters = static_cast<quint32>(object.value("freeClusters").toInteger());
+    const QJsonArray tree = object.value("efi").toArray();
+    for (const QJsonValue &value : tree) {
+        const QJsonObject entry = value.toObject();
+        summary.efiTree.append({entry.value("path").toString(), entry.value("dir").toBool(),
+                                static_cast<quint32>(entry.value("size").toInteger())});
+    }
+    return summary;
+}
+
+} // namespace fatfs
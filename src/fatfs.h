@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+#include <functional>
+#include <optional>
+
+// Read-only FAT12/16/32 with long file names, enough to check an ESP's free space and list its
+// EFI directory straight from the partition, without mounting it
+namespace fatfs
+{
+
+enum class Type { Fat12, Fat16, Fat32 };
+
+struct Entry {
+    QString path; // from the volume root with forward slashes, e.g. /EFI/BOOT/BOOTX64.EFI
+    bool isDirectory = false;
+    quint32 size = 0;
+
+    bool operator==(const Entry &other) const = default;
+};
+
+struct Summary {
+    Type type = Type::Fat32;
+    QString label;
+    quint32 clusterSize = 0; // bytes
+    quint32 clusterCount = 0;
+    quint32 freeClusters = 0; // counted in the FAT, not the FSInfo hint
+    QList<Entry> efiTree;     // everything under /EFI, parents before their children
+
+    [[nodiscard]] quint64 freeBytes() const { return quint64(freeClusters) * clusterSize; }
+};
+
+// Reads length bytes at offset from the start of the partition; a short result is a read error
+using ByteReader = std::function<QByteArray(quint64 offset, quint32 length)>;
+
+[[nodiscard]] std::optional<Summary> inspect(const ByteReader &reader, QString *error = nullptr);
+// A partition or an image file; needs read access
+[[nodiscard]] std::optional<Summary> inspectDevice(const QString &path, QString *error = nullptr);
+
+// Space the files take once written: each is rounded up to whole clusters
+[[nodiscard]] quint64 spaceNeeded(const QList<qint64> &sizes, quint32 clusterSize);
+// Space freed by deleting the files directly inside dir (e.g. /EFI/MX/stub), matched case-insensitively
+[[nodiscard]] quint64 spaceInDirectory(const Summary &summary, const QString &dir);
+
+[[nodiscard]] QJsonObject toJson(const Summary &summary);
+[[nodiscard]] std::optional<Summary> fromJson(const QJsonObject &object);
+
+} // namespace fatfs
@@ -0,0 +1,468 @@
+#include "gpt.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QObject>
+#include <QSet>
+#include <QUuid>
+#include <QtEndian>
+
+#include <algorithm>
+#include <array>
+
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+
+namespace gpt
+{
+
+namespace
+{
+using CrcTables = std::array<std::array<quint32, 256>, 8>;
+
+// Table 0 is the byte-wise table of the reflected polynomial; table n advances a byte by n more zero bytes
+constexpr CrcTables makeCrcTables()
+{
+    CrcTables tables {};
+    for (quint32 i = 0; i < 256; ++i) {
+        quint32 crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ (0xedb88320U & (0U - (crc & 1U)));
+        }
+        tables[0][i] = crc;
+    }
+    for (quint32 i = 0; i < 256; ++i) {
+        for (size_t t = 1; t < tables.size(); ++t) {
+            tables[t][i] = (tables[t - 1][i] >> 8) ^ tables[0][tables[t - 1][i] & 0xff];
+        }
+    }
+    return tables;
+}
+constexpr CrcTables CRC_TABLES = makeCrcTables();
+
+// GPT header (LBA 1 and the last LBA)
+constexpr char SIGNATURE[] = "EFI PART";
+constexpr qsizetype MIN_HEADER_SIZE = 92;
+constexpr qsizetype HEADER_SIZE_OFFSET = 12;
+constexpr qsizetype HEADER_CRC_OFFSET = 16;
+constexpr qsizetype MY_LBA_OFFSET = 24;
+constexpr qsizetype ALTERNATE_LBA_OFFSET = 32;
+constexpr qsizetype DISK_GUID_OFFSET = 56;
+constexpr qsizetype ENTRIES_LBA_OFFSET = 72;
+constexpr qsizetype ENTRY_COUNT_OFFSET = 80;
+constexpr qsizetype ENTRY_SIZE_OFFSET = 84;
+constexpr qsizetype ENTRIES_CRC_OFFSET = 88;
+
+// GPT partition entry
+constexpr quint32 MIN_ENTRY_SIZE = 128;
+constexpr qsizetype UNIQUE_GUID_OFFSET = 16;
+constexpr qsizetype FIRST_LBA_OFFSET = 32;
+constexpr qsizetype LAST_LBA_OFFSET = 40;
+constexpr qsizetype ATTRIBUTES_OFFSET = 48;
+constexpr qsizetype NAME_OFFSET = 56;
+constexpr qsizetype NAME_CHARS = 36;
+// Far above the usual 128 x 128 bytes; keeps a corrupt header from asking for gigabytes
+constexpr quint64 MAX_ENTRIES_BYTES = 1024 * 1024;
+
+// MBR
+constexpr qsizetype MBR_DISK_SIGNATURE_OFFSET = 440;
+constexpr qsizetype MBR_PARTITIONS_OFFSET = 446;
+constexpr qsizetype MBR_ENTRY_SIZE = 16;
+constexpr qsizetype MBR_BOOT_SIGNATURE_OFFSET = 510;
+constexpr quint8 MBR_TYPE_PROTECTIVE = 0xee;
+// Extended partitions hold a chain of EBRs, one per logical partition
+constexpr std::array<quint8, 3> MBR_TYPES_EXTENDED {0x05, 0x0f, 0x85};
+constexpr quint32 MBR_FIRST_LOGICAL = 5;
+// The kernel gives up on longer chains too; also what stops a chain that loops back on itself
+constexpr int MAX_LOGICAL_PARTITIONS = 128;
+
+struct Header {
+    quint64 alternateLba = 0;
+    quint64 entriesLba = 0;
+    quint32 entryCount = 0;
+    quint32 entrySize = 0;
+    quint32 entriesCrc = 0;
+    QString diskGuid;
+};
+
+struct Copy {
+    Header header;
+    QByteArray entries;
+};
+
+bool fail(QString *error, const QString &message)
+{
+    if (error) {
+        *error = message;
+    }
+    return false;
+}
+
+// Mixed-endian on disk: the first three fields are little-endian
+QString guidString(const char *bytes)
+{
+    const auto *b = reinterpret_cast<const uchar *>(bytes);
+    return QUuid(qFromLittleEndian<quint32>(b), qFromLittleEndian<quint16>(b + 4), qFromLittleEndian<quint16>(b + 6),
+                 b[8], b[9], b[10], b[11], b[12], b[13], b[14], b[15])
+        .toString(QUuid::WithoutBraces);
+}
+
+bool isNullGuid(const char *bytes)
+{
+    return std::all_of(bytes, bytes + 16, [](char c) { return c == 0; });
+}
+
+std::optional<Header> parseHeader(const QByteArray &sector, quint64 lba, quint64 sectorCount)
+{
+    if (sector.size() < MIN_HEADER_SIZE || !sector.startsWith(SIGNATURE)) {
+        return std::nullopt;
+    }
+    const char *data = sector.constData();
+    const quint32 headerSize = qFromLittleEndian<quint32>(data + HEADER_SIZE_OFFSET);
+    if (headerSize < MIN_HEADER_SIZE || headerSize > static_cast<quint32>(sector.size())) {
+        return std::nullopt;
+    }
+    // The CRC covers the header with its own CRC field zeroed
+    QByteArray copy = sector.first(headerSize);
+    qToLittleEndian<quint32>(0, copy.data() + HEADER_CRC_OFFSET);
+    if (crc32(copy) != qFromLittleEndian<quint32>(data + HEADER_CRC_OFFSET)
+        || qFromLittleEndian<quint64>(data + MY_LBA_OFFSET) != lba) {
+        return std::nullopt;
+    }
+
+    Header header;
+    header.alternateLba = qFromLittleEndian<quint64>(data + ALTERNATE_LBA_OFFSET);
+    header.entriesLba = qFromLittleEndian<quint64>(data + ENTRIES_LBA_OFFSET);
+    header.entryCount = qFromLittleEndian<quint32>(data + ENTRY_COUNT_OFFSET);
+    header.entrySize = qFromLittleEndian<quint32>(data + ENTRY_SIZE_OFFSET);
+    header.entriesCrc = qFromLittleEndian<quint32>(data + ENTRIES_CRC_OFFSET);
+    header.diskGuid = guidString(data + DISK_GUID_OFFSET);
+    if (header.entrySize < MIN_ENTRY_SIZE || header.entrySize % 8 != 0
+        || quint64(header.entryCount) * header.entrySize > MAX_ENTRIES_BYTES || header.entriesLba >= sectorCount) {
+        return std::nullopt;
+    }
+    return header;
+}
+
+std::optional<Copy> readCopy(const SectorReader &reader, quint32 sectorSize, quint64 lba, quint64 sectorCount)
+{
+    const auto header = parseHeader(reader(lba, 1), lba, sectorCount);
+    if (!header) {
+        return std::nullopt;
+    }
+    const quint64 bytes = quint64(header->entryCount) * header->entrySize;
+    const auto sectors = static_cast<quint32>((bytes + sectorSize - 1) / sectorSize);
+    if (header->entriesLba + sectors > sectorCount) {
+        return std::nullopt;
+    }
+    const QByteArray entries = reader(header->entriesLba, sectors);
+    if (entries.size() < static_cast<qsizetype>(bytes)) {
+        return std::nullopt;
+    }
+    Copy copy {*header, entries.first(static_cast<qsizetype>(bytes))};
+    if (crc32(copy.entries) != header->entriesCrc) {
+        return std::nullopt;
+    }
+    return copy;
+}
+
+QList<Partition> parseEntries(const Copy &copy)
+{
+    QList<Partition> partitions;
+    for (quint32 i = 0; i < copy.header.entryCount; ++i) {
+        const char *entry = copy.entries.constData() + qsizetype(i) * copy.header.entrySize;
+        if (isNullGuid(entry)) {
+            continue;
+        }
+        Partition partition;
+        partition.number = i + 1;
+        partition.type = guidString(entry);
+        partition.partuuid = guidString(entry + UNIQUE_GUID_OFFSET);
+        partition.start = qFromLittleEndian<quint64>(entry + FIRST_LBA_OFFSET);
+        const quint64 last = qFromLittleEndian<quint64>(entry + LAST_LBA_OFFSET);
+        partition.size = last >= partition.start ? last - partition.start + 1 : 0;
+        partition.attributes = qFromLittleEndian<quint64>(entry + ATTRIBUTES_OFFSET);
+        for (qsizetype c = 0; c < NAME_CHARS; ++c) {
+            const quint16 unit = qFromLittleEndian<quint16>(entry + NAME_OFFSET + c * 2);
+            if (unit == 0) {
+                break;
+            }
+            partition.name += QChar(unit);
+        }
+        partitions.append(partition);
+    }
+    return partitions;
+}
+
+bool hasBootSignature(const QByteArray &sector)
+{
+    return sector.size() >= MBR_BOOT_SIGNATURE_OFFSET + 2
+           && qFromLittleEndian<quint16>(sector.constData() + MBR_BOOT_SIGNATURE_OFFSET) == 0xaa55;
+}
+
+bool isExtended(quint8 type)
+{
+    return std::find(MBR_TYPES_EXTENDED.cbegin(), MBR_TYPES_EXTENDED.cend(), type) != MBR_TYPES_EXTENDED.cend();
+}
+
+Partition mbrPartition(quint32 signature, quint32 number, quint8 type, quint64 start, quint64 size)
+{
+    Partition partition;
+    partition.number = number;
+    partition.type = "0x" + QString::number(type, 16);
+    partition.partuuid = QString("%1-%2").arg(signature, 8, 16, QChar('0')).arg(number, 2, 16, QChar('0'));
+    partition.start = start;
+    partition.size = size;
+    return partition;
+}
+
+// Logical partitions numbered from 5 in chain order, as the kernel does. Each EBR holds a partition
+// relative to itself and a link to the next EBR relative to the start of the extended partition.
+void appendLogicalPartitions(const SectorReader &reader, quint32 signature, quint64 extendedStart, quint32 *number,
+                             Table *table)
+{
+    quint64 ebr = extendedStart;
+    QSet<quint64> visited;
+    for (int i = 0; i < MAX_LOGICAL_PARTITIONS && !visited.contains(ebr); ++i) {
+        visited.insert(ebr);
+        const QByteArray sector = reader(ebr, 1);
+        if (!hasBootSignature(sector)) {
+            return;
+        }
+        std::optional<quint64> next;
+        for (quint32 slot = 0; slot < 4; ++slot) {
+            const char *entry = sector.constData() + MBR_PARTITIONS_OFFSET + slot * MBR_ENTRY_SIZE;
+            const auto type = static_cast<quint8>(entry[4]);
+            const quint32 start = qFromLittleEndian<quint32>(entry + 8);
+            const quint32 size = qFromLittleEndian<quint32>(entry + 12);
+            if (type == 0 || size == 0) {
+                continue;
+            }
+            if (isExtended(type)) {
+                next = next.value_or(extendedStart + start);
+                continue;
+            }
+            table->partitions.append(mbrPartition(signature, (*number)++, type, ebr + start, size));
+        }
+        if (!next) {
+            return;
+        }
+        ebr = *next;
+    }
+}
+
+std::optional<Table> parseMbr(const SectorReader &reader, quint32 sectorSize)
+{
+    const QByteArray sector = reader(0, 1);
+    if (!hasBootSignature(sector)) {
+        return std::nullopt;
+    }
+    const quint32 signature = qFromLittleEndian<quint32>(sector.constData() + MBR_DISK_SIGNATURE_OFFSET);
+    Table table;
+    table.scheme = Scheme::Mbr;
+    table.sectorSize = sectorSize;
+    QList<quint64> extendedStarts;
+    for (quint32 i = 0; i < 4; ++i) {
+        const char *entry = sector.constData() + MBR_PARTITIONS_OFFSET + i * MBR_ENTRY_SIZE;
+        const auto type = static_cast<quint8>(entry[4]);
+        if (type == MBR_TYPE_PROTECTIVE) {
+            return std::nullopt; // a GPT disk whose tables are both damaged
+        }
+        if (type == 0) {
+            continue;
+        }
+        const quint32 start = qFromLittleEndian<quint32>(entry + 8);
+        table.partitions.append(mbrPartition(signature, i + 1, type, start, qFromLittleEndian<quint32>(entry + 12)));
+        if (isExtended(type)) {
+            extendedStarts.append(start);
+        }
+    }
+    quint32 number = MBR_FIRST_LOGICAL;
+    for (quint64 start : std::as_const(extendedStarts)) {
+        appendLogicalPartitions(reader, signature, start, &number, &table);
+    }
+    return table;
+}
+
+quint64 readNumber(const QString &path, bool *ok)
+{
+    QFile file(path);
+    *ok = file.open(QIODevice::ReadOnly);
+    return *ok ? file.readAll().trimmed().toULongLong(ok) : 0;
+}
+} // namespace
+
+const Partition *Table::find(quint32 number) const
+{
+    for (const Partition &partition : partitions) {
+        if (partition.number == number) {
+            return &partition;
+        }
+    }
+    return nullptr;
+}
+
+quint32 crc32(QByteArrayView data, quint32 crc)
+{
+    const CrcTables &t = CRC_TABLES;
+    const auto *p = reinterpret_cast<const uchar *>(data.data());
+    qsizetype n = data.size();
+    crc = ~crc;
+    while (n >= 8) {
+        const quint32 low = qFromLittleEndian<quint32>(p) ^ crc;
+        const quint32 high = qFromLittleEndian<quint32>(p + 4);
+        crc = t[7][low & 0xff] ^ t[6][(low >> 8) & 0xff] ^ t[5][(low >> 16) & 0xff] ^ t[4][low >> 24]
+              ^ t[3][high & 0xff] ^ t[2][(high >> 8) & 0xff] ^ t[1][(high >> 16) & 0xff] ^ t[0][high >> 24];
+        p += 8;
+        n -= 8;
+    }
+    while (n-- > 0) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xff];
+    }
+    return ~crc;
+}
+
+std::optional<Table> read(const SectorReader &reader, quint32 sectorSize, quint64 sectorCount, QString *error)
+{
+    if (sectorSize < 512 || sectorCount < 3) {
+        fail(error, QObject::tr("The disk is too small to hold a partition table."));
+        return std::nullopt;
+    }
+    const auto primary = readCopy(reader, sectorSize, 1, sectorCount);
+    // The primary header says where the backup is; without it, the last sector is where it belongs
+    quint64 backupLba = primary ? primary->header.alternateLba : sectorCount - 1;
+    if (backupLba >= sectorCount || backupLba <= 1) {
+        backupLba = sectorCount - 1;
+    }
+    const auto backup = readCopy(reader, sectorSize, backupLba, sectorCount);
+    if (!primary && !backup) {
+        if (auto mbr = parseMbr(reader, sectorSize)) {
+            return mbr;
+        }
+        fail(error, QObject::tr("No valid partition table was found."));
+        return std::nullopt;
+    }
+
+    const Copy &copy = primary ? *primary : *backup;
+    Table table;
+    table.sectorSize = sectorSize;
+    table.diskGuid = copy.header.diskGuid;
+    table.primaryValid = primary.has_value();
+    table.backupValid = backup.has_value();
+    table.partitions = parseEntries(copy);
+    return table;
+}
+
+std::optional<Table> readDevice(const QString &path, QString *error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        fail(error, QObject::tr("Could not open %1: %2").arg(path, file.errorString()));
+        return std::nullopt;
+    }
+    quint32 sectorSize = 512;
+    quint64 bytes = file.size();
+    struct stat info {};
+    if (::fstat(file.handle(), &info) == 0 && S_ISBLK(info.st_mode)) {
+        int logicalBlockSize = 0;
+        if (::ioctl(file.handle(), BLKSSZGET, &logicalBlockSize) == 0 && logicalBlockSize > 0) {
+            sectorSize = static_cast<quint32>(logicalBlockSize);
+        }
+        if (::ioctl(file.handle(), BLKGETSIZE64, &bytes) != 0) {
+            fail(error, QObject::tr("Could not read the size of %1").arg(path));
+            return std::nullopt;
+        }
+    }
+    const SectorReader reader = [&file, sectorSize](quint64 lba, quint32 count) -> QByteArray {
+        if (!file.seek(static_cast<qint64>(lba * sectorSize))) {
+            return {};
+        }
+        return file.read(qint64(count) * sectorSize);
+    };
+    return read(reader, sectorSize, bytes / sectorSize, error);
+}
+
+std::optional<Location> locate(const QString &partitionName)
+{
+    // /sys/class/block/<partition> links into the directory of its disk
+    const QString dir = QFileInfo("/sys/class/block/" + partitionName.section('/', -1)).canonicalFilePath();
+    if (dir.isEmpty()) {
+        return std::nullopt;
+    }
+    bool ok = false;
+    const quint64 number = readNumber(dir + "/partition", &ok);
+    if (!ok || number == 0) {
+        return std::nullopt;
+    }
+    return Location {QFileInfo(QFileInfo(dir).path()).fileName(), static_cast<quint32>(number)};
+}
+
+QString partitionName(const QString &disk, quint32 number)
+{
+    const QString diskDir = "/sys/block/" + disk;
+    const QStringList children = QDir(diskDir).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString &child : children) {
+        bool ok = false;
+        if (readNumber(diskDir + '/' + child + "/partition", &ok) == number && ok) {
+            return child;
+        }
+    }
+    return {};
+}
+
+QJsonObject toJson(const Table &table)
+{
+    QJsonArray partitions;
+    for (const Partition &partition : table.partitions) {
+        partitions.append(QJsonObject {
+            {"number", static_cast<qint64>(partition.number)},
+            {"type", partition.type},
+            {"partuuid", partition.partuuid},
+            {"start", static_cast<qint64>(partition.start)},
+            {"size", static_cast<qint64>(partition.size)},
+            {"attributes", QString::number(partition.attributes, 16)},
+            {"name", partition.name},
+        });
+    }
+    return {
+        {"scheme", table.scheme == Scheme::Gpt ? "gpt" : "dos"},
+        {"sectorSize", static_cast<qint64>(table.sectorSize)},
+        {"diskGuid", table.diskGuid},
+        {"primaryValid", table.primaryValid},
+        {"backupValid", table.backupValid},
+        {"partitions", partitions},
+    };
+}
+
+std::optional<Table> fromJson(const QJsonObject &object)
+{
+    const QString scheme = object.value("scheme").toString();
+    if (scheme != "gpt" && scheme != "dos") {
+        return std::nullopt;
+    }
+    Table table;
+    table.scheme = scheme == "gpt" ? Scheme::Gpt : Scheme::Mbr;
+    table.sectorSize = static_cast<quint32>(object.value("sectorSize").toInteger(512));
+    table.diskGuid = object.value("diskGuid").toString();
+    table.primaryValid = object.value("primaryValid").toBool();
+    table.backupValid = object.value("backupValid").toBool();
+    const QJsonArray partitions = object.value("partitions").toArray();
+    for (const QJsonValue &value : partitions) {
+        const QJsonObject entry = value.toObject();
+        Partition partition;
+        partition.number = static_cast<quint32>(entry.value("number").toInteger());
+        partition.type = entry.value("type").toString();
+        partition.partuuid = entry.value("partuuid").toString();
+        partition.start = static_cast<quint64>(entry.value("start").toInteger());
+        partition.size = static_cast<quint64>(entry.value("size").toInteger());
+        partition.attributes = entry.value("attributes").toString().toULongLong(nullptr, 16);
+        partition.name = entry.value("name").toString();
+        table.partitions.append(partition);
+    }
+    return table;
+}
+
+} // namespace gpt
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+
+#include <functional>
+#include <optional>
+
+// GUID partition tables (UEFI spec 5.3), read straight from the disk. Both headers and their entry
+// arrays are checked; a damaged primary falls back to the backup at the end of the disk.
+// Disks with a plain MBR instead report its primary partitions and the logical ones of its extended
+// partitions.
+namespace gpt
+{
+
+enum class Scheme { Gpt, Mbr };
+
+struct Partition {
+    quint32 number = 0; // as the kernel numbers it: the entry index + 1, the MBR slot, or 5 up for logical ones
+    QString type;       // lowercase type GUID, or "0x<hex>" for MBR, like lsblk's PARTTYPE
+    QString partuuid;   // lowercase unique GUID, or "<disk signature>-<number>" for MBR
+    quint64 start = 0;  // in logical blocks, as the HD() device path node wants them
+    quint64 size = 0;
+    quint64 attributes = 0;
+    QString name;
+
+    bool operator==(const Partition &other) const = default;
+};
+
+struct Table {
+    Scheme scheme = Scheme::Gpt;
+    quint32 sectorSize = 512;
+    QString diskGuid; // empty for MBR
+    bool primaryValid = false;
+    bool backupValid = false;
+    QList<Partition> partitions; // by number
+
+    [[nodiscard]] const Partition *find(quint32 number) const;
+};
+
+// Reads count logical blocks starting at lba; a short or empty result is a read error
+using SectorReader = std::function<QByteArray(quint64 lba, quint32 count)>;
+
+// CRC-32 as used by GPT and zlib, slice-by-8
+[[nodiscard]] quint32 crc32(QByteArrayView data, quint32 crc = 0);
+
+[[nodiscard]] std::optional<Table> read(const SectorReader &reader, quint32 sectorSize, quint64 sectorCount,
+                                        QString *error = nullptr);
+// A block device (sector size and length from the kernel) or a disk image file; needs read access
+[[nodiscard]] std::optional<Table> readDevice(const QString &path, QString *error = nullptr);
+
+// Disk name and partition number of a partition such as nvme0n1p2, from sysfs
+struct Location {
+    QString disk;
+    quint32 number = 0;
+};
+[[nodiscard]] std::optional<Location> locate(const QString &partitionName);
+// The reverse: the kernel's name for that partition of the disk (e.g. sda1), empty if there is none
+[[nodiscard]] QString partitionName(const QString &disk, quint32 number);
+
+// Transport between the helper, which can open the disks, and the application
+[[nodiscard]] QJsonObject toJson(const Table &table);
+[[nodiscard]] std::optional<Table> fromJson(const QJsonObject &object);
+
+} // namespace gpt
@@ -0,0 +1,106 @@
+#include "kernelinventory.h"
+
+#include <QFile>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <time.h>
+
+namespace
+{
+bool isBootImage(const char *name)
+{
+    const QLatin1StringView view(name);
+    return view.startsWith(QLatin1StringView("vmlinuz")) || view.startsWith(QLatin1StringView("initrd"))
+           || view.startsWith(QLatin1StringView("initramfs")) || view.endsWith(QLatin1StringView("-ucode.img"));
+}
+
+constexpr qint64 NSEC_PER_SEC = 1'000'000'000;
+
+// Nanoseconds since the epoch; nullopt when the directory can't be read
+std::optional<qint64> modificationTime(const QString &dir)
+{
+    struct statx info {};
+    if (dir.isEmpty()
+        || ::statx(AT_FDCWD, QFile::encodeName(dir).constData(), AT_STATX_SYNC_AS_STAT, STATX_MTIME, &info) != 0) {
+        return std::nullopt;
+    }
+    return qint64(info.stx_mtime.tv_sec) * NSEC_PER_SEC + info.stx_mtime.tv_nsec;
+}
+
+qint64 now()
+{
+    timespec time {};
+    ::clock_gettime(CLOCK_REALTIME, &time);
+    return qint64(time.tv_sec) * NSEC_PER_SEC + time.tv_nsec;
+}
+} // namespace
+
+void KernelInventory::setDirectory(const QString &directory, bool isFrugal)
+{
+    const std::optional<qint64> modified = modificationTime(directory);
+    if (directory == dir && isFrugal == frugal && stamp && modified == stamp) {
+        return;
+    }
+    const qint64 started = now();
+    dir = directory;
+    frugal = isFrugal;
+    files = scan(dir);
+    // File systems stamp with a coarse clock, so a change in the second before the scan could leave the
+    // time as it was; such a directory is read again next time
+    stamp = modified && *modified < started - NSEC_PER_SEC ? modified : std::nullopt;
+}
+
+KernelInventory::Kernel KernelInventory::kernel(const QString &version) const
+{
+    Kernel result;
+    result.vmlinuz = file(frugal ? "vmlinuz" : "vmlinuz-" + version);
+    if (!result.vmlinuz.exists()) {
+        result.vmlinuz = file("vmlinuz-linux");
+    }
+
+    const File initrd = file(frugal ? "initrd.gz" : "initrd.img-" + version);
+    const File initramfs = file(frugal ? "initramfs-" : "initramfs-" + version + ".img");
+    if (initrd.exists()) {
+        result.initrd = initrd;
+    } else if (initramfs.exists()) {
+        result.initrd = initramfs;
+    } else {
+        const File archFallback = file("initramfs-linux.img");
+        result.initrd = archFallback.exists() ? archFallback : initramfs;
+    }
+
+    result.amdUcode = file("amd-ucode.img");
+    result.intelUcode = file("intel-ucode.img");
+    return result;
+}
+
+KernelInventory::File KernelInventory::file(const QString &name) const
+{
+    return {dir + '/' + name, files.value(name, -1)};
+}
+
+// One readdir pass, and one statx for each boot image; config-*, System.map-* and the like are skipped
+QHash<QString, qint64> KernelInventory::scan(const QString &dir)
+{
+    QHash<QString, qint64> result;
+    DIR *stream = dir.isEmpty() ? nullptr : ::opendir(QFile::encodeName(dir).constData());
+    if (!stream) {
+        return result;
+    }
+    const int dirFd = ::dirfd(stream);
+    while (const dirent *entry = ::readdir(stream)) {
+        if ((entry->d_type != DT_REG && entry->d_type != DT_LNK && entry->d_type != DT_UNKNOWN)
+            || !isBootImage(entry->d_name)) {
+            continue;
+        }
+        struct statx info {};
+        if (::statx(dirFd, entry->d_name, AT_STATX_SYNC_AS_STAT, STATX_TYPE | STATX_SIZE, &info) == 0
+            && S_ISREG(info.stx_mode)) {
+            result.insert(QFile::decodeName(entry->d_name), static_cast<qint64>(info.stx_size));
+        }
+    }
+    ::closedir(stream);
+    return result;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <QHash>
+#include <QString>
+
+#include <optional>
+
+// The kernels, initrds and microcode images of a boot directory, read in one pass over the
+// directory and read again once the directory's modification time moves. Choosing, sizing and
+// copying a kernel then only looks files up.
+class KernelInventory
+{
+public:
+    struct File {
+        QString path;
+        qint64 size = -1; // -1 when the file does not exist
+
+        [[nodiscard]] bool exists() const { return size >= 0; }
+    };
+
+    // A kernel and the images booted with it
+    struct Kernel {
+        File vmlinuz;    // vmlinuz-<version>, or Arch's vmlinuz-linux
+        File initrd;     // initrd.img-<version>, initramfs-<version>.img or Arch's initramfs-linux.img
+        File amdUcode;   // shared by all the kernels in the directory
+        File intelUcode; // likewise
+    };
+
+    // Scans directory unless it is the one last scanned and hasn't changed since. A frugal
+    // directory holds a single unversioned vmlinuz and initrd.gz.
+    void setDirectory(const QString &directory, bool isFrugal);
+    [[nodiscard]] const QString &directory() const { return dir; }
+    // Paths of missing files are still filled in, for the messages that name them
+    [[nodiscard]] Kernel kernel(const QString &version) const;
+    [[nodiscard]] File file(const QString &name) const;
+
+    // Sizes of the kernel, initrd and microcode files in dir by name, following symlinks
+    [[nodiscard]] static QHash<QString, qint64> scan(const QString &dir);
+
+private:
+    QString dir;
+    bool frugal = false;
+    std::optional<qint64> stamp; // dir's modification time, in ns, when it can be trusted to show changes
+    QHash<QString, qint64> files;
+};
@@ -0,0 +1,213 @@
+#include "kernelslots.h"
+
+#include <QRegularExpression>
+#include <QSet>
+
+#include <algorithm>
+
+#include "loadoption.h"
+
+namespace kernelslots
+{
+
+namespace
+{
+constexpr int HASH_DIGITS = 12;
+
+QList<quint16> bootOrder(const bootsnapshot::Snapshot &snapshot)
+{
+    const bootsnapshot::Variable *order = snapshot.find("BootOrder");
+    return order ? bootsnapshot::decodeUint16List(order->data) : QList<quint16>();
+}
+
+// Replaces, adds or (for empty data) removes a variable, keeping its attributes and the sort order
+void setVariable(bootsnapshot::Snapshot *snapshot, const QString &name, const QByteArray &data)
+{
+    const bootsnapshot::Variable *old = snapshot->find(name);
+    const quint32 attributes = old ? old->attributes : bootsnapshot::BOOT_VARIABLE_ATTRIBUTES;
+    snapshot->variables.removeIf([&name](const bootsnapshot::Variable &var) { return var.name == name; });
+    if (!data.isEmpty()) {
+        snapshot->variables.append({name, attributes, data});
+        std::sort(snapshot->variables.begin(), snapshot->variables.end(),
+                  [](const bootsnapshot::Variable &a, const bootsnapshot::Variable &b) { return a.name < b.name; });
+    }
+}
+
+// Directory part of an ESP path, lowercase for comparisons
+QString dirOf(const QString &path)
+{
+    return path.section('\\', 0, -2).toLower();
+}
+} // namespace
+
+QString slotDir(const QString &distro, QChar letter)
+{
+    return QString("\\EFI\\%1\\slot-%2").arg(distro).arg(letter);
+}
+
+QString hashedName(const QString &base, const QByteArray &sha256, const QString &suffix)
+{
+    const QString name = base + '-' + QString::fromLatin1(sha256.toHex().left(HASH_DIGITS));
+    return suffix.isEmpty() ? name : name + '.' + suffix;
+}
+
+QString label(const QString &name, QChar letter)
+{
+    return QString("%1 (slot %2)").arg(name).arg(letter.toUpper());
+}
+
+QList<Slot> findSlots(const bootsnapshot::Snapshot &snapshot, const QString &distro)
+{
+    const QRegularExpression loaderRegex(
+        "^\\\\EFI\\\\" + (distro.isEmpty() ? QString("[^\\\\]+") : QRegularExpression::escape(distro))
+            + "\\\\slot-([a-z])\\\\vmlinuz-[0-9a-f]+$",
+        QRegularExpression::CaseInsensitiveOption);
+    const QList<quint16> order = bootOrder(snapshot);
+
+    QList<Slot> slotEntries;
+    for (const bootsnapshot::Variable &var : snapshot.variables) {
+        bool ok = false;
+        const quint16 number = var.name.mid(4).toUShort(&ok, 16);
+        if (!var.name.startsWith("Boot") || var.name.size() != 8 || !ok) {
+            continue;
+        }
+        const auto option = loadoption::decode(var.data);
+        const auto media = option ? loadoption::hardDriveMedia(option->filePathList) : std::nullopt;
+        if (!media) {
+            continue;
+        }
+        const QString loader = loadoption::normalizeLoaderPath(media->loaderPath);
+        const QRegularExpressionMatch match = loaderRegex.match(loader);
+        if (!match.hasMatch()) {
+            continue;
+        }
+        Slot slot;
+        slot.letter = match.captured(1).toLower().at(0);
+        slot.bootNumber = number;
+        slot.label = option->description;
+        slot.loader = loader;
+        const qsizetype rank = order.indexOf(number);
+        slot.orderRank = rank < 0 ? order.size() : rank;
+        QStringList kernelOptions;
+        const QStringList words
+            = loadoption::optionalDataToString(option->optionalData).split(' ', Qt::SkipEmptyParts);
+        for (const QString &word : words) {
+            if (word.startsWith("initrd=")) {
+                slot.initrds.append(loadoption::normalizeLoaderPath(word.mid(7)));
+            } else {
+                kernelOptions.append(word);
+            }
+        }
+        slot.kernelOptions = kernelOptions.join(' ');
+        slotEntries.append(slot);
+    }
+    std::sort(slotEntries.begin(), slotEntries.end(),
+              [](const Slot &a, const Slot &b) { return a.letter < b.letter; });
+    return slotEntries;
+}
+
+QChar pickSlot(const QList<Slot> &slotEntries, int slotCount, std::optional<quint16> bootCurrent)
+{
+    slotCount = std::clamp(slotCount, DEFAULT_SLOT_COUNT, MAX_SLOT_COUNT);
+    for (int i = 0; i < slotCount; ++i) {
+        const QChar letter(u'a' + i);
+        const auto hasLetter = [letter](const Slot &slot) { return slot.letter == letter; };
+        if (std::none_of(slotEntries.cbegin(), slotEntries.cend(), hasLetter)) {
+            return letter;
+        }
+    }
+    // Never overwrite the kernel that is running; the default one only when nothing else is left
+    const Slot *best = nullptr;
+    for (const Slot &slot : slotEntries) {
+        if (bootCurrent && slot.bootNumber == *bootCurrent) {
+            continue;
+        }
+        if (!best || slot.orderRank > best->orderRank) {
+            best = &slot;
+        }
+    }
+    return best ? best->letter : QChar(u'a');
+}
+
+QString placeFile(const QString &name, const QString &distro, QChar letter, const QStringList &existingFiles)
+{
+    const QString slotsPrefix = QString("\\EFI\\%1\\slot-").arg(distro).toLower();
+    const QString own = slotDir(distro, letter) + '\\' + name;
+    if (existingFiles.contains(own, Qt::CaseInsensitive)) {
+        return own;
+    }
+    for (const QString &file : existingFiles) {
+        if (file.toLower().startsWith(slotsPrefix) && file.section('\\', -1).compare(name, Qt::CaseInsensitive) == 0) {
+            return file;
+        }
+    }
+    return own;
+}
+
+QString optionsString(const QString &kernelOptions, const QStringList &initrds)
+{
+    QStringList words = kernelOptions.split(' ', Qt::SkipEmptyParts);
+    for (const QString &initrd : initrds) {
+        words.append("initrd=" + initrd);
+    }
+    return words.join(' ');
+}
+
+QStringList unreferencedFiles(const QList<Slot> &slotEntries, const QStringList &existingFiles)
+{
+    QSet<QString> used;
+    QSet<QString> slotDirs;
+    for (const Slot &slot : slotEntries) {
+        used.insert(slot.loader.toLower());
+        slotDirs.insert(dirOf(slot.loader));
+        for (const QString &initrd : slot.initrds) {
+            used.insert(initrd.toLower());
+        }
+    }
+    QStringList unused;
+    for (const QString &file : existingFiles) {
+        if (slotDirs.contains(dirOf(file)) && !used.contains(file.toLower())) {
+            unused.append(file);
+        }
+    }
+    return unused;
+}
+
+bootsnapshot::Snapshot stage(const bootsnapshot::Snapshot &current, std::optional<quint16> existing,
+                             const QByteArray &loadOption, quint16 *number)
+{
+    bootsnapshot::Snapshot target = current;
+    quint16 slotNumber = 0;
+    if (existing) {
+        slotNumber = *existing;
+    } else {
+        while (current.find(bootsnapshot::bootVariableName(slotNumber))) {
+            ++slotNumber;
+        }
+        QList<quint16> order = bootOrder(current);
+        order.append(slotNumber);
+        setVariable(&target, "BootOrder", bootsnapshot::encodeUint16List(order));
+    }
+    setVariable(&target, bootsnapshot::bootVariableName(slotNumber), loadOption);
+    setVariable(&target, "BootNext", bootsnapshot::encodeUint16List({slotNumber}));
+    if (number) {
+        *number = slotNumber;
+    }
+    return target;
+}
+
+bootsnapshot::Snapshot promote(const bootsnapshot::Snapshot &current, quint16 number)
+{
+    bootsnapshot::Snapshot target = current;
+    QList<quint16> order = bootOrder(current);
+    order.removeAll(number);
+    order.prepend(number);
+    setVariable(&target, "BootOrder", bootsnapshot::encodeUint16List(order));
+    if (const bootsnapshot::Variable *bootNext = current.find("BootNext");
+        bootNext && bootsnapshot::decodeUint16List(bootNext->data).value(0, 0xffff) == number) {
+        setVariable(&target, "BootNext", {});
+    }
+    return target;
+}
+
+} // namespace kernelslots
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+#include <optional>
+
+#include "bootsnapshot.h"
+
+// EFI stub installs rotating between slot directories (\EFI\<distro>\slot-a, slot-b, ...), each
+// with its own Boot#### entry. A new kernel is tried through BootNext and only becomes the
+// default when promoted, so rolling back is a BootOrder write. Files are named by content hash,
+// and an initrd or microcode image identical to one in another slot is referenced, not copied.
+namespace kernelslots
+{
+
+inline constexpr int DEFAULT_SLOT_COUNT = 2;
+inline constexpr int MAX_SLOT_COUNT = 26;
+
+struct Slot {
+    QChar letter; // 'a', 'b', ...
+    quint16 bootNumber = 0;
+    QString label;
+    QString loader;      // \EFI\<distro>\slot-<letter>\vmlinuz-<hash>
+    QStringList initrds; // ESP paths from the initrd= options, in order
+    QString kernelOptions; // options without the initrd= ones
+    qsizetype orderRank = 0; // position in BootOrder, past the end when not listed
+};
+
+// \EFI\<distro>\slot-<letter>
+[[nodiscard]] QString slotDir(const QString &distro, QChar letter);
+// <base>-<first 12 hex digits of the SHA-256>[.<suffix>], e.g. initrd-0123456789ab.img
+[[nodiscard]] QString hashedName(const QString &base, const QByteArray &sha256, const QString &suffix = {});
+[[nodiscard]] QString label(const QString &name, QChar letter);
+
+// Slot entries of this distribution (of any, for an empty distro), sorted by slot letter
+[[nodiscard]] QList<Slot> findSlots(const bootsnapshot::Snapshot &snapshot, const QString &distro);
+// A slot without an entry, or else the slot furthest back in BootOrder that isn't BootCurrent
+[[nodiscard]] QChar pickSlot(const QList<Slot> &slotEntries, int slotCount, std::optional<quint16> bootCurrent);
+
+// Where a file named by hash should live for a new kernel in the given slot: an identical
+// file already in any slot directory, or the slot's own directory
+[[nodiscard]] QString placeFile(const QString &name, const QString &distro, QChar letter,
+                                const QStringList &existingFiles);
+// Command line for the stub: the kernel options followed by one initrd= per image
+[[nodiscard]] QString optionsString(const QString &kernelOptions, const QStringList &initrds);
+// Files (ESP paths, backslashes) in slot directories that no slot entry uses any more
+[[nodiscard]] QStringList unreferencedFiles(const QList<Slot> &slotEntries, const QStringList &existingFiles);
+
+// current with the slot's Boot#### (re)written to loadOption: an existing entry keeps its number
+// and place in BootOrder, a new one goes last. BootNext is set to it so it is tried once.
+[[nodiscard]] bootsnapshot::Snapshot stage(const bootsnapshot::Snapshot &current, std::optional<quint16> existing,
+                                           const QByteArray &loadOption, quint16 *number);
+// current with the entry moved to the front of BootOrder and BootNext cleared if it named it
+[[nodiscard]] bootsnapshot::Snapshot promote(const bootsnapshot::Snapshot &current, quint16 number);
+
+} // namespace kernelslots
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <QStringView>
+
+#include <array>
+#include <limits>
+
+// A kernel name parsed once into a sort key: the first <major>.<minor>[.<patch>] in it as integers,
+// and what follows, ordered the way dpkg --compare-versions orders the rest of a version.
+// Parsing and comparing only view the name, so keys can be built ahead of a sort and checked
+// at compile time.
+struct KernelVersion {
+    std::array<quint32, 3> numbers {}; // major, minor, patch
+    QStringView suffix;                // after the patch level, e.g. -28-amd64
+    QStringView text;                  // the whole name, compared as text when it holds no version
+    bool valid = false;
+
+    [[nodiscard]] static constexpr KernelVersion parse(QStringView name);
+    // Negative, zero or positive; names without a version sort after all those with one
+    [[nodiscard]] static constexpr int compare(const KernelVersion &a, const KernelVersion &b);
+    // dpkg's verrevcmp: digit runs compare as numbers, ~ before anything, even the end, letters before other characters
+    [[nodiscard]] static constexpr int compareSuffix(QStringView a, QStringView b);
+
+    friend constexpr bool operator<(const KernelVersion &a, const KernelVersion &b) { return compare(a, b) < 0; }
+    friend constexpr bool operator==(const KernelVersion &a, const KernelVersion &b) { return compare(a, b) == 0; }
+
+private:
+    static constexpr bool isDigit(char16_t c) { return c >= u'0' && c <= u'9'; }
+    static constexpr char16_t at(QStringView text, qsizetype i) { return i < text.size() ? text[i].unicode() : 0; }
+    // Reads the digits at *i, saturating rather than overflowing
+    static constexpr quint32 number(QStringView text, qsizetype *i);
+    static constexpr int order(char16_t c);
+};
+
+constexpr quint32 KernelVersion::number(QStringView text, qsizetype *i)
+{
+    constexpr quint32 max = std::numeric_limits<quint32>::max();
+    quint32 value = 0;
+    for (; isDigit(at(text, *i)); ++*i) {
+        const quint32 digit = at(text, *i) - u'0';
+        value = value > (max - digit) / 10 ? max : value * 10 + digit;
+    }
+    return value;
+}
+
+constexpr KernelVersion KernelVersion::parse(QStringView name)
+{
+    KernelVersion version;
+    version.text = name;
+    for (qsizetype i = 0; i < name.size();) {
+        if (!isDigit(at(name, i))) {
+            ++i;
+            continue;
+        }
+        qsizetype pos = i;
+        const quint32 first = number(name, &pos);
+        if (at(name, pos) != u'.' || !isDigit(at(name, pos + 1))) {
+            i = pos;
+            continue;
+        }
+        ++pos;
+        version.numbers[0] = first;
+        version.numbers[1] = number(name, &pos);
+        if (at(name, pos) == u'.' && isDigit(at(name, pos + 1))) {
+            ++pos;
+            version.numbers[2] = number(name, &pos);
+        }
+        version.suffix = name.sliced(pos);
+        version.valid = true;
+        break;
+    }
+    return version;
+}
+
+constexpr int KernelVersion::order(char16_t c)
+{
+    if (isDigit(c) || c == 0) {
+        return 0;
+    }
+    if ((c >= u'a' && c <= u'z') || (c >= u'A' && c <= u'Z')) {
+        return c;
+    }
+    return c == u'~' ? -1 : c + 0x10000;
+}
+
+constexpr int KernelVersion::compareSuffix(QStringView a, QStringView b)
+{
+    qsizetype i = 0;
+    qsizetype j = 0;
+    while (i < a.size() || j < b.size()) {
+        while ((i < a.size() && !isDigit(at(a, i))) || (j < b.size() && !isDigit(at(b, j)))) {
+            const int diff = order(at(a, i)) - order(at(b, j));
+            if (diff != 0) {
+                return diff;
+            }
+            ++i;
+            ++j;
+        }
+        while (at(a, i) == u'0') {
+            ++i;
+        }
+        while (at(b, j) == u'0') {
+            ++j;
+        }
+        int firstDiff = 0;
+        for (; isDigit(at(a, i)) && isDigit(at(b, j)); ++i, ++j) {
+            if (firstDiff == 0) {
+                firstDiff = at(a, i) - at(b, j);
+            }
+        }
+        if (isDigit(at(a, i))) {
+            return 1;
+        }
+        if (isDigit(at(b, j))) {
+            return -1;
+        }
+        if (firstDiff != 0) {
+            return firstDiff;
+        }
+    }
+    return 0;
+}
+
+constexpr int KernelVersion::compare(const KernelVersion &a, const KernelVersion &b)
+{
+    if (a.valid != b.valid) {
+        return a.valid ? -1 : 1;
+    }
+    if (!a.valid) {
+        for (qsizetype i = 0; i < a.text.size() && i < b.text.size(); ++i) {
+            if (a.text[i] != b.text[i]) {
+                return a.text[i].unicode() - b.text[i].unicode();
+            }
+        }
+        return a.text.size() < b.text.size() ? -1 : (a.text.size() > b.text.size() ? 1 : 0);
+    }
+    for (size_t i = 0; i < a.numbers.size(); ++i) {
+        if (a.numbers[i] != b.numbers[i]) {
+            return a.numbers[i] < b.numbers[i] ? -1 : 1;
+        }
+    }
+    return compareSuffix(a.suffix, b.suffix);
+}
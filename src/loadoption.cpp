@@ -0,0 +1,229 @@
+#include "loadoption.h"
+
+#include <QUuid>
+#include <QtEndian>
+
+#include <algorithm>
+
+namespace loadoption
+{
+
+namespace
+{
+constexpr quint8 MEDIA_DEVICE_PATH = 0x04;
+constexpr quint8 MEDIA_HARDDRIVE = 0x01;
+constexpr quint8 MEDIA_FILEPATH = 0x04;
+constexpr quint8 END_DEVICE_PATH = 0x7f;
+constexpr quint8 END_ENTIRE_DEVICE_PATH = 0xff;
+constexpr qsizetype NODE_HEADER_SIZE = 4;
+constexpr qsizetype HARDDRIVE_NODE_SIZE = 42;
+constexpr quint8 PARTITION_FORMAT_GPT = 0x02;
+constexpr quint8 SIGNATURE_TYPE_GUID = 0x02;
+
+// Reads a UCS-2 string up to its NUL or to end; returns the bytes consumed or -1 without a terminator
+qsizetype readUcs2(const QByteArray &data, qsizetype offset, qsizetype end, QString *text)
+{
+    text->clear();
+    for (qsizetype pos = offset; pos + 1 < end; pos += 2) {
+        const auto unit = qFromLittleEndian<quint16>(data.constData() + pos);
+        if (unit == 0) {
+            return pos + 2 - offset;
+        }
+        text->append(QChar(unit));
+    }
+    return -1;
+}
+
+void appendUcs2(QByteArray *data, const QString &text, bool terminate)
+{
+    for (const QChar ch : text) {
+        const quint16 unit = qToLittleEndian(static_cast<quint16>(ch.unicode()));
+        data->append(reinterpret_cast<const char *>(&unit), 2);
+    }
+    if (terminate) {
+        data->append(2, '\0');
+    }
+}
+
+template <typename T>
+void appendLittleEndian(QByteArray *data, T value)
+{
+    const T le = qToLittleEndian(value);
+    data->append(reinterpret_cast<const char *>(&le), sizeof(T));
+}
+
+void appendNodeHeader(QByteArray *data, quint8 type, quint8 subType, quint16 length)
+{
+    data->append(static_cast<char>(type));
+    data->append(static_cast<char>(subType));
+    appendLittleEndian(data, length);
+}
+
+// EFI_GUID keeps its first three fields little-endian
+QByteArray guidToBytes(const QUuid &uuid)
+{
+    QByteArray bytes;
+    appendLittleEndian(&bytes, uuid.data1);
+    appendLittleEndian(&bytes, uuid.data2);
+    appendLittleEndian(&bytes, uuid.data3);
+    bytes.append(reinterpret_cast<const char *>(uuid.data4), sizeof(uuid.data4));
+    return bytes;
+}
+
+QUuid guidFromBytes(const char *bytes)
+{
+    return QUuid(qFromLittleEndian<quint32>(bytes), qFromLittleEndian<quint16>(bytes + 4),
+                 qFromLittleEndian<quint16>(bytes + 6), static_cast<uchar>(bytes[8]), static_cast<uchar>(bytes[9]),
+                 static_cast<uchar>(bytes[10]), static_cast<uchar>(bytes[11]), static_cast<uchar>(bytes[12]),
+                 static_cast<uchar>(bytes[13]), static_cast<uchar>(bytes[14]), static_cast<uchar>(bytes[15]));
+}
+
+bool isPrintable(const QString &text)
+{
+    return std::all_of(text.cbegin(), text.cend(), [](QChar ch) { return ch.isPrint() || ch == '\t'; });
+}
+} // namespace
+
+std::optional<LoadOption> decode(const QByteArray &data)
+{
+    constexpr qsizetype headerSize = 4 + 2;
+    if (data.size() < headerSize + 2) {
+        return std::nullopt;
+    }
+    LoadOption option;
+    option.attributes = qFromLittleEndian<quint32>(data.constData());
+    const auto pathLength = qFromLittleEndian<quint16>(data.constData() + 4);
+    const qsizetype descriptionSize = readUcs2(data, headerSize, data.size(), &option.description);
+    if (descriptionSize < 0) {
+        return std::nullopt;
+    }
+    const qsizetype pathOffset = headerSize + descriptionSize;
+    if (pathOffset + pathLength > data.size()) {
+        return std::nullopt;
+    }
+    option.filePathList = data.mid(pathOffset, pathLength);
+    option.optionalData = data.mid(pathOffset + pathLength);
+    return option;
+}
+
+QByteArray encode(const LoadOption &option)
+{
+    QByteArray data;
+    appendLittleEndian(&data, option.attributes);
+    appendLittleEndian(&data, static_cast<quint16>(option.filePathList.size()));
+    appendUcs2(&data, option.description, true);
+    data += option.filePathList;
+    data += option.optionalData;
+    return data;
+}
+
+QByteArray hardDriveFilePath(const HardDriveMedia &media)
+{
+    QByteArray path;
+    appendNodeHeader(&path, MEDIA_DEVICE_PATH, MEDIA_HARDDRIVE, HARDDRIVE_NODE_SIZE);
+    appendLittleEndian(&path, media.partition);
+    appendLittleEndian(&path, media.start);
+    appendLittleEndian(&path, media.size);
+    path += guidToBytes(QUuid::fromString(media.partuuid));
+    path.append(static_cast<char>(PARTITION_FORMAT_GPT));
+    path.append(static_cast<char>(SIGNATURE_TYPE_GUID));
+
+    const QString loader = normalizeLoaderPath(media.loaderPath);
+    appendNodeHeader(&path, MEDIA_DEVICE_PATH, MEDIA_FILEPATH,
+                     static_cast<quint16>(NODE_HEADER_SIZE + (loader.size() + 1) * 2));
+    appendUcs2(&path, loader, true);
+
+    appendNodeHeader(&path, END_DEVICE_PATH, END_ENTIRE_DEVICE_PATH, NODE_HEADER_SIZE);
+    return path;
+}
+
+std::optional<HardDriveMedia> hardDriveMedia(const QByteArray &filePathList)
+{
+    HardDriveMedia media;
+    bool hasHardDrive = false;
+    for (qsizetype pos = 0; pos + NODE_HEADER_SIZE <= filePathList.size();) {
+        const auto type = static_cast<quint8>(filePathList.at(pos));
+        const auto subType = static_cast<quint8>(filePathList.at(pos + 1));
+        const auto length = qFromLittleEndian<quint16>(filePathList.constData() + pos + 2);
+        if (length < NODE_HEADER_SIZE || pos + length > filePathList.size() || type == END_DEVICE_PATH) {
+            break;
+        }
+        const char *node = filePathList.constData() + pos;
+        if (type == MEDIA_DEVICE_PATH && subType == MEDIA_HARDDRIVE && length >= HARDDRIVE_NODE_SIZE
+            && static_cast<quint8>(node[41]) == SIGNATURE_TYPE_GUID) {
+            media.partition = qFromLittleEndian<quint32>(node + 4);
+            media.start = qFromLittleEndian<quint64>(node + 8);
+            media.size = qFromLittleEndian<quint64>(node + 16);
+            media.partuuid = guidFromBytes(node + 24).toString(QUuid::WithoutBraces).toLower();
+            hasHardDrive = true;
+        } else if (type == MEDIA_DEVICE_PATH && subType == MEDIA_FILEPATH) {
+            QString part;
+            readUcs2(filePathList, pos + NODE_HEADER_SIZE, pos + length, &part);
+            media.loaderPath += part;
+        }
+        pos += length;
+    }
+    if (!hasHardDrive || media.loaderPath.isEmpty()) {
+        return std::nullopt;
+    }
+    media.loaderPath = normalizeLoaderPath(media.loaderPath);
+    return media;
+}
+
+QString optionalDataToString(const QByteArray &data, bool *ok)
+{
+    auto result = [ok](const QString &text, bool valid) {
+        if (ok) {
+            *ok = valid;
+        }
+        return text;
+    };
+
+    if (data.isEmpty()) {
+        return result({}, true);
+    }
+    // A UCS-2 command line has a zero high byte in every code unit
+    bool isUcs2 = data.size() % 2 == 0;
+    for (qsizetype pos = 1; isUcs2 && pos < data.size(); pos += 2) {
+        isUcs2 = data.at(pos) == '\0';
+    }
+    if (isUcs2) {
+        QString text;
+        for (qsizetype pos = 0; pos + 1 < data.size(); pos += 2) {
+            text.append(QChar(qFromLittleEndian<quint16>(data.constData() + pos)));
+        }
+        while (text.endsWith(QChar::Null)) {
+            text.chop(1);
+        }
+        if (isPrintable(text)) {
+            return result(text, true);
+        }
+    }
+    QString text = QString::fromLatin1(data);
+    while (text.endsWith(QChar::Null)) {
+        text.chop(1);
+    }
+    if (isPrintable(text) && std::all_of(text.cbegin(), text.cend(), [](QChar ch) { return ch.unicode() < 0x80; })) {
+        return result(text, true);
+    }
+    return result({}, false);
+}
+
+QByteArray optionalDataFromString(const QString &text)
+{
+    QByteArray data;
+    appendUcs2(&data, text, false);
+    return data;
+}
+
+QString normalizeLoaderPath(const QString &path)
+{
+    QString normalized = path.trimmed();
+    normalized.replace('/', '\\');
+    if (!normalized.startsWith('\\')) {
+        normalized.prepend('\\');
+    }
+    return normalized;
+}
+
+} // namespace loadoption
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+
+#include <optional>
+
+// Binary EFI_LOAD_OPTION as stored in Boot#### variables (UEFI spec 3.1.3)
+namespace loadoption
+{
+
+inline constexpr quint32 LOAD_OPTION_ACTIVE = 0x1;
+
+struct LoadOption {
+    quint32 attributes = LOAD_OPTION_ACTIVE;
+    QString description;
+    QByteArray filePathList; // raw device path nodes, end node included
+    QByteArray optionalData;
+
+    [[nodiscard]] bool isActive() const { return attributes & LOAD_OPTION_ACTIVE; }
+};
+
+[[nodiscard]] std::optional<LoadOption> decode(const QByteArray &data);
+[[nodiscard]] QByteArray encode(const LoadOption &option);
+
+// GPT partition plus loader file, the path efibootmgr -c writes
+struct HardDriveMedia {
+    quint32 partition = 0;
+    quint64 start = 0; // in logical blocks
+    quint64 size = 0;
+    QString partuuid; // lowercase
+    QString loaderPath;
+};
+
+[[nodiscard]] QByteArray hardDriveFilePath(const HardDriveMedia &media);
+// Reads the HD(GPT) and File() nodes of a device path, if it has both
+[[nodiscard]] std::optional<HardDriveMedia> hardDriveMedia(const QByteArray &filePathList);
+
+// Optional data holding a kernel command line: UCS-2 as written by efibootmgr --unicode,
+// or plain ASCII. ok is false for binary data that should not be edited as text.
+[[nodiscard]] QString optionalDataToString(const QByteArray &data, bool *ok = nullptr);
+[[nodiscard]] QByteArray optionalDataFromString(const QString &text);
+
+// Canonical form of a loader path for comparisons, e.g. \EFI\MX\grubx64.efi
+[[nodiscard]] QString normalizeLoaderPath(const QString &path);
+
+} // namespace loadoption
@@ -0,0 +1,267 @@
+#include "luks.h"
+
+#include <QCryptographicHash>
+#include <QFile>
+#include <QJsonDocument>
+#include <QObject>
+#include <QtEndian>
+
+#include <algorithm>
+#include <array>
+
+namespace luks
+{
+
+namespace
+{
+constexpr char MAGIC[] = "LUKS\xba\xbe";
+constexpr char SECONDARY_MAGIC[] = "SKUL\xba\xbe";
+constexpr qsizetype MAGIC_SIZE = 6;
+constexpr qsizetype VERSION_OFFSET = 6;
+constexpr qsizetype UUID_OFFSET = 168;
+constexpr qsizetype UUID_SIZE = 40;
+
+// LUKS1: a single header, big-endian like LUKS2's binary one
+constexpr qsizetype LUKS1_HEADER_SIZE = 592;
+constexpr qsizetype LUKS1_CIPHER_NAME = 8;
+constexpr qsizetype LUKS1_CIPHER_MODE = 40;
+constexpr qsizetype LUKS1_CIPHER_SIZE = 32;
+constexpr qsizetype LUKS1_PAYLOAD_OFFSET = 104;
+constexpr qsizetype LUKS1_KEYSLOTS = 208;
+constexpr qsizetype LUKS1_KEYSLOT_SIZE = 48;
+constexpr int LUKS1_KEYSLOT_COUNT = 8;
+constexpr quint32 LUKS1_KEYSLOT_ACTIVE = 0x00ac71f3;
+constexpr quint64 LUKS1_SECTOR_SIZE = 512;
+
+// LUKS2: a binary header followed by the JSON metadata, stored twice
+constexpr quint32 LUKS2_BINARY_SIZE = 4096;
+constexpr qsizetype LUKS2_HDR_SIZE = 8;
+constexpr qsizetype LUKS2_SEQID = 16;
+constexpr qsizetype LUKS2_LABEL = 24;
+constexpr qsizetype LUKS2_LABEL_SIZE = 48;
+constexpr qsizetype LUKS2_CHECKSUM_ALG = 72;
+constexpr qsizetype LUKS2_CHECKSUM_ALG_SIZE = 32;
+constexpr qsizetype LUKS2_HDR_OFFSET = 256;
+constexpr qsizetype LUKS2_CSUM = 448;
+constexpr qsizetype LUKS2_CSUM_SIZE = 64;
+// The only header sizes cryptsetup writes, which are also where a secondary header can start
+constexpr std::array<quint64, 9> LUKS2_HEADER_SIZES {0x4000,  0x8000,   0x10000,  0x20000, 0x40000,
+                                                     0x80000, 0x100000, 0x200000, 0x400000};
+
+bool fail(QString *error, const QString &message)
+{
+    if (error) {
+        *error = message;
+    }
+    return false;
+}
+
+// A NUL-terminated field
+QString fixedString(const QByteArray &bytes)
+{
+    const qsizetype end = bytes.indexOf('\0');
+    return QString::fromUtf8(end < 0 ? bytes : bytes.first(end)).trimmed();
+}
+
+std::optional<Header> parseLuks1(const QByteArray &bytes)
+{
+    if (bytes.size() < LUKS1_HEADER_SIZE) {
+        return std::nullopt;
+    }
+    Header header;
+    header.version = 1;
+    header.uuid = fixedString(bytes.mid(UUID_OFFSET, UUID_SIZE));
+    const QString name = fixedString(bytes.mid(LUKS1_CIPHER_NAME, LUKS1_CIPHER_SIZE));
+    const QString mode = fixedString(bytes.mid(LUKS1_CIPHER_MODE, LUKS1_CIPHER_SIZE));
+    header.cipher = mode.isEmpty() ? name : name + '-' + mode;
+    header.payloadOffset
+        = quint64(qFromBigEndian<quint32>(bytes.constData() + LUKS1_PAYLOAD_OFFSET)) * LUKS1_SECTOR_SIZE;
+    for (int i = 0; i < LUKS1_KEYSLOT_COUNT; ++i) {
+        const char *slot = bytes.constData() + LUKS1_KEYSLOTS + i * LUKS1_KEYSLOT_SIZE;
+        if (qFromBigEndian<quint32>(slot) == LUKS1_KEYSLOT_ACTIVE) {
+            ++header.keyslots;
+        }
+    }
+    return header;
+}
+
+std::optional<QCryptographicHash::Algorithm> checksumAlgorithm(const QString &name)
+{
+    if (name == "sha256") {
+        return QCryptographicHash::Sha256;
+    }
+    if (name == "sha512") {
+        return QCryptographicHash::Sha512;
+    }
+    if (name == "sha384") {
+        return QCryptographicHash::Sha384;
+    }
+    if (name == "sha1") {
+        return QCryptographicHash::Sha1;
+    }
+    return std::nullopt;
+}
+
+struct Luks2Copy {
+    Header header;
+    quint64 seqid = 0;
+};
+
+// One copy of a LUKS2 header: the binary part at offset has already been read, the JSON area is
+// read only once the binary part looks sound
+std::optional<Luks2Copy> readLuks2Copy(const ByteReader &reader, quint64 offset, const QByteArray &binary)
+{
+    const char *magic = offset == 0 ? MAGIC : SECONDARY_MAGIC;
+    if (binary.size() != qsizetype(LUKS2_BINARY_SIZE) || binary.first(MAGIC_SIZE) != QByteArray(magic, MAGIC_SIZE)
+        || qFromBigEndian<quint16>(binary.constData() + VERSION_OFFSET) != 2) {
+        return std::nullopt;
+    }
+    const quint64 size = qFromBigEndian<quint64>(binary.constData() + LUKS2_HDR_SIZE);
+    if (std::find(LUKS2_HEADER_SIZES.cbegin(), LUKS2_HEADER_SIZES.cend(), size) == LUKS2_HEADER_SIZES.cend()
+        || qFromBigEndian<quint64>(binary.constData() + LUKS2_HDR_OFFSET) != offset) {
+        return std::nullopt;
+    }
+    const auto algorithm = checksumAlgorithm(fixedString(binary.mid(LUKS2_CHECKSUM_ALG, LUKS2_CHECKSUM_ALG_SIZE)));
+    if (!algorithm) {
+        return std::nullopt;
+    }
+    const QByteArray json = reader(offset + LUKS2_BINARY_SIZE, static_cast<quint32>(size - LUKS2_BINARY_SIZE));
+    if (json.size() != qsizetype(size - LUKS2_BINARY_SIZE)) {
+        return std::nullopt;
+    }
+
+    // The checksum covers both parts, with its own field zeroed
+    QByteArray zeroed = binary;
+    zeroed.replace(LUKS2_CSUM, LUKS2_CSUM_SIZE, QByteArray(LUKS2_CSUM_SIZE, '\0'));
+    QCryptographicHash hash(*algorithm);
+    hash.addData(zeroed);
+    hash.addData(json);
+    const QByteArray digest = hash.result();
+    if (binary.mid(LUKS2_CSUM, digest.size()) != digest) {
+        return std::nullopt;
+    }
+
+    const qsizetype end = json.indexOf('\0');
+    const QJsonDocument document = QJsonDocument::fromJson(end < 0 ? json : json.first(end));
+    if (!document.isObject()) {
+        return std::nullopt;
+    }
+    const QJsonObject metadata = document.object();
+
+    Luks2Copy copy;
+    copy.seqid = qFromBigEndian<quint64>(binary.constData() + LUKS2_SEQID);
+    copy.header.version = 2;
+    copy.header.uuid = fixedString(binary.mid(UUID_OFFSET, UUID_SIZE));
+    copy.header.label = fixedString(binary.mid(LUKS2_LABEL, LUKS2_LABEL_SIZE));
+    copy.header.keyslots = static_cast<int>(metadata.value("keyslots").toObject().size());
+    // Segment "0" is the data; its offset is a decimal string since JSON numbers cannot hold 64 bits
+    const QJsonObject segment = metadata.value("segments").toObject().value("0").toObject();
+    copy.header.cipher = segment.value("encryption").toString();
+    copy.header.payloadOffset = segment.value("offset").toString().toULongLong();
+    return copy;
+}
+
+// The secondary copy starts where the primary ends, so every header size is tried and the newest
+// copy found wins
+std::optional<Header> readSecondary(const ByteReader &reader)
+{
+    std::optional<Luks2Copy> best;
+    for (const quint64 offset : LUKS2_HEADER_SIZES) {
+        const auto secondary = readLuks2Copy(reader, offset, reader(offset, LUKS2_BINARY_SIZE));
+        if (secondary && (!best || secondary->seqid > best->seqid)) {
+            best = secondary;
+        }
+    }
+    if (!best) {
+        return std::nullopt;
+    }
+    return best->header;
+}
+
+// A healthy container costs one read of its header area; a damaged primary falls back to the secondary
+std::optional<Header> readLuks2(const ByteReader &reader, const QByteArray &primaryBinary)
+{
+    if (const auto primary = readLuks2Copy(reader, 0, primaryBinary)) {
+        return primary->header;
+    }
+    return readSecondary(reader);
+}
+} // namespace
+
+std::optional<Header> read(const ByteReader &reader, QString *error)
+{
+    const QByteArray bytes = reader(0, LUKS2_BINARY_SIZE);
+    if (bytes.size() < LUKS1_HEADER_SIZE || bytes.first(MAGIC_SIZE) != QByteArray(MAGIC, MAGIC_SIZE)) {
+        // Without the primary magic only a LUKS2 secondary header can still identify the container
+        if (const auto secondary = readSecondary(reader); secondary && !secondary->uuid.isEmpty()) {
+            return secondary;
+        }
+        fail(error, QObject::tr("No LUKS header was found."));
+        return std::nullopt;
+    }
+    const quint16 version = qFromBigEndian<quint16>(bytes.constData() + VERSION_OFFSET);
+    std::optional<Header> header;
+    if (version == 1) {
+        header = parseLuks1(bytes);
+    } else if (version == 2) {
+        header = readLuks2(reader, bytes);
+    } else {
+        fail(error, QObject::tr("Unsupported LUKS version %1.").arg(version));
+        return std::nullopt;
+    }
+    if (!header || header->uuid.isEmpty()) {
+        fail(error, QObject::tr("The LUKS header is damaged."));
+        return std::nullopt;
+    }
+    return header;
+}
+
+std::optional<Header> readDevice(const QString &path, QString *error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        fail(error, QObject::tr("Could not open %1: %2").arg(path, file.errorString()));
+        return std::nullopt;
+    }
+    const ByteReader reader = [&file](quint64 offset, quint32 length) -> QByteArray {
+        if (!file.seek(static_cast<qint64>(offset))) {
+            return {};
+        }
+        return file.read(length);
+    };
+    return read(reader, error);
+}
+
+QString mapperName(const Header &header)
+{
+    return "luks-" + header.uuid;
+}
+
+QJsonObject toJson(const Header &header)
+{
+    return {
+        {"version", header.version},
+        {"uuid", header.uuid},
+        {"label", header.label},
+        {"cipher", header.cipher},
+        {"keyslots", header.keyslots},
+        {"payloadOffset", QString::number(header.payloadOffset)},
+    };
+}
+
+std::optional<Header> fromJson(const QJsonObject &object)
+{
+    Header header;
+    header.version = object.value("version").toInt();
+    header.uuid = object.value("uuid").toString();
+    if (header.version == 0 || header.uuid.isEmpty()) {
+        return std::nullopt;
+    }
+    header.label = object.value("label").toString();
+    header.cipher = object.value("cipher").toString();
+    header.keyslots = object.value("keyslots").toInt();
+    header.payloadOffset = object.value("payloadOffset").toString().toULongLong();
+    return header;
+}
+
+} // namespace luks
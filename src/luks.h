@@ -0,0 +1,42 @@
+#pragma once
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QString>
+
+#include <functional>
+#include <optional>
+
+// LUKS1 and LUKS2 headers, read straight from the partition to tell encrypted containers apart
+// and name their mappings the way cryptsetup isLuks and luksUUID would, without running it.
+// A LUKS2 header is only trusted when its checksum matches; a damaged primary falls back to the
+// secondary copy.
+namespace luks
+{
+
+struct Header {
+    int version = 0; // 1 or 2
+    QString uuid;
+    QString label;             // LUKS2 only
+    QString cipher;            // e.g. "aes-xts-plain64"
+    int keyslots = 0;          // the ones in use
+    quint64 payloadOffset = 0; // bytes from the start of the partition to the encrypted data
+
+    bool operator==(const Header &other) const = default;
+};
+
+// Reads length bytes at offset from the start of the partition; a short result is a read error
+using ByteReader = std::function<QByteArray(quint64 offset, quint32 length)>;
+
+[[nodiscard]] std::optional<Header> read(const ByteReader &reader, QString *error = nullptr);
+// A partition or an image file; needs read access
+[[nodiscard]] std::optional<Header> readDevice(const QString &path, QString *error = nullptr);
+
+// The device-mapper name containers are opened as, "luks-<uuid>"
+[[nodiscard]] QString mapperName(const Header &header);
+
+// Transport between the helper, which can open the partitions, and the application
+[[nodiscard]] QJsonObject toJson(const Header &header);
+[[nodiscard]] std::optional<Header> fromJson(const QJsonObject &object);
+
+} // namespace luks
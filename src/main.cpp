@@ -31,6 +31,7 @@
 #include <QMessageBox>
 #include <QTranslator>
 
+#include "cli.h"
 #include "cmd.h"
 #include "common.h"
 #include "log.h"
@@ -41,10 +42,12 @@
     #define VERSION "?.?.?.?"
 #endif
 
-bool isUefi();
-
 int main(int argc, char *argv[])
 {
+    if (cli::isCliInvocation(argc, argv)) {
+        return cli::run(argc, argv);
+    }
+
     if (getuid() == 0) {
         qputenv("XDG_RUNTIME_DIR", "/run/user/0");
         qunsetenv("SESSION_MANAGER");
@@ -121,6 +124,6 @@ int main(int argc, char *argv[])
 
 bool isUefi()
 {
-    QDir dir("/sys/firmware/efi/efivars");
+    QDir dir(EFIVARS_DIR);
     return dir.exists() && !dir.entryList(QDir::NoDotAndDotDot | QDir::AllEntries).isEmpty();
 }
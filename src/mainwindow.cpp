@@ -26,30 +26,100 @@
 #include "utils.h"
 
 #include <QDebug>
+#include <QDialogButtonBox>
 #include <QDir>
 #include <QFileDialog>
+#include <QFormLayout>
+#include <QHeaderView>
 #include <QFileInfo>
 #include <QInputDialog>
-#include <QListWidget>
 #include <QRegularExpression>
 
-#include <QCollator>
+#include <QCryptographicHash>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QLabel>
+#include <QListWidget>
+#include <QSaveFile>
 #include <QScreen>
 #include <QStorageInfo>
+#include <QTableWidget>
+#include <QTemporaryFile>
 #include <QTextStream>
 #include <QTimer>
+#include <QVBoxLayout>
 
 #include "about.h"
+#include "blockreader.h"
+#include "blsentry.h"
+#include "bootperf.h"
+#include "bootsnapshot.h"
 #include "cmd.h"
 #include "common.h"
+#include "desiredstate.h"
+#include "duplicates.h"
+#include "efivars.h"
+#include "fatfs.h"
+#include "gpt.h"
+#include "kernelslots.h"
+#include "loadoption.h"
 #include "log.h"
+#include "rootfs.h"
+
+#include <algorithm>
+#include <utility>
 
 namespace {
 const QRegularExpression bootStripRegex("^Boot|\\*$");
 const QRegularExpression hexIdRegex("^[0-9A-Fa-f]{4}$");
+
+// "Boot0001* Label ..." -> "0001", empty if the line is not a boot entry
+QString entryBootNum(const QString &text)
+{
+    QString item = text.section(' ', 0, 0);
+    item.remove(bootStripRegex);
+    return item.contains(hexIdRegex) ? item : QString();
+}
+
+// What one efibootmgr listing says about the boot manager
+struct BootManagerState {
+    QStringList entryLines;
+    QStringList bootOrder;
+    QString bootNext;
+    QString bootCurrent;
+    int timeout = 0;
+
+    [[nodiscard]] QHash<QString, bool> activeFlags() const
+    {
+        QHash<QString, bool> flags;
+        for (const QString &line : entryLines) {
+            flags.insert(entryBootNum(line), line.section(' ', 0, 0).endsWith('*'));
+        }
+        return flags;
+    }
+};
+
+BootManagerState parseBootManager(const QString &efibootmgrOutput)
+{
+    static const QRegularExpression bootEntryRegex(R"(^Boot[0-9A-Fa-f]{4}\*?\s+)");
+    BootManagerState state;
+    const QStringList lines = efibootmgrOutput.split('\n', Qt::SkipEmptyParts);
+    for (const QString &line : lines) {
+        if (bootEntryRegex.match(line).hasMatch()) {
+            state.entryLines.append(line);
+        } else if (line.startsWith("Timeout:")) {
+            state.timeout = line.section(' ', 1).trimmed().toInt();
+        } else if (line.startsWith("BootNext:")) {
+            state.bootNext = line.section(' ', 1).trimmed();
+        } else if (line.startsWith("BootCurrent:")) {
+            state.bootCurrent = line.section(' ', 1).trimmed();
+        } else if (line.startsWith("BootOrder:")) {
+            state.bootOrder = line.section(' ', 1).split(',', Qt::SkipEmptyParts);
+        }
+    }
+    return state;
+}
 }
 
 // Trying to map all the persistence type to values that make sense
@@ -89,7 +159,17 @@ MainWindow::MainWindow(const QCommandLineParser &argParser, QWidget *parent)
 
 MainWindow::~MainWindow()
 {
+    // A rescan still running posts its result to this window; wait for it and drop the result
+    scanPool.waitForDone();
+    QCoreApplication::removePostedEvents(this, QEvent::MetaCall);
     settings.setValue("geometry", saveGeometry());
+    if (!scancache::save(scancache::defaultPath(), scanCache)) {
+        qWarning() << "Could not save the scan cache";
+    }
+    // Write any boot order/timeout edits still waiting for the debounce timer
+    efivarWatcher.stop();
+    disconnect(&nvramBatch, nullptr, nullptr, nullptr);
+    nvramBatch.flush();
     const bool needsCleanup = !newMounts.isEmpty() || !newDirectories.isEmpty() || !newLuksDevices.isEmpty();
     if (needsCleanup) {
         QStringList cleanupArgs = {"cleanup_temp"};
@@ -115,114 +195,242 @@ MainWindow::~MainWindow()
     delete ui;
 }
 
+// ESPs by the PARTTYPE lsblk reports, which needs no privileges
 QStringList MainWindow::getEspDevicePaths()
 {
     QString lsblkJson;
     cmd.proc("lsblk", {"-ln", "--json", "-o", "PATH,PARTTYPE,FSTYPE,TYPE"}, &lsblkJson);
 
-    QJsonDocument doc = QJsonDocument::fromJson(lsblkJson.toUtf8());
-    QJsonArray devices = doc.object().value("blockdevices").toArray();
-
+    const QJsonArray devices = QJsonDocument::fromJson(lsblkJson.toUtf8()).object().value("blockdevices").toArray();
     QStringList paths;
-    for (const QJsonValue &val : devices) {
-        QJsonObject dev = val.toObject();
-        if (dev.value("type").toString() != "part") {
+    for (const QJsonValue &value : devices) {
+        const QJsonObject device = value.toObject();
+        if (device.value("type").toString() != "part") {
             continue;
         }
-        const QString parttype = dev.value("parttype").toString().toLower();
+        const QString path = device.value("path").toString();
+        const QString fstype = device.value("fstype").toString();
+        QString parttype = device.value("parttype").toString().toLower();
+        // Partitions udev hasn't probed have neither; their disk's table may still tell the type
+        if (parttype.isEmpty() && fstype.isEmpty()) {
+            parttype = readablePartitionType(path);
+        }
         if ((parttype == ESP_GUID_GPT || parttype == ESP_TYPE_MBR)
-            && dev.value("fstype").toString().compare("vfat", Qt::CaseInsensitive) == 0) {
-            paths.append(dev.value("path").toString());
+            && (fstype.isEmpty() || fstype.compare("vfat", Qt::CaseInsensitive) == 0)) {
+            paths.append(path);
         }
     }
     return paths;
 }
 
-void MainWindow::addUefiEntry(QListWidget *listEntries, QWidget *dialogUefi)
+// The type of a partition from its disk's partition table, but only when that is already read or
+// readable without elevation; empty otherwise
+QString MainWindow::readablePartitionType(const QString &partition)
 {
-    // Mount all ESPs
-    const QStringList partList = getEspDevicePaths();
+    const auto location = gpt::locate(partition);
+    if (!location) {
+        return {};
+    }
+    const QString disk = "/dev/" + location->disk;
+    if (!partitionTables.contains(disk) && !QFileInfo(disk).isReadable()) {
+        return {};
+    }
+    loadPartitionTables({disk});
+    const auto table = partitionTables.constFind(disk);
+    const gpt::Partition *entry = table != partitionTables.constEnd() ? table->find(location->number) : nullptr;
+    return entry ? entry->type : QString();
+}
 
-    for (const auto &device : std::as_const(partList)) {
-        if (!cmd.procAsRoot("findmnt", {"-n", device})) {
-            QString partName = device.section('/', -1);
-            QString mountDir = "/boot/efi/" + partName;
-            if (!QDir(mountDir).exists()) {
-                cmd.procAsRoot("mkdir", {"-p", mountDir});
-                newDirectories.append(mountDir);
-            }
-            if (cmd.procAsRoot("mount", {device, mountDir})) {
-                newMounts.append(mountDir);
-            }
+// Runs a read-only parser on the devices: directly when they are all readable, otherwise
+// through a single helper call. The results are keyed by device.
+QJsonObject MainWindow::readDevices(const QString &reader, const QStringList &devices)
+{
+    QJsonObject results;
+    const auto isReadable = [](const QString &device) { return QFileInfo(device).isReadable(); };
+    if (std::all_of(devices.cbegin(), devices.cend(), isReadable)) {
+        for (const QString &device : devices) {
+            results.insert(device, blockreader::read(reader, device));
         }
+        return results;
     }
+    QString out;
+    if (!cmd.procAsRootRead(reader, devices, &out, QuietMode::Yes)) {
+        qWarning() << "Could not run" << reader << "on" << devices;
+        return results;
+    }
+    return QJsonDocument::fromJson(out.toUtf8()).object();
+}
 
-    const QString initialPath = QFile::exists("/boot/efi/EFI") ? "/boot/efi/EFI" : "/boot/efi/";
-    QString fileName
-        = QFileDialog::getOpenFileName(dialogUefi, tr("Select EFI file"), initialPath, tr("EFI files (*.efi *.EFI)"));
-
-    if (!QFile::exists(fileName)) {
+// Reads the partition tables that aren't cached yet
+void MainWindow::loadPartitionTables(const QStringList &disks)
+{
+    QStringList missing;
+    for (const QString &disk : disks) {
+        if (!partitionTables.contains(disk)) {
+            missing.append(disk);
+        }
+    }
+    if (missing.isEmpty()) {
         return;
     }
+    const QJsonObject tables = readDevices("gpt", missing);
+    for (auto it = tables.constBegin(); it != tables.constEnd(); ++it) {
+        if (const auto table = gpt::fromJson(it.value().toObject())) {
+            partitionTables.insert(it.key(), *table);
+        } else {
+            qDebug() << "No partition table on" << it.key() << it.value().toObject().value("error").toString();
+        }
+    }
+}
 
-    QString dfOut;
-    cmd.proc("df", {"--output=source", fileName}, &dfOut);
-    const QStringList dfLines = dfOut.split('\n', Qt::SkipEmptyParts);
-    const QString partitionName = dfLines.size() >= 2 ? dfLines.last().trimmed() : QString();
+// The ESP's partition table record, and the disk it is on (e.g. /dev/nvme0n1)
+std::optional<gpt::Partition> MainWindow::espPartition(const QString &esp, QString *disk)
+{
+    const auto location = gpt::locate(esp);
+    if (!location) {
+        qWarning() << "Could not find the disk of" << esp;
+        return std::nullopt;
+    }
+    const QString diskPath = "/dev/" + location->disk;
+    loadPartitionTables({diskPath});
+    const auto table = partitionTables.constFind(diskPath);
+    const gpt::Partition *partition = table != partitionTables.constEnd() ? table->find(location->number) : nullptr;
+    if (!partition) {
+        qWarning() << "Partition" << location->number << "is not in the partition table of" << diskPath;
+        return std::nullopt;
+    }
+    if (disk) {
+        *disk = diskPath;
+    }
+    return *partition;
+}
 
-    if (partitionName.isEmpty() || !partitionName.startsWith("/dev/")) {
-        QMessageBox::critical(dialogUefi, tr("Error"), tr("Could not find the source mountpoint for %1").arg(fileName));
+void MainWindow::addUefiEntry(QWidget *dialogUefi)
+{
+    // Loaders on every ESP, read from the FAT without mounting anything
+    const QStringList espDevices = getEspDevicePaths();
+    const QJsonObject summaries = readDevices("fat", espDevices);
+    QStringList choices;
+    QList<QPair<QString, QString>> loaders; // device, loader path from the ESP root
+    for (const QString &device : espDevices) {
+        const auto summary = fatfs::fromJson(summaries.value(device).toObject());
+        if (!summary) {
+            continue;
+        }
+        for (const fatfs::Entry &entry : summary->efiTree) {
+            if (!entry.isDirectory && entry.path.endsWith(".efi", Qt::CaseInsensitive)) {
+                choices.append(QString("%1: %2").arg(device.section('/', -1), QString(entry.path).replace('/', '\\')));
+                loaders.append({device, entry.path});
+            }
+        }
+    }
+    if (choices.isEmpty()) {
+        QMessageBox::critical(dialogUefi, tr("Error"), tr("No EFI files were found on the EFI System Partitions."));
         return;
     }
 
-    QString pkname;
-    cmd.proc("lsblk", {"-no", "PKNAME", partitionName}, &pkname);
-    const QString disk = "/dev/" + pkname.trimmed();
-    const QRegularExpressionMatch partMatch = QRegularExpression("[0-9]+$").match(partitionName);
-    const QString partition = partMatch.hasMatch() ? partMatch.captured() : QString();
+    bool ok = false;
+    const QString choice
+        = QInputDialog::getItem(dialogUefi, tr("Select EFI file"), tr("EFI files:"), choices, 0, false, &ok);
+    if (!ok || !choices.contains(choice)) {
+        return;
+    }
+    const auto &[device, loaderPath] = loaders.at(choices.indexOf(choice));
 
-    if (cmd.exitCode() != 0 || partition.isEmpty() || pkname.trimmed().isEmpty()) {
-        QMessageBox::critical(dialogUefi, tr("Error"), tr("Could not find the source mountpoint for %1").arg(fileName));
+    QString disk;
+    const auto espPart = espPartition(device, &disk);
+    if (!espPart) {
+        QMessageBox::critical(dialogUefi, tr("Error"), tr("Could not find the partition of %1").arg(device));
         return;
     }
+    const QString partition = QString::number(espPart->number);
 
     QString name = QInputDialog::getText(dialogUefi, tr("Set name"), tr("Enter the name for the UEFI menu item:"));
     if (name.isEmpty()) {
         name = "New entry";
     }
-
-    // Express the loader path relative to the ESP root (e.g. \EFI\fedora\shimx64.efi).
-    // We strip the actual mountpoint rather than searching for "/EFI/" in the absolute
-    // path: the ESP is mounted under /boot/efi/<part>, whose own "/efi/" would match
-    // first (case-insensitively) and leave the mount directory name wrongly embedded
-    // in the path, e.g. \EFI\nvme1n1p1\EFI\fedora\shimx64.efi.
-    QString dfTarget;
-    cmd.proc("df", {"--output=target", fileName}, &dfTarget);
-    const QStringList targetLines = dfTarget.split('\n', Qt::SkipEmptyParts);
-    const QString mountPoint = targetLines.size() >= 2 ? targetLines.last().trimmed() : QString();
-
-    QString loaderPath;
-    if (!mountPoint.isEmpty() && fileName.startsWith(mountPoint)) {
-        loaderPath = fileName.mid(mountPoint.length());
-        if (!loaderPath.startsWith('/')) {
-            loaderPath.prepend('/');
-        }
-    }
-    if (!loaderPath.startsWith("/EFI/", Qt::CaseInsensitive)) {
-        QMessageBox::critical(dialogUefi, tr("Error"), tr("Selected file is not in an EFI directory"));
+    if (!checkNvramHeadroom(efivars::estimateLoadOptionSize(name, loaderPath))) {
         return;
     }
+
     QString out;
-    cmd.procAsRoot("efibootmgr", {"-c", "-L", name, "-d", disk, "-p", partition, "-l", loaderPath}, &out);
+    const QStringList efiArgs {"-c", "-L", name, "-d", disk, "-p", partition, "-l", loaderPath};
+    cmd.procAsRoot("efibootmgr", efiArgs, &out);
 
     if (cmd.exitCode() != 0) {
         QMessageBox::critical(dialogUefi, tr("Error"), tr("Something went wrong, could not add entry."));
         return;
     }
+    efivars::recordWrites(efivars::variableWrites(efiArgs));
 
-    QStringList outList = out.split('\n', Qt::SkipEmptyParts);
-    listEntries->insertItem(0, outList.constLast());
-    emit listEntries->itemSelectionChanged();
+    const QStringList outList = out.split('\n', Qt::SkipEmptyParts);
+    if (const auto entry = entryFromLine(outList.value(outList.size() - 1))) {
+        bootEntries.insertEntry(0, *entry);
+    }
+}
+
+// Edit the description and optional data of an entry, rewriting only its Boot#### variable
+bool MainWindow::editUefiEntry(const QListView *listEntries, QWidget *uefiDialog)
+{
+    const QString bootNum = listEntries->currentIndex().data(BootEntryModel::BootNumRole).toString();
+    if (bootNum.isEmpty()) {
+        return false;
+    }
+
+    const QString name = "Boot" + bootNum.toUpper();
+    const std::optional<bootsnapshot::Variable> var = bootsnapshot::readVariable(name);
+    const std::optional<loadoption::LoadOption> option = var ? loadoption::decode(var->data) : std::nullopt;
+    if (!option) {
+        QMessageBox::critical(uefiDialog, tr("Error"), tr("Could not read boot entry %1.").arg(name));
+        return false;
+    }
+    bool isText = false;
+    const QString options = loadoption::optionalDataToString(option->optionalData, &isText);
+
+    QDialog dialog(uefiDialog);
+    dialog.setWindowTitle(tr("Edit entry %1").arg(name));
+    auto *form = new QFormLayout(&dialog);
+    auto *textDescription = new QLineEdit(option->description, &dialog);
+    auto *textOptions = new QLineEdit(options, &dialog);
+    textOptions->setMinimumWidth(400);
+    if (!isText) {
+        textOptions->setEnabled(false);
+        textOptions->setPlaceholderText(tr("binary data, can't be edited"));
+    }
+    auto *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    form->addRow(tr("Description:"), textDescription);
+    form->addRow(tr("Kernel options:"), textOptions);
+    form->addRow(buttons);
+    if (dialog.exec() != QDialog::Accepted) {
+        return false;
+    }
+
+    QString error;
+    const std::optional<bootsnapshot::Change> change
+        = desiredstate::editEntry(*var, textDescription->text(), textOptions->text(), &error);
+    if (!change) {
+        if (!error.isEmpty()) {
+            QMessageBox::critical(uefiDialog, tr("Error"), error);
+        }
+        return false;
+    }
+    const qsizetype growth = change->variable.data.size() - var->data.size();
+    if (growth > 0 && !checkNvramHeadroom(growth)) {
+        return false;
+    }
+
+    // The dialog may have been open for a while; the helper refuses to overwrite what another program wrote
+    if (!cmd.procAsRootEfivars(bootsnapshot::toHelperOperations({*change}))) {
+        QMessageBox::critical(uefiDialog, tr("Error"),
+                              cmd.exitCode() == EXIT_CODE_CONFLICT
+                                  ? tr("%1 was changed by another program, please edit it again.").arg(name)
+                                  : tr("Something went wrong, could not edit entry."));
+        return false;
+    }
+    efivars::recordWrites(1);
+    return true;
 }
 
 void MainWindow::checkDoneStub()
@@ -279,11 +487,38 @@ void MainWindow::setup()
         }
     }
 
-    // Refresh blkid cache (best-effort, may not update cache without root)
-    cmd.proc("blkid");
+    ui->comboDrive->setModel(&blockDevices);
+    ui->comboDriveStub->setModel(&blockDevices);
+
+    nvramBatch.setDelay(settings.value("nvramWriteDelay", 2000).toInt());
+    efivarPollInterval = settings.value("efivarPollInterval", 3000).toInt();
+    ui->checkBls->setChecked(settings.value("stubUseBls", false).toBool());
+    efivarWatcher.setInterval(efivarPollInterval);
 
-    // Detect root device/partition once at startup
-    detectRootDevice();
+    // A warm start shows the last scan at once and checks it when the window is up
+    const std::optional<scancache::Snapshot> cached = scancache::load(scancache::defaultPath());
+    if (cached) {
+        scanCache = *cached;
+        useCachedDevices = !scanCache.devices.isEmpty();
+        partuuidIndex.build(scanCache.devices);
+    }
+    if (cached && !scanCache.bootId.isEmpty() && scanCache.bootId == scancache::currentBootId()) {
+        rootDevicePath = scanCache.rootDevicePath;
+        rootPartition = scanCache.rootPartition;
+        rootDrive = scanCache.rootDrive;
+    } else {
+        // BootCurrent and the running kernel belong to the boot they were read in
+        scanCache.efibootmgr.clear();
+        for (scancache::CachedKernels &kernels : scanCache.kernels) {
+            kernels.stamps.clear();
+        }
+        if (!cached) {
+            // Refresh blkid cache (best-effort, may not update cache without root)
+            cmd.proc("blkid");
+        }
+        // Detect root device/partition once at startup
+        detectRootDevice();
+    }
 
     // Refresh appropriate tab content based on current tab
     const auto currentTab = ui->tabWidget->currentIndex();
@@ -298,6 +533,9 @@ void MainWindow::setup()
         refreshStubInstall();
         break;
     }
+    if (cached) {
+        revalidateScan();
+    }
 }
 
 void MainWindow::cmdStart()
@@ -314,6 +552,7 @@ void MainWindow::setConnections()
 {
     connect(&cmd, &Cmd::done, this, &MainWindow::cmdDone);
     connect(&cmd, &Cmd::started, this, &MainWindow::cmdStart);
+    connect(&rootPrefetcher, &RootPrefetcher::finished, this, &MainWindow::prefetchedRoot);
 
     connect(ui->comboDrive, &QComboBox::currentTextChanged, this, &MainWindow::filterDrivePartitions);
     connect(ui->comboDriveStub, &QComboBox::currentTextChanged, this, &MainWindow::filterDrivePartitions);
@@ -331,37 +570,21 @@ void MainWindow::setConnections()
     connect(ui->textKernelOptions, &QLineEdit::textChanged, this, &MainWindow::checkDoneStub);
 }
 
-void MainWindow::toggleUefiActive(QListWidget *listEntries)
+void MainWindow::toggleUefiActive(const QListView *listEntries)
 {
     if (!listEntries) {
         return;
     }
 
-    auto currentItem = listEntries->currentItem();
-    if (!currentItem) {
-        return;
-    }
-
-    static const QRegularExpression bootPrefixRegex("^Boot");
-    static const QRegularExpression hexIdStarRegex(R"(^[0-9A-Fa-f]{4}\*?$)");
-    QString item = currentItem->text().section(' ', 0, 0).remove(bootPrefixRegex);
-    QString rest = currentItem->text().section(' ', 1, -1);
-
-    if (!item.contains(hexIdStarRegex)) {
+    const QModelIndex current = listEntries->currentIndex();
+    const QString item = current.data(BootEntryModel::BootNumRole).toString();
+    if (item.isEmpty()) {
         return;
     }
 
-    bool isActive = item.endsWith('*');
-    if (isActive) {
-        item.chop(1);
-    }
-
-    if (Cmd().procAsRoot("efibootmgr", {isActive ? "--inactive" : "--active", "-b", item})) {
-        listEntries->currentItem()->setText(QString("Boot%1%2 %3").arg(item, isActive ? "" : "*", rest));
-        listEntries->currentItem()->setBackground(isActive ? QBrush(Qt::gray) : QBrush());
-    }
-
-    emit listEntries->itemSelectionChanged();
+    const bool isActive = current.data(BootEntryModel::ActiveRole).toBool();
+    nvramBatch.stageActive(item, !isActive);
+    bootEntries.setActive(item, !isActive);
 }
 
 void MainWindow::tabWidgetCurrentChanged()
@@ -369,6 +592,9 @@ void MainWindow::tabWidgetCurrentChanged()
     const int currentTab = ui->tabWidget->currentIndex();
     ui->pushNext->setVisible(currentTab == Tab::Frugal || currentTab == Tab::StubInstall);
     ui->pushBack->setVisible(currentTab == Tab::Frugal);
+    if (currentTab != Tab::Entries) {
+        efivarWatcher.stop();
+    }
 
     switch (currentTab) {
     case Tab::Entries:
@@ -385,7 +611,7 @@ void MainWindow::tabWidgetCurrentChanged()
 
 [[nodiscard]] QString MainWindow::getBootLocation()
 {
-    QString partition = ui->comboPartitionStub->currentText().section(' ', 0, 0);
+    QString partition = ui->comboPartitionStub->currentData().toString();
     QString mountPoint = getMountPoint(partition);
     if (mountPoint.isEmpty()) {
         mountPoint = mountPartition(partition);
@@ -400,38 +626,20 @@ void MainWindow::tabWidgetCurrentChanged()
 
 [[nodiscard]] QString MainWindow::getBootLocation(const QString &mountPoint)
 {
-
     // Check /etc/fstab for separate /boot partition
-    QFile fstab(mountPoint + "/etc/fstab");
-    if (!fstab.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        qWarning() << "Could not open" << fstab.fileName();
+    const RootProfile profile = rootProfile(mountPoint);
+    if (!profile.hasFstab) {
+        qWarning() << "Could not open" << mountPoint + "/etc/fstab";
         return mountPoint;
     }
 
-    QString bootPartition;
-    QTextStream in(&fstab);
-    QString line;
-    QRegularExpression regex(R"(^(.+?)\s+(/boot)\s+.*$)");
-    while (in.readLineInto(&line)) {
-        line = line.trimmed();
-        // Skip empty lines or comment lines
-        if (line.isEmpty() || line.startsWith('#')) {
-            continue;
-        }
-        // Match lines with /boot
-        QRegularExpressionMatch match = regex.match(line);
-        if (match.hasMatch()) {
-            bootPartition = match.captured(1).trimmed();
-            // replace "\040" codes for spaces in LABELs used within fstab
-            bootPartition.replace("\\040", " ");
-            qDebug().noquote() << "/boot partition :" << bootPartition;
-            break;
-        }
+    const QString bootPartition = profile.bootSource;
+    if (!bootPartition.isEmpty()) {
+        qDebug().noquote() << "/boot partition :" << bootPartition;
     }
-    fstab.close();
 
     if (bootPartition.isEmpty()) {
-        if (QDir(mountPoint + "/boot").exists()) {
+        if (profile.hasBootDirectory) {
             return mountPoint + "/boot";
         } else {
             qWarning() << "Failed to find boot directory as " << mountPoint;
@@ -470,31 +678,28 @@ bool MainWindow::copyKernel()
     }
 
     // Copy kernel and initrd files
-    const QString sourceDir = isFrugal ? frugalDir : [this]() {
-        QString dir = getBootLocation();
-
-        return dir;
-    }();
-    const auto kernelFiles = utils::resolveKernelFiles(sourceDir, ui->comboKernel->currentText(), isFrugal);
+    kernelInventory.setDirectory(isFrugal ? frugalDir : getBootLocation(), isFrugal);
+    const KernelInventory::Kernel kernel = kernelInventory.kernel(ui->comboKernel->currentText());
 
-    const QStringList filesToCopy = {kernelFiles.vmlinuz, kernelFiles.initrd, kernelFiles.amdUcode, kernelFiles.intelUcode};
+    const QList<KernelInventory::File> filesToCopy
+        = {kernel.vmlinuz, kernel.initrd, kernel.amdUcode, kernel.intelUcode};
     const QStringList targetFiles = {"/vmlinuz", "/initrd.img", "/amducode.img", "/intucode.img"};
 
     for (int i = 0; i < filesToCopy.size(); ++i) {
-        QString file = filesToCopy.at(i);
+        const KernelInventory::File &file = filesToCopy.at(i);
         const QString targetFile = targetPath + targetFiles.at(i);
 
-        if (!QFile::exists(file) && file.endsWith("ucode.img")) {
+        if (!file.exists() && file.path.endsWith("ucode.img")) {
             continue;
         }
 
-        if (!QFile::exists(file) && !file.endsWith("ucode.img")) {
-            qWarning() << "Source file does not exist:" << file;
+        if (!file.exists()) {
+            qWarning() << "Source file does not exist:" << file.path;
             return false;
         }
 
-        if (!cmd.procAsRoot("cp", {file, targetFile})) {
-            qWarning() << "Failed to copy file:" << file << "to" << targetFile;
+        if (!cmd.procAsRoot("cp", {file.path, targetFile})) {
+            qWarning() << "Failed to copy file:" << file.path << "to" << targetFile;
             return false;
         }
     }
@@ -505,24 +710,35 @@ bool MainWindow::copyKernel()
 
 bool MainWindow::installEfiStub(const QString &esp)
 {
-    if (esp.isEmpty() || !copyKernel()) {
+    if (esp.isEmpty()) {
         return false;
     }
 
-    const QString disk = "/dev/" + utils::extractDiskFromPartition(esp);
-    const QRegularExpressionMatch partMatch = QRegularExpression("[0-9]+$").match(esp);
-    QString part = partMatch.hasMatch() ? partMatch.captured() : QString();
+    const bool isFrugal = ui->tabWidget->currentIndex() == Tab::Frugal;
+    const QString efiDir = isFrugal ? "frugal" : "stub";
+    const QString entryName = isFrugal ? ui->textUefiEntryFrugal->text() : ui->textEntryName->text();
+    const QString kernelOptions = isFrugal ? ui->textOptionsFrugal->text() : ui->textKernelOptions->text();
 
-    if (disk.isEmpty() || part.isEmpty()) {
+    // The initrd= options added below take up to ~200 more characters
+    constexpr int initrdOptionsLength = 200;
+    if (!checkNvramHeadroom(efivars::estimateLoadOptionSize(
+            entryName, QString("\\EFI\\%1\\%2\\vmlinuz").arg(distro, efiDir),
+            kernelOptions + QString(initrdOptionsLength, ' ')))) {
         return false;
     }
 
-    const bool isFrugal = ui->tabWidget->currentIndex() == Tab::Frugal;
-    const QString efiDir = isFrugal ? "frugal" : "stub";
-    const QString entryName = isFrugal ? ui->textUefiEntryFrugal->text() : ui->textEntryName->text();
+    if (!copyKernel()) {
+        return false;
+    }
+
+    QString disk;
+    const auto partition = espPartition(esp, &disk);
+    if (!partition) {
+        return false;
+    }
 
     QStringList args;
-    args << "--disk" << disk << "--part" << part << "--create"
+    args << "--disk" << disk << "--part" << QString::number(partition->number) << "--create"
          << "--label" << entryName << "--loader"
          << QString("\\EFI\\%1\\%2\\vmlinuz").arg(distro, efiDir) << "--unicode";
 
@@ -552,15 +768,527 @@ bool MainWindow::installEfiStub(const QString &esp)
         bootOptions = QString("%1 %2").arg(ui->textKernelOptions->text(), initrd);
     }
 
+    // Reinstalling the same kernel only refreshes the files; keep using the entry it already has
+    const bootsnapshot::Snapshot current = bootsnapshot::capture();
+    const QString loader = QString("\\EFI\\%1\\%2\\vmlinuz").arg(distro, efiDir);
+    if (const auto existing = duplicates::findEntry(current, partition->partuuid, loader, bootOptions)) {
+        return reuseBootEntry(current, *existing, entryName);
+    }
+
     if (!cmd.procAsRoot("efibootmgr", args << bootOptions)) {
         return false;
     }
+    efivars::recordWrites(efivars::variableWrites(args));
+    return true;
+}
+
+// Install the kernel as a Boot Loader Specification entry for systemd-boot. Only the first install
+// creates a Boot#### variable; later kernels are file writes on the ESP.
+bool MainWindow::installBlsEntry(const QString &esp)
+{
+    if (esp.isEmpty() || espMountPoint.isEmpty()) {
+        return false;
+    }
+
+    const QString rootDir = mountPartition(ui->comboPartitionStub->currentData().toString());
+    const QString bootDir = getBootLocation();
+    if (rootDir.isEmpty() || bootDir.isEmpty()) {
+        return false;
+    }
+    blsentry::Entry entry;
+    entry.title = ui->textEntryName->text();
+    entry.version = ui->comboKernel->currentText();
+    QFile machineIdFile(rootDir + "/etc/machine-id");
+    if (machineIdFile.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        entry.machineId = QString::fromLatin1(machineIdFile.readLine()).trimmed();
+    }
+    if (entry.machineId.isEmpty()) {
+        entry.machineId = distro.toLower();
+    }
+    entry.sortKey = distro.toLower();
+    entry.options = ui->textKernelOptions->text();
+
+    kernelInventory.setDirectory(bootDir, false);
+    const KernelInventory::Kernel kernel = kernelInventory.kernel(entry.version);
+    entry.hasAmdUcode = kernel.amdUcode.exists();
+    entry.hasIntelUcode = kernel.intelUcode.exists();
+    if (!kernel.vmlinuz.exists() || !kernel.initrd.exists()) {
+        qWarning() << "Kernel or initrd not found for" << entry.version;
+        return false;
+    }
+
+    // systemd-boot itself, copied from the running system the first time
+    const QString loaderFile = espMountPoint + "/EFI/systemd/" + blsentry::bootLoaderFileName();
+    if (!QFile::exists(loaderFile)) {
+        const QString source = QString(blsentry::SYSTEMD_BOOT_SOURCE_DIR) + '/' + blsentry::bootLoaderFileName();
+        if (!QFile::exists(source)) {
+            QMessageBox::critical(this, QApplication::applicationDisplayName(),
+                                  tr("systemd-boot is not installed on the EFI System Partition, and %1 was not "
+                                     "found to install it.")
+                                      .arg(source));
+            return false;
+        }
+        if (!cmd.procAsRoot("mkdir", {"-p", espMountPoint + "/EFI/systemd"})
+            || !cmd.procAsRoot("cp", {source, loaderFile})) {
+            return false;
+        }
+    }
+
+    const QString targetDir = espMountPoint + blsentry::kernelDir(entry);
+    const QString entriesDir = espMountPoint + blsentry::ENTRIES_DIR;
+    if (!cmd.procAsRoot("mkdir", {"-p", targetDir, entriesDir})) {
+        return false;
+    }
+    QList<QStringList> copies {{"cp", kernel.vmlinuz.path, targetDir + "/linux"},
+                               {"cp", kernel.initrd.path, targetDir + "/initrd"}};
+    if (entry.hasAmdUcode) {
+        copies.append({"cp", kernel.amdUcode.path, targetDir + "/amd-ucode.img"});
+    }
+    if (entry.hasIntelUcode) {
+        copies.append({"cp", kernel.intelUcode.path, targetDir + "/intel-ucode.img"});
+    }
+
+    const QString entryFile = entriesDir + '/' + blsentry::fileName(entry);
+    const QByteArray text = blsentry::render(entry).toUtf8();
+    QFile existingEntry(entryFile);
+    QTemporaryFile staged;
+    if (!existingEntry.open(QIODevice::ReadOnly) || existingEntry.readAll() != text) {
+        if (!staged.open() || staged.write(text) != text.size() || !staged.flush()) {
+            return false;
+        }
+        copies.append({"cp", staged.fileName(), entryFile});
+    }
+    if (!cmd.procAsRootBatch(copies)) {
+        return false;
+    }
+    qInfo() << "Boot Loader Specification entry written to" << entryFile;
+
+    // One stable NVRAM entry for systemd-boot, left alone once it exists
+    QString disk;
+    const auto partition = espPartition(esp, &disk);
+    if (!partition) {
+        return false;
+    }
+    if (duplicates::findEntry(bootsnapshot::capture(), partition->partuuid, blsentry::bootLoaderPath(), {})) {
+        return true;
+    }
+    if (!checkNvramHeadroom(
+            efivars::estimateLoadOptionSize(blsentry::SYSTEMD_BOOT_LABEL, blsentry::bootLoaderPath()))) {
+        return false;
+    }
+    const QStringList args {"--disk", disk, "--part", QString::number(partition->number), "--create",
+                            "--label", blsentry::SYSTEMD_BOOT_LABEL, "--loader", blsentry::bootLoaderPath()};
+    if (!cmd.procAsRoot("efibootmgr", args)) {
+        return false;
+    }
+    efivars::recordWrites(efivars::variableWrites(args));
+    return true;
+}
+
+// Install the kernel into the next A/B slot. Its entry is tried once through BootNext and
+// only becomes the default when promoted from the Kernel slots dialog (or --promote-slot).
+bool MainWindow::installKernelSlot(const QString &esp)
+{
+    if (esp.isEmpty() || espMountPoint.isEmpty()) {
+        return false;
+    }
+    kernelInventory.setDirectory(getBootLocation(), false);
+    const KernelInventory::Kernel kernel = kernelInventory.kernel(ui->comboKernel->currentText());
+    if (!kernel.vmlinuz.exists() || !kernel.initrd.exists()) {
+        qWarning() << "Kernel or initrd not found:" << kernel.vmlinuz.path << kernel.initrd.path;
+        return false;
+    }
+
+    const auto partition = espPartition(esp);
+    if (!partition) {
+        return false;
+    }
+
+    const bootsnapshot::Snapshot current = bootsnapshot::captureWithBootNext();
+    const QList<kernelslots::Slot> slotEntries = kernelslots::findSlots(current, distro);
+    std::optional<quint16> bootCurrent;
+    if (const auto var = bootsnapshot::readVariable("BootCurrent")) {
+        const QList<quint16> numbers = bootsnapshot::decodeUint16List(var->data);
+        if (!numbers.isEmpty()) {
+            bootCurrent = numbers.constFirst();
+        }
+    }
+    const QChar letter = kernelslots::pickSlot(
+        slotEntries, settings.value("stubSlots", kernelslots::DEFAULT_SLOT_COUNT).toInt(), bootCurrent);
+    const auto existing = std::find_if(slotEntries.cbegin(), slotEntries.cend(),
+                                       [letter](const kernelslots::Slot &slot) { return slot.letter == letter; });
+
+    // Files already in any slot directory, as ESP paths
+    QStringList existingFiles;
+    const QString distroDir = espMountPoint + "/EFI/" + distro;
+    const QStringList slotDirs = QDir(distroDir).entryList({"slot-*"}, QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString &dir : slotDirs) {
+        const QStringList files = QDir(distroDir + '/' + dir).entryList(QDir::Files);
+        for (const QString &file : files) {
+            existingFiles.append(QString("\\EFI\\%1\\%2\\%3").arg(distro, dir, file));
+        }
+    }
+    const auto toEspFile = [this](const QString &espPath) {
+        return espMountPoint + QString(espPath).replace('\\', '/');
+    };
+
+    // Microcode goes before the initrd; the kernel always lives in its own slot
+    struct Image {
+        QString source;
+        QString base;
+        QString suffix;
+    };
+    const QList<Image> images {{kernel.vmlinuz.path, "vmlinuz", {}},
+                               {kernel.amdUcode.path, "amducode", "img"},
+                               {kernel.intelUcode.path, "intucode", "img"},
+                               {kernel.initrd.path, "initrd", "img"}};
+    const QString ownDir = kernelslots::slotDir(distro, letter);
+    QList<QStringList> commands {{"mkdir", "-p", toEspFile(ownDir)}};
+    QString loader;
+    QStringList initrds;
+    for (const Image &image : images) {
+        QFile file(image.source);
+        if (!file.open(QIODevice::ReadOnly)) {
+            continue; // microcode is optional, the kernel and initrd were checked above
+        }
+        QCryptographicHash hash(QCryptographicHash::Sha256);
+        hash.addData(&file);
+        const QString name = kernelslots::hashedName(image.base, hash.result(), image.suffix);
+        const QString espPath = image.base == "vmlinuz"
+                                    ? ownDir + '\\' + name
+                                    : kernelslots::placeFile(name, distro, letter, existingFiles);
+        if (!existingFiles.contains(espPath, Qt::CaseInsensitive)) {
+            commands.append({"cp", image.source, toEspFile(espPath)});
+        }
+        if (image.base == "vmlinuz") {
+            loader = espPath;
+        } else {
+            initrds.append(espPath);
+        }
+    }
+
+    loadoption::LoadOption option;
+    option.description = kernelslots::label(ui->textEntryName->text(), letter);
+    loadoption::HardDriveMedia media;
+    media.partition = partition->number;
+    media.start = partition->start;
+    media.size = partition->size;
+    media.partuuid = partition->partuuid;
+    media.loaderPath = loader;
+    option.filePathList = loadoption::hardDriveFilePath(media);
+    option.optionalData
+        = loadoption::optionalDataFromString(kernelslots::optionsString(ui->textKernelOptions->text(), initrds));
+    const QByteArray data = loadoption::encode(option);
+
+    std::optional<quint16> existingNumber;
+    qint64 neededBytes = data.size();
+    if (existing != slotEntries.cend()) {
+        existingNumber = existing->bootNumber;
+        neededBytes -= current.find(bootsnapshot::bootVariableName(existing->bootNumber))->data.size();
+    }
+    if (neededBytes > 0 && !checkNvramHeadroom(neededBytes)) {
+        return false;
+    }
+    if (!cmd.procAsRootBatch(commands)) {
+        return false;
+    }
+
+    quint16 number = 0;
+    const bootsnapshot::Snapshot target = kernelslots::stage(current, existingNumber, data, &number);
+    // The helper refuses the writes if another program changed the entries since they were captured
+    const QList<bootsnapshot::Change> changes = bootsnapshot::versioned(bootsnapshot::diff(current, target), current);
+    if (!cmd.procAsRootEfivars(bootsnapshot::toHelperOperations(changes))) {
+        if (cmd.exitCode() == EXIT_CODE_CONFLICT) {
+            QMessageBox::critical(this, tr("Error"),
+                                  tr("The boot entries were changed by another program while the kernel was being "
+                                     "installed, please install it again."));
+        }
+        return false;
+    }
+    efivars::recordWrites(static_cast<int>(changes.size()));
+    qInfo() << "Installed kernel slot" << letter << "as" << bootsnapshot::bootVariableName(number);
+
+    // Images only the replaced kernel used
+    QStringList unused;
+    const QStringList unreferenced
+        = kernelslots::unreferencedFiles(kernelslots::findSlots(target, distro), existingFiles);
+    for (const QString &file : unreferenced) {
+        unused.append(toEspFile(file));
+    }
+    if (!unused.isEmpty()) {
+        cmd.procAsRoot("rm", QStringList {"-f"} + unused);
+    }
+    return true;
+}
+
+// Slot entries with their state; promoting one is a single BootOrder write. Returns true if it did.
+bool MainWindow::showKernelSlots(QWidget *uefiDialog)
+{
+    const bootsnapshot::Snapshot current = bootsnapshot::captureWithBootNext();
+    const QList<kernelslots::Slot> slotEntries = kernelslots::findSlots(current, {});
+    if (slotEntries.isEmpty()) {
+        QMessageBox::information(uefiDialog, QApplication::applicationDisplayName(),
+                                 tr("No kernel slots found. Kernels installed from the EFI stub tab get one."));
+        return false;
+    }
+    const auto firstNumber = [&current](const QString &name) -> std::optional<quint16> {
+        const bootsnapshot::Variable *var = current.find(name);
+        const QList<quint16> numbers = var ? bootsnapshot::decodeUint16List(var->data) : QList<quint16>();
+        return numbers.isEmpty() ? std::nullopt : std::optional(numbers.constFirst());
+    };
+    const std::optional<quint16> bootNext = firstNumber("BootNext");
+    const std::optional<quint16> bootDefault = firstNumber("BootOrder");
+    std::optional<quint16> bootCurrent;
+    if (const auto var = bootsnapshot::readVariable("BootCurrent")) {
+        const QList<quint16> numbers = bootsnapshot::decodeUint16List(var->data);
+        if (!numbers.isEmpty()) {
+            bootCurrent = numbers.constFirst();
+        }
+    }
+
+    QDialog dialog(uefiDialog);
+    dialog.setWindowTitle(tr("Kernel slots"));
+    auto *layout = new QVBoxLayout(&dialog);
+    auto *table = new QTableWidget(static_cast<int>(slotEntries.size()), 4, &dialog);
+    table->setHorizontalHeaderLabels({tr("Entry"), tr("Description"), tr("Kernel"), tr("State")});
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table->setSelectionBehavior(QAbstractItemView::SelectRows);
+    table->setSelectionMode(QAbstractItemView::SingleSelection);
+    table->verticalHeader()->hide();
+    for (int row = 0; row < slotEntries.size(); ++row) {
+        const kernelslots::Slot &slot = slotEntries.at(row);
+        QStringList state;
+        if (bootDefault == slot.bootNumber) {
+            state << tr("default");
+        }
+        if (bootNext == slot.bootNumber) {
+            state << tr("next boot");
+        }
+        if (bootCurrent == slot.bootNumber) {
+            state << tr("running");
+        }
+        table->setItem(row, 0, new QTableWidgetItem(bootsnapshot::bootVariableName(slot.bootNumber)));
+        table->setItem(row, 1, new QTableWidgetItem(slot.label));
+        table->setItem(row, 2, new QTableWidgetItem(slot.loader.section('\\', -1)));
+        table->setItem(row, 3, new QTableWidgetItem(state.join(", ")));
+    }
+    table->resizeColumnsToContents();
+    table->setMinimumWidth(500);
+    table->selectRow(0);
+
+    auto *buttons = new QDialogButtonBox(QDialogButtonBox::Close, &dialog);
+    auto *pushPromote = buttons->addButton(tr("Make &default"), QDialogButtonBox::ActionRole);
+    pushPromote->setToolTip(tr("Move the selected kernel to the front of the boot order. To roll back, make the "
+                               "previous kernel the default again."));
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    connect(pushPromote, &QPushButton::clicked, &dialog, [&]() {
+        const int row = table->currentRow();
+        if (row < 0) {
+            return;
+        }
+        const QList<bootsnapshot::Change> changes = bootsnapshot::versioned(
+            bootsnapshot::diff(current, kernelslots::promote(current, slotEntries.at(row).bootNumber)), current);
+        if (!changes.isEmpty() && !cmd.procAsRootEfivars(bootsnapshot::toHelperOperations(changes))) {
+            QMessageBox::critical(&dialog, tr("Error"),
+                                  cmd.exitCode() == EXIT_CODE_CONFLICT
+                                      ? tr("The boot order was changed by another program, please open the kernel "
+                                           "slots again.")
+                                      : tr("Something went wrong, could not change the boot order."));
+            return;
+        }
+        efivars::recordWrites(static_cast<int>(changes.size()));
+        dialog.accept();
+    });
+    layout->addWidget(table);
+    layout->addWidget(buttons);
+    return dialog.exec() == QDialog::Accepted;
+}
+
+// Relabel and activate an existing entry and move it to the front of BootOrder, in one helper call
+bool MainWindow::reuseBootEntry(const bootsnapshot::Snapshot &current, quint16 number, const QString &label)
+{
+    bootsnapshot::Snapshot target = current;
+    const QString name = bootsnapshot::bootVariableName(number);
+    QList<quint16> order;
+    quint32 orderAttributes = bootsnapshot::BOOT_VARIABLE_ATTRIBUTES;
+    for (bootsnapshot::Variable &var : target.variables) {
+        if (var.name == name) {
+            if (auto option = loadoption::decode(var.data)) {
+                option->description = label;
+                option->attributes |= loadoption::LOAD_OPTION_ACTIVE;
+                var.data = loadoption::encode(*option);
+            }
+        } else if (var.name == "BootOrder") {
+            order = bootsnapshot::decodeUint16List(var.data);
+            orderAttributes = var.attributes;
+        }
+    }
+    order.removeAll(number);
+    order.prepend(number);
+    target.variables.removeIf([](const bootsnapshot::Variable &var) { return var.name == "BootOrder"; });
+    target.variables.append({"BootOrder", orderAttributes, bootsnapshot::encodeUint16List(order)});
+
+    const QList<bootsnapshot::Change> changes = bootsnapshot::diff(current, target);
+    if (changes.isEmpty()) {
+        return true;
+    }
+    qDebug() << "Reusing existing boot entry" << name << "for" << label;
+    if (!cmd.procAsRootEfivars(bootsnapshot::toHelperOperations(changes))) {
+        return false;
+    }
+    efivars::recordWrites(static_cast<int>(changes.size()));
     return true;
 }
 
+// Remove entries that repeat another entry's loader, keeping the one that boots first
+QStringList MainWindow::removeDuplicateEntries(QWidget *uefiDialog)
+{
+    const bootsnapshot::Snapshot current = bootsnapshot::captureWithBootNext();
+    const bool includeOptions = !settings.value("duplicatesIgnoreOptions", false).toBool();
+    const QList<duplicates::Group> groups = duplicates::findDuplicates(current, includeOptions);
+    if (groups.isEmpty()) {
+        QMessageBox::information(uefiDialog, QApplication::applicationDisplayName(),
+                                 tr("No duplicate boot entries found."));
+        return {};
+    }
+
+    QList<quint16> numbers;
+    QStringList details;
+    for (const duplicates::Group &group : groups) {
+        QStringList names;
+        for (quint16 number : group.remove) {
+            names.append(bootsnapshot::bootVariableName(number));
+        }
+        numbers += group.remove;
+        details.append(tr("Keep %1 (%2), remove %3")
+                           .arg(bootsnapshot::bootVariableName(group.keep), group.description, names.join(", ")));
+    }
+    QMessageBox box(QMessageBox::Question, tr("Remove duplicates"),
+                    tr("Found %n duplicate boot entries. Remove them and keep the entry that comes first in the "
+                       "boot order?",
+                       nullptr, static_cast<int>(numbers.size())),
+                    QMessageBox::Yes | QMessageBox::No, uefiDialog);
+    box.setDetailedText(details.join('\n'));
+    if (box.exec() != QMessageBox::Yes) {
+        return {};
+    }
+
+    const QList<bootsnapshot::Change> changes = bootsnapshot::diff(current, duplicates::withoutEntries(current, numbers));
+    if (!cmd.procAsRootEfivars(bootsnapshot::toHelperOperations(changes))) {
+        QMessageBox::critical(uefiDialog, tr("Error"), tr("Something went wrong, could not remove duplicates."));
+        return {};
+    }
+    efivars::recordWrites(static_cast<int>(changes.size()));
+
+    QStringList removed;
+    for (quint16 number : std::as_const(numbers)) {
+        removed.append(bootsnapshot::bootVariableName(number).mid(4));
+    }
+    return removed;
+}
+
+// Ask before writing when the firmware variable store is close to full, or its capacity is unknown
+bool MainWindow::checkNvramHeadroom(qint64 neededBytes)
+{
+    const efivars::StoreUsage usage = efivars::readUsage();
+    const std::optional<bool> headroom = efivars::hasHeadroom(usage, neededBytes);
+    if (!headroom) {
+        qWarning() << "NVRAM headroom unknown: the kernel reports no variable store capacity";
+        if (nvramCapacityUnknownAccepted) {
+            return true;
+        }
+        nvramCapacityUnknownAccepted
+            = QMessageBox::Yes
+              == QMessageBox::warning(
+                  this, tr("UEFI variable store capacity unknown"),
+                  tr("The free space in the UEFI variable store could not be determined, so this write can't be "
+                     "checked against it. Some firmware stops creating boot entries or fails to boot when the store "
+                     "fills up.\nDo you want to continue anyway?"),
+                  QMessageBox::Yes | QMessageBox::No, QMessageBox::No);
+        return nvramCapacityUnknownAccepted;
+    }
+    if (*headroom) {
+        return true;
+    }
+    qWarning() << "Low NVRAM headroom:" << usage.freeBytes << "of" << usage.totalBytes << "bytes free, need"
+               << neededBytes;
+    return QMessageBox::Yes
+           == QMessageBox::warning(
+               this, tr("UEFI variable store almost full"),
+               tr("Only %1 of %2 are free in the UEFI variable store. Some firmware stops creating boot entries "
+                  "or fails to boot when the store fills up.\nDo you want to continue anyway?")
+                   .arg(locale().formattedDataSize(usage.freeBytes), locale().formattedDataSize(usage.totalBytes)),
+               QMessageBox::Yes | QMessageBox::No, QMessageBox::No);
+}
+
 bool MainWindow::isLuks(const QString &part)
 {
-    return cmd.procAsRoot("cryptsetup", {"isLuks", part});
+    return luksHeader(part).has_value();
+}
+
+// The first lookup also reads the other LUKS partitions of the last device scan, so classifying
+// all of them costs a single helper call
+std::optional<luks::Header> MainWindow::luksHeader(const QString &part)
+{
+    const QString device = part.startsWith("/dev/") ? part : "/dev/" + part;
+    if (!luksHeaders.contains(device)) {
+        loadLuksHeaders(QStringList(luksPartitions) << device);
+    }
+    return luksHeaders.value(device);
+}
+
+// Reads the LUKS headers that aren't cached yet
+void MainWindow::loadLuksHeaders(const QStringList &devices)
+{
+    QStringList missing;
+    for (const QString &device : devices) {
+        if (!luksHeaders.contains(device) && !missing.contains(device)) {
+            missing.append(device);
+        }
+    }
+    if (missing.isEmpty()) {
+        return;
+    }
+    const QJsonObject headers = readDevices("luks", missing);
+    for (const QString &device : std::as_const(missing)) {
+        // Devices the helper could not be run for are tried again on the next lookup
+        if (headers.contains(device)) {
+            luksHeaders.insert(device, luks::fromJson(headers.value(device).toObject()));
+        }
+    }
+}
+
+// The device-mapper name an already unlocked container is open as, found through its holders in sysfs
+QString MainWindow::luksMapping(const QString &part) const
+{
+    const QString sysDir = "/sys/class/block/" + part.section('/', -1);
+    const QStringList holders = QDir(sysDir + "/holders").entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString &holder : holders) {
+        QFile nameFile("/sys/class/block/" + holder + "/dm/name");
+        if (nameFile.open(QIODevice::ReadOnly)) {
+            return QString::fromUtf8(nameFile.readAll()).trimmed();
+        }
+    }
+    return {};
+}
+
+// Where an already unlocked container's mapping is mounted
+QString MainWindow::luksMountPoint(const QString &part) const
+{
+    const QString mapping = luksMapping(part);
+    if (mapping.isEmpty()) {
+        return {};
+    }
+    const QString mapper = "/dev/mapper/" + mapping;
+    const QString dmDevice = QFileInfo(mapper).canonicalFilePath();
+    const QList<QStorageInfo> volumes = QStorageInfo::mountedVolumes();
+    for (const QStorageInfo &volume : volumes) {
+        const QString source = QString::fromUtf8(volume.device());
+        if (source == mapper || (!dmDevice.isEmpty() && source == dmDevice)) {
+            return volume.rootPath();
+        }
+    }
+    return {};
 }
 
 QString MainWindow::mountPartition(QString part)
@@ -595,15 +1323,17 @@ QString MainWindow::mountPartition(QString part)
     }
 
     if (isLuks(part)) {
-
-        mountDir = getMountPoint(part);
+        mountDir = luksMountPoint(part);
 
         if (!mountDir.isEmpty()) {
             return mountDir;
         }
 
-        QString luksDevice;
-        luksDevice = openLuks(part);
+        // Opened earlier, e.g. together with another container, but not mounted yet
+        QString luksDevice = luksMapping(part);
+        if (luksDevice.isEmpty()) {
+            luksDevice = openLuks(part);
+        }
         if (!luksDevice.isEmpty()) {
             mountDir = MOUNT_BASE + "/" + luksDevice;
             if (!QDir(mountDir).exists()) {
@@ -643,188 +1373,551 @@ QString MainWindow::mountPartition(QString part)
 // Add list of devices to comboLocation
 void MainWindow::addDevToList()
 {
+    // Both drive combo boxes show the model, so both see the reset
+    ui->comboDrive->blockSignals(true);
+    ui->comboDriveStub->blockSignals(true);
     listDevices();
 
+    // Start on the drive holding the running system, otherwise the first one
     auto *comboDrive = (ui->tabWidget->currentIndex() == Tab::Frugal) ? ui->comboDrive : ui->comboDriveStub;
-    comboDrive->blockSignals(true);
-    comboDrive->clear();
-    comboDrive->addItems(driveList);
+    const QModelIndex root = blockDevices.driveIndex(rootDrive);
+    comboDrive->setCurrentIndex(root.isValid() ? root.row() : 0);
+
+    ui->comboDrive->blockSignals(false);
+    ui->comboDriveStub->blockSignals(false);
+
+    filterDrivePartitions();
+}
 
-    QString currentDrive = comboDrive->currentText().section(' ', 0, 0);
+// BLS entries and kernel slots keep each kernel in its own directory; only the legacy stub install
+// overwrites \EFI\<distro>\stub
+bool MainWindow::usesStubDirectory() const
+{
+    return !ui->checkBls->isChecked()
+           && settings.value("stubSlots", kernelslots::DEFAULT_SLOT_COUNT).toInt() <= 1;
+}
 
-    const int driveCount = comboDrive->count();
+// Whether the kernel set fits on the ESP. With its FAT read, every file is rounded up to whole clusters
+// and the files the install deletes first count as free; otherwise the mounted ESP is asked.
+bool MainWindow::checkSizeEsp(const std::optional<fatfs::Summary> &esp)
+{
+    const bool isFrugal = ui->tabWidget->currentIndex() == Tab::Frugal;
+    const QString sourceDir = isFrugal ? frugalDir : getBootLocation();
+    qDebug() << "Source Dir:" << sourceDir;
+    kernelInventory.setDirectory(sourceDir, isFrugal);
+    const KernelInventory::Kernel kernel = kernelInventory.kernel(ui->comboKernel->currentText());
+
+    qDebug() << "VMLINUZ:" << kernel.vmlinuz.path;
+    qDebug() << "INITRD :" << kernel.initrd.path;
+    if (kernel.intelUcode.exists()) {
+        qDebug() << "INTEL-UCODE :" << kernel.intelUcode.path;
+    }
+    if (kernel.amdUcode.exists()) {
+        qDebug() << "AMD-UCODE :" << kernel.amdUcode.path;
+    }
+    // Missing files count as empty
+    const qint64 vmlinuzSize = std::max<qint64>(kernel.vmlinuz.size, 0);
+    const qint64 initrdSize = std::max<qint64>(kernel.initrd.size, 0);
+    const qint64 amdUcodeSize = std::max<qint64>(kernel.amdUcode.size, 0);
+    const qint64 intUcodeSize = std::max<qint64>(kernel.intelUcode.size, 0);
+    if (!esp) {
+        const qint64 totalSize = vmlinuzSize + initrdSize + amdUcodeSize + intUcodeSize;
+        qDebug() << "Total needed:" << totalSize;
+        const qint64 espFreeSpace = QStorageInfo(espMountPoint).bytesAvailable();
+        qDebug() << "ESP Free    :" << espFreeSpace;
+        return totalSize <= espFreeSpace;
+    }
+
+    const quint64 needed = fatfs::spaceNeeded({vmlinuzSize, initrdSize, amdUcodeSize, intUcodeSize}, esp->clusterSize);
+    quint64 available = esp->freeBytes();
+    // BLS entries and kernel slots keep what is there; the stub and frugal files are replaced
+    if (isFrugal || usesStubDirectory()) {
+        available += fatfs::spaceInDirectory(*esp, "/EFI/" + distro + (isFrugal ? "/frugal" : "/stub"));
+    }
+    qDebug() << "Total needed:" << needed << "in" << esp->clusterSize << "byte clusters";
+    qDebug() << "ESP Free    :" << available;
+    return needed <= available;
+}
 
-    // Set current index based on rootDrive
-    if (!rootDrive.isEmpty() && !currentDrive.isEmpty() && rootDrive != currentDrive) {
-        for (int index = 0; index < driveCount; ++index) {
-            const QString drive = comboDrive->itemText(index).section(' ', 0, 0);
-            if (drive == rootDrive) {
-                comboDrive->setCurrentIndex(index);
-                break;
+void MainWindow::filterDrivePartitions()
+{
+    auto *comboDrive = (ui->tabWidget->currentIndex() == Tab::Frugal) ? ui->comboDrive : ui->comboDriveStub;
+    auto *comboPartition = (ui->tabWidget->currentIndex() == Tab::Frugal) ? ui->comboPartition : ui->comboPartitionStub;
+
+    const auto purpose = (ui->tabWidget->currentIndex() == Tab::Frugal) ? BlockDeviceModel::Purpose::Frugal
+                                                                        : BlockDeviceModel::Purpose::Linux;
+
+    comboPartition->blockSignals(true);
+    comboPartition->clear();
+    const QString drive = comboDrive->currentData(BlockDeviceModel::NameRole).toString();
+    if (!drive.isEmpty()) {
+        for (const auto *partition : blockDevices.partitions(drive, purpose)) {
+            comboPartition->addItem(partition->displayText(), partition->name);
+        }
+    }
+    comboPartition->blockSignals(false);
+
+    guessPartition();
+}
+
+// The kernels on a root, the one to select with its options, and the distribution's names
+scancache::KernelChoice MainWindow::readKernelChoice(const rootfs::Snapshot &root)
+{
+    // Kernels are on the /boot partition the root's fstab names, or in its /boot directory
+    const RootProfile profile = rootProfile(root);
+    std::optional<rootfs::Snapshot> separateBoot;
+    const QString &bootSource = profile.bootSource;
+    if (!bootSource.isEmpty()) {
+        qDebug().noquote() << "/boot partition :" << bootSource;
+        separateBoot = readRoot(bootSource);
+        if (!separateBoot) {
+            qWarning() << "Failed to read boot partition" << bootSource;
+        }
+    }
+    const rootfs::Snapshot &boot = separateBoot ? *separateBoot : root;
+    const QString bootDir = separateBoot || !profile.hasBootDirectory ? "/" : "/boot";
+
+    QStringList kernelFiles = boot.list(bootDir, "vmlinuz-");
+    std::transform(kernelFiles.begin(), kernelFiles.end(), kernelFiles.begin(),
+                   [](const QString &file) { return file.mid(QStringLiteral("vmlinuz-").length()); });
+
+    scancache::KernelChoice choice;
+    choice.kernels = utils::sortKernelVersions(kernelFiles);
+    if (choice.kernels.isEmpty()) {
+        return choice;
+    }
+    choice.kernel = choice.kernels.constFirst();
+
+    if (root.mountPoint == "/") {
+        QString kernel;
+        cmd.proc("uname", {"-r"}, &kernel, nullptr, QuietMode::Yes);
+        kernel = kernel.trimmed();
+        if (choice.kernels.contains(kernel)) {
+            choice.kernel = kernel;
+        }
+    }
+
+    choice.options = getKernelOptions(boot, bootDir, root, profile, choice.kernel);
+    choice.entryName = profile.entryName;
+    choice.distro = profile.distro;
+    return choice;
+}
+
+void MainWindow::applyKernelChoice(const scancache::KernelChoice &choice)
+{
+    ui->comboKernel->clear();
+    ui->textKernelOptions->setText("");
+    if (choice.kernels.isEmpty()) {
+        return;
+    }
+    ui->comboKernel->addItems(choice.kernels);
+    ui->comboKernel->setCurrentText(choice.kernel);
+    ui->textKernelOptions->setText(choice.options);
+    distro = choice.distro;
+    if (!choice.entryName.isEmpty()) {
+        ui->textEntryName->setText(choice.entryName);
+    }
+}
+
+// Reads the kernel choice off a root and keeps it, under the partition's identity, for the next launch
+scancache::KernelChoice MainWindow::rememberKernelChoice(const QString &partition, const rootfs::Snapshot &root)
+{
+    const scancache::KernelChoice choice = readKernelChoice(root);
+    const auto [partuuid, uuid] = scancache::identity(scanCache.devices, partition);
+    if (partuuid.isEmpty() && uuid.isEmpty()) {
+        scanCache.kernels.remove(partition);
+        return choice;
+    }
+    // Temporary mounts are gone by the next launch, so their files can't vouch for the choice
+    const bool lastingMount = !root.mountPoint.isEmpty() && !root.mountPoint.startsWith(MOUNT_BASE);
+    scanCache.kernels.insert(partition, {partuuid, uuid,
+                                         lastingMount ? scancache::mountedStamps(root.mountPoint)
+                                                      : QList<scancache::Stamp>(),
+                                         choice});
+    return choice;
+}
+
+// Reads the partition whose cached kernels are shown, and shows the result if it differs
+void MainWindow::revalidateKernelChoice()
+{
+    const QString partition = std::exchange(staleKernelChoice, {});
+    if (partition.isEmpty() || ui->comboPartitionStub->currentData().toString() != partition) {
+        return;
+    }
+    const scancache::KernelChoice shown = scanCache.kernels.value(partition).choice;
+    const auto root = readRoot(partition);
+    if (!root) {
+        return;
+    }
+    const scancache::KernelChoice choice = rememberKernelChoice(partition, *root);
+    if (choice != shown) {
+        qDebug() << "Kernels on" << partition << "changed since the last scan";
+        applyKernelChoice(choice);
+    }
+}
+
+// The kernels and boot configuration of a Linux root or /boot partition, given by name (sda2), path
+// or fstab tag. Unmounted ext4 and btrfs are read off the device; mounted file systems from their
+// mount point. Only LUKS containers and other file systems still get mounted.
+std::optional<rootfs::Snapshot> MainWindow::readRoot(const QString &source)
+{
+    QString device = source;
+    if (source.contains('=')) {
+        device = rootfs::resolveSource(source);
+    } else if (!source.startsWith("/dev/")) {
+        device = "/dev/" + source;
+    }
+    if (const auto cached = rootSnapshots.constFind(device); !device.isEmpty() && cached != rootSnapshots.constEnd()) {
+        return *cached;
+    }
+
+    std::optional<rootfs::Snapshot> snapshot;
+    QString mountPoint = device.isEmpty() ? QString() : getMountPoint(device);
+    if (!device.isEmpty() && mountPoint.isEmpty()) {
+        // The helper runs anyway, so the other likely roots only it can read come along
+        const QStringList others = helperOnlyRoots(device);
+        const QJsonObject results = readDevices("root", QStringList {device} + others);
+        for (const QString &other : others) {
+            auto otherSnapshot = rootfs::fromJson(results.value(other).toObject());
+            if (otherSnapshot && otherSnapshot->isComplete()) {
+                otherSnapshot->device = other;
+                rootSnapshots.insert(other, *otherSnapshot);
             }
         }
+        const QJsonObject result = results.value(device).toObject();
+        snapshot = rootfs::fromJson(result);
+        if (!snapshot) {
+            qDebug() << "Could not read" << device << result.value("error").toString();
+        } else if (!snapshot->isComplete()) {
+            qDebug() << "Some files on" << device << "cannot be read without mounting it";
+            snapshot.reset();
+        } else {
+            snapshot->device = device;
+        }
     }
+    if (!snapshot) {
+        if (mountPoint.isEmpty()) {
+            mountPoint = mountPartition(device.isEmpty() ? source : device);
+        }
+        if (mountPoint.isEmpty()) {
+            return std::nullopt;
+        }
+        snapshot = readMountedRoot(mountPoint);
+    }
+    if (!device.isEmpty()) {
+        rootSnapshots.insert(device, *snapshot);
+    }
+    return snapshot;
+}
 
-    comboDrive->blockSignals(false);
+// The partition a root's fstab mounts on /boot, e.g. /dev/sda1; empty when /boot is on the root
+QString MainWindow::separateBootDevice(const rootfs::Snapshot &root)
+{
+    const QString bootSource = rootProfile(root).bootSource;
+    return bootSource.isEmpty() ? QString() : rootfs::resolveSource(bootSource);
+}
 
-    filterDrivePartitions();
+// Candidate roots that are neither read yet nor mounted, and need the helper to be read at all
+QStringList MainWindow::helperOnlyRoots(const QString &device) const
+{
+    if (QFileInfo(device).isReadable()) {
+        return {};
+    }
+    QStringList devices;
+    const auto candidates
+        = RootPrefetcher::rank(blockDevices.partitions({}, BlockDeviceModel::Purpose::Linux), rootPartition);
+    for (const BlockDeviceModel::Device *partition : candidates) {
+        const QString other = "/dev/" + partition->name;
+        if (other != device && partition->mountpoint.isEmpty() && !rootSnapshots.contains(other)
+            && !QFileInfo(other).isReadable()) {
+            devices.append(other);
+        }
+    }
+    return devices;
 }
 
-bool MainWindow::checkSizeEsp()
+// Starts reading the likeliest roots in the background, so choosing one of them needs no wait.
+// Those only the helper can read are left to the first foreground read; see helperOnlyRoots.
+void MainWindow::prefetchRoots()
 {
-    const bool isFrugal = ui->tabWidget->currentIndex() == Tab::Frugal;
-    const QString sourceDir = isFrugal ? frugalDir : getBootLocation();
-    qDebug() << "Source Dir:" << sourceDir;
-    const auto kernelFiles = utils::resolveKernelFiles(sourceDir, ui->comboKernel->currentText(), isFrugal);
-    const QString vmlinuz = kernelFiles.vmlinuz;
-    const QString initrd = kernelFiles.initrd;
-    const QString amdUcode = kernelFiles.amdUcode;
-    const QString intUcode = kernelFiles.intelUcode;
-
-    qDebug() << "VMLINUZ:" << vmlinuz;
-    qDebug() << "INITRD :" << initrd;
-    if (QFile(intUcode).exists()) {
-        qDebug() << "INTEL-UCODE :" << intUcode;
-    }
-    if (QFile(amdUcode).exists()) {
-        qDebug() << "AMD-UCODE :" << amdUcode;
-    }
-    const qint64 vmlinuzSize = QFile(vmlinuz).size();
-    const qint64 initrdSize = QFile(initrd).size();
-    const qint64 amdUcodeSize = QFile(amdUcode).exists() ? QFile(amdUcode).size() : 0;
-    const qint64 intUcodeSize = QFile(intUcode).exists() ? QFile(intUcode).size() : 0;
-    const qint64 totalSize = vmlinuzSize + initrdSize + amdUcodeSize + intUcodeSize;
-    qDebug() << "Total needed:" << totalSize;
-
-    const qint64 espFreeSpace = QStorageInfo(espMountPoint).bytesAvailable();
-    qDebug() << "ESP Free    :" << espFreeSpace;
-    if (totalSize > espFreeSpace) {
-        return false;
+    QList<RootPrefetcher::Target> targets;
+    const auto candidates
+        = RootPrefetcher::rank(blockDevices.partitions({}, BlockDeviceModel::Purpose::Linux), rootPartition);
+    for (const BlockDeviceModel::Device *partition : candidates) {
+        const QString device = "/dev/" + partition->name;
+        if (!rootSnapshots.contains(device)
+            && (!partition->mountpoint.isEmpty() || QFileInfo(device).isReadable())) {
+            targets.append({device, partition->mountpoint});
+        }
+    }
+    rootPrefetcher.prefetch(targets);
+}
+
+// Keeps what a background read found, and reads the root's separate /boot next
+void MainWindow::prefetchedRoot(const QString &device, const std::optional<rootfs::Snapshot> &snapshot)
+{
+    if (snapshot && !rootSnapshots.contains(device)) {
+        rootSnapshots.insert(device, *snapshot);
+        const QString bootDevice = separateBootDevice(*snapshot);
+        if (!bootDevice.isEmpty() && !rootSnapshots.contains(bootDevice)) {
+            const auto *boot = blockDevices.device(bootDevice.mid(QStringLiteral("/dev/").size()));
+            if (boot && (!boot->mountpoint.isEmpty() || QFileInfo(bootDevice).isReadable())) {
+                rootPrefetcher.prefetch({{bootDevice, boot->mountpoint}});
+            }
+        }
+    }
+    showPendingKernelChoice();
+}
+
+// Shows the kernels of the selected partition unless a background read of it or its /boot is still
+// running; whatever those reads could not get is read here
+void MainWindow::showPendingKernelChoice()
+{
+    const QString partition = pendingKernelChoice;
+    if (partition.isEmpty()) {
+        return;
+    }
+    if (ui->comboPartitionStub->currentData().toString() != partition) {
+        pendingKernelChoice.clear();
+        return;
+    }
+    const QString device = "/dev/" + partition;
+    if (rootPrefetcher.isPending(device)) {
+        return;
+    }
+    if (const auto cached = rootSnapshots.constFind(device); cached != rootSnapshots.constEnd()) {
+        const QString bootDevice = separateBootDevice(*cached);
+        if (!bootDevice.isEmpty() && rootPrefetcher.isPending(bootDevice)) {
+            return;
+        }
+    }
+    pendingKernelChoice.clear();
+    const auto root = readRoot(partition);
+    if (root) {
+        applyKernelChoice(rememberKernelChoice(partition, *root));
+    }
+}
+
+// Files only root may read, such as a grub.cfg with mode 0600, are read through the helper
+rootfs::Snapshot MainWindow::readMountedRoot(const QString &mountPoint)
+{
+    rootfs::Snapshot snapshot = rootfs::readDirectory(mountPoint);
+    QStringList unreadable;
+    for (auto it = snapshot.files.cbegin(); it != snapshot.files.cend(); ++it) {
+        if (!it->readable) {
+            unreadable.append(QDir::cleanPath(mountPoint + it.key()));
+        }
+    }
+    const QMap<QString, QByteArray> contents = cmd.readFilesAsRoot(unreadable);
+    for (auto it = snapshot.files.begin(); it != snapshot.files.end(); ++it) {
+        const auto file = contents.constFind(QDir::cleanPath(mountPoint + it.key()));
+        if (!it->readable && file != contents.constEnd()) {
+            it->readable = true;
+            it->contents = *file;
+        }
+    }
+    return snapshot;
+}
+
+// Profiles read off a device last until the next device scan, those of mounted roots until the files
+// they were parsed from change
+RootProfile MainWindow::rootProfile(const rootfs::Snapshot &root)
+{
+    const QString key = root.device.isEmpty() ? root.mountPoint : root.device;
+    auto profile = rootProfiles.constFind(key);
+    if (profile == rootProfiles.constEnd() || !profile->isCurrent()) {
+        profile = rootProfiles.insert(key, RootProfile::read(root));
+    }
+    return *profile;
+}
+
+RootProfile MainWindow::rootProfile(const QString &mountPoint)
+{
+    if (const auto profile = rootProfiles.constFind(mountPoint);
+        profile != rootProfiles.constEnd() && profile->isCurrent()) {
+        return *profile;
+    }
+    return rootProfile(readMountedRoot(mountPoint));
+}
+
+void MainWindow::promptFrugalStubInstall()
+{
+    int ret = QMessageBox::question(this, tr("UEFI Installer"),
+                                    tr("A recent frugal install has been detected. Do you wish to add a UEFI entry "
+                                       "direct to your UEFI system menu?"),
+                                    QMessageBox::Yes | QMessageBox::No, QMessageBox::No);
+
+    if (ret == QMessageBox::No) {
+        cmd.procElevated(cmd.helperLibraryPath(), {"write_checkfile"});
+        qApp->quit();
+        return;
+    } else {
+        ui->tabWidget->setCurrentIndex(Tab::Frugal);
     }
-    return true;
 }
 
-void MainWindow::filterDrivePartitions()
+void MainWindow::readBootEntries(QLabel *textTimeout, QLabel *textBootNext, QLabel *textBootCurrent,
+                                 QStringList *bootorder)
 {
-    auto *comboDrive = (ui->tabWidget->currentIndex() == Tab::Frugal) ? ui->comboDrive : ui->comboDriveStub;
-    auto *comboPartition = (ui->tabWidget->currentIndex() == Tab::Frugal) ? ui->comboPartition : ui->comboPartitionStub;
-
-    QStringList filteredPartitionList
-        = (ui->tabWidget->currentIndex() == Tab::Frugal) ? frugalPartitionList : linuxPartitionList;
+    // efibootmgr is not run again while the variables are the ones it listed last time in this boot
+    const EfivarWatcher::Fingerprints fingerprints = EfivarWatcher::scan(EFIVARS_DIR);
+    QString efiOut;
+    if (!scanCache.efibootmgr.isEmpty() && fingerprints == scanCache.efivars) {
+        efiOut = scanCache.efibootmgr;
+    } else {
+        cmd.proc("efibootmgr", {}, &efiOut);
+        scanCache.efivars = fingerprints;
+        scanCache.efibootmgr = efiOut;
+    }
+    const BootManagerState state = parseBootManager(efiOut);
 
-    comboPartition->blockSignals(true);
-    comboPartition->clear();
-    comboPartition->blockSignals(false);
-    QString drive = comboDrive->currentText().section(' ', 0, 0);
-    if (!drive.isEmpty()) {
-        QStringList drivePart = filteredPartitionList.filter(QRegularExpression("^" + QRegularExpression::escape(drive)));
-        comboPartition->blockSignals(true);
-        comboPartition->addItems(drivePart);
-        comboPartition->blockSignals(false);
+    if (partuuidIndex.isEmpty()) {
+        buildPartuuidIndex();
     }
 
-    guessPartition();
+    QList<BootEntryModel::Entry> entries;
+    entries.reserve(state.entryLines.size());
+    for (const auto &line : state.entryLines) {
+        if (const auto entry = entryFromLine(line)) {
+            entries.append(*entry);
+        }
+    }
+    bootEntries.setEntries(entries);
+    cachedTimeout = state.timeout;
+    textTimeout->setText(tr("Timeout: %1 seconds").arg(cachedTimeout));
+    textBootNext->setText(
+        tr("Boot Next: %1").arg(state.bootNext.isEmpty() ? tr("not set, will boot using list order") : state.bootNext));
+    if (!state.bootCurrent.isEmpty()) {
+        textBootCurrent->setText(tr("Boot Current: %1").arg(state.bootCurrent));
+    }
+    *bootorder = state.bootOrder;
+    nvramBatch.setCommitted(state.bootOrder, state.bootNext, cachedTimeout, state.activeFlags());
 }
 
-void MainWindow::selectKernel(const QString &rootDir)
+std::optional<BootEntryModel::Entry> MainWindow::entryFromLine(const QString &line) const
 {
-    QDir bootDir {getBootLocation(rootDir)};
-    QStringList kernelFiles = bootDir.entryList({"vmlinuz-*"}, QDir::Files | QDir::NoDotAndDotDot, QDir::Name);
-    std::transform(kernelFiles.begin(), kernelFiles.end(), kernelFiles.begin(),
-                   [](const QString &file) { return file.mid(QStringLiteral("vmlinuz-").length()); });
-    ui->comboKernel->clear();
-    ui->textKernelOptions->setText("");
+    auto entry = BootEntryModel::parseLine(line);
+    if (entry) {
+        entry->target = describeBootTarget(line, &entry->missing);
+    }
+    return entry;
+}
 
-    QStringList sortedKernelFiles = utils::sortKernelVersions(kernelFiles);
-    if (sortedKernelFiles.count() == 0) {
+// Patch the list with the boot variables another tool changed, from a single efibootmgr read
+void MainWindow::applyExternalChanges(QListView *listEntries, QLabel *textTimeout, QLabel *textBootNext,
+                                      QLabel *textBootCurrent)
+{
+    // Staged edits win; the changes are picked up once they are written
+    if (nvramBatch.hasPending() || (externalEntryChanges.isEmpty() && !externalGlobalsChanged)) {
         return;
     }
+    const QSet<QString> changedEntries = std::exchange(externalEntryChanges, {});
+    const bool globalsChanged = std::exchange(externalGlobalsChanged, false);
 
-    ui->comboKernel->addItems(sortedKernelFiles);
+    QString efiOut;
+    if (!cmd.proc("efibootmgr", {}, &efiOut, nullptr, QuietMode::Yes)) {
+        return;
+    }
+    const BootManagerState state = parseBootManager(efiOut);
+    QHash<QString, QString> lines;
+    for (const QString &line : state.entryLines) {
+        lines.insert(entryBootNum(line), line);
+    }
 
-    if (rootDir == "/") {
-        QString kernel;
-        cmd.proc("uname", {"-r"}, &kernel, nullptr, QuietMode::Yes);
-        kernel = kernel.trimmed();
-        if (ui->comboKernel->findText(kernel) != -1) {
-            ui->comboKernel->setCurrentText(kernel);
+    const QString selected = listEntries->currentIndex().data(BootEntryModel::BootNumRole).toString();
+    bool added = false;
+    for (const QString &bootNum : changedEntries) {
+        const QString line = lines.value(bootNum);
+        if (line.isEmpty()) {
+            bootEntries.removeEntry(bootNum);
+            nvramBatch.forgetEntry(bootNum);
+            continue;
+        }
+        if (const auto entry = entryFromLine(line)) {
+            added = bootEntries.updateEntry(*entry) || added;
         }
     }
 
-    getKernelOptions(bootDir.absolutePath(), rootDir, ui->comboKernel->currentText());
-    QString distroName;
-    if (!QFile::exists(rootDir + "/etc/antix-version") && !QFile::exists(rootDir + "/etc/mx-version")
-        && QFile::exists(rootDir + "/etc/os-release")) {
-        distroName = getDistroName(true, rootDir, "os-release");
-        distro = getDistroName(false, rootDir, "os-release");
-    } else {
-        distroName = getDistroName(true, rootDir, "lsb-release");
-        distro = getDistroName(false, rootDir, "initrd_release");
+    if (globalsChanged) {
+        cachedTimeout = state.timeout;
+        textTimeout->setText(tr("Timeout: %1 seconds").arg(cachedTimeout));
+        textBootNext->setText(tr("Boot Next: %1")
+                                  .arg(state.bootNext.isEmpty() ? tr("not set, will boot using list order")
+                                                                : state.bootNext));
+        if (!state.bootCurrent.isEmpty()) {
+            textBootCurrent->setText(tr("Boot Current: %1").arg(state.bootCurrent));
+        }
     }
-    distroName = distroName.trimmed();
-
-    // Remove " GNU/Linux" if it exists
-    distroName.replace(" GNU/Linux", "");
-    // Remove " Linux" if it exists
-    distroName.replace(" Linux", "");
-
-    if (!distroName.isEmpty()) {
-        ui->textEntryName->setText(distroName);
+    if (globalsChanged || added) {
+        sortUefiBootOrder(state.bootOrder, listEntries);
+        const int selectedRow = bootEntries.row(selected);
+        if (selectedRow >= 0) {
+            listEntries->setCurrentIndex(bootEntries.index(selectedRow));
+        }
     }
+    nvramBatch.setCommitted(state.bootOrder, state.bootNext, state.timeout, state.activeFlags());
 }
 
-void MainWindow::promptFrugalStubInstall()
+void MainWindow::buildPartuuidIndex()
 {
-    int ret = QMessageBox::question(this, tr("UEFI Installer"),
-                                    tr("A recent frugal install has been detected. Do you wish to add a UEFI entry "
-                                       "direct to your UEFI system menu?"),
-                                    QMessageBox::Yes | QMessageBox::No, QMessageBox::No);
-
-    if (ret == QMessageBox::No) {
-        cmd.procElevated(cmd.helperLibraryPath(), {"write_checkfile"});
-        qApp->quit();
+    QString lsblkJson;
+    if (!cmd.proc("lsblk", {"-ln", "--json", "-o", "NAME,PATH,PARTUUID"}, &lsblkJson, nullptr, QuietMode::Yes)) {
+        qWarning() << "lsblk failed; boot entry targets will not be resolved";
         return;
-    } else {
-        ui->tabWidget->setCurrentIndex(Tab::Frugal);
     }
+    partuuidIndex.build(QJsonDocument::fromJson(lsblkJson.toUtf8()).object().value("blockdevices").toArray());
 }
 
-void MainWindow::readBootEntries(QListWidget *listEntries, QLabel *textTimeout, QLabel *textBootNext,
-                                 QLabel *textBootCurrent, QStringList *bootorder)
+// Describe the disk/partition a boot entry points at; *missing is set when the
+// entry references a partition that does not exist on this system
+QString MainWindow::describeBootTarget(const QString &entryLine, bool *missing) const
 {
-    QString efiOut;
-    cmd.proc("efibootmgr", {}, &efiOut);
-    QStringList entries = efiOut.split('\n', Qt::SkipEmptyParts);
-    static const QRegularExpression bootEntryRegex(R"(^Boot[0-9A-Fa-f]{4}\*?\s+)");
-    cachedTimeout = 0;
+    *missing = false;
+    const devicepath::DevicePath path = devicepath::parse(devicepath::pathFromEntryLine(entryLine));
+    if (path.isEmpty()) {
+        return {};
+    }
 
-    for (const auto &item : std::as_const(entries)) {
-        if (bootEntryRegex.match(item).hasMatch()) {
-            auto *listItem = new QListWidgetItem(item);
-            if (!item.contains("*")) {
-                listItem->setBackground(QBrush(Qt::gray));
-            }
-            listEntries->addItem(listItem);
-        } else if (item.startsWith("Timeout:")) {
-            cachedTimeout = item.section(' ', 1).trimmed().toInt();
-            textTimeout->setText(tr("Timeout: %1 seconds").arg(cachedTimeout));
-        } else if (item.startsWith("BootNext:")) {
-            textBootNext->setText(tr("Boot Next: %1").arg(item.section(' ', 1).trimmed()));
-        } else if (item.startsWith("BootCurrent:")) {
-            textBootCurrent->setText(tr("Boot Current: %1").arg(item.section(' ', 1).trimmed()));
-        } else if (item.startsWith("BootOrder:")) {
-            *bootorder = item.section(' ', 1).split(',', Qt::SkipEmptyParts);
+    if (path.hardDrive) {
+        const auto &hd = *path.hardDrive;
+        const QString device = hd.scheme == "GPT" ? partuuidIndex.device(hd.signature) : QString();
+        if (device.isEmpty()) {
+            *missing = hd.scheme == "GPT";
+            return tr("Target: partition %1 (%2 %3) not found on this system").arg(hd.partition).arg(hd.scheme, hd.signature);
         }
+        return path.file.isEmpty() ? tr("Target: %1").arg(device) : tr("Target: %1 %2").arg(device, path.file);
+    }
+    if (!path.uri.isEmpty()) {
+        return tr("Target: HTTP boot from %1").arg(path.uri);
     }
+    if (!path.macAddress.isEmpty()) {
+        return tr("Target: network boot on interface %1").arg(path.macAddress);
+    }
+    if (!path.bus.isEmpty()) {
+        return tr("Target: %1 device").arg(path.bus);
+    }
+    if (!path.vendor.isEmpty()) {
+        return tr("Target: firmware vendor device %1").arg(path.vendor);
+    }
+    return tr("Target: %1").arg(path.nodes.constFirst().name);
 }
 
 void MainWindow::refreshEntries()
 {
+    efivarWatcher.stop();
     Cmd::resetElevation();
+    nvramBatch.flush();
     clearEntryWidget();
 
     auto *layout = new QGridLayout(ui->tabManageUefi);
-    auto *listEntries = new QListWidget(ui->tabManageUefi);
+    // A plain list view only lays out and paints the rows in sight, however long the menu
+    auto *listEntries = new QListView(ui->tabManageUefi);
+    listEntries->setModel(&bootEntries);
+    listEntries->setUniformItemSizes(true);
+    listEntries->setSelectionMode(QAbstractItemView::SingleSelection);
+    auto *textFilter = new QLineEdit(ui->tabManageUefi);
+    textFilter->setPlaceholderText(tr("Filter by number, name or target"));
+    textFilter->setClearButtonEnabled(true);
     auto *textIntro = new QLabel(tr("You can use the Up/Down buttons, or drag & drop items to change boot order.\n"
                                     "- Items are listed in the boot order.\n"
                                     "- Grayed out lines are inactive."),
@@ -838,6 +1931,12 @@ void MainWindow::refreshEntries()
 
     auto *pushActive = createButton(tr("Set ac&tive"), "star-on");
     auto *pushAddEntry = createButton(tr("&Add entry"), "list-add");
+    auto *pushEdit = createButton(tr("&Edit entry"), "document-edit");
+    auto *pushDuplicates = createButton(tr("Remove dupli&cates"), "edit-copy");
+    auto *pushSlots = createButton(tr("&Kernel slots"), "system-reboot");
+    auto *pushApply = createButton(tr("A&pply changes"), "dialog-ok-apply");
+    auto *pushUsage = createButton(tr("NVRAM &usage"), "drive-harddisk");
+    auto *pushPerformance = createButton(tr("Boot per&formance"), "chronometer");
     auto *pushBootNext = createButton(tr("Boot &next"), "go-next");
     auto *pushDown = createButton(tr("Move &down"), "arrow-down");
     auto *pushRemove = createButton(tr("&Remove entry"), "trash-empty");
@@ -851,85 +1950,176 @@ void MainWindow::refreshEntries()
     auto *textBootNext
         = new QLabel(tr("Boot Next: %1").arg(tr("not set, will boot using list order")), ui->tabManageUefi);
     auto *textTimeout = new QLabel(tr("Timeout: %1 seconds").arg("0"), ui->tabManageUefi);
+    auto *textTarget = new QLabel(ui->tabManageUefi);
+    textTarget->setTextInteractionFlags(Qt::TextSelectableByMouse);
     listEntries->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
 
-    connect(pushResetNext, &QPushButton::clicked, ui->tabManageUefi, [textBootNext]() {
+    connect(pushResetNext, &QPushButton::clicked, ui->tabManageUefi, [this, textBootNext]() {
+        nvramBatch.stageBootNext({});
+        textBootNext->setText(tr("Boot Next: %1").arg(tr("not set, will boot using list order")));
+    });
+    connect(pushTimeout, &QPushButton::clicked, this,
+            [this, textTimeout]() { setUefiTimeout(ui->tabManageUefi, textTimeout); });
+    connect(pushAddEntry, &QPushButton::clicked, this, [this]() {
+        Cmd::resetElevation();
+        nvramBatch.flush();
+        addUefiEntry(ui->tabManageUefi);
+    });
+    connect(pushEdit, &QPushButton::clicked, this,
+            [this, listEntries, textTimeout, textBootNext, textBootCurrent]() {
+                Cmd::resetElevation();
+                nvramBatch.flush();
+                if (editUefiEntry(listEntries, ui->tabManageUefi)) {
+                    externalEntryChanges.insert(
+                        listEntries->currentIndex().data(BootEntryModel::BootNumRole).toString());
+                    applyExternalChanges(listEntries, textTimeout, textBootNext, textBootCurrent);
+                }
+            });
+    connect(pushDuplicates, &QPushButton::clicked, this,
+            [this, listEntries, textTimeout, textBootNext, textBootCurrent]() {
+                Cmd::resetElevation();
+                nvramBatch.flush();
+                const QStringList removed = removeDuplicateEntries(ui->tabManageUefi);
+                if (!removed.isEmpty()) {
+                    for (const QString &bootNum : removed) {
+                        externalEntryChanges.insert(bootNum);
+                    }
+                    externalGlobalsChanged = true;
+                    applyExternalChanges(listEntries, textTimeout, textBootNext, textBootCurrent);
+                }
+            });
+    connect(pushSlots, &QPushButton::clicked, this, [this, listEntries, textTimeout, textBootNext, textBootCurrent]() {
         Cmd::resetElevation();
-        if (Cmd().procAsRoot("efibootmgr", {"-N"})) {
-            textBootNext->setText(tr("Boot Next: %1").arg(tr("not set, will boot using list order")));
+        nvramBatch.flush();
+        if (showKernelSlots(ui->tabManageUefi)) {
+            externalGlobalsChanged = true;
+            applyExternalChanges(listEntries, textTimeout, textBootNext, textBootCurrent);
         }
     });
-    connect(pushTimeout, &QPushButton::clicked, this,
-            [this, textTimeout]() { Cmd::resetElevation(); setUefiTimeout(ui->tabManageUefi, textTimeout); });
-    connect(pushAddEntry, &QPushButton::clicked, this,
-            [this, listEntries]() { Cmd::resetElevation(); addUefiEntry(listEntries, ui->tabManageUefi); });
     connect(pushBootNext, &QPushButton::clicked, this,
-            [listEntries, textBootNext]() { Cmd::resetElevation(); setUefiBootNext(listEntries, textBootNext); });
+            [this, listEntries, textBootNext]() { setUefiBootNext(listEntries, textBootNext); });
     connect(pushRemove, &QPushButton::clicked, this,
             [this, listEntries]() { Cmd::resetElevation(); removeUefiEntry(listEntries, ui->tabManageUefi); });
 
-    connect(pushActive, &QPushButton::clicked, ui->tabManageUefi, [listEntries]() { Cmd::resetElevation(); toggleUefiActive(listEntries); });
-    connect(pushUp, &QPushButton::clicked, ui->tabManageUefi, [this, listEntries, pushUp, pushDown]() {
-        pushUp->setEnabled(false);
-        pushDown->setEnabled(false);
-        listEntries->model()->moveRow(QModelIndex(), listEntries->currentRow(), QModelIndex(),
-                                      listEntries->currentRow() - 1);
-        pushUp->setEnabled(listEntries->currentRow() != 0);
-        pushDown->setEnabled(listEntries->currentRow() != listEntries->count() - 1);
+    connect(pushActive, &QPushButton::clicked, ui->tabManageUefi, [this, listEntries]() { toggleUefiActive(listEntries); });
+    connect(pushApply, &QPushButton::clicked, this, [this]() {
+        Cmd::resetElevation();
+        nvramBatch.flush();
     });
-    connect(pushDown, &QPushButton::clicked, ui->tabManageUefi, [this, listEntries, pushUp, pushDown]() {
-        pushUp->setEnabled(false);
-        pushDown->setEnabled(false);
-        listEntries->model()->moveRow(QModelIndex(), listEntries->currentRow() + 1, QModelIndex(),
-                                      listEntries->currentRow()); // move next entry down
-        pushUp->setEnabled(listEntries->currentRow() != 0);
-        pushDown->setEnabled(listEntries->currentRow() != listEntries->count() - 1);
+    connect(pushUsage, &QPushButton::clicked, this, &MainWindow::showNvramUsage);
+    connect(pushPerformance, &QPushButton::clicked, this, &MainWindow::showBootPerformance);
+    pushApply->setEnabled(false);
+    connect(&nvramBatch, &NvramBatch::pendingChanged, pushApply, &QPushButton::setEnabled);
+    connect(&nvramBatch, &NvramBatch::conflicts, listEntries, [this](const QStringList &messages) {
+        QMessageBox::warning(this, tr("Boot entries changed"),
+                             tr("Another program changed the boot entries while you were editing them:\n%1")
+                                 .arg(messages.join('\n')));
     });
-    connect(listEntries, &QListWidget::itemSelectionChanged, ui->tabManageUefi,
-            [listEntries, pushUp, pushDown, pushActive]() {
-                if (!listEntries || !pushUp || !pushDown || !pushActive) {
+    connect(&nvramBatch, &NvramBatch::flushed, listEntries,
+            [this, listEntries, textTimeout, textBootNext, textBootCurrent](bool ok) {
+                if (ok) {
+                    externalGlobalsChanged = externalGlobalsChanged || nvramBatch.lastWriteMerged();
+                    applyExternalChanges(listEntries, textTimeout, textBootNext, textBootCurrent);
                     return;
                 }
-
-                pushUp->setEnabled(listEntries->currentRow() != 0);
-                pushDown->setEnabled(listEntries->currentRow() != listEntries->count() - 1);
-
-                auto currentItem = listEntries->currentItem();
-                if (currentItem && currentItem->text().section(' ', 0, 0).endsWith('*')) {
-                    pushActive->setText(tr("Set &inactive"));
-                    pushActive->setIcon(QIcon::fromTheme("star-off"));
-                } else {
-                    pushActive->setText(tr("Set ac&tive"));
-                    pushActive->setIcon(QIcon::fromTheme("star-on"));
+                // Elevation failures already show their own message
+                if (nvramBatch.lastExitCode() != 126 && nvramBatch.lastExitCode() != 127) {
+                    QMessageBox::critical(this, tr("Error"), tr("Something went wrong, could not save boot changes."));
                 }
+                revertStagedEntries(listEntries, textTimeout, textBootNext);
+            });
+    connect(pushUp, &QPushButton::clicked, ui->tabManageUefi, [this, listEntries]() {
+        const int row = listEntries->currentIndex().row();
+        bootEntries.moveRow(QModelIndex(), row, QModelIndex(), row - 1);
+    });
+    connect(pushDown, &QPushButton::clicked, ui->tabManageUefi, [this, listEntries]() {
+        const int row = listEntries->currentIndex().row();
+        bootEntries.moveRow(QModelIndex(), row + 1, QModelIndex(), row); // move next entry up
+    });
+
+    // Actions patch single rows of the model; the buttons, target and filter follow whatever changed
+    const auto updateEntryButtons = [this, listEntries, textFilter, pushUp, pushDown, pushActive, textTarget]() {
+        const QModelIndex current = listEntries->currentIndex();
+        // Moving entries of a filtered list would reorder ones that are hidden
+        const bool canMove = current.isValid() && textFilter->text().trimmed().isEmpty();
+        pushUp->setEnabled(canMove && current.row() != 0);
+        pushDown->setEnabled(canMove && current.row() != bootEntries.rowCount() - 1);
+        textTarget->setText(current.data(BootEntryModel::TargetRole).toString());
+        if (current.data(BootEntryModel::ActiveRole).toBool()) {
+            pushActive->setText(tr("Set &inactive"));
+            pushActive->setIcon(QIcon::fromTheme("star-off"));
+        } else {
+            pushActive->setText(tr("Set ac&tive"));
+            pushActive->setIcon(QIcon::fromTheme("star-on"));
+        }
+    };
+    const auto filterRows = [this, listEntries, textFilter, updateEntryButtons](int first, int last) {
+        const QString text = textFilter->text().trimmed();
+        for (int row = first; row <= last; ++row) {
+            listEntries->setRowHidden(row, !bootEntries.matches(row, text));
+        }
+        updateEntryButtons();
+    };
+    const auto filterEntries = [this, listEntries, textFilter, filterRows]() {
+        listEntries->setDragDropMode(textFilter->text().trimmed().isEmpty() ? QAbstractItemView::InternalMove
+                                                                            : QAbstractItemView::NoDragDrop);
+        filterRows(0, bootEntries.rowCount() - 1);
+    };
+    connect(textFilter, &QLineEdit::textChanged, listEntries, filterEntries);
+    connect(listEntries->selectionModel(), &QItemSelectionModel::currentChanged, listEntries, updateEntryButtons);
+    connect(&bootEntries, &QAbstractItemModel::dataChanged, listEntries,
+            [filterRows](const QModelIndex &topLeft, const QModelIndex &bottomRight) {
+                filterRows(topLeft.row(), bottomRight.row());
             });
+    connect(&bootEntries, &QAbstractItemModel::rowsInserted, listEntries,
+            [filterRows](const QModelIndex & /*parent*/, int first, int last) { filterRows(first, last); });
+    connect(&bootEntries, &QAbstractItemModel::rowsRemoved, listEntries, updateEntryButtons);
+    connect(&bootEntries, &QAbstractItemModel::layoutChanged, listEntries, updateEntryButtons);
+    connect(&bootEntries, &QAbstractItemModel::rowsMoved, listEntries, [this, updateEntryButtons]() {
+        stageBootOrder();
+        updateEntryButtons();
+    });
 
     QStringList bootorder;
-    readBootEntries(listEntries, textTimeout, textBootNext, textBootCurrent, &bootorder);
+    readBootEntries(textTimeout, textBootNext, textBootCurrent, &bootorder);
     sortUefiBootOrder(bootorder, listEntries);
+    filterEntries();
 
-    listEntries->setDragDropMode(QAbstractItemView::InternalMove);
-    connect(listEntries->model(), &QAbstractItemModel::rowsMoved, this, [this, listEntries]() {
-        Cmd::resetElevation();
-        if (!saveBootOrder(listEntries)) {
-            QTimer::singleShot(0, this, &MainWindow::refreshEntries);
-            return;
-        }
-        emit listEntries->itemSelectionChanged();
-    });
+    connect(&efivarWatcher, &EfivarWatcher::changed, listEntries,
+            [this, listEntries, textTimeout, textBootNext, textBootCurrent](const QStringList &entries,
+                                                                             bool globalsChanged) {
+                for (const QString &bootNum : entries) {
+                    externalEntryChanges.insert(bootNum);
+                }
+                externalGlobalsChanged = externalGlobalsChanged || globalsChanged;
+                applyExternalChanges(listEntries, textTimeout, textBootNext, textBootCurrent);
+            });
+    externalEntryChanges.clear();
+    externalGlobalsChanged = false;
+    if (efivarPollInterval > 0) {
+        efivarWatcher.start();
+    }
 
     int row = 0;
-    const int rowspan = 7;
+    const int rowspan = 13;
     layout->addWidget(textIntro, row++, 0, 1, 2);
+    layout->addWidget(textFilter, row++, 0);
     layout->addWidget(listEntries, row, 0, rowspan, 1);
     layout->addWidget(pushRemove, row++, 1);
 
     layout->addWidget(pushAddEntry, row++, 1);
+    layout->addWidget(pushEdit, row++, 1);
+    layout->addWidget(pushDuplicates, row++, 1);
+    layout->addWidget(pushSlots, row++, 1);
     layout->addWidget(pushUp, row++, 1);
     layout->addWidget(pushDown, row++, 1);
     layout->addWidget(pushActive, row++, 1);
     layout->addWidget(pushBootNext, row++, 1);
+    layout->addWidget(pushApply, row++, 1);
+    layout->addWidget(pushUsage, row++, 1);
+    layout->addWidget(pushPerformance, row++, 1);
     layout->addItem(spacer, row++, 1);
+    layout->addWidget(textTarget, row++, 0, 1, 2);
     layout->addWidget(textBootCurrent, row++, 0);
     layout->addWidget(textTimeout, row, 0);
     layout->addWidget(pushTimeout, row++, 1);
@@ -1021,97 +2211,107 @@ void MainWindow::loadStubOption()
 
 QString MainWindow::openLuks(const QString &partition)
 {
-    QString uuid;
-    if (!cmd.procAsRoot("cryptsetup", {"luksUUID", partition}, &uuid) || uuid.trimmed().isEmpty()) {
+    const auto header = luksHeader(partition);
+    if (!header) {
         QMessageBox::critical(this, tr("Error"), tr("Could not retrieve UUID for %1").arg(partition));
         return {};
     }
-    const QString luksDevice = "luks-" + uuid.trimmed();
+    const QString luksDevice = luks::mapperName(*header);
 
-    bool ok;
-    QByteArray pass = QInputDialog::getText(this, this->windowTitle(),
-                                            tr("Enter passphrase to unlock %1 encrypted partition:").arg(partition),
-                                            QLineEdit::Password, QString(), &ok)
-                          .toUtf8();
+    // The other containers still locked since the last scan are offered too, unchecked, so a system spread
+    // over several of them can be unlocked with one prompt and one round of key derivation
+    QList<QPair<QString, QString>> candidates;
+    for (const QString &other : std::as_const(luksPartitions)) {
+        if (other == partition || !luksMapping(other).isEmpty()) {
+            continue;
+        }
+        if (const auto otherHeader = luksHeader(other)) {
+            candidates.append({other, luks::mapperName(*otherHeader)});
+        }
+    }
 
+    QDialog dialog(this);
+    dialog.setWindowTitle(this->windowTitle());
+    auto *layout = new QVBoxLayout(&dialog);
+    QListWidget *listContainers = nullptr;
+    if (!candidates.isEmpty()) {
+        layout->addWidget(new QLabel(tr("Encrypted partitions to unlock with this passphrase:"), &dialog));
+        listContainers = new QListWidget(&dialog);
+        auto *item = new QListWidgetItem(partition, listContainers);
+        item->setFlags(Qt::ItemIsEnabled); // the clicked partition can't be left out
+        item->setCheckState(Qt::Checked);
+        for (const auto &candidate : std::as_const(candidates)) {
+            item = new QListWidgetItem(candidate.first, listContainers);
+            item->setFlags(Qt::ItemIsEnabled | Qt::ItemIsUserCheckable);
+            item->setCheckState(Qt::Unchecked);
+        }
+        layout->addWidget(listContainers);
+    }
+    layout->addWidget(new QLabel(tr("Enter passphrase to unlock %1 encrypted partition:").arg(partition), &dialog));
+    auto *textPass = new QLineEdit(&dialog);
+    textPass->setEchoMode(QLineEdit::Password);
+    layout->addWidget(textPass);
+    auto *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    layout->addWidget(buttons);
+
+    const bool ok = dialog.exec() == QDialog::Accepted;
+    QByteArray pass = textPass->text().toUtf8();
+    textPass->clear();
     if (!ok || pass.isEmpty()) {
+        pass.fill(SCRUB_BYTE);
         QMessageBox::critical(this, tr("Error"), tr("Passphrase entry cancelled or empty for %1").arg(partition));
         return {};
     }
 
-    // Try to open the LUKS container
-    if (!cmd.procAsRoot("cryptsetup", {"luksOpen", "--allow-discards", partition, luksDevice, "-"}, nullptr, &pass)) {
+    QList<QPair<QString, QString>> targets {{partition, luksDevice}};
+    for (qsizetype i = 0; i < candidates.size(); ++i) {
+        if (listContainers->item(int(i) + 1)->checkState() == Qt::Checked) {
+            targets.append(candidates.at(i));
+        }
+    }
+
+    QString output;
+    const bool unlocked = cmd.procAsRootUnlock(targets, pass, &output);
+    pass.fill(SCRUB_BYTE);
+    const QJsonObject results = unlocked ? QJsonDocument::fromJson(output.toUtf8()).object() : QJsonObject();
+    QStringList opened;
+    for (const auto &[device, name] : std::as_const(targets)) {
+        const QJsonObject result = results.value(device).toObject();
+        if (result.value("opened").toBool()) {
+            opened.append(name);
+        } else if (!result.isEmpty()) {
+            qDebug() << "Could not unlock" << device << result.value("error").toString();
+        }
+    }
+    if (!opened.isEmpty()) {
+        qDebug() << "Unlocked LUKS containers:" << opened;
+        newLuksDevices.append(opened);
+    }
+    if (!opened.contains(luksDevice)) {
         QMessageBox::critical(this, tr("Error"), tr("Could not open %1 LUKS container").arg(partition));
-        pass.fill(SCRUB_BYTE);
         return {};
     }
-    pass.fill(SCRUB_BYTE);
-    qDebug() << "openLuks:" << luksDevice;
-    newLuksDevices.append(luksDevice);
     return luksDevice;
 }
 
-void MainWindow::sortUefiBootOrder(const QStringList &order, QListWidget *list)
+void MainWindow::sortUefiBootOrder(const QStringList &order, QListView *list)
 {
     if (order.isEmpty()) {
         return;
     }
 
-    int index = 0;
-    for (const auto &orderItem : order) {
-        auto items = list->findItems("Boot" + orderItem, Qt::MatchStartsWith);
-        if (items.isEmpty()) {
-            continue;
-        }
-
-        auto *item = items.constFirst();
-        list->takeItem(list->row(item));
-        list->insertItem(index, item);
-        ++index;
-    }
-
-    list->setCurrentRow(0);
-    if (list->currentItem()) {
-        list->currentItem()->setSelected(true);
-    }
-    emit list->itemSelectionChanged();
+    bootEntries.sortByBootOrder(order);
+    list->setCurrentIndex(bootEntries.index(0));
 }
 
 QString MainWindow::getDistroName(bool pretty, const QString &mountPoint, const QString &releaseFile) const
 {
-
     QFile file(QString("%1/etc/%2").arg(mountPoint, releaseFile));
-    QString searchTerm;
-    if (releaseFile == "initrd_release") {
-        searchTerm = pretty ? "PRETTY_NAME=" : "NAME=";
-    } else if (releaseFile == "lsb-release") {
-        searchTerm = pretty ? "PRETTY_NAME=" : "DISTRIB_DESCRIPTION=";
-    } else if (releaseFile == "os-release") {
-        searchTerm = pretty ? "PRETTY_NAME=" : "ID=";
-    } else {
-        return pretty ? "MX Linux" : "MX";
-    }
-
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        return pretty ? "MX Linux" : "MX";
-    }
-    QTextStream in(&file);
-    QString line;
-    QString distroName;
-
-    while (!in.atEnd()) {
-        line = in.readLine();
-        if (line.startsWith(searchTerm)) {
-            distroName = line.section('=', 1, 1).remove('"').trimmed();
-            break;
-        }
-    }
-
-    file.close();
-    if (distroName.isEmpty()) {
-        return "Linux";
-    }
-    return distroName;
+    return RootProfile::distroName(pretty, releaseFile,
+                                   file.open(QIODevice::ReadOnly | QIODevice::Text) ? std::optional(file.readAll())
+                                                                                    : std::nullopt);
 }
 
 [[nodiscard]] QString MainWindow::getMountPoint(const QString &partition)
@@ -1132,54 +2332,45 @@ QString MainWindow::getDistroName(bool pretty, const QString &mountPoint, const
     return match.hasMatch() ? match.captured(1) : QString();
 }
 
-void MainWindow::getKernelOptions(const QString &bootDir, const QString &rootDir, const QString &kernel)
+QString MainWindow::getKernelOptions(const rootfs::Snapshot &boot, const QString &bootDir,
+                                     const rootfs::Snapshot &root, const RootProfile &profile, const QString &kernel)
 {
-    QString kernelDir = determineKernelDir(bootDir, rootDir);
+    // GRUB names kernels by their path from the file system they are on
+    const QString kernelDir = bootDir == "/boot" ? "/boot" : "";
     QString vmlinuz = kernel;
     if (!vmlinuz.startsWith("vmlinuz-")) {
         vmlinuz = "vmlinuz-" + kernel;
     }
 
-    auto [rootPatterns, rootUUID] = getRootIdentifiers(rootDir);
-    QString grubFile = bootDir.endsWith("/") ? bootDir + "grub/grub.cfg" : bootDir + "/grub/grub.cfg";
+    auto [rootPatterns, rootUUID] = getRootIdentifiers(root, profile);
+    const QByteArray grubCfg = boot.contents(QDir::cleanPath(bootDir + "/grub/grub.cfg"));
 
-    QString bootOptions = parseGrubOptions(grubFile, rootPatterns, kernelDir, vmlinuz);
+    QString bootOptions = parseGrubOptions(grubCfg, rootPatterns, kernelDir, vmlinuz);
     if (bootOptions.isEmpty()) {
-        bootOptions = getFallbackOptions(rootDir, rootUUID);
-    }
-    bootOptions = combineBootOptions(bootOptions, rootDir);
-    ui->textKernelOptions->setText(bootOptions);
-}
-QString MainWindow::determineKernelDir(const QString &bootDir, const QString &rootDir)
-{
-    QString kernelDir;
-    if (bootDir == "/boot" || bootDir == "/boot/") {
-        if (!cmd.proc("mountpoint", {"-q", bootDir})) {
-            kernelDir = "/boot";
-        } else {
-            kernelDir = "";
-        }
-    } else if (bootDir.startsWith(rootDir)) {
-        kernelDir = "/boot";
-    } else {
-        kernelDir = "";
+        bootOptions = getFallbackOptions(root, rootUUID);
     }
-    return kernelDir;
+    return combineBootOptions(bootOptions, profile);
 }
 
-QPair<QStringList, QString> MainWindow::getRootIdentifiers(const QString &rootDir)
+QPair<QStringList, QString> MainWindow::getRootIdentifiers(const rootfs::Snapshot &root, const RootProfile &profile)
 {
-    QString dfOut;
-    cmd.proc("df", {"--output=source", rootDir}, &dfOut);
-    const QStringList dfLines = dfOut.split('\n', Qt::SkipEmptyParts);
-    QString rootDevicePath = dfLines.size() >= 2 ? dfLines.last().trimmed() : QString();
+    const QString rootDir = root.mountPoint;
+    QString rootDevicePath = root.device;
+    if (rootDevicePath.isEmpty()) {
+        QString dfOut;
+        cmd.proc("df", {"--output=source", rootDir}, &dfOut);
+        const QStringList dfLines = dfOut.split('\n', Qt::SkipEmptyParts);
+        rootDevicePath = dfLines.size() >= 2 ? dfLines.last().trimmed() : QString();
+    }
     if (rootDevicePath.isEmpty() || !rootDevicePath.startsWith("/dev/")) {
         qWarning() << "Could not determine root device for" << rootDir;
         return {{}, {}};
     }
     QStringList rootPatternList = {rootDevicePath};
-    QString rootUUID;
-    cmd.procAsRoot("blkid", {"--output", "value", "--match-tag", "UUID", rootDevicePath}, &rootUUID, nullptr);
+    QString rootUUID = root.uuid;
+    if (rootUUID.isEmpty()) {
+        cmd.procAsRoot("blkid", {"--output", "value", "--match-tag", "UUID", rootDevicePath}, &rootUUID, nullptr);
+    }
     if (!rootUUID.isEmpty()) {
         rootPatternList << "UUID=" + rootUUID;
     }
@@ -1213,43 +2404,34 @@ QPair<QStringList, QString> MainWindow::getRootIdentifiers(const QString &rootDi
                 rootParentPatternList << "PARTLABEL=" + rootParentPARTLABEL;
             }
 
-            QString crypttab = rootDir.endsWith("/") ? rootDir + "etc/crypttab" : rootDir + "/etc/crypttab";
-
-            if (QFile::exists(crypttab)) {
-                QStringList escapedPatterns;
-                for (const QString &token : std::as_const(rootParentPatternList)) {
-                    escapedPatterns << QRegularExpression::escape(token);
-                }
-                cmd.procAsRoot("grep", {"-m1", "-oP", QString("^([^[:space:]]+)[[:space:]]+(?=(%1).*)").arg(escapedPatterns.join("|")), crypttab}, &rootDevMapper, nullptr);
-                if (!rootDevMapper.trimmed().isEmpty()) {
-                    rootPatternList << "/dev/mapper/" + rootDevMapper.trimmed();
-                }
+            rootDevMapper = profile.mapperName(rootParentPatternList);
+            if (!rootDevMapper.isEmpty()) {
+                rootPatternList << "/dev/mapper/" + rootDevMapper;
             }
         }
     }
     return {rootPatternList, rootUUID};
 }
 
-QString MainWindow::parseGrubOptions(const QString &grubFile, const QStringList &rootPatterns, const QString &kernelDir, const QString &vmlinuz)
+QString MainWindow::parseGrubOptions(const QByteArray &grubCfg, const QStringList &rootPatterns,
+                                     const QString &kernelDir, const QString &vmlinuz)
 {
-    QString bootOptions;
-    if (!QFile::exists(grubFile)) {
-        qWarning() << "GRUB file not found:" << grubFile;
-        return "";
-    } else {
-        QStringList escapedRootPatterns;
-        for (const QString &p : rootPatterns) {
-            escapedRootPatterns << QRegularExpression::escape(p);
-        }
-        QString pattern = QString("^[[:space:]]*linux[[:space:]]+(/@)?%1/%2[[:space:]]+\\K.*root=(%3).*")
-                              .arg(kernelDir, QRegularExpression::escape(vmlinuz), escapedRootPatterns.join("|"));
-        cmd.procAsRoot("grep", {"-m1", "-oiP", pattern, grubFile}, &bootOptions);
-        bootOptions = bootOptions.trimmed();
+    if (grubCfg.isEmpty()) {
+        qWarning() << "GRUB configuration not found";
+        return {};
     }
-    return bootOptions;
+    QStringList escapedRootPatterns;
+    for (const QString &p : rootPatterns) {
+        escapedRootPatterns << QRegularExpression::escape(p);
+    }
+    const QRegularExpression pattern(
+        QString("^[[:space:]]*linux[[:space:]]+(/@)?%1/%2[[:space:]]+\\K.*root=(%3).*")
+            .arg(kernelDir, QRegularExpression::escape(vmlinuz), escapedRootPatterns.join("|")),
+        QRegularExpression::CaseInsensitiveOption | QRegularExpression::MultilineOption);
+    return pattern.match(QString::fromUtf8(grubCfg)).captured(0).trimmed();
 }
 
-QString MainWindow::getFallbackOptions(const QString &rootDir, const QString &rootUUID)
+QString MainWindow::getFallbackOptions(const rootfs::Snapshot &root, const QString &rootUUID)
 {
     QString bootOptions;
     // Obtain root= from rootUUID
@@ -1258,17 +2440,17 @@ QString MainWindow::getFallbackOptions(const QString &rootDir, const QString &ro
     }
 
     // Try to read options from /etc/default/grub if it exists
-    QString defaultGrubFile = rootDir.endsWith("/") ? rootDir + "etc/default/grub" : rootDir + "/etc/default/grub";
-    if (QFile::exists(defaultGrubFile)) {
+    if (root.exists("/etc/default/grub")) {
+        const QString defaultGrub = QString::fromUtf8(root.contents("/etc/default/grub"));
+        static const QRegularExpression linuxRegex(R"(^GRUB_CMDLINE_LINUX="\K[^"]+)",
+                                                   QRegularExpression::MultilineOption);
+        static const QRegularExpression defaultRegex(R"(^GRUB_CMDLINE_LINUX_DEFAULT="\K[^"]+)",
+                                                     QRegularExpression::MultilineOption);
         // Get options from GRUB_CMDLINE_LINUX
-        QString linuxOptions;
-        cmd.procAsRoot("grep", {"-m1", "-oP", R"(^GRUB_CMDLINE_LINUX="\K[^"]+)", defaultGrubFile}, &linuxOptions);
-        linuxOptions = linuxOptions.trimmed();
+        const QString linuxOptions = linuxRegex.match(defaultGrub).captured(0).trimmed();
 
         // Get options from GRUB_CMDLINE_LINUX_DEFAULT
-        QString defaultOptions;
-        cmd.procAsRoot("grep", {"-m1", "-oP", R"(^GRUB_CMDLINE_LINUX_DEFAULT="\K[^"]+)", defaultGrubFile}, &defaultOptions);
-        defaultOptions = defaultOptions.trimmed();
+        const QString defaultOptions = defaultRegex.match(defaultGrub).captured(0).trimmed();
 
         // Combine both options
         if (!linuxOptions.isEmpty()) {
@@ -1288,13 +2470,13 @@ QString MainWindow::getFallbackOptions(const QString &rootDir, const QString &ro
     return bootOptions.trimmed();
 }
 
-QString MainWindow::combineBootOptions(const QString &parsedOptions, const QString &rootDir)
+QString MainWindow::combineBootOptions(const QString &parsedOptions, const RootProfile &profile)
 {
     QString bootOptions = parsedOptions;
     const QString initSystemd = "init=/lib/systemd/systemd";
     if (!bootOptions.isEmpty()) {
         if (isSystemd() && !bootOptions.contains(initSystemd)) {
-            if (isShimSystemd(rootDir)) {
+            if (profile.needsInitSystemd) {
                 bootOptions = bootOptions + " " + initSystemd;
                 qDebug() << "System init boot options added:" << bootOptions;
             }
@@ -1305,7 +2487,6 @@ QString MainWindow::combineBootOptions(const QString &parsedOptions, const QStri
     return bootOptions;
 }
 
-
 // Try to guess root partition by checking partition labels and types
 void MainWindow::guessPartition()
 {
@@ -1315,18 +2496,28 @@ void MainWindow::guessPartition()
 
     const int partitionCount = comboPartition->count();
 
-    // Define local lambda function findKernel
+    // Kernels cached for the partition show at once; unless its files are unchanged they are read again afterwards
     auto findKernel = [this]() {
-        if (!ui->comboPartitionStub->currentText().isEmpty()) {
-            const QString mountPoint = mountPartition(ui->comboPartitionStub->currentText().section(' ', 0, 0));
-            if (mountPoint.isEmpty()) {
-                return;
+        const QString partition = ui->comboPartitionStub->currentData().toString();
+        if (ui->comboPartitionStub->currentText().isEmpty() || partition.isEmpty()) {
+            return;
+        }
+        if (const auto cached = scanCache.kernels.constFind(partition); cached != scanCache.kernels.constEnd()) {
+            applyKernelChoice(cached->choice);
+            if (!scancache::isCurrent(cached->stamps)) {
+                staleKernelChoice = partition;
+                QTimer::singleShot(0, this, &MainWindow::revalidateKernelChoice);
             }
-            selectKernel(mountPoint);
+            return;
         }
+        // Shown now, or when the background reads it needs are done
+        applyKernelChoice({});
+        pendingKernelChoice = partition;
+        showPendingKernelChoice();
     };
 
     if (ui->tabWidget->currentIndex() == Tab::StubInstall) {
+        prefetchRoots();
         disconnect(ui->comboPartitionStub, nullptr, this, nullptr);
         connect(ui->comboPartitionStub, &QComboBox::currentTextChanged, this, findKernel);
     }
@@ -1342,10 +2533,10 @@ void MainWindow::guessPartition()
 
     // Helper: check cached partition info against a regex pattern
     auto findPartition = [&](const QString &field, const QRegularExpression &pattern) -> bool {
-        QString drive = comboDrive->currentText().section(' ', 0, 0);
+        const QString drive = comboDrive->currentData(BlockDeviceModel::NameRole).toString();
         if (drive == rootDrive) {
             for (int index = 0; index < partitionCount; ++index) {
-                const QString part = comboPartition->itemText(index).section(' ', 0, 0);
+                const QString part = comboPartition->itemData(index).toString();
                 if (part == rootPartition) {
                     comboPartition->setCurrentIndex(index);
                     return true;
@@ -1354,12 +2545,11 @@ void MainWindow::guessPartition()
         }
 
         for (int index = 0; index < partitionCount; ++index) {
-            const QString part = comboPartition->itemText(index).section(' ', 0, 0);
-            auto it = partitionInfoMap.constFind(part);
-            if (it == partitionInfoMap.constEnd()) {
+            const auto *partition = blockDevices.device(comboPartition->itemData(index).toString());
+            if (!partition) {
                 continue;
             }
-            const QString &value = (field == "LABEL") ? it->label : it->parttype;
+            const QString &value = (field == "LABEL") ? partition->label : partition->parttype;
             if (pattern.match(value).hasMatch()) {
                 comboPartition->setCurrentIndex(index);
                 return true;
@@ -1379,43 +2569,61 @@ void MainWindow::guessPartition()
 
 void MainWindow::detectRootDevice()
 {
+    setRootDevice(findRootDevice(cmd));
+}
+
+MainWindow::RootDevice MainWindow::findRootDevice(Cmd &cmd)
+{
+    RootDevice root;
     QString dfRoot;
     cmd.proc("df", {"--output=source", "/"}, &dfRoot);
     const QStringList dfLines = dfRoot.split('\n', Qt::SkipEmptyParts);
-    rootDevicePath = dfLines.size() >= 2 ? dfLines.last().trimmed() : QString();
-    if (rootDevicePath.isEmpty() || !rootDevicePath.startsWith("/dev/")) {
+    root.path = dfLines.size() >= 2 ? dfLines.last().trimmed() : QString();
+    if (root.path.isEmpty() || !root.path.startsWith("/dev/")) {
         qWarning() << "Could not determine root device";
-        return;
+        return root;
     }
 
-    if (rootDevicePath.startsWith("/dev/mapper")) {
-        cmd.proc("lsblk", {"-ln", "-o", "PKNAME", rootDevicePath}, &rootPartition);
-        rootPartition = rootPartition.trimmed();
+    if (root.path.startsWith("/dev/mapper")) {
+        cmd.proc("lsblk", {"-ln", "-o", "PKNAME", root.path}, &root.partition);
+        root.partition = root.partition.trimmed();
     } else {
-        rootPartition = QFileInfo(rootDevicePath).fileName();
+        root.partition = QFileInfo(root.path).fileName();
     }
-
-    rootDrive = utils::extractDiskFromPartition(rootPartition);
+    root.drive = utils::extractDiskFromPartition(root.partition);
+    return root;
 }
 
-void MainWindow::listDevices()
+void MainWindow::setRootDevice(const RootDevice &root)
 {
-    // Regex for physical disk/partition device names (sd*, hd*, vd*, xvd*, mmcblk*, nvme*)
-    static const QRegularExpression driveNameRegex("^x?[hsv]d[a-z]|^mmcblk|^nvme");
-    static const QRegularExpression partNameRegex("^x?[hsv]d[a-z]\\d|^mmcblk\\d+p|^nvme\\d+n\\d+p");
-
-    // Filesystem types excluded from Linux partition list
-    static const QStringList excludedLinuxFs = {"ntfs", "exfat", "vfat", "BitLocker", "swap"};
-    // Filesystem types excluded from frugal partition list
-    static const QStringList excludedFrugalFs = {"swap", "BitLocker"};
+    rootDevicePath = root.path;
+    if (!root.path.startsWith("/dev/")) {
+        return;
+    }
+    rootPartition = root.partition;
+    rootDrive = root.drive;
+    // Only a reboot moves the root, so later launches in this boot take it from the cache
+    scanCache.bootId = scancache::currentBootId();
+    scanCache.rootDevicePath = rootDevicePath;
+    scanCache.rootPartition = rootPartition;
+    scanCache.rootDrive = rootDrive;
+}
 
-    static constexpr qint64 ONE_GB = 1'073'741'824LL;
-    static constexpr qint64 SIX_GB = 6 * ONE_GB;
+// The drives and partitions lsblk lists now, kept for the next launch
+QJsonArray MainWindow::scanDevices()
+{
+    scanCache.devices = readBlockDevices(cmd);
+    scancache::prune(&scanCache);
+    return scanCache.devices;
+}
 
+QJsonArray MainWindow::readBlockDevices(Cmd &cmd)
+{
     // Single lsblk call to get all block device info as JSON
     QString lsblkJson;
     if (!cmd.proc("lsblk", {"-ln", "--json", "--bytes", "-o",
-                            "NAME,SIZE,FSTYPE,MOUNTPOINT,LABEL,MODEL,PARTTYPE,TYPE", "-e", "2,11"},
+                            "NAME,PKNAME,PATH,SIZE,FSTYPE,MOUNTPOINT,LABEL,MODEL,PARTTYPE,PARTUUID,UUID,TYPE", "-e",
+                            "2,11"},
                    &lsblkJson)) {
         qWarning() << "lsblk failed; device lists will be empty";
     }
@@ -1424,89 +2632,32 @@ void MainWindow::listDevices()
     if (doc.isNull()) {
         qWarning() << "Failed to parse lsblk JSON output";
     }
-    QJsonArray devices = doc.object().value("blockdevices").toArray();
-
-    // Helper: format display string with name first (for .section(' ', 0, 0) extraction)
-    auto formatSize = [](qint64 bytes) -> QString {
-        if (bytes >= ONE_GB) {
-            return QString::number(static_cast<double>(bytes) / ONE_GB, 'f', 1) + "G";
-        }
-        return QString::number(static_cast<double>(bytes) / (1024 * 1024), 'f', 1) + "M";
-    };
+    return doc.object().value("blockdevices").toArray();
+}
 
-    espList.clear();
-    driveList.clear();
-    partitionList.clear();
-    linuxPartitionList.clear();
-    frugalPartitionList.clear();
-    partitionInfoMap.clear();
+void MainWindow::listDevices()
+{
+    // After a warm start the cached list is shown first; revalidateScan compares it with lsblk
+    const QJsonArray devices = std::exchange(useCachedDevices, false) ? scanCache.devices : scanDevices();
+    partuuidIndex.build(devices);
+    blockDevices.load(devices, rootPartition);
+
+    partitionTables.clear();
+    rootSnapshots.clear();
+    rootPrefetcher.cancel();
+    pendingKernelChoice.clear();
+    rootProfiles.removeIf([](QMap<QString, RootProfile>::iterator profile) { return profile->mountPoint.isEmpty(); });
+    luksHeaders.clear();
+    luksPartitions.clear();
 
     for (const QJsonValue &val : devices) {
-        QJsonObject dev = val.toObject();
+        const QJsonObject dev = val.toObject();
         const QString name = dev.value("name").toString();
-        const qint64 size = dev.value("size").toInteger();
-        const QString fstype = dev.value("fstype").toString();
-        const QString mountpoint = dev.value("mountpoint").toString();
-        const QString label = dev.value("label").toString();
-        const QString model = dev.value("model").toString();
-        const QString parttype = dev.value("parttype").toString().toLower();
-        const QString type = dev.value("type").toString();
-        const QString sizeStr = formatSize(size);
-
-        bool isDrive = (type == "disk") && driveNameRegex.match(name).hasMatch();
-        bool isPartition = (type == "part") && partNameRegex.match(name).hasMatch();
-
-        if (isPartition) {
-            partitionInfoMap[name] = {label, parttype};
-        }
-
-        // ESP list: EFI System Partitions with vfat filesystem
-        if (isPartition && fstype.compare("vfat", Qt::CaseInsensitive) == 0
-            && (parttype == ESP_GUID_GPT || parttype == ESP_TYPE_MBR)) {
-            espList.append(QString("%1 %2 %3").arg(name, sizeStr, label).trimmed());
-        }
-
-        // Drive list: physical disk devices
-        if (isDrive) {
-            driveList.append(QString("%1 %2 %3 %4").arg(name, sizeStr, label, model).trimmed());
-        }
-
-        // Partition list: all partitions on physical disks
-        if (isPartition) {
-            // Show mountpoint as "/" for root partition
-            QString mp = (name == rootPartition) ? "/" : mountpoint;
-            partitionList.append(QString("%1 %2 %3 %4 %5").arg(name, sizeStr, fstype, mp, label).trimmed());
-        }
-
-        // Linux partition list: non-Windows/swap filesystems, >= 6 GB
-        if (isPartition && size >= SIX_GB && !fstype.isEmpty()
-            && !excludedLinuxFs.contains(fstype, Qt::CaseInsensitive)) {
-            QString mp = (name == rootPartition) ? "/" : mountpoint;
-            linuxPartitionList.append(
-                QString("%1 %2 %3 %4 %5").arg(name, sizeStr, fstype, mp, label).trimmed());
-        }
-
-        // Frugal partition list: broader FS set, >= 1 GB
-        if (isPartition && size >= ONE_GB && !fstype.isEmpty()
-            && !excludedFrugalFs.contains(fstype, Qt::CaseInsensitive)) {
-            QString mp = (name == rootPartition) ? "/" : mountpoint;
-            frugalPartitionList.append(
-                QString("%1 %2 %3 %4 %5").arg(name, sizeStr, fstype, mp, label).trimmed());
+        const auto *device = blockDevices.device(name);
+        if (device && !device->isDrive() && device->fstype == "crypto_LUKS") {
+            luksPartitions.append("/dev/" + name);
         }
     }
-
-    // Sort partition lists by version (matches original sort -V behavior)
-    auto versionSort = [](QStringList &list) {
-        QCollator collator;
-        collator.setNumericMode(true);
-        std::sort(list.begin(), list.end(), [&collator](const QString &a, const QString &b) {
-            return collator.compare(a, b) < 0;
-        });
-    };
-    versionSort(espList);
-    versionSort(partitionList);
-    versionSort(linuxPartitionList);
-    versionSort(frugalPartitionList);
 }
 
 void MainWindow::validateAndLoadOptions(const QString &frugalDir)
@@ -1558,21 +2709,27 @@ QString MainWindow::selectFrugalDirectory(const QString &partition)
 
 QString MainWindow::selectESP()
 {
-
-    if (espList.isEmpty()) {
+    const auto esps = blockDevices.partitions({}, BlockDeviceModel::Purpose::Esp);
+    if (esps.isEmpty()) {
         QMessageBox::critical(this, QApplication::applicationDisplayName(), tr("No EFI System Partitions found."));
         return {};
     }
 
+    QStringList espTexts;
+    espTexts.reserve(esps.size());
+    for (const auto *esp : esps) {
+        espTexts.append(esp->displayText());
+    }
     QInputDialog dialog(this);
     dialog.setWindowTitle(tr("Select EFI System Partition"));
     dialog.setLabelText(tr("EFI System Partitions:"));
-    dialog.setComboBoxItems(espList);
+    dialog.setComboBoxItems(espTexts);
     dialog.setMinimumWidth(400);
     dialog.resize(dialog.minimumWidth(), dialog.height());
     QString selectedEsp;
     if (dialog.exec() == QDialog::Accepted) {
-        selectedEsp = dialog.textValue().section(' ', 0, 0);
+        const qsizetype selected = espTexts.indexOf(dialog.textValue());
+        selectedEsp = selected >= 0 ? esps.at(selected)->name : QString();
     }
 
     if (selectedEsp.isEmpty()) {
@@ -1580,6 +2737,15 @@ QString MainWindow::selectESP()
         return {};
     }
 
+    // Check the space from the FAT first, so a full ESP is never mounted
+    const QString device = "/dev/" + selectedEsp;
+    const auto summary = fatfs::fromJson(readDevices("fat", {device}).value(device).toObject());
+    if (summary && !checkSizeEsp(summary)) {
+        QMessageBox::critical(this, QApplication::applicationDisplayName(),
+                              tr("Not enough space on the EFI System Partition to copy the kernel and initrd files."));
+        return {};
+    }
+
     espMountPoint = mountPartition(selectedEsp);
     if (espMountPoint.isEmpty()) {
         QMessageBox::warning(this, QApplication::applicationDisplayName(),
@@ -1587,16 +2753,17 @@ QString MainWindow::selectESP()
         return {};
     }
 
-    if (!checkSizeEsp()) {
+    if (!summary && !checkSizeEsp(std::nullopt)) {
         QMessageBox::critical(this, QApplication::applicationDisplayName(),
                               tr("Not enough space on the EFI System Partition to copy the kernel and initrd files."));
         return {};
     }
 
     const bool isFrugal = ui->tabWidget->currentIndex() == Tab::Frugal;
-    const QString subDir = isFrugal ? "/frugal" : "/stub";
-    const QString targetPath = espMountPoint + "/EFI/" + distro + subDir;
-    cleanEspTarget(targetPath);
+    if (isFrugal || usesStubDirectory()) {
+        const QString subDir = isFrugal ? "/frugal" : "/stub";
+        cleanEspTarget(espMountPoint + "/EFI/" + distro + subDir);
+    }
     return selectedEsp;
 }
 
@@ -1607,7 +2774,7 @@ void MainWindow::pushNextClicked()
         if (ui->stackedFrugal->currentIndex() == Page::Location) {
             ui->pushNext->setEnabled(false);
             if (!ui->comboDrive->currentText().isEmpty() && !ui->comboPartition->currentText().isEmpty()) {
-                QString part = mountPartition(ui->comboPartition->currentText().section(' ', 0, 0));
+                QString part = mountPartition(ui->comboPartition->currentData().toString());
                 if (part.isEmpty()) {
                     QMessageBox::critical(
                         this, QApplication::applicationDisplayName(),
@@ -1651,7 +2818,7 @@ void MainWindow::pushNextClicked()
             QMessageBox::warning(this, QApplication::applicationDisplayName(), tr("All fields are required"));
             return;
         }
-        QString part = mountPartition(ui->comboPartitionStub->currentText().section(' ', 0, 0));
+        QString part = mountPartition(ui->comboPartitionStub->currentData().toString());
         if (part.isEmpty()) {
             QMessageBox::critical(
                 this, QApplication::applicationDisplayName(),
@@ -1675,7 +2842,26 @@ void MainWindow::pushNextClicked()
             refreshStubInstall();
             return;
         }
-        if (installEfiStub(esp)) {
+        settings.setValue("stubUseBls", ui->checkBls->isChecked());
+        if (ui->checkBls->isChecked()) {
+            if (installBlsEntry(esp)) {
+                QMessageBox::information(this, QApplication::applicationDisplayName(),
+                                         tr("Boot Loader Specification entry installed successfully."));
+            } else {
+                QMessageBox::critical(this, QApplication::applicationDisplayName(),
+                                      tr("Failed to install the Boot Loader Specification entry."));
+                refreshStubInstall();
+            }
+        } else if (settings.value("stubSlots", kernelslots::DEFAULT_SLOT_COUNT).toInt() > 1) {
+            if (installKernelSlot(esp)) {
+                QMessageBox::information(this, QApplication::applicationDisplayName(),
+                                         tr("EFI stub installed successfully. It will be tried on the next boot "
+                                            "only; once it works, make it the default under Kernel slots."));
+            } else {
+                QMessageBox::critical(this, QApplication::applicationDisplayName(), tr("Failed to install EFI stub."));
+                refreshStubInstall();
+            }
+        } else if (installEfiStub(esp)) {
             QMessageBox::information(this, QApplication::applicationDisplayName(),
                                      tr("EFI stub installed successfully."));
         } else {
@@ -1717,27 +2903,66 @@ void MainWindow::pushBackClicked()
     }
 }
 
-bool MainWindow::saveBootOrder(const QListWidget *list)
+void MainWindow::stageBootOrder()
+{
+    nvramBatch.stageBootOrder(bootEntries.bootOrder());
+}
+
+// Scans what a warm start took from the cache on the scan pool, so the window stays responsive while
+// blkid, df and lsblk run; applyRescan then replaces only what turned out different
+void MainWindow::revalidateScan()
+{
+    scanPool.start([this] {
+        Cmd scanCmd;
+        // Refresh blkid cache (best-effort, may not update cache without root)
+        scanCmd.proc("blkid");
+        const RootDevice root = findRootDevice(scanCmd);
+        const QJsonArray devices = readBlockDevices(scanCmd);
+        QMetaObject::invokeMethod(this, [this, root, devices] { applyRescan(root, devices); }, Qt::QueuedConnection);
+    });
+}
+
+void MainWindow::applyRescan(const RootDevice &root, const QJsonArray &devices)
 {
-    QStringList orderList;
-    orderList.reserve(list->count());
-    for (int i = 0; i < list->count(); ++i) {
-        QString item = list->item(i)->text().section(' ', 0, 0);
-        item.remove(bootStripRegex);
-        if (item.contains(hexIdRegex)) {
-            orderList.append(item);
+    const QString previousRoot = rootPartition;
+    setRootDevice(root);
+    const QJsonArray previousDevices = scanCache.devices;
+    scanCache.devices = devices;
+    scancache::prune(&scanCache);
+    if (devices == previousDevices && rootPartition == previousRoot) {
+        return;
+    }
+    qDebug() << "Devices changed since the last scan";
+
+    partuuidIndex.build(devices);
+    const QList<BootEntryModel::Entry> entries = bootEntries.entries();
+    for (const BootEntryModel::Entry &entry : entries) {
+        const auto updated = entryFromLine(entry.text());
+        if (updated && (updated->target != entry.target || updated->missing != entry.missing)) {
+            bootEntries.updateEntry(*updated);
         }
     }
+    if (ui->tabWidget->currentIndex() != Tab::Entries) {
+        useCachedDevices = true; // the scan just made
+        addDevToList();
+    }
+}
 
-    const QString order = orderList.join(',');
-    if (!cmd.procAsRoot("efibootmgr", {"-o", order})) {
-        // Only show generic error if it wasn't already an elevation failure (which shows its own message)
-        if (cmd.exitCode() != 126 && cmd.exitCode() != 127) {
-            QMessageBox::critical(this, tr("Error"), tr("Something went wrong, could not save boot order."));
+// Put the list and labels back to what NVRAM still holds after a failed write
+void MainWindow::revertStagedEntries(QListView *listEntries, QLabel *textTimeout, QLabel *textBootNext)
+{
+    const QList<BootEntryModel::Entry> entries = bootEntries.entries();
+    for (const BootEntryModel::Entry &entry : entries) {
+        if (entry.active != nvramBatch.committedActive(entry.bootNum)) {
+            bootEntries.setActive(entry.bootNum, !entry.active);
         }
-        return false;
     }
-    return true;
+    sortUefiBootOrder(nvramBatch.committedBootOrder(), listEntries);
+
+    cachedTimeout = nvramBatch.committedTimeout();
+    textTimeout->setText(tr("Timeout: %1 seconds").arg(cachedTimeout));
+    const QString bootNext = nvramBatch.committedBootNext();
+    textBootNext->setText(tr("Boot Next: %1").arg(bootNext.isEmpty() ? tr("not set, will boot using list order") : bootNext));
 }
 
 void MainWindow::setUefiTimeout(QWidget *uefiDialog, QLabel *textTimeout)
@@ -1746,58 +2971,141 @@ void MainWindow::setUefiTimeout(QWidget *uefiDialog, QLabel *textTimeout)
     int newTimeout = QInputDialog::getInt(uefiDialog, tr("Set timeout"), tr("Timeout in seconds:"), cachedTimeout,
                                           0, 65535, 1, &ok);
 
-    if (ok && Cmd().procAsRoot("efibootmgr", {"-t", QString::number(newTimeout)})) {
+    if (ok) {
+        nvramBatch.stageTimeout(newTimeout);
         cachedTimeout = newTimeout;
         textTimeout->setText(tr("Timeout: %1 seconds").arg(newTimeout));
     }
 }
 
-void MainWindow::setUefiBootNext(QListWidget *listEntries, QLabel *textBootNext)
+void MainWindow::showBootPerformance()
+{
+    const std::optional<bootperf::FirmwareTimes> firmware
+        = bootperf::readFirmwareTimes([this](const QStringList &paths) { return cmd.readFilesAsRoot(paths); });
+    const bootperf::Sample sample = bootperf::measure(firmware);
+    bootperf::record(sample);
+    const QList<bootperf::Sample> samples = bootperf::history();
+
+    const auto msec = [this](std::optional<double> value) {
+        return value ? tr("%1 ms").arg(locale().toString(*value, 'f', 0)) : QString("-");
+    };
+    const bootperf::Phases split = bootperf::phases(sample);
+    const auto usecToMsec = [](std::optional<quint64> usec) {
+        return usec ? std::optional<double>(*usec / 1000.0) : std::nullopt;
+    };
+    QString summary = tr("This boot: entry %1 (%2), firmware %3, boot loader %4")
+                          .arg(sample.bootCurrent, sample.label, msec(usecToMsec(split.firmwareUsec)),
+                               msec(usecToMsec(split.loaderUsec)));
+    if (!firmware) {
+        summary += '\n' + bootperf::missingFirmwareReason();
+    }
+
+    QDialog dialog(this);
+    dialog.setWindowTitle(tr("Boot performance"));
+    auto *layout = new QVBoxLayout(&dialog);
+    auto *textSummary = new QLabel(summary, &dialog);
+    textSummary->setWordWrap(true);
+    auto *table = new QTableWidget(&dialog);
+    table->setColumnCount(5);
+    table->setHorizontalHeaderLabels({tr("Entry"), tr("Description"), tr("Boots"), tr("Firmware"), tr("Boot loader")});
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table->verticalHeader()->hide();
+    const QList<bootperf::EntrySummary> entries = bootperf::summarize(samples);
+    table->setRowCount(static_cast<int>(entries.size()));
+    for (int row = 0; row < entries.size(); ++row) {
+        const bootperf::EntrySummary &entry = entries.at(row);
+        table->setItem(row, 0, new QTableWidgetItem(entry.bootCurrent));
+        table->setItem(row, 1, new QTableWidgetItem(entry.label));
+        table->setItem(row, 2, new QTableWidgetItem(QString::number(entry.boots)));
+        table->setItem(row, 3, new QTableWidgetItem(msec(entry.firmwareMsec)));
+        table->setItem(row, 4, new QTableWidgetItem(msec(entry.loaderMsec)));
+    }
+    table->resizeColumnsToContents();
+    table->setMinimumWidth(500);
+
+    auto *buttons = new QDialogButtonBox(QDialogButtonBox::Close, &dialog);
+    auto *pushExport = buttons->addButton(tr("&Export JSON..."), QDialogButtonBox::ActionRole);
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    connect(pushExport, &QPushButton::clicked, &dialog, [&dialog, &sample, &samples]() {
+        const QString fileName = QFileDialog::getSaveFileName(&dialog, tr("Export boot performance"),
+                                                              "boot-performance.json", tr("JSON files (*.json)"));
+        if (fileName.isEmpty()) {
+            return;
+        }
+        QSaveFile file(fileName);
+        const QByteArray json = QJsonDocument(bootperf::report(sample, samples)).toJson(QJsonDocument::Indented);
+        if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size() || !file.commit()) {
+            QMessageBox::critical(&dialog, tr("Error"), tr("Could not write %1: %2").arg(fileName, file.errorString()));
+        }
+    });
+    layout->addWidget(textSummary);
+    layout->addWidget(table);
+    layout->addWidget(buttons);
+    dialog.exec();
+}
+
+void MainWindow::showNvramUsage()
+{
+    const efivars::StoreUsage usage = efivars::readUsage();
+    const QLocale loc = locale();
+
+    QStringList lines;
+    lines << tr("Variables: %1 (%2 boot entries)").arg(usage.variableCount).arg(usage.bootEntryCount);
+    lines << tr("Estimated space used: %1").arg(loc.formattedDataSize(usage.usedBytes));
+    if (usage.isCapacityKnown()) {
+        lines << tr("Free space reported by the firmware: %1 of %2")
+                     .arg(loc.formattedDataSize(usage.freeBytes), loc.formattedDataSize(usage.totalBytes));
+    } else {
+        lines << tr("Free space: not reported by this kernel");
+    }
+    lines << tr("NVRAM writes made by UEFI Manager on this machine: %1").arg(efivars::writeCount());
+
+    QStringList largest;
+    for (const auto &var : usage.largest) {
+        largest << QString("%1  %2").arg(var.name, loc.formattedDataSize(var.size));
+    }
+
+    QMessageBox box(QMessageBox::Information, tr("NVRAM usage"), lines.join('\n'), QMessageBox::Ok, this);
+    box.setInformativeText(tr("Largest variables:") + '\n' + largest.join('\n'));
+    box.setDetailedText(QJsonDocument(efivars::toJson(usage)).toJson());
+    box.exec();
+}
+
+void MainWindow::setUefiBootNext(const QListView *listEntries, QLabel *textBootNext)
 {
     if (!listEntries || !textBootNext) {
         return;
     }
 
-    if (auto currentItem = listEntries->currentItem()) {
-        QString item = currentItem->text().section(' ', 0, 0);
-        item.remove(bootStripRegex);
-
-        if (hexIdRegex.match(item).hasMatch()
-            && Cmd().procAsRoot("efibootmgr", {"-n", item})) {
-            textBootNext->setText(tr("Boot Next: %1").arg(item));
-        }
+    const QString item = listEntries->currentIndex().data(BootEntryModel::BootNumRole).toString();
+    if (!item.isEmpty()) {
+        nvramBatch.stageBootNext(item);
+        textBootNext->setText(tr("Boot Next: %1").arg(item));
     }
 }
 
-void MainWindow::removeUefiEntry(QListWidget *listEntries, QWidget *uefiDialog)
+void MainWindow::removeUefiEntry(const QListView *listEntries, QWidget *uefiDialog)
 {
     if (!listEntries || !uefiDialog) {
         return;
     }
 
-    auto *currentItem = listEntries->currentItem();
-    if (!currentItem) {
+    const QModelIndex current = listEntries->currentIndex();
+    const QString item = current.data(BootEntryModel::BootNumRole).toString();
+    if (item.isEmpty()) {
         return;
     }
 
-    QString itemText = currentItem->text();
     if (QMessageBox::Yes
         != QMessageBox::question(uefiDialog, tr("Removal confirmation"),
-                                 tr("Are you sure you want to delete this boot entry?\n%1").arg(itemText))) {
-        return;
-    }
-
-    QString item = itemText.section(' ', 0, 0);
-    item.remove(bootStripRegex);
-
-    if (!item.contains(hexIdRegex)) {
+                                 tr("Are you sure you want to delete this boot entry?\n%1")
+                                     .arg(current.data().toString()))) {
         return;
     }
 
-    if (Cmd().procAsRoot("efibootmgr", {"-B", "-b", item})) {
-        delete currentItem;
+    if (nvramBatch.removeEntry(item)) {
+        bootEntries.removeEntry(item);
     }
-    emit listEntries->itemSelectionChanged();
 }
 
 // Helper function to check system is running with systemd
@@ -1813,57 +3121,3 @@ bool MainWindow::isSystemd() const
     return true;
 }
 
-// Helper function to check whether system under rootPath is a shim-systemd system
-bool MainWindow::isShimSystemd(const QString &rootPath) const
-{
-    QString root = rootPath; // Create a mutable copy of rootPath
-
-    // Remove trailing slash if it exists
-    if (root.endsWith("/")) {
-        root.chop(1); // Remove the last character
-    }
-
-    // sanity check if full path to init was given
-    if (root.endsWith("/usr/sbin/init")) {
-        root.chop(strlen("/usr/sbin/init"));
-    } else if (root.endsWith("/sbin/init")) {
-        root.chop(strlen("/sbin/init"));
-    } else if (root.endsWith("/usr/bin/init")) {
-        root.chop(strlen("/usr/bin/init"));
-    } else if (root.endsWith("/usr/lib/systemd/systemd")) {
-        root.chop(strlen("/usr/lib/systemd/systemd"));
-    } else if (root.endsWith("/lib/systemd/systemd")) {
-        root.chop(strlen("/lib/systemd/systemd"));
-    }
-
-    // Check if /sbin/init or /bin/init is a symlink to systemd
-    QString initPath;
-    if (QFile::exists(root + "/sbin/init")) {
-        initPath = root + "/sbin/init";
-    } else if (QFile::exists(root + "/bin/init")) {
-        initPath = root + "/bin/init";
-    } else {
-        return false;
-    }
-
-    if (!QFile::exists(root + "/lib/systemd/systemd")) {
-        return false;
-    }
-
-    // Read raw symlink target without resolving through host filesystem
-    QFileInfo initInfo(initPath);
-    if (!initInfo.isSymLink()) {
-        return true; // init is not a symlink to systemd, need explicit init= param
-    }
-
-    const QString target = initInfo.symLinkTarget();
-    // For absolute symlinks, resolve relative to the mounted root
-    QString resolvedTarget = target;
-    if (target.startsWith('/')) {
-        resolvedTarget = root + target;
-    }
-    if (resolvedTarget.startsWith(root)) {
-        resolvedTarget = resolvedTarget.mid(root.length());
-    }
-    return !resolvedTarget.endsWith("/systemd");
-}
@@ -22,12 +22,29 @@
 #pragma once
 
 #include <QCommandLineParser>
-#include <QListWidget>
+#include <QJsonObject>
+#include <QListView>
 #include <QMap>
 #include <QMessageBox>
+#include <QSet>
 #include <QSettings>
+#include <QThreadPool>
 
+#include "blockdevicemodel.h"
+#include "bootentrymodel.h"
+#include "bootsnapshot.h"
 #include "cmd.h"
+#include "devicepath.h"
+#include "efivarwatcher.h"
+#include "fatfs.h"
+#include "gpt.h"
+#include "kernelinventory.h"
+#include "luks.h"
+#include "nvrambatch.h"
+#include "rootfs.h"
+#include "rootprefetch.h"
+#include "rootprofile.h"
+#include "scancache.h"
 
 namespace Ui
 {
@@ -65,6 +82,12 @@ private slots:
 private:
     Ui::MainWindow *ui;
     Cmd cmd;
+    NvramBatch nvramBatch;
+    EfivarWatcher efivarWatcher;
+    QSet<QString> externalEntryChanges; // boot numbers changed by other tools, not yet shown
+    bool externalGlobalsChanged = false;
+    int efivarPollInterval = 0;
+    bool nvramCapacityUnknownAccepted = false; // asked once per session when the store's capacity isn't reported
     QString distro = getDistroName();
     int cachedTimeout = 0;
     QString espMountPoint;
@@ -73,22 +96,34 @@ private:
     QString rootPartition;
     QString rootDevicePath;
     QSettings settings;
-    QStringList driveList;
-    QStringList espList;
-    QStringList partitionList;
-    QStringList linuxPartitionList;
-    QStringList frugalPartitionList;
     QStringList newDirectories;
     QStringList newLuksDevices;
     QStringList newMounts;
-    struct PartitionInfo {
-        QString label;
-        QString parttype;
-    };
-    QMap<QString, PartitionInfo> partitionInfoMap;
+    BlockDeviceModel blockDevices; // drives and partitions from the last device scan
+    BootEntryModel bootEntries;    // the entries tab list, kept across refreshes of the tab
+    QMap<QString, gpt::Table> partitionTables; // by disk, e.g. /dev/sda; cleared on every device scan
+    QMap<QString, rootfs::Snapshot> rootSnapshots; // by partition, e.g. /dev/sda2; cleared on every device scan
+    QMap<QString, RootProfile> rootProfiles; // by partition, or by mount point for mounted roots; see rootProfile
+    RootPrefetcher rootPrefetcher;           // reads likely roots into rootSnapshots before they are chosen
+    QString pendingKernelChoice;             // partition whose kernels show once its background reads finish
+    QMap<QString, std::optional<luks::Header>> luksHeaders; // by partition, nullopt if not LUKS; cleared likewise
+    QStringList luksPartitions; // what lsblk reported as crypto_LUKS in the last device scan
+    devicepath::PartuuidIndex partuuidIndex;
+    KernelInventory kernelInventory; // the boot or frugal directory kernels are copied from
+    scancache::Snapshot scanCache; // the last scan, saved on exit for a warm start
+    bool useCachedDevices = false; // the next listDevices shows scanCache.devices instead of running lsblk
+    QString staleKernelChoice;     // partition whose cached kernels are shown but not read again yet
+    QThreadPool scanPool;          // runs the rescan that checks a warm start
 
     static const QMap<QString, QString> PERSISTENCE_TYPES;
 
+    // Where / is mounted from; partition and drive are empty when it isn't a block device
+    struct RootDevice {
+        QString path;      // e.g. /dev/mapper/root
+        QString partition; // e.g. sda2
+        QString drive;     // e.g. sda
+    };
+
     struct Options {
         QString entryName;
         QString uuid;
@@ -97,6 +132,7 @@ private:
         QString persistenceType;
     } options;
 
+    [[nodiscard]] QString describeBootTarget(const QString &entryLine, bool *missing) const;
     [[nodiscard]] QString getBootLocation();
     [[nodiscard]] QString getBootLocation(const QString &mountPoint);
     [[nodiscard]] QString getDistroName(bool pretty = false, const QString &mountPoint = "/",
@@ -106,42 +142,82 @@ private:
     [[nodiscard]] QString openLuks(const QString &part);
     [[nodiscard]] QString selectESP();
     [[nodiscard]] QString selectFrugalDirectory(const QString &part);
-    [[nodiscard]] bool checkSizeEsp();
+    [[nodiscard]] bool checkNvramHeadroom(qint64 neededBytes);
+    [[nodiscard]] bool checkSizeEsp(const std::optional<fatfs::Summary> &esp);
     [[nodiscard]] bool copyKernel();
+    [[nodiscard]] std::optional<gpt::Partition> espPartition(const QString &esp, QString *disk = nullptr);
+    [[nodiscard]] bool editUefiEntry(const QListView *listEntries, QWidget *uefiDialog);
+    [[nodiscard]] std::optional<BootEntryModel::Entry> entryFromLine(const QString &line) const;
+    [[nodiscard]] bool installBlsEntry(const QString &esp);
     [[nodiscard]] bool installEfiStub(const QString &esp);
+    [[nodiscard]] bool installKernelSlot(const QString &esp);
     [[nodiscard]] bool isLuks(const QString &part);
+    [[nodiscard]] std::optional<luks::Header> luksHeader(const QString &part);
+    [[nodiscard]] QString luksMapping(const QString &part) const;
+    [[nodiscard]] QString luksMountPoint(const QString &part) const;
     [[nodiscard]] bool readGrubEntry();
-    static void removeUefiEntry(QListWidget *listEntries, QWidget *uefiDialog);
-    static void setUefiBootNext(QListWidget *listEntries, QLabel *textBootNext);
+    [[nodiscard]] scancache::KernelChoice readKernelChoice(const rootfs::Snapshot &root);
+    [[nodiscard]] rootfs::Snapshot readMountedRoot(const QString &mountPoint);
+    [[nodiscard]] std::optional<rootfs::Snapshot> readRoot(const QString &source);
+    [[nodiscard]] RootProfile rootProfile(const rootfs::Snapshot &root);
+    [[nodiscard]] QString separateBootDevice(const rootfs::Snapshot &root);
+    [[nodiscard]] QStringList helperOnlyRoots(const QString &device) const;
+    [[nodiscard]] RootProfile rootProfile(const QString &mountPoint);
+    [[nodiscard]] scancache::KernelChoice rememberKernelChoice(const QString &partition, const rootfs::Snapshot &root);
+    [[nodiscard]] bool reuseBootEntry(const bootsnapshot::Snapshot &current, quint16 number, const QString &label);
+    [[nodiscard]] QStringList removeDuplicateEntries(QWidget *uefiDialog);
+    [[nodiscard]] bool showKernelSlots(QWidget *uefiDialog);
+    void removeUefiEntry(const QListView *listEntries, QWidget *uefiDialog);
+    void setUefiBootNext(const QListView *listEntries, QLabel *textBootNext);
     void setUefiTimeout(QWidget *uefiDialog, QLabel *textTimeout);
-    static void sortUefiBootOrder(const QStringList &order, QListWidget *list);
-    static void toggleUefiActive(QListWidget *listEntries);
+    void showBootPerformance();
+    void showNvramUsage();
+    void sortUefiBootOrder(const QStringList &order, QListView *list);
+    void toggleUefiActive(const QListView *listEntries);
     void addDevToList();
-    void addUefiEntry(QListWidget *listEntries, QWidget *dialogUefi);
+    void applyKernelChoice(const scancache::KernelChoice &choice);
+    void buildPartuuidIndex();
+    void addUefiEntry(QWidget *dialogUefi);
+    void applyExternalChanges(QListView *listEntries, QLabel *textTimeout, QLabel *textBootNext,
+                              QLabel *textBootCurrent);
     void checkDoneStub();
     void clearEntryWidget();
     void cleanEspTarget(const QString &targetPath);
     void filterDrivePartitions();
-    void getKernelOptions(const QString &mountPoint, const QString &rootDir, const QString &kernel);
-    QString determineKernelDir(const QString &bootDir, const QString &rootDir);
-    QPair<QStringList, QString> getRootIdentifiers(const QString &rootDir);
-    QString parseGrubOptions(const QString &grubFile, const QStringList &rootPatterns, const QString &kernelDir, const QString &vmlinuz);
-    QString getFallbackOptions(const QString &rootDir, const QString &rootUUID);
-    QString combineBootOptions(const QString &parsedOptions, const QString &rootDir);
+    QString getKernelOptions(const rootfs::Snapshot &boot, const QString &bootDir, const rootfs::Snapshot &root,
+                             const RootProfile &profile, const QString &kernel);
+    QPair<QStringList, QString> getRootIdentifiers(const rootfs::Snapshot &root, const RootProfile &profile);
+    QString parseGrubOptions(const QByteArray &grubCfg, const QStringList &rootPatterns, const QString &kernelDir,
+                             const QString &vmlinuz);
+    QString getFallbackOptions(const rootfs::Snapshot &root, const QString &rootUUID);
+    QString combineBootOptions(const QString &parsedOptions, const RootProfile &profile);
     void guessPartition();
     void detectRootDevice();
+    [[nodiscard]] static RootDevice findRootDevice(Cmd &cmd);
+    void setRootDevice(const RootDevice &root);
     QStringList getEspDevicePaths();
+    QString readablePartitionType(const QString &partition);
     void listDevices();
+    [[nodiscard]] QJsonArray scanDevices();
+    [[nodiscard]] static QJsonArray readBlockDevices(Cmd &cmd);
+    void loadLuksHeaders(const QStringList &devices);
+    void loadPartitionTables(const QStringList &disks);
+    [[nodiscard]] QJsonObject readDevices(const QString &reader, const QStringList &devices);
     void loadStubOption();
+    void prefetchRoots();
+    void prefetchedRoot(const QString &device, const std::optional<rootfs::Snapshot> &snapshot);
     void promptFrugalStubInstall();
-    void readBootEntries(QListWidget *listEntries, QLabel *textTimeout, QLabel *textBootNext, QLabel *textBootCurrent,
-                         QStringList *bootorder);
+    void readBootEntries(QLabel *textTimeout, QLabel *textBootNext, QLabel *textBootCurrent, QStringList *bootorder);
     void refreshEntries();
     void refreshFrugal();
     void refreshStubInstall();
-    bool saveBootOrder(const QListWidget *list);
-    void selectKernel(const QString &mountPoint);
+    void revalidateKernelChoice();
+    void revalidateScan();
+    void applyRescan(const RootDevice &root, const QJsonArray &devices);
+    void showPendingKernelChoice();
+    void revertStagedEntries(QListView *listEntries, QLabel *textTimeout, QLabel *textBootNext);
+    void stageBootOrder();
     void validateAndLoadOptions(const QString &frugalDir);
     bool isSystemd() const;
-    bool isShimSystemd(const QString &rootPath = "/") const;
+    [[nodiscard]] bool usesStubDirectory() const;
 };
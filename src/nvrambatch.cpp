@@ -0,0 +1,180 @@
+#include "nvrambatch.h"
+
+#include <QDebug>
+
+#include "common.h"
+#include "efivars.h"
+
+NvramBatch::NvramBatch(QObject *parent)
+    : QObject(parent)
+{
+    timer.setSingleShot(true);
+    timer.setInterval(2000);
+    connect(&timer, &QTimer::timeout, this, &NvramBatch::flush);
+}
+
+void NvramBatch::setCommitted(const QStringList &order, const QString &next, int seconds,
+                              const QHash<QString, bool> &activeFlags)
+{
+    committed = {order, next, seconds, activeFlags};
+    base = bootsnapshot::captureWithBootNext();
+    discard();
+}
+
+void NvramBatch::stageBootOrder(const QStringList &order)
+{
+    if (order == committed.bootOrder) {
+        bootOrder.reset();
+    } else {
+        bootOrder = order;
+    }
+    staged();
+}
+
+void NvramBatch::stageBootNext(const QString &bootNum)
+{
+    if (bootNum == committed.bootNext) {
+        bootNext.reset();
+    } else {
+        bootNext = bootNum;
+    }
+    staged();
+}
+
+void NvramBatch::stageTimeout(int seconds)
+{
+    if (seconds == committed.timeout) {
+        timeout.reset();
+    } else {
+        timeout = seconds;
+    }
+    staged();
+}
+
+void NvramBatch::stageActive(const QString &bootNum, bool isActive)
+{
+    if (isActive == committedActive(bootNum)) {
+        active.remove(bootNum);
+    } else {
+        active.insert(bootNum, isActive);
+    }
+    staged();
+}
+
+bool NvramBatch::hasPending() const
+{
+    return bootOrder || bootNext || timeout || !active.isEmpty();
+}
+
+nvrammerge::Edit NvramBatch::pendingEdit() const
+{
+    return {bootOrder, bootNext, timeout, active};
+}
+
+bool NvramBatch::flush()
+{
+    timer.stop();
+    if (!hasPending()) {
+        return true;
+    }
+
+    const nvrammerge::Edit edit = pendingEdit();
+    const bool ok = write([this, &edit](const bootsnapshot::Snapshot &current) {
+        return nvrammerge::plan(base, current, edit);
+    });
+    if (ok) {
+        if (bootOrder) {
+            committed.bootOrder = *bootOrder;
+        }
+        if (bootNext) {
+            committed.bootNext = *bootNext;
+        }
+        if (timeout) {
+            committed.timeout = *timeout;
+        }
+        for (auto it = active.cbegin(); it != active.cend(); ++it) {
+            committed.active.insert(it.key(), it.value());
+        }
+    } else {
+        qWarning() << "Failed to write staged NVRAM changes";
+    }
+    discard();
+    emit flushed(ok);
+    return ok;
+}
+
+bool NvramBatch::removeEntry(const QString &bootNum)
+{
+    if (!flush()) {
+        return false;
+    }
+    const bool ok = write([this, &bootNum](const bootsnapshot::Snapshot &current) {
+        return nvrammerge::planRemoval(base, current, bootNum);
+    });
+    if (!ok || base.find("Boot" + bootNum.toUpper())) {
+        return false;
+    }
+    forgetEntry(bootNum);
+    return true;
+}
+
+void NvramBatch::discard()
+{
+    timer.stop();
+    const bool hadPending = hasPending();
+    bootOrder.reset();
+    bootNext.reset();
+    timeout.reset();
+    active.clear();
+    if (hadPending) {
+        emit pendingChanged(false);
+    }
+}
+
+// Drop an entry that was deleted outside the batch from the committed state
+void NvramBatch::forgetEntry(const QString &bootNum)
+{
+    committed.bootOrder.removeAll(bootNum);
+    committed.active.remove(bootNum);
+    if (committed.bootNext == bootNum) {
+        committed.bootNext.clear();
+    }
+}
+
+// Plan against the variables as they are now and write with their versions. If another
+// instance writes in between, the helper refuses the batch and it is planned once more.
+bool NvramBatch::write(const std::function<nvrammerge::Plan(const bootsnapshot::Snapshot &)> &planner)
+{
+    Cmd::resetElevation();
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        const bootsnapshot::Snapshot current = bootsnapshot::captureWithBootNext();
+        const nvrammerge::Plan plan = planner(current);
+        const bool ok = cmd.procAsRootEfivars(bootsnapshot::toHelperOperations(plan.changes));
+        exitCode = cmd.exitCode();
+        if (ok) {
+            efivars::recordWrites(static_cast<int>(plan.changes.size()));
+            merged = current.variables != base.variables;
+            base = bootsnapshot::captureWithBootNext();
+            if (!plan.conflicts.isEmpty()) {
+                emit conflicts(plan.conflicts);
+            }
+            return true;
+        }
+        if (exitCode != EXIT_CODE_CONFLICT) {
+            break;
+        }
+        qDebug() << "NVRAM changed while writing, planning the batch again";
+    }
+    return false;
+}
+
+void NvramBatch::staged()
+{
+    const bool pending = hasPending();
+    if (pending) {
+        timer.start();
+    } else {
+        timer.stop();
+    }
+    emit pendingChanged(pending);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <QHash>
+#include <QObject>
+#include <QStringList>
+#include <QTimer>
+
+#include <functional>
+#include <optional>
+
+#include "bootsnapshot.h"
+#include "cmd.h"
+#include "nvrammerge.h"
+
+// Stages edits to BootOrder, BootNext, Timeout and the active flags in memory
+// and writes them to NVRAM as one batch, either after a debounce period or when
+// flush() is called. Edits that end up matching the committed state are dropped.
+// Edits are based on the variables read by setCommitted(); whatever other programs
+// changed since then is merged in at flush time, or reported through conflicts().
+class NvramBatch : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit NvramBatch(QObject *parent = nullptr);
+
+    void setCommitted(const QStringList &order, const QString &next, int seconds,
+                      const QHash<QString, bool> &activeFlags);
+    void setDelay(int msec) { timer.setInterval(msec); }
+
+    void stageBootOrder(const QStringList &order);
+    void stageBootNext(const QString &bootNum); // empty clears BootNext
+    void stageTimeout(int seconds);
+    void stageActive(const QString &bootNum, bool isActive);
+
+    [[nodiscard]] bool hasPending() const;
+    [[nodiscard]] nvrammerge::Edit pendingEdit() const;
+    [[nodiscard]] const QStringList &committedBootOrder() const { return committed.bootOrder; }
+    [[nodiscard]] const QString &committedBootNext() const { return committed.bootNext; }
+    [[nodiscard]] int committedTimeout() const { return committed.timeout; }
+    [[nodiscard]] bool committedActive(const QString &bootNum) const { return committed.active.value(bootNum, true); }
+    [[nodiscard]] int lastExitCode() const { return exitCode; }
+    // The last write merged in changes made by another program, so views should re-read NVRAM
+    [[nodiscard]] bool lastWriteMerged() const { return merged; }
+
+    bool flush();
+    void discard();
+    // Flushes, then deletes the entry and drops it from BootOrder and BootNext
+    bool removeEntry(const QString &bootNum);
+    void forgetEntry(const QString &bootNum);
+
+signals:
+    void pendingChanged(bool pending);
+    void flushed(bool ok);
+    void conflicts(const QStringList &messages);
+
+private:
+    struct State {
+        QStringList bootOrder;
+        QString bootNext;
+        int timeout = 0;
+        QHash<QString, bool> active;
+    } committed;
+    bootsnapshot::Snapshot base; // raw variables the committed state was read from
+
+    std::optional<QStringList> bootOrder;
+    std::optional<QString> bootNext;
+    std::optional<int> timeout;
+    QHash<QString, bool> active;
+
+    Cmd cmd;
+    QTimer timer;
+    int exitCode = 0;
+    bool merged = false;
+
+    void staged();
+    bool write(const std::function<nvrammerge::Plan(const bootsnapshot::Snapshot &)> &planner);
+};
@@ -0,0 +1,148 @@
+#include "nvrammerge.h"
+
+#include <QObject>
+#include <QtEndian>
+
+#include "loadoption.h"
+
+namespace nvrammerge
+{
+
+namespace
+{
+QStringList bootOrderOf(const bootsnapshot::Snapshot &snapshot)
+{
+    const bootsnapshot::Variable *var = snapshot.find("BootOrder");
+    QStringList order;
+    if (var) {
+        for (quint16 number : bootsnapshot::decodeUint16List(var->data)) {
+            order.append(bootsnapshot::bootVariableName(number).mid(4));
+        }
+    }
+    return order;
+}
+
+QByteArray encodeBootOrder(const QStringList &order)
+{
+    QList<quint16> numbers;
+    numbers.reserve(order.size());
+    for (const QString &bootNum : order) {
+        numbers.append(bootNum.toUShort(nullptr, 16));
+    }
+    return bootsnapshot::encodeUint16List(numbers);
+}
+
+QByteArray dataOf(const bootsnapshot::Snapshot &snapshot, const QString &name)
+{
+    const bootsnapshot::Variable *var = snapshot.find(name);
+    return var ? var->data : QByteArray();
+}
+
+// Write data to name, or delete it when data is empty, based on its current version
+void setVariable(Plan *result, const bootsnapshot::Snapshot &current, const QString &name, const QByteArray &data)
+{
+    const bootsnapshot::Variable *var = current.find(name);
+    if (data == (var ? var->data : QByteArray())) {
+        return;
+    }
+    bootsnapshot::Change change;
+    change.kind = data.isEmpty() ? bootsnapshot::Change::Kind::Delete : bootsnapshot::Change::Kind::Write;
+    change.variable = {name, var ? var->attributes : bootsnapshot::BOOT_VARIABLE_ATTRIBUTES, data};
+    change.expectedVersion = bootsnapshot::version(var);
+    result->changes.append(change);
+}
+
+// BootNext and Timeout: ours wins unless another program set a different value meanwhile
+void mergeScalar(Plan *result, const bootsnapshot::Snapshot &base, const bootsnapshot::Snapshot &current,
+                 const QString &name, const QByteArray &ours)
+{
+    const QByteArray theirs = dataOf(current, name);
+    if (theirs != dataOf(base, name) && theirs != ours) {
+        result->conflicts.append(QObject::tr("%1 was changed by another program and was left as is.").arg(name));
+        return;
+    }
+    setVariable(result, current, name, ours);
+}
+} // namespace
+
+QStringList mergeBootOrder(const QStringList &ours, const QStringList &theirs)
+{
+    QStringList merged;
+    for (const QString &bootNum : ours) {
+        if (theirs.contains(bootNum) && !merged.contains(bootNum)) {
+            merged.append(bootNum);
+        }
+    }
+    for (qsizetype i = 0; i < theirs.size(); ++i) {
+        const QString &bootNum = theirs.at(i);
+        if (merged.contains(bootNum)) {
+            continue;
+        }
+        // Added elsewhere: keep it right after the entry it follows in theirs
+        merged.insert(i == 0 ? 0 : merged.indexOf(theirs.at(i - 1)) + 1, bootNum);
+    }
+    return merged;
+}
+
+Plan plan(const bootsnapshot::Snapshot &base, const bootsnapshot::Snapshot &current, const Edit &edit)
+{
+    Plan result;
+    for (auto it = edit.active.cbegin(); it != edit.active.cend(); ++it) {
+        const QString name = "Boot" + it.key().toUpper();
+        const bootsnapshot::Variable *var = current.find(name);
+        if (!var || !loadoption::decode(var->data)) {
+            result.conflicts.append(QObject::tr("%1 was removed by another program.").arg(name));
+            continue;
+        }
+        // Only the attribute bits change, so edits to the rest of the entry made elsewhere are kept
+        QByteArray data = var->data;
+        quint32 attributes = qFromLittleEndian<quint32>(data.constData());
+        attributes = it.value() ? attributes | loadoption::LOAD_OPTION_ACTIVE
+                                : attributes & ~loadoption::LOAD_OPTION_ACTIVE;
+        qToLittleEndian(attributes, data.data());
+        setVariable(&result, current, name, data);
+    }
+    if (edit.bootOrder) {
+        const QStringList theirs = bootOrderOf(current);
+        const QStringList merged = mergeBootOrder(*edit.bootOrder, theirs);
+        if (merged != theirs && !merged.isEmpty()) {
+            setVariable(&result, current, "BootOrder", encodeBootOrder(merged));
+        }
+    }
+    if (edit.bootNext) {
+        const QByteArray ours = edit.bootNext->isEmpty() ? QByteArray() : encodeBootOrder({*edit.bootNext});
+        mergeScalar(&result, base, current, "BootNext", ours);
+    }
+    if (edit.timeout) {
+        mergeScalar(&result, base, current, "Timeout",
+                    bootsnapshot::encodeUint16List({static_cast<quint16>(*edit.timeout)}));
+    }
+    return result;
+}
+
+Plan planRemoval(const bootsnapshot::Snapshot &base, const bootsnapshot::Snapshot &current, const QString &bootNum)
+{
+    Plan result;
+    const QString name = "Boot" + bootNum.toUpper();
+    const bootsnapshot::Variable *var = current.find(name);
+    if (!var) {
+        return result; // already removed elsewhere
+    }
+    const bootsnapshot::Variable *baseVar = base.find(name);
+    if (baseVar && *baseVar != *var) {
+        result.conflicts.append(QObject::tr("%1 was changed by another program and was not removed.").arg(name));
+        return result;
+    }
+
+    QStringList order = bootOrderOf(current);
+    if (order.removeAll(bootNum.toUpper()) > 0) {
+        setVariable(&result, current, "BootOrder", encodeBootOrder(order));
+    }
+    if (dataOf(current, "BootNext") == encodeBootOrder({bootNum})) {
+        setVariable(&result, current, "BootNext", {});
+    }
+    setVariable(&result, current, name, {});
+    return result;
+}
+
+} // namespace nvrammerge
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <QHash>
+#include <QStringList>
+
+#include <optional>
+
+#include "bootsnapshot.h"
+
+// Plans staged NVRAM edits against the variables as they are now, merging in what other
+// programs changed since the edits' base was read. Every planned change carries the version
+// it was planned against, so the helper rejects it if NVRAM moves again before the write.
+namespace nvrammerge
+{
+
+// Boot numbers are four hex digits, e.g. "0001"
+struct Edit {
+    std::optional<QStringList> bootOrder;
+    std::optional<QString> bootNext; // empty clears BootNext
+    std::optional<int> timeout;
+    QHash<QString, bool> active;
+};
+
+struct Plan {
+    QList<bootsnapshot::Change> changes;
+    QStringList conflicts; // one message per variable left as another program set it
+};
+
+// ours applied on top of theirs: entries removed elsewhere are dropped, entries added elsewhere
+// stay right after the entry they followed in theirs
+[[nodiscard]] QStringList mergeBootOrder(const QStringList &ours, const QStringList &theirs);
+
+[[nodiscard]] Plan plan(const bootsnapshot::Snapshot &base, const bootsnapshot::Snapshot &current, const Edit &edit);
+// Delete an entry unless another program changed it since base, and drop it from BootOrder and BootNext
+[[nodiscard]] Plan planRemoval(const bootsnapshot::Snapshot &base, const bootsnapshot::Snapshot &current,
+                               const QString &bootNum);
+
+} // namespace nvrammerge
@@ -0,0 +1,1351 @@
+#include "rootfs.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonArray>
+#include <QObject>
+#include <QRegularExpression>
+#include <QSet>
+#include <QUuid>
+#include <QtEndian>
+
+#include <algorithm>
+#include <array>
+#include <compare>
+#include <memory>
+
+namespace rootfs
+{
+
+namespace
+{
+// Paths selecting a kernel looks at; the systemd binary only has to exist
+struct Probe {
+    const char *path;
+    bool contents;
+};
+constexpr std::array PROBED_FILES {
+    Probe {"/etc/fstab", true},          Probe {"/etc/crypttab", true},       Probe {"/etc/os-release", true},
+    Probe {"/etc/lsb-release", true},    Probe {"/etc/initrd_release", true}, Probe {"/etc/antix-version", true},
+    Probe {"/etc/mx-version", true},     Probe {"/etc/default/grub", true},   Probe {"/boot/grub/grub.cfg", true},
+    Probe {"/grub/grub.cfg", true},      Probe {"/sbin/init", false},         Probe {"/bin/init", false},
+    Probe {"/lib/systemd/systemd", false},
+};
+constexpr std::array PROBED_DIRECTORIES {"/", "/boot"};
+
+constexpr quint64 MAX_CONTENT_BYTES = 1024 * 1024;
+constexpr quint64 MAX_LINK_BYTES = 4096;
+constexpr quint64 MAX_DIRECTORY_BYTES = 4 * 1024 * 1024;
+constexpr quint64 MAX_READ_BYTES = 4 * 1024 * 1024;
+constexpr int MAX_SYMLINKS = 8;
+
+constexpr quint32 MODE_TYPE_MASK = 0xf000;
+constexpr quint32 MODE_DIRECTORY = 0x4000;
+constexpr quint32 MODE_FILE = 0x8000;
+constexpr quint32 MODE_SYMLINK = 0xa000;
+// Directory entry file types, the same on ext4 and btrfs
+constexpr quint8 FT_FILE = 1;
+constexpr quint8 FT_DIRECTORY = 2;
+constexpr quint8 FT_SYMLINK = 7;
+
+// ext2/3/4 superblock, group descriptors and inodes
+constexpr quint64 EXT_SUPERBLOCK_OFFSET = 1024;
+constexpr quint32 EXT_SUPERBLOCK_SIZE = 1024;
+constexpr qsizetype EXT_INODES_COUNT = 0;
+constexpr qsizetype EXT_BLOCKS_COUNT_LO = 4;
+constexpr qsizetype EXT_FIRST_DATA_BLOCK = 20;
+constexpr qsizetype EXT_LOG_BLOCK_SIZE = 24;
+constexpr qsizetype EXT_INODES_PER_GROUP = 40;
+constexpr qsizetype EXT_MAGIC = 56;
+constexpr qsizetype EXT_REV_LEVEL = 76;
+constexpr qsizetype EXT_INODE_SIZE = 88;
+constexpr qsizetype EXT_FEATURE_INCOMPAT = 96;
+constexpr qsizetype EXT_UUID = 104;
+constexpr qsizetype EXT_VOLUME_NAME = 120;
+constexpr qsizetype EXT_DESC_SIZE = 254;
+constexpr qsizetype EXT_BLOCKS_COUNT_HI = 336;
+constexpr quint16 EXT_MAGIC_VALUE = 0xef53;
+constexpr quint32 EXT_INCOMPAT_COMPRESSION = 0x1;
+constexpr quint32 EXT_INCOMPAT_FILETYPE = 0x2;
+constexpr quint32 EXT_INCOMPAT_JOURNAL_DEV = 0x8;
+constexpr quint32 EXT_INCOMPAT_META_BG = 0x10;
+constexpr quint32 EXT_INCOMPAT_64BIT = 0x80;
+constexpr qsizetype EXT_DESC_INODE_TABLE_LO = 8;
+constexpr qsizetype EXT_DESC_INODE_TABLE_HI = 0x28;
+constexpr quint32 EXT_MIN_DESC_SIZE = 32;
+constexpr quint32 EXT_MIN_DESC_SIZE_64BIT = 64;
+constexpr quint32 EXT_GOOD_OLD_INODE_SIZE = 128;
+constexpr quint32 EXT_ROOT_INODE = 2;
+constexpr qsizetype EXT_I_MODE = 0;
+constexpr qsizetype EXT_I_SIZE_LO = 4;
+constexpr qsizetype EXT_I_FLAGS = 32;
+constexpr qsizetype EXT_I_BLOCK = 40;
+constexpr qsizetype EXT_I_BLOCK_SIZE = 60;
+constexpr qsizetype EXT_I_SIZE_HIGH = 108;
+constexpr quint32 EXT_EXTENTS_FL = 0x80000;
+constexpr quint32 EXT_INLINE_DATA_FL = 0x10000000;
+constexpr int EXT_DIRECT_BLOCKS = 12;
+// Extent trees
+constexpr quint16 EXT_EXTENT_MAGIC = 0xf30a;
+constexpr qsizetype EXT_EXTENT_HEADER_SIZE = 12;
+constexpr qsizetype EXT_EXTENT_ENTRY_SIZE = 12;
+constexpr quint16 EXT_MAX_INIT_EXTENT_LENGTH = 32768;
+constexpr int EXT_MAX_EXTENT_DEPTH = 5;
+constexpr qsizetype EXT_MAX_EXTENTS = 65536;
+// Linear directory entries
+constexpr qsizetype EXT_DIR_ENTRY_HEADER = 8;
+constexpr qsizetype EXT_INLINE_DIR_PARENT = 4;
+
+// btrfs superblock, tree nodes and items
+constexpr quint64 BTRFS_SUPERBLOCK_OFFSET = 0x10000;
+constexpr quint32 BTRFS_SUPERBLOCK_SIZE = 4096;
+constexpr qsizetype BTRFS_FSID = 0x20;
+constexpr qsizetype BTRFS_MAGIC = 0x40;
+constexpr qsizetype BTRFS_ROOT = 0x50;
+constexpr qsizetype BTRFS_CHUNK_ROOT = 0x58;
+constexpr qsizetype BTRFS_ROOT_DIR_OBJECTID = 0x80;
+constexpr qsizetype BTRFS_NUM_DEVICES = 0x88;
+constexpr qsizetype BTRFS_SECTOR_SIZE = 0x90;
+constexpr qsizetype BTRFS_NODE_SIZE = 0x94;
+constexpr qsizetype BTRFS_SYS_CHUNK_ARRAY_SIZE = 0xa0;
+constexpr qsizetype BTRFS_INCOMPAT_FLAGS = 0xbc;
+constexpr qsizetype BTRFS_ROOT_LEVEL = 0xc6;
+constexpr qsizetype BTRFS_CHUNK_ROOT_LEVEL = 0xc7;
+constexpr qsizetype BTRFS_LABEL = 0x12b;
+constexpr qsizetype BTRFS_LABEL_SIZE = 256;
+constexpr qsizetype BTRFS_METADATA_UUID = 0x23b;
+constexpr qsizetype BTRFS_SYS_CHUNK_ARRAY = 0x32b;
+constexpr quint32 BTRFS_SYS_CHUNK_ARRAY_MAX = 2048;
+constexpr char BTRFS_MAGIC_VALUE[] = "_BHRfS_M";
+constexpr qsizetype BTRFS_MAGIC_SIZE = 8;
+constexpr quint64 BTRFS_INCOMPAT_METADATA_UUID = 1 << 10;
+constexpr qsizetype BTRFS_HEADER_FSID = 0x20;
+constexpr qsizetype BTRFS_HEADER_BYTENR = 0x30;
+constexpr qsizetype BTRFS_HEADER_NRITEMS = 0x60;
+constexpr qsizetype BTRFS_HEADER_LEVEL = 0x64;
+constexpr qsizetype BTRFS_HEADER_SIZE = 0x65;
+constexpr qsizetype BTRFS_KEY_SIZE = 17;
+constexpr qsizetype BTRFS_ITEM_SIZE = 25;    // key, data offset, data size
+constexpr qsizetype BTRFS_KEY_PTR_SIZE = 33; // key, block pointer, generation
+constexpr int BTRFS_MAX_LEVEL = 8;
+constexpr qsizetype BTRFS_MAX_ITEMS = 65536;
+// Tree nodes one lookup may read; a real lookup needs a handful, a crafted tree with overlapping
+// children could otherwise fan out to items^depth reads
+constexpr qsizetype BTRFS_MAX_SEARCH_NODES = 4096;
+constexpr quint8 BTRFS_INODE_ITEM = 1;
+constexpr quint8 BTRFS_DIR_ITEM = 84;
+constexpr quint8 BTRFS_DIR_INDEX = 96;
+constexpr quint8 BTRFS_EXTENT_DATA = 108;
+constexpr quint8 BTRFS_ROOT_ITEM = 132;
+constexpr quint8 BTRFS_ROOT_BACKREF = 144;
+constexpr quint8 BTRFS_CHUNK_ITEM = 228;
+constexpr quint64 BTRFS_FS_TREE = 5;
+constexpr quint64 BTRFS_FIRST_CHUNK_TREE = 256;
+constexpr quint64 BTRFS_FIRST_INODE = 256; // the root directory of every subvolume
+constexpr qsizetype BTRFS_CHUNK_LENGTH = 0;
+constexpr qsizetype BTRFS_CHUNK_TYPE = 24;
+constexpr qsizetype BTRFS_CHUNK_NUM_STRIPES = 44;
+constexpr qsizetype BTRFS_CHUNK_STRIPES = 48;
+constexpr qsizetype BTRFS_STRIPE_SIZE = 32;
+constexpr qsizetype BTRFS_STRIPE_OFFSET = 8;
+// RAID0, RAID10, RAID5 and RAID6 spread a chunk over stripes; the others keep whole copies
+constexpr quint64 BTRFS_STRIPED_PROFILES = 0x8 | 0x40 | 0x80 | 0x100;
+constexpr qsizetype BTRFS_ROOT_ITEM_BYTENR = 176;
+constexpr qsizetype BTRFS_ROOT_ITEM_LEVEL = 238;
+constexpr qsizetype BTRFS_INODE_SIZE = 16;
+constexpr qsizetype BTRFS_INODE_MODE = 52;
+constexpr qsizetype BTRFS_DIR_DATA_LEN = 25;
+constexpr qsizetype BTRFS_DIR_NAME_LEN = 27;
+constexpr qsizetype BTRFS_DIR_TYPE = 29;
+constexpr qsizetype BTRFS_DIR_NAME = 30;
+constexpr qsizetype BTRFS_BACKREF_NAME_LEN = 16;
+constexpr qsizetype BTRFS_BACKREF_NAME = 18;
+constexpr qsizetype BTRFS_EXTENT_RAM_BYTES = 8;
+constexpr qsizetype BTRFS_EXTENT_COMPRESSION = 16;
+constexpr qsizetype BTRFS_EXTENT_TYPE = 20;
+constexpr qsizetype BTRFS_EXTENT_INLINE_DATA = 21;
+constexpr qsizetype BTRFS_EXTENT_DISK_BYTENR = 21;
+constexpr qsizetype BTRFS_EXTENT_DISK_NUM_BYTES = 29;
+constexpr qsizetype BTRFS_EXTENT_OFFSET = 37;
+constexpr qsizetype BTRFS_EXTENT_NUM_BYTES = 45;
+constexpr qsizetype BTRFS_EXTENT_REGULAR_SIZE = 53;
+constexpr quint8 BTRFS_EXTENT_INLINE = 0;
+constexpr quint8 BTRFS_EXTENT_PREALLOC = 2;
+constexpr quint8 BTRFS_COMPRESS_ZLIB = 1;
+
+bool fail(QString *error, const QString &message)
+{
+    if (error) {
+        *error = message;
+    }
+    return false;
+}
+
+bool isPowerOfTwo(quint64 value)
+{
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+Kind kindOfMode(quint32 mode)
+{
+    switch (mode & MODE_TYPE_MASK) {
+    case MODE_FILE:
+        return Kind::File;
+    case MODE_DIRECTORY:
+        return Kind::Directory;
+    case MODE_SYMLINK:
+        return Kind::Symlink;
+    default:
+        return Kind::Other;
+    }
+}
+
+Kind kindOfFileType(quint8 type)
+{
+    switch (type) {
+    case FT_FILE:
+        return Kind::File;
+    case FT_DIRECTORY:
+        return Kind::Directory;
+    case FT_SYMLINK:
+        return Kind::Symlink;
+    default:
+        return Kind::Other;
+    }
+}
+
+// A NUL-padded name field
+QString fixedString(const QByteArray &bytes)
+{
+    const qsizetype end = bytes.indexOf('\0');
+    return QString::fromUtf8(end < 0 ? bytes : bytes.first(end)).trimmed();
+}
+
+QString uuidString(const QByteArray &bytes)
+{
+    return QUuid::fromRfc4122(bytes).toString(QUuid::WithoutBraces);
+}
+
+struct Ref {
+    quint64 tree = 0; // btrfs subvolume; unused on ext4
+    quint64 inode = 0;
+};
+
+struct Entry {
+    QString name;
+    Ref ref;
+    Kind kind = Kind::Other; // Other when the directory does not record it
+};
+
+struct Stat {
+    Kind kind = Kind::Other;
+    quint64 size = 0;
+};
+
+class Filesystem
+{
+public:
+    virtual ~Filesystem() = default;
+    [[nodiscard]] virtual Ref root() const = 0;
+    [[nodiscard]] virtual std::optional<Stat> stat(const Ref &ref) = 0;
+    [[nodiscard]] virtual std::optional<QList<Entry>> list(const Ref &dir) = 0;
+    // The first length bytes of a file, or a symlink's target
+    [[nodiscard]] virtual std::optional<QByteArray> read(const Ref &ref, quint64 length) = 0;
+};
+
+// Follows symlinks in every component but the last, and in the last too when followLast
+std::optional<Ref> resolve(Filesystem &fs, const QString &path, bool followLast)
+{
+    QStringList pending = path.split('/', Qt::SkipEmptyParts);
+    QList<Ref> parents {fs.root()};
+    int links = 0;
+    while (!pending.isEmpty()) {
+        const QString name = pending.takeFirst();
+        if (name == ".") {
+            continue;
+        }
+        if (name == "..") {
+            if (parents.size() > 1) {
+                parents.removeLast();
+            }
+            continue;
+        }
+        const auto entries = fs.list(parents.constLast());
+        if (!entries) {
+            return std::nullopt;
+        }
+        const auto entry = std::find_if(entries->cbegin(), entries->cend(),
+                                        [&name](const Entry &candidate) { return candidate.name == name; });
+        if (entry == entries->cend()) {
+            return std::nullopt;
+        }
+        Kind kind = entry->kind;
+        if (kind == Kind::Other) {
+            const auto stat = fs.stat(entry->ref);
+            kind = stat ? stat->kind : Kind::Other;
+        }
+        if (kind == Kind::Symlink && (followLast || !pending.isEmpty())) {
+            const auto target = fs.read(entry->ref, MAX_LINK_BYTES);
+            if (!target || ++links > MAX_SYMLINKS) {
+                return std::nullopt;
+            }
+            const QString link = QString::fromUtf8(*target);
+            if (link.startsWith('/')) {
+                parents = {fs.root()};
+            }
+            pending = link.split('/', Qt::SkipEmptyParts) + pending;
+            continue;
+        }
+        parents.append(entry->ref);
+    }
+    return parents.constLast();
+}
+
+void probe(Filesystem &fs, Snapshot *snapshot)
+{
+    for (const Probe &probe : PROBED_FILES) {
+        const auto ref = resolve(fs, probe.path, false);
+        const auto stat = ref ? fs.stat(*ref) : std::nullopt;
+        if (!stat) {
+            continue;
+        }
+        Node node;
+        node.kind = stat->kind;
+        node.size = stat->size;
+        if (node.kind == Kind::Symlink) {
+            const auto target = fs.read(*ref, std::min(stat->size, MAX_LINK_BYTES));
+            node.readable = target.has_value();
+            node.target = QString::fromUtf8(target.value_or(QByteArray()));
+        } else if (node.kind == Kind::File && probe.contents) {
+            const auto contents = stat->size <= MAX_CONTENT_BYTES ? fs.read(*ref, stat->size) : std::nullopt;
+            node.readable = contents.has_value();
+            node.contents = contents.value_or(QByteArray());
+        }
+        snapshot->files.insert(probe.path, node);
+    }
+
+    for (const char *path : PROBED_DIRECTORIES) {
+        const auto ref = resolve(fs, path, true);
+        const auto entries = ref ? fs.list(*ref) : std::nullopt;
+        if (!entries) {
+            continue;
+        }
+        QList<DirEntry> listing;
+        listing.reserve(entries->size());
+        for (const Entry &entry : *entries) {
+            const auto stat = fs.stat(entry.ref);
+            listing.append({entry.name, stat ? stat->kind : entry.kind, stat ? stat->size : 0});
+        }
+        std::sort(listing.begin(), listing.end(),
+                  [](const DirEntry &a, const DirEntry &b) { return a.name < b.name; });
+        snapshot->directories.insert(path, listing);
+    }
+}
+
+class Ext4 final : public Filesystem
+{
+public:
+    static std::unique_ptr<Ext4> open(const ByteReader &reader, const QByteArray &superblock, Snapshot *snapshot,
+                                      QString *error);
+
+    [[nodiscard]] Ref root() const override { return {0, EXT_ROOT_INODE}; }
+    [[nodiscard]] std::optional<Stat> stat(const Ref &ref) override;
+    [[nodiscard]] std::optional<QList<Entry>> list(const Ref &dir) override;
+    [[nodiscard]] std::optional<QByteArray> read(const Ref &ref, quint64 length) override;
+
+private:
+    struct Extent {
+        quint64 logical = 0;
+        quint64 physical = 0;
+        quint64 length = 0;
+        bool initialized = true; // uninitialized extents read as zeros
+    };
+
+    explicit Ext4(ByteReader reader)
+        : reader(std::move(reader))
+    {
+    }
+
+    [[nodiscard]] std::optional<QByteArray> inode(quint64 number);
+    [[nodiscard]] std::optional<QByteArray> readBlock(quint64 block);
+    [[nodiscard]] std::optional<QByteArray> readData(const QByteArray &inode, quint64 length);
+    bool collectExtents(const QByteArray &node, quint64 blocks, int depth, QList<Extent> *extents);
+    bool collectIndirect(quint32 block, int level, quint64 blocks, quint64 *logical, QList<Extent> *extents);
+    static void appendBlock(quint64 logical, quint64 physical, QList<Extent> *extents);
+
+    ByteReader reader;
+    quint32 blockSize = 0;
+    quint32 inodeSize = 0;
+    quint32 inodesPerGroup = 0;
+    quint32 descSize = 0;
+    quint32 firstDataBlock = 0;
+    quint64 inodeCount = 0;
+    quint64 blockCount = 0;
+    bool hasFileType = false;
+    QHash<quint64, quint64> inodeTables; // by group
+};
+
+std::unique_ptr<Ext4> Ext4::open(const ByteReader &reader, const QByteArray &superblock, Snapshot *snapshot,
+                                 QString *error)
+{
+    const char *sb = superblock.constData();
+    const quint32 logBlockSize = qFromLittleEndian<quint32>(sb + EXT_LOG_BLOCK_SIZE);
+    const quint32 incompat = qFromLittleEndian<quint32>(sb + EXT_FEATURE_INCOMPAT);
+    if (logBlockSize > 6) {
+        fail(error, QObject::tr("The ext file system has an invalid block size."));
+        return nullptr;
+    }
+    if (incompat & (EXT_INCOMPAT_COMPRESSION | EXT_INCOMPAT_JOURNAL_DEV | EXT_INCOMPAT_META_BG)) {
+        fail(error, QObject::tr("The ext file system uses features that cannot be read (0x%1).")
+                        .arg(incompat, 0, 16));
+        return nullptr;
+    }
+
+    std::unique_ptr<Ext4> fs(new Ext4(reader));
+    fs->blockSize = 1024U << logBlockSize;
+    fs->inodeSize = qFromLittleEndian<quint32>(sb + EXT_REV_LEVEL) == 0
+                        ? EXT_GOOD_OLD_INODE_SIZE
+                        : qFromLittleEndian<quint16>(sb + EXT_INODE_SIZE);
+    fs->inodesPerGroup = qFromLittleEndian<quint32>(sb + EXT_INODES_PER_GROUP);
+    fs->firstDataBlock = qFromLittleEndian<quint32>(sb + EXT_FIRST_DATA_BLOCK);
+    fs->inodeCount = qFromLittleEndian<quint32>(sb + EXT_INODES_COUNT);
+    fs->blockCount = qFromLittleEndian<quint32>(sb + EXT_BLOCKS_COUNT_LO);
+    fs->descSize = EXT_MIN_DESC_SIZE;
+    if (incompat & EXT_INCOMPAT_64BIT) {
+        fs->blockCount |= quint64(qFromLittleEndian<quint32>(sb + EXT_BLOCKS_COUNT_HI)) << 32;
+        fs->descSize = qFromLittleEndian<quint16>(sb + EXT_DESC_SIZE);
+    }
+    fs->hasFileType = (incompat & EXT_INCOMPAT_FILETYPE) != 0;
+    if (fs->inodeSize < EXT_GOOD_OLD_INODE_SIZE || fs->inodeSize > fs->blockSize || !isPowerOfTwo(fs->inodeSize)
+        || fs->inodesPerGroup == 0 || fs->descSize < EXT_MIN_DESC_SIZE || fs->descSize > fs->blockSize
+        || fs->blockCount <= fs->firstDataBlock) {
+        fail(error, QObject::tr("The ext superblock is not consistent."));
+        return nullptr;
+    }
+
+    snapshot->fsType = "ext4";
+    snapshot->uuid = uuidString(superblock.mid(EXT_UUID, 16));
+    snapshot->label = fixedString(superblock.mid(EXT_VOLUME_NAME, 16));
+    return fs;
+}
+
+std::optional<QByteArray> Ext4::readBlock(quint64 block)
+{
+    if (block >= blockCount) {
+        return std::nullopt;
+    }
+    QByteArray bytes = reader(block * blockSize, blockSize);
+    if (bytes.size() != qsizetype(blockSize)) {
+        return std::nullopt;
+    }
+    return bytes;
+}
+
+std::optional<QByteArray> Ext4::inode(quint64 number)
+{
+    if (number == 0 || number > inodeCount) {
+        return std::nullopt;
+    }
+    const quint64 group = (number - 1) / inodesPerGroup;
+    const quint64 index = (number - 1) % inodesPerGroup;
+    auto table = inodeTables.constFind(group);
+    if (table == inodeTables.constEnd()) {
+        const quint64 offset = (quint64(firstDataBlock) + 1) * blockSize + group * descSize;
+        const QByteArray desc = reader(offset, descSize);
+        if (desc.size() != qsizetype(descSize)) {
+            return std::nullopt;
+        }
+        quint64 block = qFromLittleEndian<quint32>(desc.constData() + EXT_DESC_INODE_TABLE_LO);
+        if (descSize >= EXT_MIN_DESC_SIZE_64BIT) {
+            block |= quint64(qFromLittleEndian<quint32>(desc.constData() + EXT_DESC_INODE_TABLE_HI)) << 32;
+        }
+        table = inodeTables.insert(group, block);
+    }
+    if (*table >= blockCount) {
+        return std::nullopt;
+    }
+    QByteArray bytes = reader(*table * blockSize + index * inodeSize, inodeSize);
+    if (bytes.size() != qsizetype(inodeSize)) {
+        return std::nullopt;
+    }
+    return bytes;
+}
+
+void Ext4::appendBlock(quint64 logical, quint64 physical, QList<Extent> *extents)
+{
+    if (!extents->isEmpty()) {
+        Extent &last = extents->last();
+        if (last.logical + last.length == logical && last.physical + last.length == physical) {
+            ++last.length;
+            return;
+        }
+    }
+    extents->append({logical, physical, 1, true});
+}
+
+// The extents of the first blocks of a file; node is the inode's i_block or an index block
+bool Ext4::collectExtents(const QByteArray &node, quint64 blocks, int depth, QList<Extent> *extents)
+{
+    if (node.size() < EXT_EXTENT_HEADER_SIZE || qFromLittleEndian<quint16>(node.constData()) != EXT_EXTENT_MAGIC
+        || depth > EXT_MAX_EXTENT_DEPTH) {
+        return false;
+    }
+    const quint16 entries = qFromLittleEndian<quint16>(node.constData() + 2);
+    const quint16 treeDepth = qFromLittleEndian<quint16>(node.constData() + 6);
+    if (EXT_EXTENT_HEADER_SIZE + qsizetype(entries) * EXT_EXTENT_ENTRY_SIZE > node.size()) {
+        return false;
+    }
+    for (quint16 i = 0; i < entries; ++i) {
+        const char *entry = node.constData() + EXT_EXTENT_HEADER_SIZE + i * EXT_EXTENT_ENTRY_SIZE;
+        const quint32 first = qFromLittleEndian<quint32>(entry);
+        if (first >= blocks) {
+            break; // entries are sorted by logical block
+        }
+        if (treeDepth == 0) {
+            quint16 length = qFromLittleEndian<quint16>(entry + 4);
+            const bool initialized = length <= EXT_MAX_INIT_EXTENT_LENGTH;
+            if (!initialized) {
+                length -= EXT_MAX_INIT_EXTENT_LENGTH;
+            }
+            const quint64 start = quint64(qFromLittleEndian<quint16>(entry + 6)) << 32
+                                  | qFromLittleEndian<quint32>(entry + 8);
+            extents->append({first, start, length, initialized});
+            if (extents->size() > EXT_MAX_EXTENTS) {
+                return false;
+            }
+        } else {
+            const quint64 leaf = qFromLittleEndian<quint32>(entry + 4)
+                                 | quint64(qFromLittleEndian<quint16>(entry + 8)) << 32;
+            const auto child = readBlock(leaf);
+            if (!child || !collectExtents(*child, blocks, depth + 1, extents)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Indirect block maps of ext2/3 files: level 1 points at data blocks, level 2 at level 1 blocks...
+bool Ext4::collectIndirect(quint32 block, int level, quint64 blocks, quint64 *logical, QList<Extent> *extents)
+{
+    const quint64 perBlock = blockSize / 4;
+    if (block == 0) {
+        quint64 span = 1;
+        for (int i = 0; i < level; ++i) {
+            span *= perBlock;
+        }
+        *logical += span; // a hole
+        return true;
+    }
+    const auto pointers = readBlock(block);
+    if (!pointers) {
+        return false;
+    }
+    for (quint64 i = 0; i < perBlock && *logical < blocks; ++i) {
+        const quint32 child = qFromLittleEndian<quint32>(pointers->constData() + i * 4);
+        if (level > 1) {
+            if (!collectIndirect(child, level - 1, blocks, logical, extents)) {
+                return false;
+            }
+            continue;
+        }
+        if (child != 0) {
+            appendBlock(*logical, child, extents);
+        }
+        ++*logical;
+    }
+    return true;
+}
+
+std::optional<QByteArray> Ext4::readData(const QByteArray &inode, quint64 length)
+{
+    const quint32 flags = qFromLittleEndian<quint32>(inode.constData() + EXT_I_FLAGS);
+    const QByteArray iblock = inode.mid(EXT_I_BLOCK, EXT_I_BLOCK_SIZE);
+    if (flags & EXT_INLINE_DATA_FL) {
+        // The rest would be in the system.data extended attribute
+        if (length > quint64(EXT_I_BLOCK_SIZE)) {
+            return std::nullopt;
+        }
+        return iblock.first(qsizetype(length));
+    }
+
+    const quint64 blocks = (length + blockSize - 1) / blockSize;
+    QList<Extent> extents;
+    if (flags & EXT_EXTENTS_FL) {
+        if (!collectExtents(iblock, blocks, 0, &extents)) {
+            return std::nullopt;
+        }
+    } else {
+        quint64 logical = 0;
+        for (int i = 0; i < EXT_DIRECT_BLOCKS && logical < blocks; ++i, ++logical) {
+            if (const quint32 block = qFromLittleEndian<quint32>(iblock.constData() + i * 4)) {
+                appendBlock(logical, block, &extents);
+            }
+        }
+        for (int level = 1; level <= 3 && logical < blocks; ++level) {
+            const quint32 block = qFromLittleEndian<quint32>(iblock.constData() + (EXT_DIRECT_BLOCKS + level - 1) * 4);
+            if (!collectIndirect(block, level, blocks, &logical, &extents)) {
+                return std::nullopt;
+            }
+        }
+    }
+
+    QByteArray data(qsizetype(length), '\0');
+    for (const Extent &extent : std::as_const(extents)) {
+        if (!extent.initialized || extent.logical >= blocks) {
+            continue;
+        }
+        const quint64 count = std::min(extent.length, blocks - extent.logical);
+        if (extent.physical + count > blockCount) {
+            return std::nullopt;
+        }
+        const quint64 offset = extent.logical * blockSize;
+        const quint64 bytes = std::min(count * blockSize, length - offset);
+        const QByteArray chunk = reader(extent.physical * blockSize, static_cast<quint32>(bytes));
+        if (chunk.size() != qsizetype(bytes)) {
+            return std::nullopt;
+        }
+        data.replace(qsizetype(offset), chunk.size(), chunk);
+    }
+    return data;
+}
+
+std::optional<Stat> Ext4::stat(const Ref &ref)
+{
+    const auto bytes = inode(ref.inode);
+    if (!bytes) {
+        return std::nullopt;
+    }
+    const char *raw = bytes->constData();
+    return Stat {kindOfMode(qFromLittleEndian<quint16>(raw + EXT_I_MODE)),
+                 qFromLittleEndian<quint32>(raw + EXT_I_SIZE_LO)
+                     | quint64(qFromLittleEndian<quint32>(raw + EXT_I_SIZE_HIGH)) << 32};
+}
+
+// Hashed (htree) directories keep every entry in ordinary leaf blocks, and their index blocks read as
+// empty entries, so scanning the blocks in order lists them like any other directory
+std::optional<QList<Entry>> Ext4::list(const Ref &dir)
+{
+    const auto bytes = inode(dir.inode);
+    const auto info = stat(dir);
+    if (!bytes || !info || info->kind != Kind::Directory || info->size > MAX_DIRECTORY_BYTES) {
+        return std::nullopt;
+    }
+    const quint32 flags = qFromLittleEndian<quint32>(bytes->constData() + EXT_I_FLAGS);
+    QByteArray data;
+    qsizetype chunkSize = blockSize;
+    if (flags & EXT_INLINE_DATA_FL) {
+        // The parent's inode number, then entries filling the rest of i_block
+        data = bytes->mid(EXT_I_BLOCK + EXT_INLINE_DIR_PARENT, EXT_I_BLOCK_SIZE - EXT_INLINE_DIR_PARENT);
+        chunkSize = data.size();
+    } else {
+        const auto contents = readData(*bytes, info->size);
+        if (!contents) {
+            return std::nullopt;
+        }
+        data = *contents;
+    }
+
+    QList<Entry> entries;
+    for (qsizetype chunk = 0; chunk < data.size(); chunk += chunkSize) {
+        const qsizetype end = std::min(chunk + chunkSize, data.size());
+        qsizetype pos = chunk;
+        while (pos + EXT_DIR_ENTRY_HEADER <= end) {
+            const char *entry = data.constData() + pos;
+            const quint32 number = qFromLittleEndian<quint32>(entry);
+            const quint16 recordLength = qFromLittleEndian<quint16>(entry + 4);
+            // Without the file type feature, the name length takes both bytes
+            const quint16 nameLength
+                = hasFileType ? static_cast<quint8>(entry[6]) : qFromLittleEndian<quint16>(entry + 6);
+            if (recordLength < EXT_DIR_ENTRY_HEADER || pos + recordLength > end) {
+                break;
+            }
+            if (number != 0 && nameLength != 0 && EXT_DIR_ENTRY_HEADER + nameLength <= recordLength) {
+                const QString name = QString::fromUtf8(entry + EXT_DIR_ENTRY_HEADER, nameLength);
+                if (name != "." && name != "..") {
+                    entries.append({name, {0, number},
+                                    hasFileType ? kindOfFileType(static_cast<quint8>(entry[7])) : Kind::Other});
+                }
+            }
+            pos += recordLength;
+        }
+    }
+    return entries;
+}
+
+std::optional<QByteArray> Ext4::read(const Ref &ref, quint64 length)
+{
+    const auto bytes = inode(ref.inode);
+    const auto info = stat(ref);
+    if (!bytes || !info) {
+        return std::nullopt;
+    }
+    length = std::min(length, info->size);
+    const quint32 flags = qFromLittleEndian<quint32>(bytes->constData() + EXT_I_FLAGS);
+    // Fast symlinks keep their target in i_block itself
+    if (info->kind == Kind::Symlink && info->size < quint64(EXT_I_BLOCK_SIZE)
+        && !(flags & (EXT_EXTENTS_FL | EXT_INLINE_DATA_FL))) {
+        return bytes->mid(EXT_I_BLOCK, qsizetype(length));
+    }
+    return readData(*bytes, length);
+}
+
+struct Key {
+    quint64 objectid = 0;
+    quint8 type = 0;
+    quint64 offset = 0;
+
+    auto operator<=>(const Key &other) const = default;
+};
+
+Key readKey(const char *raw)
+{
+    return {qFromLittleEndian<quint64>(raw), static_cast<quint8>(raw[8]), qFromLittleEndian<quint64>(raw + 9)};
+}
+
+class Btrfs final : public Filesystem
+{
+public:
+    static std::unique_ptr<Btrfs> open(const ByteReader &reader, const QByteArray &superblock, Snapshot *snapshot,
+                                       QString *error);
+
+    [[nodiscard]] Ref root() const override { return {fsTree, BTRFS_FIRST_INODE}; }
+    [[nodiscard]] std::optional<Stat> stat(const Ref &ref) override;
+    [[nodiscard]] std::optional<QList<Entry>> list(const Ref &dir) override;
+    [[nodiscard]] std::optional<QByteArray> read(const Ref &ref, quint64 length) override;
+
+private:
+    struct Chunk {
+        quint64 logical = 0;
+        quint64 length = 0;
+        quint64 physical = 0; // of the first stripe; every stripe is a full copy
+    };
+    struct Tree {
+        quint64 bytenr = 0;
+        quint8 level = 0;
+    };
+    struct Item {
+        Key key;
+        QByteArray data;
+    };
+
+    explicit Btrfs(ByteReader reader)
+        : reader(std::move(reader))
+    {
+    }
+
+    bool addChunk(quint64 logical, const char *item, qsizetype size);
+    [[nodiscard]] std::optional<QByteArray> readLogical(quint64 logical, quint64 length);
+    bool search(const Tree &tree, const Key &min, const Key &max, QList<Item> *items);
+    bool searchNode(quint64 bytenr, quint8 level, const Key &min, const Key &max, QList<Item> *items,
+                    QSet<quint64> *visited);
+    [[nodiscard]] std::optional<Tree> tree(quint64 id);
+    [[nodiscard]] std::optional<Item> find(quint64 treeId, const Key &key);
+    [[nodiscard]] QString subvolumeName(quint64 id);
+
+    ByteReader reader;
+    QByteArray nodeFsid;
+    quint32 nodeSize = 0;
+    QList<Chunk> chunks;
+    Tree rootTree;
+    quint64 fsTree = BTRFS_FS_TREE;
+    QHash<quint64, Tree> trees;
+};
+
+bool Btrfs::addChunk(quint64 logical, const char *item, qsizetype size)
+{
+    if (size < BTRFS_CHUNK_STRIPES) {
+        return false;
+    }
+    const quint16 stripes = qFromLittleEndian<quint16>(item + BTRFS_CHUNK_NUM_STRIPES);
+    if (stripes == 0 || BTRFS_CHUNK_STRIPES + qsizetype(stripes) * BTRFS_STRIPE_SIZE > size) {
+        return false;
+    }
+    // Leave striped chunks unmapped: reading through them fails instead of returning the wrong bytes
+    if (!(qFromLittleEndian<quint64>(item + BTRFS_CHUNK_TYPE) & BTRFS_STRIPED_PROFILES)) {
+        chunks.append({logical, qFromLittleEndian<quint64>(item + BTRFS_CHUNK_LENGTH),
+                       qFromLittleEndian<quint64>(item + BTRFS_CHUNK_STRIPES + BTRFS_STRIPE_OFFSET)});
+    }
+    return true;
+}
+
+std::optional<QByteArray> Btrfs::readLogical(quint64 logical, quint64 length)
+{
+    const auto chunk = std::find_if(chunks.cbegin(), chunks.cend(), [logical, length](const Chunk &candidate) {
+        return logical >= candidate.logical && logical - candidate.logical + length <= candidate.length;
+    });
+    if (chunk == chunks.cend() || length > MAX_READ_BYTES) {
+        return std::nullopt;
+    }
+    QByteArray bytes = reader(chunk->physical + (logical - chunk->logical), static_cast<quint32>(length));
+    if (bytes.size() != qsizetype(length)) {
+        return std::nullopt;
+    }
+    return bytes;
+}
+
+bool Btrfs::search(const Tree &tree, const Key &min, const Key &max, QList<Item> *items)
+{
+    QSet<quint64> visited;
+    return searchNode(tree.bytenr, tree.level, min, max, items, &visited);
+}
+
+// Collects the items with keys in [min, max], descending only into children that can hold them.
+// A tree reaches each node once; a node seen before, or more nodes than any real lookup reads, fail it.
+bool Btrfs::searchNode(quint64 bytenr, quint8 level, const Key &min, const Key &max, QList<Item> *items,
+                       QSet<quint64> *visited)
+{
+    if (visited->contains(bytenr) || visited->size() >= BTRFS_MAX_SEARCH_NODES) {
+        return false;
+    }
+    visited->insert(bytenr);
+    const auto node = readLogical(bytenr, nodeSize);
+    if (!node || level > BTRFS_MAX_LEVEL) {
+        return false;
+    }
+    const char *raw = node->constData();
+    // A node from another file system or the wrong place in the tree means a bad mapping
+    if (qFromLittleEndian<quint64>(raw + BTRFS_HEADER_BYTENR) != bytenr
+        || node->mid(BTRFS_HEADER_FSID, 16) != nodeFsid || static_cast<quint8>(raw[BTRFS_HEADER_LEVEL]) != level) {
+        return false;
+    }
+    const quint32 count = qFromLittleEndian<quint32>(raw + BTRFS_HEADER_NRITEMS);
+    const qsizetype entrySize = level == 0 ? BTRFS_ITEM_SIZE : BTRFS_KEY_PTR_SIZE;
+    if (BTRFS_HEADER_SIZE + qsizetype(count) * entrySize > node->size()) {
+        return false;
+    }
+
+    for (quint32 i = 0; i < count; ++i) {
+        const char *entry = raw + BTRFS_HEADER_SIZE + i * entrySize;
+        const Key key = readKey(entry);
+        if (key > max) {
+            break;
+        }
+        if (level == 0) {
+            if (key < min) {
+                continue;
+            }
+            const quint32 offset = qFromLittleEndian<quint32>(entry + BTRFS_KEY_SIZE);
+            const quint32 size = qFromLittleEndian<quint32>(entry + BTRFS_KEY_SIZE + 4);
+            if (BTRFS_HEADER_SIZE + qsizetype(offset) + size > node->size() || items->size() >= BTRFS_MAX_ITEMS) {
+                return false;
+            }
+            items->append({key, node->mid(BTRFS_HEADER_SIZE + offset, size)});
+            continue;
+        }
+        // Child i holds the keys from its own up to the next child's
+        if (i + 1 < count && readKey(entry + entrySize) <= min) {
+            continue;
+        }
+        if (!searchNode(qFromLittleEndian<quint64>(entry + BTRFS_KEY_SIZE), level - 1, min, max, items, visited)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::optional<Btrfs::Tree> Btrfs::tree(quint64 id)
+{
+    if (const auto it = trees.constFind(id); it != trees.constEnd()) {
+        return *it;
+    }
+    // Snapshots record the generation they were taken at in the key offset; the last item is current
+    QList<Item> items;
+    if (!search(rootTree, {id, BTRFS_ROOT_ITEM, 0}, {id, BTRFS_ROOT_ITEM, UINT64_MAX}, &items) || items.isEmpty()
+        || items.constLast().data.size() <= BTRFS_ROOT_ITEM_LEVEL) {
+        return std::nullopt;
+    }
+    const QByteArray &item = items.constLast().data;
+    const Tree found {qFromLittleEndian<quint64>(item.constData() + BTRFS_ROOT_ITEM_BYTENR),
+                      static_cast<quint8>(item.at(BTRFS_ROOT_ITEM_LEVEL))};
+    trees.insert(id, found);
+    return found;
+}
+
+std::optional<Btrfs::Item> Btrfs::find(quint64 treeId, const Key &key)
+{
+    const auto root = tree(treeId);
+    QList<Item> items;
+    if (!root || !search(*root, key, key, &items) || items.isEmpty()) {
+        return std::nullopt;
+    }
+    return items.constFirst();
+}
+
+QString Btrfs::subvolumeName(quint64 id)
+{
+    QList<Item> items;
+    if (!search(rootTree, {id, BTRFS_ROOT_BACKREF, 0}, {id, BTRFS_ROOT_BACKREF, UINT64_MAX}, &items)
+        || items.isEmpty()) {
+        return {};
+    }
+    const QByteArray &item = items.constFirst().data;
+    if (item.size() < BTRFS_BACKREF_NAME) {
+        return {};
+    }
+    const quint16 length = qFromLittleEndian<quint16>(item.constData() + BTRFS_BACKREF_NAME_LEN);
+    return QString::fromUtf8(item.mid(BTRFS_BACKREF_NAME, length));
+}
+
+std::unique_ptr<Btrfs> Btrfs::open(const ByteReader &reader, const QByteArray &superblock, Snapshot *snapshot,
+                                   QString *error)
+{
+    const char *sb = superblock.constData();
+    if (qFromLittleEndian<quint64>(sb + BTRFS_NUM_DEVICES) != 1) {
+        fail(error, QObject::tr("The btrfs file system spans several devices."));
+        return nullptr;
+    }
+    std::unique_ptr<Btrfs> fs(new Btrfs(reader));
+    fs->nodeSize = qFromLittleEndian<quint32>(sb + BTRFS_NODE_SIZE);
+    const quint32 sectorSize = qFromLittleEndian<quint32>(sb + BTRFS_SECTOR_SIZE);
+    const quint32 arraySize = qFromLittleEndian<quint32>(sb + BTRFS_SYS_CHUNK_ARRAY_SIZE);
+    if (!isPowerOfTwo(fs->nodeSize) || fs->nodeSize < 4096 || fs->nodeSize > 65536 || !isPowerOfTwo(sectorSize)
+        || arraySize > BTRFS_SYS_CHUNK_ARRAY_MAX) {
+        fail(error, QObject::tr("The btrfs superblock is not consistent."));
+        return nullptr;
+    }
+    const bool metadataUuid = qFromLittleEndian<quint64>(sb + BTRFS_INCOMPAT_FLAGS) & BTRFS_INCOMPAT_METADATA_UUID;
+    fs->nodeFsid = superblock.mid(metadataUuid ? BTRFS_METADATA_UUID : BTRFS_FSID, 16);
+
+    // The system chunks in the superblock map the chunk tree, which maps everything else
+    for (qsizetype pos = 0; pos + BTRFS_KEY_SIZE + BTRFS_CHUNK_STRIPES <= qsizetype(arraySize);) {
+        const char *item = sb + BTRFS_SYS_CHUNK_ARRAY + pos + BTRFS_KEY_SIZE;
+        const quint16 stripes = qFromLittleEndian<quint16>(item + BTRFS_CHUNK_NUM_STRIPES);
+        const qsizetype size = BTRFS_CHUNK_STRIPES + qsizetype(stripes) * BTRFS_STRIPE_SIZE;
+        if (!fs->addChunk(readKey(sb + BTRFS_SYS_CHUNK_ARRAY + pos).offset, item, arraySize - pos - BTRFS_KEY_SIZE)) {
+            break;
+        }
+        pos += BTRFS_KEY_SIZE + size;
+    }
+    QList<Item> chunkItems;
+    const Tree chunkTree {qFromLittleEndian<quint64>(sb + BTRFS_CHUNK_ROOT),
+                          static_cast<quint8>(sb[BTRFS_CHUNK_ROOT_LEVEL])};
+    if (!fs->search(chunkTree, {BTRFS_FIRST_CHUNK_TREE, BTRFS_CHUNK_ITEM, 0},
+                    {BTRFS_FIRST_CHUNK_TREE, BTRFS_CHUNK_ITEM, UINT64_MAX}, &chunkItems)) {
+        fail(error, QObject::tr("Could not read the btrfs chunk tree."));
+        return nullptr;
+    }
+    for (const Item &item : std::as_const(chunkItems)) {
+        fs->addChunk(item.key.offset, item.data.constData(), item.data.size());
+    }
+
+    // The default subvolume; when that is the top level, the "@" subvolume distributions root on
+    fs->rootTree = {qFromLittleEndian<quint64>(sb + BTRFS_ROOT), static_cast<quint8>(sb[BTRFS_ROOT_LEVEL])};
+    const quint64 rootDir = qFromLittleEndian<quint64>(sb + BTRFS_ROOT_DIR_OBJECTID);
+    QList<Item> dirItems;
+    fs->search(fs->rootTree, {rootDir, BTRFS_DIR_ITEM, 0}, {rootDir, BTRFS_DIR_ITEM, UINT64_MAX}, &dirItems);
+    for (const Item &item : std::as_const(dirItems)) {
+        for (qsizetype pos = 0; pos + BTRFS_DIR_NAME <= item.data.size();) {
+            const char *entry = item.data.constData() + pos;
+            const quint16 nameLength = qFromLittleEndian<quint16>(entry + BTRFS_DIR_NAME_LEN);
+            if (item.data.mid(pos + BTRFS_DIR_NAME, nameLength) == "default") {
+                fs->fsTree = readKey(entry).objectid;
+            }
+            pos += BTRFS_DIR_NAME + nameLength + qFromLittleEndian<quint16>(entry + BTRFS_DIR_DATA_LEN);
+        }
+    }
+    if (!fs->tree(fs->fsTree)) {
+        fail(error, QObject::tr("Could not find the default btrfs subvolume."));
+        return nullptr;
+    }
+    if (fs->fsTree == BTRFS_FS_TREE) {
+        if (const auto entries = fs->list({BTRFS_FS_TREE, BTRFS_FIRST_INODE})) {
+            for (const Entry &entry : *entries) {
+                if (entry.name == "@" && entry.ref.tree != BTRFS_FS_TREE && fs->tree(entry.ref.tree)) {
+                    fs->fsTree = entry.ref.tree;
+                }
+            }
+        }
+    }
+
+    snapshot->fsType = "btrfs";
+    snapshot->uuid = uuidString(superblock.mid(BTRFS_FSID, 16));
+    snapshot->label = fixedString(superblock.mid(BTRFS_LABEL, BTRFS_LABEL_SIZE));
+    snapshot->subvolume = fs->fsTree == BTRFS_FS_TREE ? QString() : fs->subvolumeName(fs->fsTree);
+    return fs;
+}
+
+std::optional<Stat> Btrfs::stat(const Ref &ref)
+{
+    const auto item = find(ref.tree, {ref.inode, BTRFS_INODE_ITEM, 0});
+    if (!item || item->data.size() < BTRFS_INODE_MODE + 4) {
+        return std::nullopt;
+    }
+    const char *raw = item->data.constData();
+    return Stat {kindOfMode(qFromLittleEndian<quint32>(raw + BTRFS_INODE_MODE)),
+                 qFromLittleEndian<quint64>(raw + BTRFS_INODE_SIZE)};
+}
+
+std::optional<QList<Entry>> Btrfs::list(const Ref &dir)
+{
+    const auto info = stat(dir);
+    const auto root = tree(dir.tree);
+    QList<Item> items;
+    if (!info || info->kind != Kind::Directory || !root
+        || !search(*root, {dir.inode, BTRFS_DIR_INDEX, 0}, {dir.inode, BTRFS_DIR_INDEX, UINT64_MAX}, &items)) {
+        return std::nullopt;
+    }
+    QList<Entry> entries;
+    entries.reserve(items.size());
+    for (const Item &item : std::as_const(items)) {
+        if (item.data.size() < BTRFS_DIR_NAME) {
+            continue;
+        }
+        const char *raw = item.data.constData();
+        const Key location = readKey(raw);
+        const quint16 nameLength = qFromLittleEndian<quint16>(raw + BTRFS_DIR_NAME_LEN);
+        const QString name = QString::fromUtf8(item.data.mid(BTRFS_DIR_NAME, nameLength));
+        const Kind kind = kindOfFileType(static_cast<quint8>(raw[BTRFS_DIR_TYPE]));
+        // A subvolume shows up as a directory whose location is its tree
+        if (location.type == BTRFS_ROOT_ITEM) {
+            entries.append({name, {location.objectid, BTRFS_FIRST_INODE}, kind});
+        } else if (location.type == BTRFS_INODE_ITEM) {
+            entries.append({name, {dir.tree, location.objectid}, kind});
+        }
+    }
+    return entries;
+}
+
+std::optional<QByteArray> Btrfs::read(const Ref &ref, quint64 length)
+{
+    const auto info = stat(ref);
+    const auto root = tree(ref.tree);
+    if (!info || !root) {
+        return std::nullopt;
+    }
+    length = std::min(length, info->size);
+    QByteArray data(qsizetype(length), '\0');
+    QList<Item> items;
+    if (length == 0) {
+        return data;
+    }
+    if (!search(*root, {ref.inode, BTRFS_EXTENT_DATA, 0}, {ref.inode, BTRFS_EXTENT_DATA, length - 1}, &items)) {
+        return std::nullopt;
+    }
+
+    // zlib is the only compression Qt can undo; files compressed with lzo or zstd cannot be read
+    const auto decompress = [](const QByteArray &compressed, quint8 compression, quint64 size) {
+        if (compression != BTRFS_COMPRESS_ZLIB || size > MAX_CONTENT_BYTES) {
+            return QByteArray();
+        }
+        QByteArray prefixed(4, '\0');
+        qToBigEndian(static_cast<quint32>(size), prefixed.data());
+        return qUncompress(prefixed + compressed);
+    };
+    for (const Item &item : std::as_const(items)) {
+        if (item.data.size() < BTRFS_EXTENT_INLINE_DATA) {
+            return std::nullopt;
+        }
+        const char *raw = item.data.constData();
+        const auto compression = static_cast<quint8>(raw[BTRFS_EXTENT_COMPRESSION]);
+        const auto type = static_cast<quint8>(raw[BTRFS_EXTENT_TYPE]);
+        const quint64 ramBytes = qFromLittleEndian<quint64>(raw + BTRFS_EXTENT_RAM_BYTES);
+        const quint64 fileOffset = item.key.offset;
+        QByteArray bytes;
+        if (type == BTRFS_EXTENT_INLINE) {
+            bytes = item.data.mid(BTRFS_EXTENT_INLINE_DATA);
+            if (compression) {
+                bytes = decompress(bytes, compression, ramBytes);
+                if (bytes.isEmpty()) {
+                    return std::nullopt;
+                }
+            }
+        } else {
+            if (item.data.size() < BTRFS_EXTENT_REGULAR_SIZE) {
+                return std::nullopt;
+            }
+            const quint64 diskBytenr = qFromLittleEndian<quint64>(raw + BTRFS_EXTENT_DISK_BYTENR);
+            const quint64 extentOffset = qFromLittleEndian<quint64>(raw + BTRFS_EXTENT_OFFSET);
+            const quint64 wanted
+                = std::min(qFromLittleEndian<quint64>(raw + BTRFS_EXTENT_NUM_BYTES), length - fileOffset);
+            if (type == BTRFS_EXTENT_PREALLOC || diskBytenr == 0) {
+                continue; // reads as zeros
+            }
+            if (compression) {
+                const auto compressed
+                    = readLogical(diskBytenr, qFromLittleEndian<quint64>(raw + BTRFS_EXTENT_DISK_NUM_BYTES));
+                bytes = compressed ? decompress(*compressed, compression, ramBytes) : QByteArray();
+                if (bytes.isEmpty()) {
+                    return std::nullopt;
+                }
+                bytes = bytes.mid(qsizetype(extentOffset), qsizetype(wanted));
+            } else {
+                const auto extent = readLogical(diskBytenr + extentOffset, wanted);
+                if (!extent) {
+                    return std::nullopt;
+                }
+                bytes = *extent;
+            }
+        }
+        const qsizetype count = std::min(bytes.size(), qsizetype(length - fileOffset));
+        data.replace(qsizetype(fileOffset), count, bytes.first(count));
+    }
+    return data;
+}
+
+QString kindName(Kind kind)
+{
+    switch (kind) {
+    case Kind::File:
+        return "file";
+    case Kind::Directory:
+        return "dir";
+    case Kind::Symlink:
+        return "link";
+    case Kind::Other:
+        return "other";
+    }
+    return {};
+}
+
+Kind kindFromName(const QString &name)
+{
+    if (name == "file") {
+        return Kind::File;
+    }
+    if (name == "dir") {
+        return Kind::Directory;
+    }
+    if (name == "link") {
+        return Kind::Symlink;
+    }
+    return Kind::Other;
+}
+} // namespace
+
+bool Snapshot::exists(const QString &path) const
+{
+    return files.contains(path) || directories.contains(path);
+}
+
+bool Snapshot::isDirectory(const QString &path) const
+{
+    return directories.contains(path) || files.value(path).kind == Kind::Directory;
+}
+
+QByteArray Snapshot::contents(const QString &path) const
+{
+    return files.value(path).contents;
+}
+
+QStringList Snapshot::list(const QString &dir, const QString &prefix) const
+{
+    QStringList names;
+    for (const DirEntry &entry : directories.value(dir)) {
+        if (entry.kind == Kind::File && entry.name.startsWith(prefix)) {
+            names.append(entry.name);
+        }
+    }
+    return names;
+}
+
+bool Snapshot::isComplete() const
+{
+    return std::all_of(files.cbegin(), files.cend(), [](const Node &node) { return node.readable; });
+}
+
+std::optional<Snapshot> read(const ByteReader &reader, QString *error)
+{
+    Snapshot snapshot;
+    std::unique_ptr<Filesystem> fs;
+    const QByteArray extSuperblock = reader(EXT_SUPERBLOCK_OFFSET, EXT_SUPERBLOCK_SIZE);
+    if (extSuperblock.size() == EXT_SUPERBLOCK_SIZE
+        && qFromLittleEndian<quint16>(extSuperblock.constData() + EXT_MAGIC) == EXT_MAGIC_VALUE) {
+        fs = Ext4::open(reader, extSuperblock, &snapshot, error);
+    } else {
+        const QByteArray btrfsSuperblock = reader(BTRFS_SUPERBLOCK_OFFSET, BTRFS_SUPERBLOCK_SIZE);
+        if (btrfsSuperblock.size() != BTRFS_SUPERBLOCK_SIZE
+            || btrfsSuperblock.mid(BTRFS_MAGIC, BTRFS_MAGIC_SIZE) != BTRFS_MAGIC_VALUE) {
+            fail(error, QObject::tr("No ext4 or btrfs file system was found."));
+            return std::nullopt;
+        }
+        fs = Btrfs::open(reader, btrfsSuperblock, &snapshot, error);
+    }
+    if (!fs) {
+        return std::nullopt;
+    }
+    probe(*fs, &snapshot);
+    return snapshot;
+}
+
+std::optional<Snapshot> readDevice(const QString &path, QString *error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        fail(error, QObject::tr("Could not open %1: %2").arg(path, file.errorString()));
+        return std::nullopt;
+    }
+    const ByteReader reader = [&file](quint64 offset, quint32 length) -> QByteArray {
+        if (!file.seek(static_cast<qint64>(offset))) {
+            return {};
+        }
+        return file.read(length);
+    };
+    return read(reader, error);
+}
+
+Snapshot readDirectory(const QString &mountPoint)
+{
+    Snapshot snapshot;
+    snapshot.mountPoint = mountPoint;
+    const QString root = mountPoint.endsWith('/') ? mountPoint.chopped(1) : mountPoint;
+    for (const Probe &probe : PROBED_FILES) {
+        const QFileInfo info(root + probe.path);
+        Node node;
+        if (info.isSymLink()) {
+            node.kind = Kind::Symlink;
+            node.target = info.symLinkTarget();
+            if (!root.isEmpty() && node.target.startsWith(root + '/')) {
+                node.target = node.target.mid(root.size());
+            }
+        } else if (!info.exists()) {
+            continue;
+        } else if (info.isDir()) {
+            node.kind = Kind::Directory;
+        } else if (info.isFile()) {
+            node.kind = Kind::File;
+            node.size = info.size();
+            if (probe.contents) {
+                QFile file(info.filePath());
+                node.readable = quint64(info.size()) <= MAX_CONTENT_BYTES && file.open(QIODevice::ReadOnly);
+                node.contents = node.readable ? file.readAll() : QByteArray();
+            }
+        }
+        snapshot.files.insert(probe.path, node);
+    }
+    for (const char *path : PROBED_DIRECTORIES) {
+        const QDir dir(root + path);
+        if (!dir.exists()) {
+            continue;
+        }
+        QList<DirEntry> listing;
+        const QFileInfoList infos
+            = dir.entryInfoList(QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot, QDir::Name);
+        for (const QFileInfo &info : infos) {
+            const Kind kind = info.isSymLink() ? Kind::Symlink
+                              : info.isDir()   ? Kind::Directory
+                              : info.isFile()  ? Kind::File
+                                               : Kind::Other;
+            listing.append({info.fileName(), kind, kind == Kind::File ? quint64(info.size()) : 0});
+        }
+        snapshot.directories.insert(path, listing);
+    }
+    return snapshot;
+}
+
+bool isProbedFile(const QString &path)
+{
+    return std::any_of(PROBED_FILES.cbegin(), PROBED_FILES.cend(),
+                       [&path](const Probe &probe) { return probe.contents && path == QLatin1String(probe.path); });
+}
+
+QString bootSource(const QByteArray &fstab)
+{
+    const QStringList lines = QString::fromUtf8(fstab).split('\n');
+    for (const QString &line : lines) {
+        const QString trimmed = line.trimmed();
+        if (trimmed.isEmpty() || trimmed.startsWith('#')) {
+            continue;
+        }
+        static const QRegularExpression whitespace(R"(\s+)");
+        const QStringList fields = trimmed.split(whitespace);
+        if (fields.size() >= 3 && fields.at(1) == "/boot") {
+            // fstab writes spaces in LABELs as "\040"
+            return QString(fields.at(0)).replace("\\040", " ");
+        }
+    }
+    return {};
+}
+
+QString resolveSource(const QString &source)
+{
+    static const QList<QPair<QString, QString>> tags {
+        {"UUID=", "/dev/disk/by-uuid/"},
+        {"LABEL=", "/dev/disk/by-label/"},
+        {"PARTUUID=", "/dev/disk/by-partuuid/"},
+        {"PARTLABEL=", "/dev/disk/by-partlabel/"},
+    };
+    QString path = source;
+    for (const auto &[tag, directory] : tags) {
+        if (source.startsWith(tag)) {
+            QString value = source.mid(tag.size());
+            value.remove('"');
+            // udev escapes these in the link names
+            path = directory + value.replace('/', "\\x2f").replace(' ', "\\x20");
+            break;
+        }
+    }
+    if (!path.startsWith("/dev/")) {
+        return {};
+    }
+    const QString device = QFileInfo(path).canonicalFilePath();
+    return device.startsWith("/dev/") ? device : QString();
+}
+
+QJsonObject toJson(const Snapshot &snapshot)
+{
+    QJsonObject files;
+    for (auto it = snapshot.files.cbegin(); it != snapshot.files.cend(); ++it) {
+        QJsonObject node {{"kind", kindName(it->kind)}, {"size", qint64(it->size)}, {"readable", it->readable}};
+        if (!it->contents.isEmpty()) {
+            node.insert("data", QString::fromLatin1(it->contents.toBase64()));
+        }
+        if (it->kind == Kind::Symlink) {
+            node.insert("target", it->target);
+        }
+        files.insert(it.key(), node);
+    }
+    QJsonObject directories;
+    for (auto it = snapshot.directories.cbegin(); it != snapshot.directories.cend(); ++it) {
+        QJsonArray entries;
+        for (const DirEntry &entry : it.value()) {
+            entries.append(
+                QJsonObject {{"name", entry.name}, {"kind", kindName(entry.kind)}, {"size", qint64(entry.size)}});
+        }
+        directories.insert(it.key(), entries);
+    }
+    return {
+        {"fsType", snapshot.fsType},
+        {"uuid", snapshot.uuid},
+        {"label", snapshot.label},
+        {"subvolume", snapshot.subvolume},
+        {"files", files},
+        {"directories", directories},
+    };
+}
+
+std::optional<Snapshot> fromJson(const QJsonObject &object)
+{
+    Snapshot snapshot;
+    snapshot.fsType = object.value("fsType").toString();
+    if (snapshot.fsType.isEmpty()) {
+        return std::nullopt;
+    }
+    snapshot.uuid = object.value("uuid").toString();
+    snapshot.label = object.value("label").toString();
+    snapshot.subvolume = object.value("subvolume").toString();
+    const QJsonObject files = object.value("files").toObject();
+    for (auto it = files.constBegin(); it != files.constEnd(); ++it) {
+        const QJsonObject node = it.value().toObject();
+        snapshot.files.insert(it.key(), {kindFromName(node.value("kind").toString()),
+                                         static_cast<quint64>(node.value("size").toInteger()),
+                                         QByteArray::fromBase64(node.value("data").toString().toLatin1()),
+                                         node.value("readable").toBool(true), node.value("target").toString()});
+    }
+    const QJsonObject directories = object.value("directories").toObject();
+    for (auto it = directories.constBegin(); it != directories.constEnd(); ++it) {
+        QList<DirEntry> entries;
+        const QJsonArray array = it.value().toArray();
+        for (const QJsonValue &value : array) {
+            const QJsonObject entry = value.toObject();
+            entries.append({entry.value("name").toString(), kindFromName(entry.value("kind").toString()),
+                            static_cast<quint64>(entry.value("size").toInteger())});
+        }
+        snapshot.directories.insert(it.key(), entries);
+    }
+    return snapshot;
+}
+
+} // namespace rootfs
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+
+#include <functional>
+#include <optional>
+
+// Read-only ext2/3/4 and btrfs, enough to find the kernels and boot configuration of a Linux
+// installation straight from its partition instead of mounting it. Only the few files that
+// selecting a kernel looks at are read: the release files, fstab, crypttab, GRUB's configuration
+// and init.
+namespace rootfs
+{
+
+enum class Kind { File, Directory, Symlink, Other };
+
+struct DirEntry {
+    QString name;
+    Kind kind = Kind::Other;
+    quint64 size = 0;
+
+    bool operator==(const DirEntry &other) const = default;
+};
+
+struct Node {
+    Kind kind = Kind::Other;
+    quint64 size = 0;
+    QByteArray contents;  // regular files whose contents are wanted
+    bool readable = true; // false when those contents could not be read (e.g. zstd-compressed on btrfs)
+    QString target;       // symlinks, as stored
+
+    bool operator==(const Node &other) const = default;
+};
+
+// What a root or separate /boot file system holds of the probed paths
+struct Snapshot {
+    QString fsType; // "ext4" or "btrfs"; empty when taken from a mounted tree
+    QString uuid;
+    QString label;
+    QString subvolume;  // btrfs: the subvolume read as the root, e.g. "@"; empty for the top level
+    QString mountPoint; // set when taken from a mounted tree
+    QString device;     // the partition read, set by the caller; empty for mounted trees
+    QMap<QString, Node> files;                  // probed paths that exist, by absolute path
+    QMap<QString, QList<DirEntry>> directories; // "/" and "/boot" when they exist, sorted by name
+
+    [[nodiscard]] bool exists(const QString &path) const;
+    [[nodiscard]] bool isDirectory(const QString &path) const;
+    [[nodiscard]] QByteArray contents(const QString &path) const;
+    // Names of the regular files in dir starting with prefix
+    [[nodiscard]] QStringList list(const QString &dir, const QString &prefix) const;
+    // Whether every probed file that exists could be read
+    [[nodiscard]] bool isComplete() const;
+};
+
+// Reads length bytes at offset from the start of the partition; a short result is a read error
+using ByteReader = std::function<QByteArray(quint64 offset, quint32 length)>;
+
+[[nodiscard]] std::optional<Snapshot> read(const ByteReader &reader, QString *error = nullptr);
+// A partition or an image file; needs read access. Mounted file systems should be read through
+// readDirectory instead: their latest writes may not have reached the device yet.
+[[nodiscard]] std::optional<Snapshot> readDevice(const QString &path, QString *error = nullptr);
+// The same paths from a mounted tree, with symlink targets made relative to mountPoint
+[[nodiscard]] Snapshot readDirectory(const QString &mountPoint);
+
+// Whether a snapshot holds the contents of the file at path, e.g. "/etc/fstab"
+[[nodiscard]] bool isProbedFile(const QString &path);
+
+// The source fstab mounts on /boot (e.g. UUID=...), empty when /boot is on the root file system
+[[nodiscard]] QString bootSource(const QByteArray &fstab);
+// The /dev path of an fstab source: a device path or a UUID=, LABEL=, PARTUUID= or PARTLABEL= tag
+[[nodiscard]] QString resolveSource(const QString &source);
+
+// Transport between the helper, which can open the partitions, and the application
+[[nodiscard]] QJsonObject toJson(const Snapshot &snapshot);
+[[nodiscard]] std::optional<Snapshot> fromJson(const QJsonObject &object);
+
+} // namespace rootfs
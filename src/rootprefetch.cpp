@@ -0,0 +1,108 @@
+#include "rootprefetch.h"
+
+#include <QFileInfo>
+
+#include <algorithm>
+
+namespace
+{
+// Lower is likelier; -1 for partitions no Linux root would be on, or that rootfs can't read unmounted
+int tier(const BlockDeviceModel::Device &partition, const QString &rootPartition)
+{
+    static const QStringList readable {"ext2", "ext3", "ext4", "btrfs"};
+    static const QStringList rootTypes {
+        "44479540-f297-41b2-9af7-d131d5f0458a", // Linux root (x86)
+        "4f68bce3-e8cd-4db1-96e7-fbcaf984b709", // Linux root (x86-64)
+    };
+    static const QStringList linuxTypes {
+        "0x83",                                 // Linux native partition
+        "0fc63daf-8483-4772-8e79-3d69d8477de4", // Linux filesystem
+    };
+    if (partition.mountpoint.isEmpty() && !readable.contains(partition.fstype)) {
+        return -1;
+    }
+    if (partition.name == rootPartition) {
+        return 0;
+    }
+    if (partition.label.startsWith("rootMX")) {
+        return 1;
+    }
+    if (rootTypes.contains(partition.parttype)) {
+        return 2;
+    }
+    return linuxTypes.contains(partition.parttype) ? 3 : -1;
+}
+} // namespace
+
+RootPrefetcher::RootPrefetcher(QObject *parent)
+    : QObject(parent)
+{
+    pool.setMaxThreadCount(MAX_CONCURRENT_READS);
+}
+
+RootPrefetcher::~RootPrefetcher()
+{
+    pool.clear();
+    pool.waitForDone();
+}
+
+QList<const BlockDeviceModel::Device *> RootPrefetcher::rank(const QList<const BlockDeviceModel::Device *> &partitions,
+                                                             const QString &rootPartition)
+{
+    QList<QPair<int, const BlockDeviceModel::Device *>> ranked;
+    for (const BlockDeviceModel::Device *partition : partitions) {
+        if (const int t = tier(*partition, rootPartition); t >= 0) {
+            ranked.append({t, partition});
+        }
+    }
+    // Stable, so each tier keeps the display order
+    std::stable_sort(ranked.begin(), ranked.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+
+    QList<const BlockDeviceModel::Device *> candidates;
+    for (qsizetype i = 0; i < std::min<qsizetype>(ranked.size(), MAX_CANDIDATES); ++i) {
+        candidates.append(ranked.at(i).second);
+    }
+    return candidates;
+}
+
+void RootPrefetcher::prefetch(const QList<Target> &targets)
+{
+    for (const Target &target : targets) {
+        if (pending.contains(target.device)) {
+            continue;
+        }
+        pending.insert(target.device);
+        pool.start([this, target, generation = generation] {
+            std::optional<rootfs::Snapshot> snapshot;
+            if (!target.mountPoint.isEmpty()) {
+                snapshot = rootfs::readDirectory(target.mountPoint);
+            } else if (QFileInfo(target.device).isReadable()) {
+                snapshot = rootfs::readDevice(target.device);
+                if (snapshot) {
+                    snapshot->device = target.device;
+                }
+            }
+            // Files only root can read are left to the foreground read, which may ask for a password
+            if (snapshot && !snapshot->isComplete()) {
+                snapshot.reset();
+            }
+            QMetaObject::invokeMethod(
+                this,
+                [this, device = target.device, snapshot, generation] {
+                    if (generation != this->generation) {
+                        return;
+                    }
+                    pending.remove(device);
+                    emit finished(device, snapshot);
+                },
+                Qt::QueuedConnection);
+        });
+    }
+}
+
+void RootPrefetcher::cancel()
+{
+    pool.clear();
+    pending.clear();
+    ++generation;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QThreadPool>
+
+#include <optional>
+
+#include "blockdevicemodel.h"
+#include "rootfs.h"
+
+// Reads the partitions most likely to be chosen as the root of a stub install ahead of time, on a
+// small thread pool, so that selecting one shows its kernels at once. Only what needs no privileges
+// is read here: mounted trees and devices the user can open. Nothing is mounted or unlocked.
+class RootPrefetcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    static constexpr int MAX_CANDIDATES = 4;
+    static constexpr int MAX_CONCURRENT_READS = 2;
+
+    struct Target {
+        QString device;     // e.g. /dev/sda2
+        QString mountPoint; // empty when not mounted
+    };
+
+    explicit RootPrefetcher(QObject *parent = nullptr);
+    ~RootPrefetcher() override;
+
+    // The partitions worth reading, likeliest first: the running root, rootMX* labels, the Linux root
+    // partition types, then the generic Linux ones. Unmounted ones must be ext2/3/4 or btrfs.
+    [[nodiscard]] static QList<const BlockDeviceModel::Device *>
+    rank(const QList<const BlockDeviceModel::Device *> &partitions, const QString &rootPartition);
+
+    // Starts reading the targets not already being read
+    void prefetch(const QList<Target> &targets);
+    [[nodiscard]] bool isPending(const QString &device) const { return pending.contains(device); }
+    // Drops the reads not started yet and forgets those in flight; their results are not reported
+    void cancel();
+
+signals:
+    // nullopt when the partition can't be read without privileges, or not all of it
+    void finished(const QString &device, const std::optional<rootfs::Snapshot> &snapshot);
+
+private:
+    QThreadPool pool;
+    QSet<QString> pending;
+    quint64 generation = 0;
+};
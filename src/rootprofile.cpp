@@ -0,0 +1,131 @@
+#include "rootprofile.h"
+
+#include <QDir>
+#include <QRegularExpression>
+
+#include <algorithm>
+
+namespace
+{
+// The files a profile is parsed from, as the root sees them
+const QStringList PROFILE_FILES {"/etc/fstab",      "/etc/crypttab",       "/etc/os-release",
+                                 "/etc/lsb-release", "/etc/initrd_release", "/etc/antix-version",
+                                 "/etc/mx-version",  "/sbin/init",          "/bin/init",
+                                 "/lib/systemd/systemd"};
+
+std::optional<QByteArray> contents(const rootfs::Snapshot &root, const QString &path)
+{
+    return root.exists(path) ? std::optional(root.contents(path)) : std::nullopt;
+}
+
+// Whether init=/lib/systemd/systemd is needed to boot systemd: it is installed, but /sbin/init
+// (or /bin/init) is a shim or another init rather than a link to it
+bool needsInitSystemd(const rootfs::Snapshot &root)
+{
+    const QString initPath = root.exists("/sbin/init") ? "/sbin/init" : root.exists("/bin/init") ? "/bin/init" : "";
+    if (initPath.isEmpty() || !root.exists("/lib/systemd/systemd")) {
+        return false;
+    }
+    const rootfs::Node init = root.files.value(initPath);
+    if (init.kind != rootfs::Kind::Symlink) {
+        return true;
+    }
+    // The target as stored in the link, so it is never resolved through the host's file system
+    return init.target.section('/', -1) != "systemd";
+}
+} // namespace
+
+RootProfile RootProfile::read(const rootfs::Snapshot &root)
+{
+    RootProfile profile;
+    profile.mountPoint = root.mountPoint;
+
+    QString entryName;
+    if (!root.exists("/etc/antix-version") && !root.exists("/etc/mx-version") && root.exists("/etc/os-release")) {
+        entryName = distroName(true, "os-release", contents(root, "/etc/os-release"));
+        profile.distro = distroName(false, "os-release", contents(root, "/etc/os-release"));
+    } else {
+        entryName = distroName(true, "lsb-release", contents(root, "/etc/lsb-release"));
+        profile.distro = distroName(false, "initrd_release", contents(root, "/etc/initrd_release"));
+    }
+    profile.entryName = entryName.trimmed().replace(" GNU/Linux", "").replace(" Linux", "");
+
+    profile.hasFstab = root.exists("/etc/fstab");
+    profile.bootSource = rootfs::bootSource(root.contents("/etc/fstab"));
+    profile.hasBootDirectory = root.isDirectory("/boot");
+    profile.crypttab = parseCrypttab(root.contents("/etc/crypttab"));
+    profile.needsInitSystemd = needsInitSystemd(root);
+
+    if (!root.mountPoint.isEmpty()) {
+        profile.stamps.reserve(PROFILE_FILES.size());
+        for (const QString &path : PROFILE_FILES) {
+            profile.stamps.append(scancache::stamp(QDir::cleanPath(root.mountPoint + path)));
+        }
+    }
+    return profile;
+}
+
+bool RootProfile::isCurrent() const
+{
+    return mountPoint.isEmpty() || scancache::isCurrent(stamps);
+}
+
+QString RootProfile::mapperName(const QStringList &sources) const
+{
+    for (const CryptEntry &entry : crypttab) {
+        if (std::any_of(sources.cbegin(), sources.cend(),
+                        [&entry](const QString &source) { return entry.source.startsWith(source); })) {
+            return entry.name;
+        }
+    }
+    return {};
+}
+
+QString RootProfile::distroName(bool pretty, const QString &releaseFile, const std::optional<QByteArray> &contents)
+{
+    QString searchTerm;
+    if (releaseFile == "initrd_release") {
+        searchTerm = pretty ? "PRETTY_NAME=" : "NAME=";
+    } else if (releaseFile == "lsb-release") {
+        searchTerm = pretty ? "PRETTY_NAME=" : "DISTRIB_DESCRIPTION=";
+    } else if (releaseFile == "os-release") {
+        searchTerm = pretty ? "PRETTY_NAME=" : "ID=";
+    } else {
+        return pretty ? "MX Linux" : "MX";
+    }
+
+    if (!contents) {
+        return pretty ? "MX Linux" : "MX";
+    }
+    QString distroName;
+    const QStringList lines = QString::fromUtf8(*contents).split('\n');
+    for (const QString &line : lines) {
+        if (line.startsWith(searchTerm)) {
+            distroName = line.section('=', 1, 1).remove('"').trimmed();
+            break;
+        }
+    }
+
+    if (distroName.isEmpty()) {
+        return "Linux";
+    }
+    return distroName;
+}
+
+QList<RootProfile::CryptEntry> RootProfile::parseCrypttab(const QByteArray &crypttab)
+{
+    static const QRegularExpression whitespace(R"(\s+)");
+    QList<CryptEntry> entries;
+    const QStringList lines = QString::fromUtf8(crypttab).split('\n');
+    for (const QString &line : lines) {
+        const QString trimmed = line.trimmed();
+        if (trimmed.isEmpty() || trimmed.startsWith('#')) {
+            continue;
+        }
+        const QStringList fields = trimmed.split(whitespace);
+        if (fields.size() >= 2) {
+            entries.append({fields.at(0), fields.at(1)});
+        }
+    }
+    return entries;
+}
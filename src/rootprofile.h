@@ -0,0 +1,45 @@
+#pragma once
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+#include <optional>
+
+#include "rootfs.h"
+#include "scancache.h"
+
+// What a Linux root says about itself, parsed in one pass over the release files, fstab, crypttab
+// and init of its snapshot. A mounted root's profile keeps stamps of those files, so it is parsed
+// again only once they change or the root is unmounted.
+struct RootProfile {
+    // A crypttab line: the /dev/mapper name and the device it unlocks, e.g. UUID=...
+    struct CryptEntry {
+        QString name;
+        QString source;
+
+        bool operator==(const CryptEntry &other) const = default;
+    };
+
+    QString mountPoint; // empty for a root read off its device
+    QString entryName;  // for a boot entry, without " GNU/Linux" or " Linux"
+    QString distro;     // directory under \EFI
+    bool hasFstab = false;
+    QString bootSource; // what fstab mounts on /boot; empty when /boot is on the root file system
+    bool hasBootDirectory = false;
+    QList<CryptEntry> crypttab;
+    bool needsInitSystemd = false;  // systemd is installed but init is not a link to it
+    QList<scancache::Stamp> stamps; // mounted roots only
+
+    [[nodiscard]] static RootProfile read(const rootfs::Snapshot &root);
+    // Always true for a root read off its device; its snapshot goes with the next device scan
+    [[nodiscard]] bool isCurrent() const;
+    // The mapper name of the first crypttab line unlocking one of sources, e.g. sda2_crypt
+    [[nodiscard]] QString mapperName(const QStringList &sources) const;
+
+    // A distribution's name from one of its release files; contents is nullopt when the file is missing
+    [[nodiscard]] static QString distroName(bool pretty, const QString &releaseFile,
+                                            const std::optional<QByteArray> &contents);
+    [[nodiscard]] static QList<CryptEntry> parseCrypttab(const QByteArray &crypttab);
+};
@@ -0,0 +1,209 @@
+#include "scancache.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <algorithm>
+
+namespace scancache
+{
+
+namespace
+{
+QJsonArray stampsToJson(const QList<Stamp> &stamps)
+{
+    QJsonArray array;
+    for (const Stamp &stamp : stamps) {
+        array.append(QJsonObject {{"path", stamp.path}, {"size", stamp.size}, {"mtime", stamp.mtime}});
+    }
+    return array;
+}
+
+QList<Stamp> stampsFromJson(const QJsonArray &array)
+{
+    QList<Stamp> stamps;
+    stamps.reserve(array.size());
+    for (const QJsonValue &value : array) {
+        const QJsonObject object = value.toObject();
+        stamps.append({object.value("path").toString(), object.value("size").toInteger(-1),
+                       object.value("mtime").toInteger()});
+    }
+    return stamps;
+}
+
+QJsonObject choiceToJson(const KernelChoice &choice)
+{
+    return {
+        {"kernels", QJsonArray::fromStringList(choice.kernels)},
+        {"kernel", choice.kernel},
+        {"options", choice.options},
+        {"entryName", choice.entryName},
+        {"distro", choice.distro},
+    };
+}
+
+KernelChoice choiceFromJson(const QJsonObject &object)
+{
+    KernelChoice choice;
+    for (const QJsonValue &kernel : object.value("kernels").toArray()) {
+        choice.kernels.append(kernel.toString());
+    }
+    choice.kernel = object.value("kernel").toString();
+    choice.options = object.value("options").toString();
+    choice.entryName = object.value("entryName").toString();
+    choice.distro = object.value("distro").toString();
+    return choice;
+}
+} // namespace
+
+Stamp stamp(const QString &path)
+{
+    const QFileInfo info(path);
+    if (!info.exists()) {
+        return {path, -1, 0};
+    }
+    return {path, info.size(), info.lastModified().toMSecsSinceEpoch()};
+}
+
+bool isCurrent(const QList<Stamp> &stamps)
+{
+    if (stamps.isEmpty()) {
+        return false;
+    }
+    return std::all_of(stamps.cbegin(), stamps.cend(), [](const Stamp &saved) { return stamp(saved.path) == saved; });
+}
+
+// /boot gets a new modification time whenever a kernel is installed or removed
+QList<Stamp> mountedStamps(const QString &mountPoint)
+{
+    static const QStringList paths = {"/boot",           "/boot/grub/grub.cfg", "/etc/default/grub", "/etc/fstab",
+                                      "/etc/os-release", "/etc/lsb-release",    "/etc/initrd_release"};
+    QList<Stamp> stamps;
+    stamps.reserve(paths.size());
+    for (const QString &path : paths) {
+        stamps.append(stamp(QDir::cleanPath(mountPoint + path)));
+    }
+    return stamps;
+}
+
+QString currentBootId(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return {};
+    }
+    return QString::fromLatin1(file.readAll()).trimmed();
+}
+
+QPair<QString, QString> identity(const QJsonArray &devices, const QString &name)
+{
+    for (const QJsonValue &value : devices) {
+        const QJsonObject device = value.toObject();
+        if (device.value("name").toString() == name) {
+            return {device.value("partuuid").toString().toLower(), device.value("uuid").toString().toLower()};
+        }
+    }
+    return {};
+}
+
+void prune(Snapshot *snapshot)
+{
+    for (auto it = snapshot->kernels.begin(); it != snapshot->kernels.end();) {
+        const auto [partuuid, uuid] = identity(snapshot->devices, it.key());
+        if ((partuuid.isEmpty() && uuid.isEmpty()) || partuuid != it->partuuid || uuid != it->uuid) {
+            it = snapshot->kernels.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+QJsonObject toJson(const Snapshot &snapshot)
+{
+    QJsonObject efivars;
+    for (auto it = snapshot.efivars.cbegin(); it != snapshot.efivars.cend(); ++it) {
+        // The hash is kept as text, JSON numbers are doubles
+        efivars.insert(it.key(), QJsonObject {{"size", it->size}, {"hash", QString::number(it->hash)}});
+    }
+    QJsonObject kernels;
+    for (auto it = snapshot.kernels.cbegin(); it != snapshot.kernels.cend(); ++it) {
+        kernels.insert(it.key(), QJsonObject {
+                                     {"partuuid", it->partuuid},
+                                     {"uuid", it->uuid},
+                                     {"stamps", stampsToJson(it->stamps)},
+                                     {"choice", choiceToJson(it->choice)},
+                                 });
+    }
+    return {
+        {"version", FORMAT_VERSION},
+        {"bootId", snapshot.bootId},
+        {"root", QJsonObject {{"devicePath", snapshot.rootDevicePath},
+                              {"partition", snapshot.rootPartition},
+                              {"drive", snapshot.rootDrive}}},
+        {"devices", snapshot.devices},
+        {"efivars", efivars},
+        {"efibootmgr", snapshot.efibootmgr},
+        {"kernels", kernels},
+    };
+}
+
+std::optional<Snapshot> fromJson(const QJsonObject &object)
+{
+    if (object.value("version").toInt() != FORMAT_VERSION) {
+        return std::nullopt;
+    }
+    Snapshot snapshot;
+    snapshot.bootId = object.value("bootId").toString();
+    const QJsonObject root = object.value("root").toObject();
+    snapshot.rootDevicePath = root.value("devicePath").toString();
+    snapshot.rootPartition = root.value("partition").toString();
+    snapshot.rootDrive = root.value("drive").toString();
+    snapshot.devices = object.value("devices").toArray();
+    const QJsonObject efivars = object.value("efivars").toObject();
+    for (auto it = efivars.constBegin(); it != efivars.constEnd(); ++it) {
+        const QJsonObject fingerprint = it.value().toObject();
+        snapshot.efivars.insert(it.key(), {fingerprint.value("size").toInteger(),
+                                           static_cast<size_t>(fingerprint.value("hash").toString().toULongLong())});
+    }
+    snapshot.efibootmgr = object.value("efibootmgr").toString();
+    const QJsonObject kernels = object.value("kernels").toObject();
+    for (auto it = kernels.constBegin(); it != kernels.constEnd(); ++it) {
+        const QJsonObject cached = it.value().toObject();
+        snapshot.kernels.insert(it.key(), {cached.value("partuuid").toString(), cached.value("uuid").toString(),
+                                           stampsFromJson(cached.value("stamps").toArray()),
+                                           choiceFromJson(cached.value("choice").toObject())});
+    }
+    return snapshot;
+}
+
+QString defaultPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/scan.json";
+}
+
+std::optional<Snapshot> load(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return std::nullopt;
+    }
+    const QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+    return doc.isObject() ? fromJson(doc.object()) : std::nullopt;
+}
+
+bool save(const QString &path, const Snapshot &snapshot)
+{
+    if (!QDir().mkpath(QFileInfo(path).absolutePath())) {
+        return false;
+    }
+    const QByteArray bytes = QJsonDocument(toJson(snapshot)).toJson(QJsonDocument::Compact);
+    QSaveFile file(path);
+    return file.open(QIODevice::WriteOnly) && file.write(bytes) == bytes.size() && file.commit();
+}
+
+} // namespace scancache
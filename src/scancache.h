@@ -0,0 +1,82 @@
+#pragma once
+
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QList>
+#include <QMap>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+
+#include <optional>
+
+#include "efivarwatcher.h"
+
+// The results of the last scan, saved on exit so the next launch can show them before scanning
+// again. Each part keeps what it was derived from, so a stale part is told apart from a valid one.
+namespace scancache
+{
+
+inline constexpr int FORMAT_VERSION = 1;
+
+// A file or directory as stat sees it; size is -1 when it does not exist
+struct Stamp {
+    QString path;
+    qint64 size = -1;
+    qint64 mtime = 0; // ms since the epoch
+
+    bool operator==(const Stamp &other) const = default;
+};
+
+// What selecting a kernel found on a Linux root partition
+struct KernelChoice {
+    QStringList kernels; // versions, newest first
+    QString kernel;      // the one selected
+    QString options;     // its command line
+    QString entryName;   // from the release files; empty when they name no distribution
+    QString distro;      // directory under \EFI
+
+    bool operator==(const KernelChoice &other) const = default;
+};
+
+// A kernel choice and the partition it was read from
+struct CachedKernels {
+    QString partuuid;
+    QString uuid;        // file system UUID
+    QList<Stamp> stamps; // mounted trees only: their files can be checked without reading the device
+    KernelChoice choice;
+};
+
+struct Snapshot {
+    QString bootId; // the boot the root device and efibootmgr output were read in
+    QString rootDevicePath;
+    QString rootPartition;
+    QString rootDrive;
+    QJsonArray devices; // lsblk's block device list
+    EfivarWatcher::Fingerprints efivars; // the variables efibootmgr was run on
+    QString efibootmgr;
+    QMap<QString, CachedKernels> kernels; // by partition, e.g. sda2
+};
+
+[[nodiscard]] Stamp stamp(const QString &path);
+// Whether every file still has its size and modification time; false for an empty list
+[[nodiscard]] bool isCurrent(const QList<Stamp> &stamps);
+// The files a kernel choice depends on, under a mounted root
+[[nodiscard]] QList<Stamp> mountedStamps(const QString &mountPoint);
+
+[[nodiscard]] QString currentBootId(const QString &path = "/proc/sys/kernel/random/boot_id");
+// PARTUUID and file system UUID of a partition in an lsblk list, by name (sda2); empty when not listed
+[[nodiscard]] QPair<QString, QString> identity(const QJsonArray &devices, const QString &name);
+// Drops the kernel choices of partitions gone from snapshot->devices or given another PARTUUID or UUID
+void prune(Snapshot *snapshot);
+
+[[nodiscard]] QJsonObject toJson(const Snapshot &snapshot);
+// nullopt for another FORMAT_VERSION
+[[nodiscard]] std::optional<Snapshot> fromJson(const QJsonObject &object);
+
+// Under the user's cache directory
+[[nodiscard]] QString defaultPath();
+[[nodiscard]] std::optional<Snapshot> load(const QString &path);
+bool save(const QString &path, const Snapshot &snapshot);
+
+} // namespace scancache
@@ -1,83 +1,31 @@
 #include "utils.h"
 
-#include <QFile>
 #include <QRegularExpression>
+#include <QVarLengthArray>
 #include <algorithm>
 
+#include "kernelversion.h"
+
 namespace utils
 {
 
-KernelFiles resolveKernelFiles(const QString &sourceDir, const QString &kernelVersion, bool isFrugal)
+QStringList sortKernelVersions(const QStringList &kernelFiles, bool reverse)
 {
-    KernelFiles result;
-
-    // vmlinuz: try versioned first, fall back to Arch-style vmlinuz-linux
-    result.vmlinuz = QString("%1/vmlinuz%2").arg(sourceDir, isFrugal ? "" : "-" + kernelVersion);
-    if (!QFile::exists(result.vmlinuz)) {
-        result.vmlinuz = QString("%1/vmlinuz-linux").arg(sourceDir);
+    // Each name is parsed once; the sort then moves keys that view into kernelFiles
+    QVarLengthArray<std::pair<KernelVersion, qsizetype>, 64> keys;
+    keys.reserve(kernelFiles.size());
+    for (qsizetype i = 0; i < kernelFiles.size(); ++i) {
+        keys.emplace_back(KernelVersion::parse(kernelFiles.at(i)), i);
     }
-
-    // initrd: try initrd pattern first, then initramfs, then Arch fallback
-    const QString initrdPath = QString("%1/initrd%2").arg(sourceDir, isFrugal ? ".gz" : ".img-" + kernelVersion);
-    const QString initramfsPath = QString("%1/initramfs-%2").arg(sourceDir, isFrugal ? "" : kernelVersion + ".img");
-
-    if (QFile::exists(initrdPath)) {
-        result.initrd = initrdPath;
-    } else if (QFile::exists(initramfsPath)) {
-        result.initrd = initramfsPath;
-    } else {
-        const QString archFallback = QString("%1/initramfs-linux.img").arg(sourceDir);
-        result.initrd = QFile::exists(archFallback) ? archFallback : initramfsPath;
+    std::sort(keys.begin(), keys.end(), [reverse](const auto &a, const auto &b) {
+        return reverse ? b.first < a.first : a.first < b.first;
+    });
+
+    QStringList sortedList;
+    sortedList.reserve(kernelFiles.size());
+    for (const auto &key : std::as_const(keys)) {
+        sortedList.append(kernelFiles.at(key.second));
     }
-
-    // microcode images (may not exist)
-    result.amdUcode = QString("%1/amd-ucode.img").arg(sourceDir);
-    result.intelUcode = QString("%1/intel-ucode.img").arg(sourceDir);
-
-    return result;
-}
-
-QStringList sortKernelVersions(const QStringList &kernelFiles, bool reverse)
-{
-    static const QRegularExpression regex(R"((\d+)\.(\d+)(?:\.(\d+))?(-([a-z0-9]+[^-]*)?)?(-.*)?)");
-
-    auto versionCompare = [reverse](const QString &a, const QString &b) {
-        QRegularExpressionMatch matchA = regex.match(a);
-        QRegularExpressionMatch matchB = regex.match(b);
-
-        if (!matchA.hasMatch() && !matchB.hasMatch()) {
-            return reverse ? a > b : a < b;
-        }
-        if (!matchA.hasMatch()) {
-            return reverse;
-        }
-        if (!matchB.hasMatch()) {
-            return !reverse;
-        }
-
-        int majorA = matchA.captured(1).toInt();
-        int minorA = matchA.captured(2).toInt();
-        int patchA = matchA.captured(3).isEmpty() ? 0 : matchA.captured(3).toInt();
-
-        int majorB = matchB.captured(1).toInt();
-        int minorB = matchB.captured(2).toInt();
-        int patchB = matchB.captured(3).isEmpty() ? 0 : matchB.captured(3).toInt();
-
-        if (majorA != majorB) {
-            return reverse ? majorA > majorB : majorA < majorB;
-        }
-        if (minorA != minorB) {
-            return reverse ? minorA > minorB : minorA < minorB;
-        }
-        if (patchA != patchB) {
-            return reverse ? patchA > patchB : patchA < patchB;
-        }
-
-        return reverse ? matchA.captured(4) > matchB.captured(4) : matchA.captured(4) < matchB.captured(4);
-    };
-
-    QStringList sortedList = kernelFiles;
-    std::sort(sortedList.begin(), sortedList.end(), versionCompare);
     return sortedList;
 }
 
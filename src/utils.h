@@ -5,14 +5,7 @@
 namespace utils
 {
 
-struct KernelFiles {
-    QString vmlinuz;
-    QString initrd;
-    QString amdUcode;
-    QString intelUcode;
-};
-
-KernelFiles resolveKernelFiles(const QString &sourceDir, const QString &kernelVersion, bool isFrugal);
+// Newest first unless reverse is false; names holding no version count as newer than any that do
 QStringList sortKernelVersions(const QStringList &kernelFiles, bool reverse = true);
 QString extractDiskFromPartition(const QString &partition);
 
@@ -0,0 +1,71 @@
+#include "variablestore.h"
+
+#include <QFile>
+#include <QObject>
+#include <QSaveFile>
+
+#include "cmd.h"
+#include "common.h"
+#include "efivars.h"
+
+bool EfivarfsStore::read(bootsnapshot::Snapshot *snapshot, QString *error)
+{
+    lastRead = bootsnapshot::capture();
+    if (lastRead.variables.isEmpty()) {
+        if (error) {
+            *error = QObject::tr("No boot variables could be read from %1").arg(EFIVARS_DIR);
+        }
+        return false;
+    }
+    *snapshot = lastRead;
+    return true;
+}
+
+bool EfivarfsStore::write(const QList<bootsnapshot::Change> &changes, QString *error)
+{
+    // Refuse to overwrite variables another program changed after they were read
+    const QList<bootsnapshot::Change> versioned = bootsnapshot::versioned(changes, lastRead);
+    Cmd cmd;
+    if (!cmd.procAsRootEfivars(bootsnapshot::toHelperOperations(versioned), nullptr, QuietMode::Yes)) {
+        if (error) {
+            *error = cmd.exitCode() == EXIT_CODE_CONFLICT
+                         ? QObject::tr("The boot configuration changed while it was being applied, nothing was written.")
+                         : QObject::tr("Writing the boot configuration failed.");
+        }
+        return false;
+    }
+    efivars::recordWrites(static_cast<int>(changes.size()));
+    return true;
+}
+
+bool VarsFileStore::read(bootsnapshot::Snapshot *snapshot, QString *error)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) {
+            *error = QObject::tr("Could not read %1: %2").arg(fileName, file.errorString());
+        }
+        return false;
+    }
+    if (!varsfile::parse(file.readAll(), &image, error)) {
+        return false;
+    }
+    *snapshot = varsfile::capture(image);
+    return true;
+}
+
+bool VarsFileStore::write(const QList<bootsnapshot::Change> &changes, QString *error)
+{
+    if (!varsfile::apply(&image, changes, error)) {
+        return false;
+    }
+    // QSaveFile keeps the old image intact if anything goes wrong halfway
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly) || file.write(image.bytes) != image.bytes.size() || !file.commit()) {
+        if (error) {
+            *error = QObject::tr("Could not write %1: %2").arg(fileName, file.errorString());
+        }
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <QString>
+
+#include "bootsnapshot.h"
+#include "varsfile.h"
+
+// Where boot variables are read from and written to: the running firmware or a VARS image
+class VariableStore
+{
+public:
+    virtual ~VariableStore() = default;
+
+    [[nodiscard]] virtual QString location() const = 0;
+    [[nodiscard]] virtual bool read(bootsnapshot::Snapshot *snapshot, QString *error) = 0;
+    // Changes are planned against the snapshot read last
+    [[nodiscard]] virtual bool write(const QList<bootsnapshot::Change> &changes, QString *error) = 0;
+};
+
+// NVRAM of this machine through efivarfs; writes go through the helper
+class EfivarfsStore : public VariableStore
+{
+public:
+    [[nodiscard]] QString location() const override { return EFIVARS_DIR; }
+    [[nodiscard]] bool read(bootsnapshot::Snapshot *snapshot, QString *error) override;
+    [[nodiscard]] bool write(const QList<bootsnapshot::Change> &changes, QString *error) override;
+
+private:
+    bootsnapshot::Snapshot lastRead;
+};
+
+// edk2 VARS.fd file of a virtual machine, rewritten in place
+class VarsFileStore : public VariableStore
+{
+public:
+    explicit VarsFileStore(const QString &path)
+        : fileName(path)
+    {
+    }
+
+    [[nodiscard]] QString location() const override { return fileName; }
+    [[nodiscard]] bool read(bootsnapshot::Snapshot *snapshot, QString *error) override;
+    [[nodiscard]] bool write(const QList<bootsnapshot::Change> &changes, QString *error) override;
+
+private:
+    QString fileName;
+    varsfile::Image image;
+};
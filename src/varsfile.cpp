@@ -0,0 +1,218 @@
+#include "varsfile.h"
+
+#include <QObject>
+#include <QSet>
+#include <QtEndian>
+
+#include <algorithm>
+
+namespace varsfile
+{
+
+namespace
+{
+// EFI_FIRMWARE_VOLUME_HEADER
+constexpr qsizetype FV_SIGNATURE_OFFSET = 40;
+constexpr qsizetype FV_HEADER_LENGTH_OFFSET = 48;
+constexpr quint32 FV_SIGNATURE = 0x4856465f; // "_FVH"
+
+// VARIABLE_STORE_HEADER
+constexpr qsizetype STORE_HEADER_SIZE = 28;
+constexpr quint8 STORE_FORMATTED = 0x5a;
+constexpr quint8 STORE_HEALTHY = 0xfe;
+const QByteArray AUTHENTICATED_VARIABLE_GUID = QByteArray::fromHex("782cf3aa7b949a43a1802e144ec37792");
+const QByteArray VARIABLE_GUID = QByteArray::fromHex("1636cfdd7532644198b6fe85707ffe7d");
+const QByteArray EFI_GLOBAL_VARIABLE_GUID = QByteArray::fromHex("61dfe48bca93d211aa0d00e098032b8c");
+
+// AUTHENTICATED_VARIABLE_HEADER and VARIABLE_HEADER
+constexpr quint16 VARIABLE_START_ID = 0x55aa;
+constexpr quint16 ERASED_START_ID = 0xffff; // the free space after the last variable
+constexpr quint8 VAR_ADDED = 0x3f;
+constexpr quint8 VAR_IN_DELETED_TRANSITION = 0xfe;
+constexpr qsizetype AUTH_HEADER_SIZE = 60;
+constexpr qsizetype HEADER_SIZE = 32;
+constexpr qsizetype STATE_OFFSET = 2;
+constexpr qsizetype ATTRIBUTES_OFFSET = 4;
+// NameSize and DataSize, followed by the vendor GUID; the authenticated header has
+// MonotonicCount, TimeStamp and PubKeyIndex before them
+constexpr qsizetype AUTH_SIZES_OFFSET = 36;
+constexpr qsizetype SIZES_OFFSET = 8;
+
+// Each header starts 4-byte aligned; edk2 builds for IA-32, x64 and ARM put the data right after
+// the name (GET_PAD_SIZE is 0)
+constexpr qsizetype HEADER_ALIGNMENT = 4;
+
+qsizetype align(qsizetype offset)
+{
+    return (offset + HEADER_ALIGNMENT - 1) & ~(HEADER_ALIGNMENT - 1);
+}
+
+bool fail(QString *error, const QString &message)
+{
+    if (error) {
+        *error = message;
+    }
+    return false;
+}
+
+QString key(const QByteArray &guid, const QString &name)
+{
+    return QString::fromLatin1(guid.toHex()) + ':' + name;
+}
+
+// Header, name and data of a variable written by us; authentication fields stay zero
+QByteArray buildRecord(const Image &image, const QByteArray &guid, const QString &name, quint32 attributes,
+                       const QByteArray &data)
+{
+    // UCS-2 with the terminating NUL
+    QByteArray nameBytes((name.size() + 1) * 2, '\0');
+    for (qsizetype i = 0; i < name.size(); ++i) {
+        qToLittleEndian(name.at(i).unicode(), nameBytes.data() + i * 2);
+    }
+    const qsizetype headerSize = image.authenticated ? AUTH_HEADER_SIZE : HEADER_SIZE;
+    QByteArray record(headerSize, '\0');
+    char *header = record.data();
+    qToLittleEndian(VARIABLE_START_ID, header);
+    header[STATE_OFFSET] = static_cast<char>(VAR_ADDED);
+    qToLittleEndian(attributes, header + ATTRIBUTES_OFFSET);
+    const qsizetype sizesOffset = image.authenticated ? AUTH_SIZES_OFFSET : SIZES_OFFSET;
+    qToLittleEndian(static_cast<quint32>(nameBytes.size()), header + sizesOffset);
+    qToLittleEndian(static_cast<quint32>(data.size()), header + sizesOffset + 4);
+    record.replace(sizesOffset + 8, guid.size(), guid);
+    record += nameBytes + data;
+    return record;
+}
+} // namespace
+
+bool parse(const QByteArray &bytes, Image *image, QString *error)
+{
+    if (bytes.size() < FV_HEADER_LENGTH_OFFSET + 2
+        || qFromLittleEndian<quint32>(bytes.constData() + FV_SIGNATURE_OFFSET) != FV_SIGNATURE) {
+        return fail(error, QObject::tr("Not a firmware volume image."));
+    }
+    const qsizetype storeOffset = qFromLittleEndian<quint16>(bytes.constData() + FV_HEADER_LENGTH_OFFSET);
+    if (storeOffset + STORE_HEADER_SIZE > bytes.size()) {
+        return fail(error, QObject::tr("The firmware volume has no variable store."));
+    }
+    const QByteArray storeGuid = bytes.mid(storeOffset, 16);
+    const bool authenticated = storeGuid == AUTHENTICATED_VARIABLE_GUID;
+    if (!authenticated && storeGuid != VARIABLE_GUID) {
+        return fail(error, QObject::tr("The firmware volume has no variable store."));
+    }
+    const quint32 storeSize = qFromLittleEndian<quint32>(bytes.constData() + storeOffset + 16);
+    const auto format = static_cast<quint8>(bytes.at(storeOffset + 20));
+    const auto state = static_cast<quint8>(bytes.at(storeOffset + 21));
+    if (storeSize < STORE_HEADER_SIZE || storeOffset + storeSize > bytes.size() || format != STORE_FORMATTED
+        || state != STORE_HEALTHY) {
+        return fail(error, QObject::tr("The variable store is damaged or not formatted."));
+    }
+
+    Image result;
+    result.bytes = bytes;
+    result.storeStart = align(storeOffset + STORE_HEADER_SIZE);
+    result.storeEnd = storeOffset + storeSize;
+    result.authenticated = authenticated;
+
+    const qsizetype headerSize = authenticated ? AUTH_HEADER_SIZE : HEADER_SIZE;
+    const qsizetype sizesOffset = authenticated ? AUTH_SIZES_OFFSET : SIZES_OFFSET;
+    QList<Record> inTransition; // copies of variables being updated when the VM stopped
+    qsizetype pos = result.storeStart;
+    // The walk has to end in erased space or at the end of the store; anything else means a variable was
+    // misread, and rewriting the store from what was read so far would drop the ones after it
+    while (pos + 2 <= result.storeEnd) {
+        const quint16 startId = qFromLittleEndian<quint16>(bytes.constData() + pos);
+        if (startId == ERASED_START_ID) {
+            break;
+        }
+        if (startId != VARIABLE_START_ID || pos + headerSize > result.storeEnd) {
+            return fail(error, QObject::tr("The variable store is damaged or not formatted."));
+        }
+        const char *header = bytes.constData() + pos;
+        const quint32 nameSize = qFromLittleEndian<quint32>(header + sizesOffset);
+        const quint32 dataSize = qFromLittleEndian<quint32>(header + sizesOffset + 4);
+        const qsizetype dataOffset = pos + headerSize + nameSize;
+        const qsizetype end = dataOffset + dataSize;
+        if (nameSize < 2 || nameSize % 2 != 0 || end > result.storeEnd) {
+            return fail(error, QObject::tr("The variable store is damaged or not formatted."));
+        }
+
+        const auto varState = static_cast<quint8>(header[STATE_OFFSET]);
+        if (varState == VAR_ADDED || varState == (VAR_ADDED & VAR_IN_DELETED_TRANSITION)) {
+            Record record;
+            record.vendorGuid = bytes.mid(pos + sizesOffset + 8, 16);
+            record.name = QString::fromUtf16(reinterpret_cast<const char16_t *>(header + headerSize), nameSize / 2 - 1);
+            record.attributes = qFromLittleEndian<quint32>(header + ATTRIBUTES_OFFSET);
+            record.data = bytes.mid(dataOffset, dataSize);
+            record.raw = bytes.mid(pos, end - pos);
+            (varState == VAR_ADDED ? result.records : inTransition).append(record);
+        }
+        pos = align(end);
+    }
+
+    // A copy in transition only counts if its replacement never made it
+    QSet<QString> added;
+    for (const Record &record : std::as_const(result.records)) {
+        added.insert(key(record.vendorGuid, record.name));
+    }
+    for (const Record &record : std::as_const(inTransition)) {
+        if (!added.contains(key(record.vendorGuid, record.name))) {
+            result.records.append(record);
+        }
+    }
+    *image = result;
+    return true;
+}
+
+bootsnapshot::Snapshot capture(const Image &image)
+{
+    bootsnapshot::Snapshot snapshot;
+    for (const Record &record : image.records) {
+        if (record.vendorGuid == EFI_GLOBAL_VARIABLE_GUID && bootsnapshot::isManagedVariable(record.name)) {
+            snapshot.variables.append({record.name, record.attributes, record.data});
+        }
+    }
+    std::sort(snapshot.variables.begin(), snapshot.variables.end(),
+              [](const bootsnapshot::Variable &a, const bootsnapshot::Variable &b) { return a.name < b.name; });
+    return snapshot;
+}
+
+bool apply(Image *image, const QList<bootsnapshot::Change> &changes, QString *error)
+{
+    QList<Record> records = image->records;
+    for (const bootsnapshot::Change &change : changes) {
+        const auto it = std::find_if(records.begin(), records.end(), [&change](const Record &record) {
+            return record.vendorGuid == EFI_GLOBAL_VARIABLE_GUID && record.name == change.variable.name;
+        });
+        if (change.kind == bootsnapshot::Change::Kind::Delete) {
+            if (it != records.end()) {
+                records.erase(it);
+            }
+            continue;
+        }
+        Record record {EFI_GLOBAL_VARIABLE_GUID, change.variable.name, change.variable.attributes, change.variable.data,
+                       buildRecord(*image, EFI_GLOBAL_VARIABLE_GUID, change.variable.name,
+                                   change.variable.attributes, change.variable.data)};
+        if (it != records.end()) {
+            *it = record;
+        } else {
+            records.append(record);
+        }
+    }
+
+    // The erased state of flash is all ones
+    QByteArray store(image->storeEnd - image->storeStart, '\xff');
+    qsizetype pos = 0;
+    for (Record &record : records) {
+        if (pos + record.raw.size() > store.size()) {
+            return fail(error, QObject::tr("The variable store is full."));
+        }
+        record.raw[STATE_OFFSET] = static_cast<char>(VAR_ADDED);
+        store.replace(pos, record.raw.size(), record.raw);
+        pos = align(pos + record.raw.size());
+    }
+    image->bytes.replace(image->storeStart, store.size(), store);
+    image->records = records;
+    return true;
+}
+
+} // namespace varsfile
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+#include "bootsnapshot.h"
+
+// edk2 firmware volume holding a variable store, as in the OVMF_VARS.fd files of virtual machines.
+// Only the variable store region is rewritten; the volume header and the fault tolerant write
+// areas after the store are kept as they are.
+namespace varsfile
+{
+
+struct Record {
+    QByteArray vendorGuid; // 16 bytes as stored
+    QString name;
+    quint32 attributes = 0;
+    QByteArray data;
+    QByteArray raw; // header, name and data as read, reused for untouched variables
+};
+
+struct Image {
+    QByteArray bytes; // the whole file
+    qsizetype storeStart = 0; // first variable header
+    qsizetype storeEnd = 0;
+    bool authenticated = true; // variable headers carry the authentication fields
+    QList<Record> records;     // live variables in store order
+};
+
+[[nodiscard]] bool parse(const QByteArray &bytes, Image *image, QString *error = nullptr);
+
+// The Boot####, BootOrder and Timeout variables of the image
+[[nodiscard]] bootsnapshot::Snapshot capture(const Image &image);
+
+// Applies the changes and rewrites the store compacted, with deleted and stale copies dropped.
+// Leaves the image untouched and returns false when the result doesn't fit.
+[[nodiscard]] bool apply(Image *image, const QList<bootsnapshot::Change> &changes, QString *error = nullptr);
+
+} // namespace varsfile
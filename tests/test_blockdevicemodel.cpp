@@ -0,0 +1,154 @@
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QTest>
+
+#include <algorithm>
+
+#include "blockdevicemodel.h"
+
+class TestBlockDeviceModel : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void load_drivesAndPartitions();
+    void load_skipsOtherDevices();
+    void data_nameAndDisplay();
+    void partitions_byDriveAndPurpose();
+    void sortKey_naturalOrder();
+};
+
+namespace
+{
+constexpr qint64 GB = 1'073'741'824LL;
+
+QJsonObject device(const QString &name, const QString &type, qint64 size, const QString &pkname = {},
+                   const QString &fstype = {}, const QString &label = {}, const QString &parttype = {})
+{
+    return {
+        {"name", name},
+        {"type", type},
+        {"size", size},
+        {"pkname", pkname},
+        {"fstype", fstype},
+        {"label", label},
+        {"parttype", parttype},
+        {"mountpoint", QJsonValue()},
+        {"model", type == "disk" ? QString("Disk %1").arg(name) : QString()},
+    };
+}
+
+// lsblk lists devices in kernel order, which is not the natural one
+QJsonArray scan()
+{
+    return {
+        device("sda", "disk", 500 * GB),
+        device("sda1", "part", GB / 2, "sda", "vfat", "EFI", "C12A7328-F81F-11D2-BA4B-00A0C93EC93B"),
+        device("sda10", "part", 10 * GB, "sda", "ext4", "home"),
+        device("sda2", "part", 50 * GB, "sda", "ext4", "root MX", "0fc63daf-8483-4772-8e79-3d69d8477de4"),
+        device("sda3", "part", 8 * GB, "sda", "swap"),
+        device("sda4", "part", 100 * GB, "sda", "ntfs", "Windows"),
+        device("nvme0n10", "disk", 64 * GB),
+        device("nvme0n10p1", "part", 2 * GB, "nvme0n10", "ext4"),
+        device("nvme0n1", "disk", 256 * GB),
+        device("nvme0n1p1", "part", 20 * GB, {}, "btrfs"),
+        device("loop0", "loop", GB, {}, "squashfs"),
+        device("sr0", "rom", GB),
+    };
+}
+
+QStringList names(const QList<const BlockDeviceModel::Device *> &devices)
+{
+    QStringList result;
+    for (const auto *device : devices) {
+        result.append(device->name);
+    }
+    return result;
+}
+} // namespace
+
+void TestBlockDeviceModel::load_drivesAndPartitions()
+{
+    BlockDeviceModel model;
+    model.load(scan());
+    QCOMPARE(model.rowCount(), 3);
+    QStringList drives;
+    for (int row = 0; row < model.rowCount(); ++row) {
+        drives.append(model.index(row, 0).data(BlockDeviceModel::NameRole).toString());
+    }
+    QCOMPARE(drives, QStringList({"nvme0n1", "nvme0n10", "sda"}));
+
+    const QModelIndex sda = model.driveIndex("sda");
+    QCOMPARE(sda.row(), 2);
+    QCOMPARE(model.rowCount(sda), 5);
+    QStringList partitions;
+    for (int row = 0; row < model.rowCount(sda); ++row) {
+        const QModelIndex partition = model.index(row, 0, sda);
+        QCOMPARE(model.parent(partition), sda);
+        QCOMPARE(model.rowCount(partition), 0);
+        partitions.append(partition.data(BlockDeviceModel::NameRole).toString());
+    }
+    QCOMPARE(partitions, QStringList({"sda1", "sda2", "sda3", "sda4", "sda10"}));
+
+    // Without PKNAME the drive comes from the partition name
+    QCOMPARE(model.rowCount(model.driveIndex("nvme0n1")), 1);
+    QCOMPARE(model.device("nvme0n1p1")->drive, QString("nvme0n1"));
+}
+
+void TestBlockDeviceModel::load_skipsOtherDevices()
+{
+    BlockDeviceModel model;
+    model.load(scan());
+    QVERIFY(!model.device("loop0"));
+    QVERIFY(!model.device("sr0"));
+    QVERIFY(!model.device("missing"));
+    QVERIFY(!model.driveIndex("sda1").isValid());
+    QVERIFY(!model.index(3, 0).isValid());
+    QVERIFY(!model.index(0, 1).isValid());
+
+    model.load({});
+    QCOMPARE(model.rowCount(), 0);
+    QVERIFY(!model.device("sda"));
+}
+
+void TestBlockDeviceModel::data_nameAndDisplay()
+{
+    BlockDeviceModel model;
+    model.load(scan(), "sda2");
+    const QModelIndex sda2 = model.index(1, 0, model.driveIndex("sda"));
+    QCOMPARE(sda2.data(BlockDeviceModel::NameRole).toString(), QString("sda2"));
+    QCOMPARE(sda2.data().toString(), QString("sda2 50.0G ext4 / root MX"));
+    QCOMPARE(model.driveIndex("sda").data().toString(), QString("sda 500.0G  Disk sda"));
+    QCOMPARE(model.device("sda1")->displayText(), QString("sda1 512.0M vfat  EFI"));
+    QCOMPARE(model.device("sda1")->parttype, QString("c12a7328-f81f-11d2-ba4b-00a0c93ec93b"));
+}
+
+void TestBlockDeviceModel::partitions_byDriveAndPurpose()
+{
+    using Purpose = BlockDeviceModel::Purpose;
+    BlockDeviceModel model;
+    model.load(scan());
+    QCOMPARE(names(model.partitions("sda", Purpose::Linux)), QStringList({"sda2", "sda10"}));
+    // The ESP is too small and swap is never offered
+    QCOMPARE(names(model.partitions("sda", Purpose::Frugal)), QStringList({"sda2", "sda4", "sda10"}));
+    // nvme0n1 is a prefix of nvme0n10, yet each keeps its own partitions
+    QCOMPARE(names(model.partitions("nvme0n1", Purpose::Frugal)), QStringList({"nvme0n1p1"}));
+    QCOMPARE(names(model.partitions("nvme0n10", Purpose::Frugal)), QStringList({"nvme0n10p1"}));
+    QVERIFY(model.partitions("nvme0n10", Purpose::Linux).isEmpty());
+    QCOMPARE(names(model.partitions({}, Purpose::Esp)), QStringList({"sda1"}));
+    QVERIFY(model.partitions("sda1", Purpose::Frugal).isEmpty());
+    QVERIFY(model.partitions("sdz", Purpose::Frugal).isEmpty());
+}
+
+void TestBlockDeviceModel::sortKey_naturalOrder()
+{
+    QStringList sorted {"sda10", "nvme1n1p2", "sdb1", "sda2", "nvme0n1p10", "sda", "nvme0n1p2", "mmcblk0p1"};
+    std::sort(sorted.begin(), sorted.end(), [](const QString &a, const QString &b) {
+        return BlockDeviceModel::sortKey(a) < BlockDeviceModel::sortKey(b);
+    });
+    QCOMPARE(sorted,
+             QStringList({"mmcblk0p1", "nvme0n1p2", "nvme0n1p10", "nvme1n1p2", "sda", "sda2", "sda10", "sdb1"}));
+}
+
+QTEST_MAIN(TestBlockDeviceModel)
+#include "test_blockdevicemodel.moc"
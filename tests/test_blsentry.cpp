@@ -0,0 +1,76 @@
+#include <QTest>
+#include "blsentry.h"
+
+using blsentry::Entry;
+
+class TestBlsEntry : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void render_writesType1Entry();
+    void render_keepsValuesOnOneLine();
+    void parse_roundTrips();
+    void parse_rejectsIncompleteEntry();
+};
+
+namespace
+{
+Entry sampleEntry()
+{
+    Entry entry;
+    entry.title = "MX Linux";
+    entry.version = "6.12.8-1-liquorix-amd64";
+    entry.machineId = "0f3c8a7d2b1e4c5f9a6b7c8d9e0f1a2b";
+    entry.sortKey = "mx";
+    entry.options = "root=UUID=2c1f quiet splash";
+    entry.hasIntelUcode = true;
+    return entry;
+}
+} // namespace
+
+void TestBlsEntry::render_writesType1Entry()
+{
+    const Entry entry = sampleEntry();
+    QCOMPARE(blsentry::fileName(entry), QString("0f3c8a7d2b1e4c5f9a6b7c8d9e0f1a2b-6.12.8-1-liquorix-amd64.conf"));
+    QCOMPARE(blsentry::render(entry),
+             QString("title MX Linux\n"
+                     "version 6.12.8-1-liquorix-amd64\n"
+                     "machine-id 0f3c8a7d2b1e4c5f9a6b7c8d9e0f1a2b\n"
+                     "sort-key mx\n"
+                     "linux /0f3c8a7d2b1e4c5f9a6b7c8d9e0f1a2b/6.12.8-1-liquorix-amd64/linux\n"
+                     "initrd /0f3c8a7d2b1e4c5f9a6b7c8d9e0f1a2b/6.12.8-1-liquorix-amd64/intel-ucode.img\n"
+                     "initrd /0f3c8a7d2b1e4c5f9a6b7c8d9e0f1a2b/6.12.8-1-liquorix-amd64/initrd\n"
+                     "options root=UUID=2c1f quiet splash\n"));
+}
+
+void TestBlsEntry::render_keepsValuesOnOneLine()
+{
+    Entry entry = sampleEntry();
+    entry.title = "MX\nLinux";
+    entry.options = "quiet\ninit=/bin/sh";
+    const QString text = blsentry::render(entry);
+    QVERIFY(text.contains("title MX Linux\n"));
+    QVERIFY(text.contains("options quiet init=/bin/sh\n"));
+
+    entry.options.clear();
+    QVERIFY(!blsentry::render(entry).contains("options"));
+}
+
+void TestBlsEntry::parse_roundTrips()
+{
+    Entry entry = sampleEntry();
+    entry.hasAmdUcode = true;
+    const auto parsed = blsentry::parse("# written by uefi-manager\n" + blsentry::render(entry));
+    QVERIFY(parsed);
+    QCOMPARE(*parsed, entry);
+}
+
+void TestBlsEntry::parse_rejectsIncompleteEntry()
+{
+    QVERIFY(!blsentry::parse("title MX Linux\nversion 6.1\n"));
+    QVERIFY(!blsentry::parse({}));
+}
+
+QTEST_MAIN(TestBlsEntry)
+#include "test_blsentry.moc"
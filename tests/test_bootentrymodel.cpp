@@ -0,0 +1,182 @@
+#include <QAbstractItemModelTester>
+#include <QSignalSpy>
+#include <QTest>
+
+#include <algorithm>
+
+#include "bootentrymodel.h"
+
+class TestBootEntryModel : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void parseLine_entries();
+    void parseLine_otherLines();
+    void sortByBootOrder_listedFirst();
+    void sortByBootOrder_largeMenu();
+    void moveRows_reindexes();
+    void patch_singleRows();
+    void matches_numberLabelTarget();
+};
+
+namespace
+{
+BootEntryModel::Entry entry(const QString &bootNum, const QString &label, bool active = true)
+{
+    auto parsed = BootEntryModel::parseLine(QString("Boot%1%2 %3\tHD(1,GPT,x)/File(\\EFI\\%3.efi)")
+                                                .arg(bootNum, active ? "*" : "", label));
+    return parsed.value_or(BootEntryModel::Entry());
+}
+
+// Boot0001 to Boot000<count> in that order
+QList<BootEntryModel::Entry> entries(int count)
+{
+    QList<BootEntryModel::Entry> result;
+    for (int i = 1; i <= count; ++i) {
+        result.append(entry(QString("%1").arg(i, 4, 16, QChar('0')).toUpper(), QString("entry%1").arg(i)));
+    }
+    return result;
+}
+} // namespace
+
+void TestBootEntryModel::parseLine_entries()
+{
+    const auto active = BootEntryModel::parseLine("Boot000A* MX Linux\tHD(1,GPT,abc)/File(\\EFI\\MX\\grubx64.efi)");
+    QVERIFY(active);
+    QCOMPARE(active->bootNum, QString("000A"));
+    QVERIFY(active->active);
+    QCOMPARE(active->label(), QString("MX Linux"));
+    QCOMPARE(active->text(), QString("Boot000A* MX Linux\tHD(1,GPT,abc)/File(\\EFI\\MX\\grubx64.efi)"));
+
+    auto inactive = BootEntryModel::parseLine("Boot0003  UEFI PXEv4 (MAC:001122334455)");
+    QVERIFY(inactive);
+    QVERIFY(!inactive->active);
+    QCOMPARE(inactive->label(), QString("UEFI PXEv4 (MAC:001122334455)"));
+    inactive->active = true;
+    QCOMPARE(inactive->text(), QString("Boot0003* UEFI PXEv4 (MAC:001122334455)"));
+}
+
+void TestBootEntryModel::parseLine_otherLines()
+{
+    QVERIFY(!BootEntryModel::parseLine("BootCurrent: 0001"));
+    QVERIFY(!BootEntryModel::parseLine("BootOrder: 0001,0002"));
+    QVERIFY(!BootEntryModel::parseLine("Timeout: 1 seconds"));
+    QVERIFY(!BootEntryModel::parseLine("Boot00G1* Bad number"));
+    QVERIFY(!BootEntryModel::parseLine({}));
+}
+
+void TestBootEntryModel::sortByBootOrder_listedFirst()
+{
+    BootEntryModel model;
+    QAbstractItemModelTester tester(&model, QAbstractItemModelTester::FailureReportingMode::QtTest);
+    model.setEntries(entries(5));
+    const QPersistentModelIndex third = model.index(2);
+
+    // Unknown and repeated numbers are skipped; unlisted entries keep their order at the end
+    model.sortByBootOrder({"0004", "0002", "FFFF", "0004"});
+    QCOMPARE(model.bootOrder(), QStringList({"0004", "0002", "0001", "0003", "0005"}));
+    for (int row = 0; row < model.rowCount(); ++row) {
+        QCOMPARE(model.row(model.entries().at(row).bootNum), row);
+    }
+    QCOMPARE(third.row(), 3);
+    QCOMPARE(third.data(BootEntryModel::BootNumRole).toString(), QString("0003"));
+
+    model.sortByBootOrder({});
+    QCOMPARE(model.bootOrder().constFirst(), QString("0004"));
+}
+
+void TestBootEntryModel::sortByBootOrder_largeMenu()
+{
+    BootEntryModel model;
+    model.setEntries(entries(600));
+    QStringList reversed = model.bootOrder();
+    std::reverse(reversed.begin(), reversed.end());
+    model.sortByBootOrder(reversed);
+    QCOMPARE(model.bootOrder(), reversed);
+    QCOMPARE(model.row("0258"), 0);
+    QCOMPARE(model.row("0001"), 599);
+}
+
+void TestBootEntryModel::moveRows_reindexes()
+{
+    BootEntryModel model;
+    QAbstractItemModelTester tester(&model, QAbstractItemModelTester::FailureReportingMode::QtTest);
+    model.setEntries(entries(4));
+    QSignalSpy moved(&model, &QAbstractItemModel::rowsMoved);
+
+    // As a drop of the last row at the top
+    QVERIFY(model.moveRow({}, 3, {}, 0));
+    QCOMPARE(model.bootOrder(), QStringList({"0004", "0001", "0002", "0003"}));
+    // As the Move down button: the next row moves up
+    QVERIFY(model.moveRow({}, 2, {}, 1));
+    QCOMPARE(model.bootOrder(), QStringList({"0004", "0002", "0001", "0003"}));
+    // Downwards, destination counted before the move
+    QVERIFY(model.moveRow({}, 0, {}, 4));
+    QCOMPARE(model.bootOrder(), QStringList({"0002", "0001", "0003", "0004"}));
+    QCOMPARE(moved.count(), 3);
+    for (int row = 0; row < model.rowCount(); ++row) {
+        QCOMPARE(model.row(model.entries().at(row).bootNum), row);
+    }
+
+    QVERIFY(!model.moveRow({}, 0, {}, -1));
+    QVERIFY(!model.moveRow({}, 1, {}, 1));
+    QVERIFY(!model.moveRow({}, 4, {}, 0));
+    QCOMPARE(moved.count(), 3);
+}
+
+void TestBootEntryModel::patch_singleRows()
+{
+    BootEntryModel model;
+    QAbstractItemModelTester tester(&model, QAbstractItemModelTester::FailureReportingMode::QtTest);
+    model.setEntries(entries(3));
+    QSignalSpy changed(&model, &QAbstractItemModel::dataChanged);
+    QSignalSpy reset(&model, &QAbstractItemModel::modelReset);
+
+    QVERIFY(model.setActive("0002", false));
+    QCOMPARE(changed.count(), 1);
+    QCOMPARE(changed.constFirst().at(0).toModelIndex().row(), 1);
+    QVERIFY(model.index(1).data().toString().startsWith("Boot0002 "));
+    QVERIFY(model.index(1).data(Qt::BackgroundRole).isValid());
+    QVERIFY(model.setActive("0002", false));
+    QCOMPARE(changed.count(), 1);
+    QVERIFY(!model.setActive("0009", true));
+
+    QVERIFY(!model.updateEntry(entry("0003", "renamed")));
+    QCOMPARE(model.entries().at(2).label(), QString("renamed"));
+    QVERIFY(model.updateEntry(entry("0007", "new")));
+    QCOMPARE(model.row("0007"), 3);
+
+    model.insertEntry(0, entry("0008", "added"));
+    QCOMPARE(model.bootOrder(), QStringList({"0008", "0001", "0002", "0003", "0007"}));
+    QCOMPARE(model.row("0003"), 3);
+    model.insertEntry(0, entry("0003", "again"));
+    QCOMPARE(model.rowCount(), 5);
+    QCOMPARE(model.entries().at(3).label(), QString("again"));
+
+    QVERIFY(model.removeEntry("0001"));
+    QVERIFY(!model.removeEntry("0001"));
+    QCOMPARE(model.bootOrder(), QStringList({"0008", "0002", "0003", "0007"}));
+    QCOMPARE(model.row("0007"), 3);
+    QCOMPARE(model.row("0001"), -1);
+    QCOMPARE(reset.count(), 0);
+}
+
+void TestBootEntryModel::matches_numberLabelTarget()
+{
+    BootEntryModel model;
+    QList<BootEntryModel::Entry> list = entries(3);
+    list[1].target = "Target: HTTP boot from http://boot.example/menu.ipxe";
+    model.setEntries(list);
+    QVERIFY(model.matches(0, {}));
+    QVERIFY(model.matches(0, "ENTRY1"));
+    QVERIFY(model.matches(2, "0003"));
+    QVERIFY(model.matches(1, "example"));
+    QVERIFY(!model.matches(0, "example"));
+    // The device path is not searched
+    QVERIFY(!model.matches(0, "GPT"));
+    QVERIFY(!model.matches(5, {}));
+}
+
+QTEST_GUILESS_MAIN(TestBootEntryModel)
+#include "test_bootentrymodel.moc"
@@ -0,0 +1,257 @@
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QtEndian>
+#include "bootperf.h"
+#include "loadoption.h"
+
+using bootperf::FirmwareTimes;
+using bootperf::Sample;
+
+class TestBootPerf : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void fbptAddress_findsPointerRecord();
+    void fbptAddress_rejectsBadTable();
+    void missingFirmwareReason_judgesTable();
+    void parseSysfsFiles_readsKernelValues();
+    void readFirmwareTimes_fallsBackToRoot();
+    void parseLoaderTime_readsUcs2Number();
+    void measure_readsBootCurrentAndLoaderTimes();
+    void phases_prefersFirmwareTable();
+    void json_roundTrips();
+    void summarize_averagesPerEntry();
+};
+
+namespace
+{
+QByteArray performanceRecord(quint16 type, const QByteArray &body)
+{
+    QByteArray record(4, '\0');
+    qToLittleEndian(type, record.data());
+    record[2] = static_cast<char>(4 + body.size());
+    record[3] = 1;
+    return record + body;
+}
+
+QByteArray uint64s(const QList<quint64> &values)
+{
+    QByteArray bytes(values.size() * 8, '\0');
+    for (qsizetype i = 0; i < values.size(); ++i) {
+        qToLittleEndian(values.at(i), bytes.data() + i * 8);
+    }
+    return bytes;
+}
+
+// FPDT with an S3 pointer ahead of the boot pointer, checksum fixed up
+QByteArray fpdt(quint64 fbptAddress)
+{
+    QByteArray table(36, '\0');
+    table.replace(0, 4, "FPDT");
+    table[8] = 1;
+    table += performanceRecord(0x0001, QByteArray(4, '\0') + uint64s({0x7f6e4000}));
+    table += performanceRecord(0x0000, QByteArray(4, '\0') + uint64s({fbptAddress}));
+    qToLittleEndian<quint32>(table.size(), table.data() + 4);
+    quint8 sum = 0;
+    for (const char byte : std::as_const(table)) {
+        sum += static_cast<quint8>(byte);
+    }
+    table[9] = static_cast<char>(-sum);
+    return table;
+}
+
+QByteArray ucs2(const QString &text)
+{
+    QByteArray bytes((text.size() + 1) * 2, '\0');
+    for (qsizetype i = 0; i < text.size(); ++i) {
+        qToLittleEndian(text.at(i).unicode(), bytes.data() + i * 2);
+    }
+    return bytes;
+}
+
+void writeVariable(const QString &dir, const QString &name, const QString &guid, const QByteArray &data)
+{
+    QFile file(QString("%1/%2-%3").arg(dir, name, guid));
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(QByteArray::fromHex("07000000") + data);
+}
+
+Sample sample(const QString &bootId, const QString &bootCurrent, quint64 startImage, quint64 exitEntry)
+{
+    Sample result;
+    result.bootId = bootId;
+    result.bootCurrent = bootCurrent;
+    result.label = "Entry " + bootCurrent;
+    result.firmware = FirmwareTimes {1'000'000, startImage - 10'000, startImage, exitEntry, exitEntry + 5'000};
+    return result;
+}
+} // namespace
+
+void TestBootPerf::fbptAddress_findsPointerRecord()
+{
+    QString error;
+    const auto address = bootperf::fbptAddress(fpdt(0x7f6e5000), &error);
+    QVERIFY2(address, qPrintable(error));
+    QCOMPARE(*address, quint64(0x7f6e5000));
+}
+
+void TestBootPerf::fbptAddress_rejectsBadTable()
+{
+    QString error;
+    QVERIFY(!bootperf::fbptAddress("FACP", &error));
+    QVERIFY(!error.isEmpty());
+
+    QByteArray corrupted = fpdt(0x7f6e5000);
+    corrupted[60] = static_cast<char>(corrupted.at(60) ^ 0x01);
+    QVERIFY(!bootperf::fbptAddress(corrupted));
+}
+
+void TestBootPerf::missingFirmwareReason_judgesTable()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString table = dir.filePath("FPDT");
+    QCOMPARE(bootperf::missingFirmwareReason(table), QString("The firmware doesn't publish an ACPI FPDT table."));
+
+    QFile file(table);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(fpdt(0x7f6e5000));
+    file.close();
+    QVERIFY(bootperf::missingFirmwareReason(table).contains("Linux 5.12"));
+
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write("FACP");
+    file.close();
+    QCOMPARE(bootperf::missingFirmwareReason(table), QString("Not an ACPI FPDT table."));
+}
+
+void TestBootPerf::parseSysfsFiles_readsKernelValues()
+{
+    const QMap<QString, QByteArray> files {{"/sys/firmware/acpi/fpdt/boot/exitbootservice_end", "3400900000\n"},
+                                           {"/sys/firmware/acpi/fpdt/boot/exitbootservice_start", "3400000000\n"},
+                                           {"/sys/firmware/acpi/fpdt/boot/load_image_start", "2100000000\n"},
+                                           {"/sys/firmware/acpi/fpdt/boot/reset_end", "1500000\n"},
+                                           {"start_image_start", "2200000000\n"}};
+    const auto times = bootperf::parseSysfsFiles(files);
+    QVERIFY(times);
+    QCOMPARE(*times, (FirmwareTimes {1'500'000, 2'100'000'000, 2'200'000'000, 3'400'000'000, 3'400'900'000}));
+
+    QMap<QString, QByteArray> partial = files;
+    partial.remove("start_image_start");
+    QVERIFY(!bootperf::parseSysfsFiles(partial));
+}
+
+void TestBootPerf::readFirmwareTimes_fallsBackToRoot()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QMap<QString, QByteArray> values {{"exitbootservice_end", "3400900000\n"},
+                                            {"exitbootservice_start", "3400000000\n"},
+                                            {"load_image_start", "2100000000\n"},
+                                            {"reset_end", "1500000\n"},
+                                            {"start_image_start", "2200000000\n"}};
+    // Empty, unreadable files stand in for the root-only ones of the kernel
+    for (auto it = values.cbegin(); it != values.cend(); ++it) {
+        QFile file(dir.filePath(it.key()));
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.close();
+        QVERIFY(file.setPermissions(QFileDevice::Permissions()));
+    }
+    QStringList requested;
+    const auto readAsRoot = [&](const QStringList &paths) {
+        requested = paths;
+        QMap<QString, QByteArray> files;
+        for (const QString &path : paths) {
+            files.insert(path, values.value(path.section('/', -1)));
+        }
+        return files;
+    };
+    const auto times = bootperf::readFirmwareTimes(readAsRoot, dir.path());
+    QVERIFY(times);
+    QCOMPARE(times->startImageStart, quint64(2'200'000'000));
+    QCOMPARE(requested.size(), values.size());
+
+    requested.clear();
+    QVERIFY(!bootperf::readFirmwareTimes(readAsRoot, dir.filePath("missing")));
+    QVERIFY(requested.isEmpty());
+}
+
+void TestBootPerf::parseLoaderTime_readsUcs2Number()
+{
+    QCOMPARE(bootperf::parseLoaderTime(ucs2("1834212")), std::optional<quint64>(1834212));
+    QVERIFY(!bootperf::parseLoaderTime({}));
+    QVERIFY(!bootperf::parseLoaderTime(ucs2("soon")));
+}
+
+void TestBootPerf::measure_readsBootCurrentAndLoaderTimes()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    loadoption::LoadOption option;
+    option.description = "MX Linux (stub)";
+    option.filePathList = QByteArray::fromHex("7fff0400");
+    writeVariable(dir.path(), "BootCurrent", EFI_GLOBAL_GUID, QByteArray::fromHex("0a00"));
+    writeVariable(dir.path(), "Boot000A", EFI_GLOBAL_GUID, loadoption::encode(option));
+    writeVariable(dir.path(), "LoaderTimeInitUSec", bootperf::LOADER_GUID, ucs2("1200000"));
+    writeVariable(dir.path(), "LoaderTimeExecUSec", bootperf::LOADER_GUID, ucs2("1750000"));
+
+    const Sample measured = bootperf::measure(std::nullopt, dir.path());
+    QCOMPARE(measured.bootCurrent, QString("000A"));
+    QCOMPARE(measured.label, QString("MX Linux (stub)"));
+    QVERIFY(!measured.firmware);
+    QCOMPARE(measured.loaderInitUsec, std::optional<quint64>(1200000));
+
+    // Without the FPDT the loader variables give the split
+    const bootperf::Phases split = bootperf::phases(measured);
+    QCOMPARE(split.firmwareUsec, std::optional<quint64>(1200000));
+    QCOMPARE(split.loaderUsec, std::optional<quint64>(550000));
+}
+
+void TestBootPerf::phases_prefersFirmwareTable()
+{
+    Sample withBoth = sample("a", "0001", 2'000'000'000, 2'600'000'000);
+    withBoth.loaderInitUsec = 900'000;
+    const bootperf::Phases split = bootperf::phases(withBoth);
+    QCOMPARE(split.firmwareUsec, std::optional<quint64>(1'999'000));
+    QCOMPARE(split.loaderUsec, std::optional<quint64>(600'000));
+}
+
+void TestBootPerf::json_roundTrips()
+{
+    Sample original = sample("4b1c", "0003", 2'000'000'000, 2'600'000'000);
+    original.time = QDateTime::fromString("2026-03-01T08:30:00Z", Qt::ISODate);
+    original.loaderExecUsec = 2'500'000;
+
+    const QJsonObject json = bootperf::toJson(original);
+    QCOMPARE(json.value("firmwareUSec").toInteger(), qint64(1'999'000));
+    const auto parsed = bootperf::fromJson(json);
+    QVERIFY(parsed);
+    QCOMPARE(parsed->bootId, original.bootId);
+    QCOMPARE(parsed->time, original.time);
+    QCOMPARE(parsed->label, original.label);
+    QCOMPARE(parsed->firmware, original.firmware);
+    QVERIFY(!parsed->loaderInitUsec);
+    QCOMPARE(parsed->loaderExecUsec, original.loaderExecUsec);
+
+    QVERIFY(!bootperf::fromJson(QJsonObject {{"bootCurrent", "0003"}}));
+}
+
+void TestBootPerf::summarize_averagesPerEntry()
+{
+    const QList<bootperf::EntrySummary> summaries
+        = bootperf::summarize({sample("a", "0002", 3'001'000'000, 3'500'000'000),
+                               sample("b", "0001", 1'001'000'000, 1'100'000'000),
+                               sample("c", "0002", 4'001'000'000, 4'700'000'000)});
+    QCOMPARE(summaries.size(), 2);
+    QCOMPARE(summaries.at(0).bootCurrent, QString("0002"));
+    QCOMPARE(summaries.at(0).boots, 2);
+    QCOMPARE(summaries.at(0).firmwareMsec, std::optional<double>(3500.0));
+    QCOMPARE(summaries.at(0).loaderMsec, std::optional<double>(599.0));
+    QCOMPARE(summaries.at(1).boots, 1);
+    QCOMPARE(summaries.at(1).loaderMsec, std::optional<double>(99.0));
+}
+
+QTEST_MAIN(TestBootPerf)
+#include "test_bootperf.moc"
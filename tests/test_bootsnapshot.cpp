@@ -0,0 +1,190 @@
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QtEndian>
+#include "bootsnapshot.h"
+
+using bootsnapshot::Change;
+using bootsnapshot::Snapshot;
+using bootsnapshot::Variable;
+
+class TestBootSnapshot : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void capture_readsManagedVariables();
+    void version_matchesEfivarfsContents();
+
+    void serialize_roundTrip();
+    void deserialize_rejectsCorruption();
+    void deserialize_rejectsTruncation();
+    void deserialize_rejectsForeignFile();
+
+    void diff_identical();
+    void diff_onlyChangedVariables();
+    void diff_order();
+    void versioned_expectsBaseVersions();
+
+    void helperOperations();
+};
+
+namespace
+{
+const QByteArray BOOT1 = QByteArray::fromHex("0100000024004d00580000000400");
+const QByteArray BOOT2 = QByteArray::fromHex("0100000024004400650062000000");
+
+Snapshot sample()
+{
+    return Snapshot {{{"Boot0001", 7, BOOT1},
+                      {"Boot0002", 7, BOOT2},
+                      {"BootOrder", 7, QByteArray::fromHex("01000200")},
+                      {"Timeout", 7, QByteArray::fromHex("0500")}}};
+}
+
+void writeVariable(const QString &dir, const QString &fileName, quint32 attributes, const QByteArray &data)
+{
+    QFile file(dir + '/' + fileName);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    QByteArray contents(4, '\0');
+    qToLittleEndian(attributes, contents.data());
+    file.write(contents + data);
+}
+} // namespace
+
+void TestBootSnapshot::capture_readsManagedVariables()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString guid = "-" + QString(EFI_GLOBAL_GUID);
+    writeVariable(dir.path(), "Boot0002" + guid, 7, BOOT2);
+    writeVariable(dir.path(), "Boot0001" + guid, 7, BOOT1);
+    writeVariable(dir.path(), "BootOrder" + guid, 7, QByteArray::fromHex("01000200"));
+    writeVariable(dir.path(), "Timeout" + guid, 7, QByteArray::fromHex("0500"));
+    writeVariable(dir.path(), "BootCurrent" + guid, 6, QByteArray::fromHex("0100"));
+    writeVariable(dir.path(), "Boot0003-00000000-0000-0000-0000-000000000000", 7, BOOT1);
+
+    const Snapshot snapshot = bootsnapshot::capture(dir.path());
+    QCOMPARE(snapshot.variables.size(), 4);
+    QCOMPARE(snapshot.variables.at(0).name, QString("Boot0001"));
+    QCOMPARE(snapshot.variables.at(0).attributes, quint32(7));
+    QCOMPARE(snapshot.variables.at(0).data, BOOT1);
+    QVERIFY(snapshot.find("Timeout"));
+    QVERIFY(!snapshot.find("BootCurrent"));
+}
+
+void TestBootSnapshot::version_matchesEfivarfsContents()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString fileName = "BootNext-" + QString(EFI_GLOBAL_GUID);
+    writeVariable(dir.path(), fileName, 7, QByteArray::fromHex("0200"));
+
+    QFile file(dir.filePath(fileName));
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QString expected
+        = QString::fromLatin1(QCryptographicHash::hash(file.readAll(), QCryptographicHash::Sha256).toHex());
+    const Snapshot snapshot = bootsnapshot::captureWithBootNext(dir.path());
+    QCOMPARE(bootsnapshot::version(snapshot.find("BootNext")), expected);
+    QVERIFY(bootsnapshot::version(snapshot.find("BootOrder")).isEmpty());
+}
+
+void TestBootSnapshot::serialize_roundTrip()
+{
+    Snapshot restored;
+    QString error;
+    QVERIFY(bootsnapshot::deserialize(bootsnapshot::serialize(sample()), &restored, &error));
+    QVERIFY(error.isEmpty());
+    QVERIFY(restored.variables == sample().variables);
+}
+
+void TestBootSnapshot::deserialize_rejectsCorruption()
+{
+    QByteArray bytes = bootsnapshot::serialize(sample());
+    bytes[20] = static_cast<char>(bytes.at(20) ^ 0x01);
+    Snapshot restored;
+    QString error;
+    QVERIFY(!bootsnapshot::deserialize(bytes, &restored, &error));
+    QVERIFY(error.contains("checksum"));
+    QVERIFY(restored.variables.isEmpty());
+}
+
+void TestBootSnapshot::deserialize_rejectsTruncation()
+{
+    Snapshot restored;
+    QVERIFY(!bootsnapshot::deserialize(bootsnapshot::serialize(sample()).first(40), &restored));
+    QVERIFY(!bootsnapshot::deserialize({}, &restored));
+}
+
+void TestBootSnapshot::deserialize_rejectsForeignFile()
+{
+    Snapshot restored;
+    QVERIFY(!bootsnapshot::deserialize(QByteArray(128, 'x'), &restored));
+}
+
+void TestBootSnapshot::diff_identical()
+{
+    QVERIFY(bootsnapshot::diff(sample(), sample()).isEmpty());
+}
+
+void TestBootSnapshot::diff_onlyChangedVariables()
+{
+    Snapshot current = sample();
+    current.variables[1].data = BOOT1;                // Boot0002 changed
+    current.variables[3].attributes = 3;              // Timeout attributes changed
+    current.variables.append({"Boot0007", 7, BOOT1}); // added after the snapshot
+    const QList<Change> changes = bootsnapshot::diff(current, sample());
+    QCOMPARE(changes.size(), 3);
+    QCOMPARE(changes.at(0).variable.name, QString("Boot0002"));
+    QVERIFY(changes.at(0).kind == Change::Kind::Write);
+    QCOMPARE(changes.at(0).variable.data, BOOT2);
+    QCOMPARE(changes.at(1).variable.name, QString("Timeout"));
+    QVERIFY(changes.at(1).kind == Change::Kind::Write);
+    QCOMPARE(changes.at(2).variable.name, QString("Boot0007"));
+    QVERIFY(changes.at(2).kind == Change::Kind::Delete);
+}
+
+void TestBootSnapshot::diff_order()
+{
+    // Entries must exist before BootOrder references them
+    const QList<Change> changes = bootsnapshot::diff(Snapshot {}, sample());
+    QCOMPARE(changes.size(), 4);
+    QCOMPARE(changes.at(0).variable.name, QString("Boot0001"));
+    QCOMPARE(changes.at(1).variable.name, QString("Boot0002"));
+    QCOMPARE(changes.at(2).variable.name, QString("BootOrder"));
+    QCOMPARE(changes.at(3).variable.name, QString("Timeout"));
+}
+
+void TestBootSnapshot::versioned_expectsBaseVersions()
+{
+    const Snapshot base = sample();
+    Snapshot target = base;
+    target.variables[0].data = BOOT2;
+    target.variables.append({"Boot0003", 7, BOOT1});
+    const QList<Change> changes = bootsnapshot::versioned(bootsnapshot::diff(base, target), base);
+    QCOMPARE(changes.size(), 2);
+    QCOMPARE(changes.at(0).expectedVersion.value_or("unset"), bootsnapshot::version(base.find("Boot0001")));
+    // A variable the base doesn't have must still be missing when it is written
+    QCOMPARE(changes.at(1).expectedVersion.value_or("unset"), QString());
+}
+
+void TestBootSnapshot::helperOperations()
+{
+    const QList<Change> changes {{Change::Kind::Write, {"Boot0001", 7, BOOT1}},
+                                 {Change::Kind::Delete, {"Boot0003", 0, {}}, QString()}};
+    const QJsonArray operations = bootsnapshot::toHelperOperations(changes);
+    QCOMPARE(operations.size(), 2);
+    const QJsonObject write = operations.at(0).toObject();
+    QCOMPARE(write.value("op").toString(), QString("write"));
+    QCOMPARE(write.value("attributes").toInteger(), qint64(7));
+    QCOMPARE(QByteArray::fromBase64(write.value("data").toString().toLatin1()), BOOT1);
+    QVERIFY(!write.contains("expect"));
+    QCOMPARE(operations.at(1).toObject(), QJsonObject({{"op", "delete"}, {"name", "Boot0003"}, {"expect", ""}}));
+}
+
+QTEST_MAIN(TestBootSnapshot)
+#include "test_bootsnapshot.moc"
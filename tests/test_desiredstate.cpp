@@ -0,0 +1,306 @@
+#include <QDebug>
+#include <QTest>
+#include "desiredstate.h"
+#include "loadoption.h"
+
+using bootsnapshot::Snapshot;
+
+class TestDesiredState : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void parse_valid();
+    void parse_invalid();
+
+    void plan_createsMissingEntries();
+    void plan_isIdempotent();
+    void plan_updatesInPlace();
+    void plan_keepsOptionalData();
+    void plan_reordersOnly();
+    void plan_prune();
+    void plan_unknownPartition();
+
+    void editEntry_textOptions();
+    void editEntry_asciiOptionalData();
+    void editEntry_binaryOptionalData();
+    void editEntry_emptyDescription();
+};
+
+namespace
+{
+const QString ESP = "2f2c1b8e-5f6a-4b2c-9d3e-0123456789ab";
+
+std::optional<desiredstate::PartitionInfo> lookup(const QString &partuuid)
+{
+    if (partuuid != ESP) {
+        return std::nullopt;
+    }
+    return desiredstate::PartitionInfo {1, 0x800, 0x100000};
+}
+
+QByteArray diskEntry(const QString &label, const QString &loader, const QString &options = {})
+{
+    loadoption::LoadOption option;
+    option.description = label;
+    option.filePathList = loadoption::hardDriveFilePath({1, 0x800, 0x100000, ESP, loader});
+    option.optionalData = loadoption::optionalDataFromString(options);
+    return loadoption::encode(option);
+}
+
+// Firmware entry without a disk path, e.g. the UEFI shell
+QByteArray firmwareEntry(const QString &label)
+{
+    loadoption::LoadOption option;
+    option.description = label;
+    option.filePathList = QByteArray::fromHex("7fff0400");
+    return loadoption::encode(option);
+}
+
+Snapshot machine()
+{
+    return Snapshot {{{"Boot0000", 7, firmwareEntry("UEFI Shell")},
+                      {"Boot0001", 7, diskEntry("MX Linux", "\\EFI\\MX\\grubx64.efi")},
+                      {"Boot0003", 7, diskEntry("Old kernel", "\\EFI\\old\\vmlinuz")},
+                      {"BootOrder", 7, QByteArray::fromHex("010003000000")},
+                      {"Timeout", 7, QByteArray::fromHex("0500")}}};
+}
+
+desiredstate::State parseState(const QByteArray &json)
+{
+    desiredstate::State state;
+    QString error;
+    if (!desiredstate::parse(json, &state, &error)) {
+        qWarning() << error;
+    }
+    return state;
+}
+
+Snapshot planned(const Snapshot &current, const desiredstate::State &state)
+{
+    Snapshot target;
+    QString error;
+    if (!desiredstate::plan(current, state, lookup, &target, &error)) {
+        qWarning() << error;
+    }
+    return target;
+}
+} // namespace
+
+void TestDesiredState::parse_valid()
+{
+    desiredstate::State state;
+    QVERIFY(desiredstate::parse(R"({"timeout": 3, "prune": true, "entries": [
+        {"label": "MX Linux", "loader": "EFI/MX/grubx64.efi", "partuuid": "2F2C1B8E-5F6A-4B2C-9D3E-0123456789AB"},
+        {"label": "Stub", "loader": "\\EFI\\MX\\stub\\vmlinuz", "partuuid": "2f2c1b8e-5f6a-4b2c-9d3e-0123456789ab",
+         "options": "ro quiet", "active": false}]})",
+                                &state));
+    QCOMPARE(state.timeout.value_or(-1), 3);
+    QVERIFY(state.prune);
+    QCOMPARE(state.entries.size(), 2);
+    QCOMPARE(state.entries.at(0).loader, QString("\\EFI\\MX\\grubx64.efi"));
+    QCOMPARE(state.entries.at(0).partuuid, ESP);
+    QVERIFY(state.entries.at(0).active);
+    QVERIFY(!state.entries.at(0).options);
+    QCOMPARE(state.entries.at(1).options.value_or(QString()), QString("ro quiet"));
+    QVERIFY(!state.entries.at(1).active);
+}
+
+void TestDesiredState::parse_invalid()
+{
+    desiredstate::State state;
+    QString error;
+    QVERIFY(!desiredstate::parse("[]", &state, &error));
+    QVERIFY(!desiredstate::parse(R"({"entries": [{"label": "MX", "partuuid": "x"}]})", &state, &error));
+    QVERIFY(!desiredstate::parse(R"({"entries": [{"label": "MX", "loader": "\\a.efi", "partuuid": "x"}]})", &state,
+                                 &error));
+    QVERIFY(error.contains("PARTUUID"));
+    QVERIFY(!desiredstate::parse(R"({"timeout": 70000})", &state, &error));
+}
+
+void TestDesiredState::plan_createsMissingEntries()
+{
+    const auto state = parseState(R"({"entries": [
+        {"label": "Stub", "loader": "\\EFI\\MX\\stub\\vmlinuz", "partuuid": "2f2c1b8e-5f6a-4b2c-9d3e-0123456789ab",
+         "options": "ro quiet"},
+        {"label": "MX Linux", "loader": "\\EFI\\MX\\grubx64.efi", "partuuid": "2f2c1b8e-5f6a-4b2c-9d3e-0123456789ab"}]})");
+    const Snapshot target = planned(machine(), state);
+    const QList<bootsnapshot::Change> changes = bootsnapshot::diff(machine(), target);
+
+    // Boot0002 is the lowest free number; the listed entries come first in BootOrder
+    QCOMPARE(changes.size(), 2);
+    QCOMPARE(changes.at(0).variable.name, QString("Boot0002"));
+    QCOMPARE(changes.at(1).variable.name, QString("BootOrder"));
+    QCOMPARE(changes.at(1).variable.data, QByteArray::fromHex("0200010003000000"));
+    const auto created = loadoption::decode(changes.at(0).variable.data);
+    QVERIFY(created.has_value());
+    QCOMPARE(created->description, QString("Stub"));
+    QCOMPARE(loadoption::optionalDataToString(created->optionalData), QString("ro quiet"));
+}
+
+void TestDesiredState::plan_isIdempotent()
+{
+    const auto state = parseState(R"({"timeout": 2, "entries": [
+        {"label": "Stub", "loader": "\\EFI\\MX\\stub\\vmlinuz", "partuuid": "2f2c1b8e-5f6a-4b2c-9d3e-0123456789ab"},
+        {"label": "MX Linux", "loader": "\\EFI\\MX\\grubx64.efi", "partuuid": "2f2c1b8e-5f6a-4b2c-9d3e-0123456789ab"}]})");
+    const Snapshot first = planned(machine(), state);
+    QVERIFY(!bootsnapshot::diff(machine(), first).isEmpty());
+    QVERIFY(bootsnapshot::diff(first, planned(first, state)).isEmpty());
+}
+
+void TestDesiredState::plan_updatesInPlace()
+{
+    const auto state = parseState(R"({"entries": [
+        {"label": "MX Linux 25", "loader": "\\efi\\mx\\GRUBX64.EFI", "partuuid": "2f2c1b8e-5f6a-4b2c-9d3e-0123456789ab",
+         "active": false}]})");
+    const QList<bootsnapshot::Change> changes = bootsnapshot::diff(machine(), planned(machine(), state));
+    QCOMPARE(changes.size(), 1);
+    QCOMPARE(changes.at(0).variable.name, QString("Boot0001"));
+    const auto updated = loadoption::decode(changes.at(0).variable.data);
+    QVERIFY(updated.has_value());
+    QCOMPARE(updated->description, QString("MX Linux 25"));
+    QVERIFY(!updated->isActive());
+    QCOMPARE(updated->filePathList, loadoption::decode(machine().find("Boot0001")->data)->filePathList);
+}
+
+void TestDesiredState::plan_keepsOptionalData()
+{
+    // Windows Boot Manager keeps a binary BCD reference in its optional data
+    const QByteArray bcd = QByteArray::fromHex("57494e444f5753000100000088000000780000004200430044004f00");
+    loadoption::LoadOption windows;
+    windows.description = "Windows Boot Manager";
+    windows.filePathList
+        = loadoption::hardDriveFilePath({1, 0x800, 0x100000, ESP, "\\EFI\\Microsoft\\Boot\\bootmgfw.efi"});
+    windows.optionalData = bcd;
+    Snapshot current = machine();
+    current.variables.insert(3, {"Boot0004", 7, loadoption::encode(windows)});
+    current.variables.replace(1, {"Boot0001", 7, diskEntry("MX Linux", "\\EFI\\MX\\grubx64.efi", "ro quiet")});
+
+    const auto relabel = parseState(R"({"entries": [
+        {"label": "Windows", "loader": "\\EFI\\Microsoft\\Boot\\bootmgfw.efi",
+         "partuuid": "2f2c1b8e-5f6a-4b2c-9d3e-0123456789ab", "options": "ignored for binary data"},
+        {"label": "MX", "loader": "\\EFI\\MX\\grubx64.efi", "partuuid": "2f2c1b8e-5f6a-4b2c-9d3e-0123456789ab"}]})");
+    const Snapshot target = planned(current, relabel);
+    const auto relabelled = loadoption::decode(target.find("Boot0004")->data);
+    QVERIFY(relabelled.has_value());
+    QCOMPARE(relabelled->description, QString("Windows"));
+    QCOMPARE(relabelled->optionalData, bcd);
+    const auto mx = loadoption::decode(target.find("Boot0001")->data);
+    QVERIFY(mx.has_value());
+    QCOMPARE(mx->description, QString("MX"));
+    QCOMPARE(loadoption::optionalDataToString(mx->optionalData), QString("ro quiet"));
+    QVERIFY(bootsnapshot::diff(target, planned(target, relabel)).isEmpty());
+
+    // Options given for a text entry still replace its command line, and an empty string clears it
+    const auto clear = parseState(R"({"entries": [
+        {"label": "MX", "loader": "\\EFI\\MX\\grubx64.efi", "partuuid": "2f2c1b8e-5f6a-4b2c-9d3e-0123456789ab",
+         "options": ""}]})");
+    QVERIFY(loadoption::decode(planned(target, clear).find("Boot0001")->data)->optionalData.isEmpty());
+}
+
+void TestDesiredState::plan_reordersOnly()
+{
+    const auto state = parseState(R"({"entries": [
+        {"label": "Old kernel", "loader": "\\EFI\\old\\vmlinuz", "partuuid": "2f2c1b8e-5f6a-4b2c-9d3e-0123456789ab"}]})");
+    const QList<bootsnapshot::Change> changes = bootsnapshot::diff(machine(), planned(machine(), state));
+    QCOMPARE(changes.size(), 1);
+    QCOMPARE(changes.at(0).variable.name, QString("BootOrder"));
+    QCOMPARE(changes.at(0).variable.data, QByteArray::fromHex("030001000000"));
+}
+
+void TestDesiredState::plan_prune()
+{
+    const auto state = parseState(R"({"prune": true, "entries": [
+        {"label": "MX Linux", "loader": "\\EFI\\MX\\grubx64.efi", "partuuid": "2f2c1b8e-5f6a-4b2c-9d3e-0123456789ab"}]})");
+    const QList<bootsnapshot::Change> changes = bootsnapshot::diff(machine(), planned(machine(), state));
+    // The firmware shell has no disk path and stays
+    QCOMPARE(changes.size(), 2);
+    QCOMPARE(changes.at(0).variable.name, QString("BootOrder"));
+    QCOMPARE(changes.at(0).variable.data, QByteArray::fromHex("01000000"));
+    QCOMPARE(changes.at(1).variable.name, QString("Boot0003"));
+    QVERIFY(changes.at(1).kind == bootsnapshot::Change::Kind::Delete);
+}
+
+void TestDesiredState::plan_unknownPartition()
+{
+    const auto state = parseState(R"({"entries": [
+        {"label": "Other", "loader": "\\EFI\\x.efi", "partuuid": "00000000-0000-0000-0000-000000000001"}]})");
+    Snapshot target;
+    QString error;
+    QVERIFY(!desiredstate::plan(machine(), state, lookup, &target, &error));
+    QVERIFY(error.contains("00000000-0000-0000-0000-000000000001"));
+}
+
+void TestDesiredState::editEntry_textOptions()
+{
+    const bootsnapshot::Variable var {"Boot0001", 7, diskEntry("MX Linux", "\\EFI\\MX\\vmlinuz", "ro quiet")};
+    QString error;
+    const auto change = desiredstate::editEntry(var, " MX Linux 25 ", " ro quiet splash ", &error);
+    QVERIFY(change.has_value());
+    QVERIFY(change->kind == bootsnapshot::Change::Kind::Write);
+    QCOMPARE(change->variable.name, QString("Boot0001"));
+    QCOMPARE(change->variable.attributes, quint32(7));
+    QCOMPARE(change->expectedVersion.value_or(QString()), bootsnapshot::version(&var));
+    const auto edited = loadoption::decode(change->variable.data);
+    QVERIFY(edited.has_value());
+    QCOMPARE(edited->description, QString("MX Linux 25"));
+    // Written back as UCS-2, like efibootmgr --unicode
+    QCOMPARE(edited->optionalData, QByteArray("r\0o\0 \0q\0u\0i\0e\0t\0 \0s\0p\0l\0a\0s\0h\0", 30));
+    QCOMPARE(edited->filePathList, loadoption::decode(var.data)->filePathList);
+
+    // Saving what is already there writes nothing
+    QVERIFY(!desiredstate::editEntry(var, "MX Linux", "ro quiet", &error));
+    QVERIFY(error.isEmpty());
+}
+
+void TestDesiredState::editEntry_asciiOptionalData()
+{
+    // efibootmgr without --unicode writes the command line as ASCII, here with a trailing NUL
+    loadoption::LoadOption mx;
+    mx.description = "MX Linux";
+    mx.filePathList = loadoption::hardDriveFilePath({1, 0x800, 0x100000, ESP, "\\EFI\\MX\\vmlinuz"});
+    mx.optionalData = QByteArray("ro quiet\0", 9);
+    const bootsnapshot::Variable var {"Boot0003", 7, loadoption::encode(mx)};
+
+    const auto change = desiredstate::editEntry(var, "MX Linux 25", "ro quiet");
+    QVERIFY(change.has_value());
+    const auto edited = loadoption::decode(change->variable.data);
+    QVERIFY(edited.has_value());
+    QCOMPARE(edited->description, QString("MX Linux 25"));
+    QCOMPARE(edited->optionalData, mx.optionalData);
+
+    QString error;
+    QVERIFY(!desiredstate::editEntry(var, "MX Linux", " ro quiet ", &error));
+    QVERIFY(error.isEmpty());
+}
+
+void TestDesiredState::editEntry_binaryOptionalData()
+{
+    loadoption::LoadOption windows;
+    windows.description = "Windows Boot Manager";
+    windows.filePathList = loadoption::hardDriveFilePath({1, 0x800, 0x100000, ESP, "\\EFI\\Microsoft\\x.efi"});
+    windows.optionalData = QByteArray::fromHex("57494e444f5753000100000088000000");
+    const bootsnapshot::Variable var {"Boot0002", 7, loadoption::encode(windows)};
+
+    const auto change = desiredstate::editEntry(var, "Windows", "ignored");
+    QVERIFY(change.has_value());
+    const auto edited = loadoption::decode(change->variable.data);
+    QVERIFY(edited.has_value());
+    QCOMPARE(edited->description, QString("Windows"));
+    QCOMPARE(edited->optionalData, windows.optionalData);
+}
+
+void TestDesiredState::editEntry_emptyDescription()
+{
+    const bootsnapshot::Variable var {"Boot0001", 7, diskEntry("MX Linux", "\\EFI\\MX\\grubx64.efi")};
+    QString error;
+    QVERIFY(!desiredstate::editEntry(var, "  ", "quiet", &error));
+    QVERIFY(!error.isEmpty());
+
+    error.clear();
+    QVERIFY(!desiredstate::editEntry({"Boot0001", 7, QByteArray("\x01", 1)}, "MX", {}, &error));
+    QVERIFY(error.contains("Boot0001"));
+}
+
+QTEST_MAIN(TestDesiredState)
+#include "test_desiredstate.moc"
@@ -0,0 +1,125 @@
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QTest>
+#include "devicepath.h"
+
+class TestDevicePath : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void parse_hardDriveFile();
+    void parse_bareFilePath();
+    void parse_nvmeBus();
+    void parse_network();
+    void parse_httpUri();
+    void parse_vendor();
+    void parse_trailingOptionalData();
+    void parse_empty();
+
+    void entryLine_tabSeparated();
+    void entryLine_spaceSeparated();
+    void entryLine_noPath();
+
+    void partuuidIndex_lookup();
+};
+
+void TestDevicePath::parse_hardDriveFile()
+{
+    const auto path = devicepath::parse(
+        u"HD(1,GPT,2F2C1B8E-5F6A-4B2C-9D3E-0123456789AB,0x800,0x100000)/File(\\EFI\\MX\\grubx64.efi)");
+    QVERIFY(path.hardDrive.has_value());
+    QCOMPARE(path.hardDrive->partition, 1);
+    QCOMPARE(path.hardDrive->scheme, QString("GPT"));
+    QCOMPARE(path.hardDrive->signature, QString("2f2c1b8e-5f6a-4b2c-9d3e-0123456789ab"));
+    QCOMPARE(path.hardDrive->start, quint64(0x800));
+    QCOMPARE(path.hardDrive->size, quint64(0x100000));
+    QCOMPARE(path.file, QString("\\EFI\\MX\\grubx64.efi"));
+    QCOMPARE(path.nodes.size(), 2);
+}
+
+void TestDevicePath::parse_bareFilePath()
+{
+    const auto path = devicepath::parse(u"HD(2,MBR,0x1234abcd,0x800,0x2000)/\\EFI\\debian\\shimx64.efi");
+    QVERIFY(path.hardDrive.has_value());
+    QCOMPARE(path.hardDrive->scheme, QString("MBR"));
+    QCOMPARE(path.hardDrive->signature, QString("0x1234abcd"));
+    QCOMPARE(path.file, QString("\\EFI\\debian\\shimx64.efi"));
+}
+
+void TestDevicePath::parse_nvmeBus()
+{
+    const auto path = devicepath::parse(u"PciRoot(0x0)/Pci(0x1d,0x0)/NVMe(0x1,00-00-00-00-00-00-00-00)");
+    QVERIFY(!path.hardDrive.has_value());
+    QCOMPARE(path.bus, QString("NVMe"));
+    QVERIFY(path.nodes.at(1).type == devicepath::NodeType::Pci);
+    QCOMPARE(path.nodes.at(1).args, QStringList({"0x1d", "0x0"}));
+}
+
+void TestDevicePath::parse_network()
+{
+    const auto path = devicepath::parse(u"PciRoot(0x0)/Pci(0x3,0x0)/MAC(525400123456,0x1)/IPv4(0.0.0.0:0<->0.0.0.0:0,0,0)");
+    QVERIFY(path.isNetwork());
+    QCOMPARE(path.macAddress, QString("52:54:00:12:34:56"));
+    QVERIFY(path.nodes.last().type == devicepath::NodeType::IPv4);
+}
+
+void TestDevicePath::parse_httpUri()
+{
+    const auto path = devicepath::parse(u"MAC(525400123456,0x1)/IPv4(0.0.0.0:0<->0.0.0.0:0,0,0)/Uri(http://boot.example/a,b.efi)");
+    QCOMPARE(path.uri, QString("http://boot.example/a,b.efi"));
+    QCOMPARE(path.nodes.size(), 3);
+}
+
+void TestDevicePath::parse_vendor()
+{
+    const auto path = devicepath::parse(u"VenHw(99E275E7-75A0-4B37-A2E6-C5385E6C00CB)");
+    QCOMPARE(path.vendor, QString("99e275e7-75a0-4b37-a2e6-c5385e6c00cb"));
+    QVERIFY(path.nodes.constFirst().type == devicepath::NodeType::Vendor);
+}
+
+void TestDevicePath::parse_trailingOptionalData()
+{
+    const auto path = devicepath::parse(u"HD(1,GPT,abcd,0x800,0x1000)/File(\\EFI\\Microsoft\\Boot\\bootmgfw.efi)WINDOWS(x)");
+    QCOMPARE(path.file, QString("\\EFI\\Microsoft\\Boot\\bootmgfw.efi"));
+}
+
+void TestDevicePath::parse_empty()
+{
+    QVERIFY(devicepath::parse(u"").isEmpty());
+    QVERIFY(devicepath::parse(u"   ").isEmpty());
+}
+
+void TestDevicePath::entryLine_tabSeparated()
+{
+    QCOMPARE(devicepath::pathFromEntryLine("Boot0001* MX Linux\tHD(1,GPT,abcd,0x800,0x1000)/File(\\EFI\\MX\\grubx64.efi)"),
+             QString("HD(1,GPT,abcd,0x800,0x1000)/File(\\EFI\\MX\\grubx64.efi)"));
+}
+
+void TestDevicePath::entryLine_spaceSeparated()
+{
+    QCOMPARE(devicepath::pathFromEntryLine("Boot0002  UEFI OS HD(1,GPT,abcd,0x800,0x1000)/File(\\EFI\\BOOT\\BOOTX64.EFI)"),
+             QString("HD(1,GPT,abcd,0x800,0x1000)/File(\\EFI\\BOOT\\BOOTX64.EFI)"));
+}
+
+void TestDevicePath::entryLine_noPath()
+{
+    QVERIFY(devicepath::pathFromEntryLine("Boot0000* Windows Boot Manager").isEmpty());
+}
+
+void TestDevicePath::partuuidIndex_lookup()
+{
+    const QJsonArray devices {
+        QJsonObject {{"name", "sda"}, {"path", "/dev/sda"}, {"partuuid", QJsonValue()}},
+        QJsonObject {{"name", "sda1"}, {"path", "/dev/sda1"}, {"partuuid", "2F2C1B8E-0000-0000-0000-000000000001"}},
+        QJsonObject {{"name", "nvme0n1p2"}, {"partuuid", "abcd"}},
+    };
+    devicepath::PartuuidIndex index;
+    index.build(devices);
+    QCOMPARE(index.device("2f2c1b8e-0000-0000-0000-000000000001"), QString("/dev/sda1"));
+    QCOMPARE(index.device("ABCD"), QString("/dev/nvme0n1p2"));
+    QVERIFY(index.device("missing").isEmpty());
+}
+
+QTEST_MAIN(TestDevicePath)
+#include "test_devicepath.moc"
@@ -0,0 +1,110 @@
+#include <QTest>
+#include "duplicates.h"
+#include "loadoption.h"
+
+using bootsnapshot::Snapshot;
+
+class TestDuplicates : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void entryKey_ignoresLoaderCase();
+    void findDuplicates_keepsFirstInBootOrder();
+    void findDuplicates_optionalData();
+    void findDuplicates_unorderedKeepsLowest();
+    void withoutEntries_updatesBootOrderAndNext();
+    void findEntry_matchesOptions();
+};
+
+namespace
+{
+const QString ESP = "2f2c1b8e-5f6a-4b2c-9d3e-0123456789ab";
+
+QByteArray diskEntry(const QString &label, const QString &loader, const QString &options = {})
+{
+    loadoption::LoadOption option;
+    option.description = label;
+    option.filePathList = loadoption::hardDriveFilePath({1, 0x800, 0x100000, ESP, loader});
+    option.optionalData = loadoption::optionalDataFromString(options);
+    return loadoption::encode(option);
+}
+
+// Two stub installs of the same kernel and a GRUB entry, Boot0004 ordered before Boot0002
+Snapshot machine()
+{
+    return Snapshot {{{"Boot0001", 7, diskEntry("MX Linux", "\\EFI\\MX\\grubx64.efi")},
+                      {"Boot0002", 7, diskEntry("MX stub", "\\EFI\\MX\\stub\\vmlinuz", "ro quiet")},
+                      {"Boot0004", 7, diskEntry("MX stub (new)", "\\efi\\mx\\STUB\\vmlinuz", "ro quiet")},
+                      {"Boot0005", 7, diskEntry("MX stub debug", "\\EFI\\MX\\stub\\vmlinuz", "ro debug")},
+                      {"BootOrder", 7, QByteArray::fromHex("0400010002000500")}}};
+}
+} // namespace
+
+void TestDuplicates::entryKey_ignoresLoaderCase()
+{
+    const Snapshot snapshot = machine();
+    QCOMPARE(duplicates::entryKey(snapshot.find("Boot0002")->data, true),
+             duplicates::entryKey(snapshot.find("Boot0004")->data, true));
+    QVERIFY(duplicates::entryKey(snapshot.find("Boot0002")->data, true)
+            != duplicates::entryKey(snapshot.find("Boot0005")->data, true));
+    QVERIFY(duplicates::entryKey(QByteArray::fromHex("0100"), true).isEmpty());
+}
+
+void TestDuplicates::findDuplicates_keepsFirstInBootOrder()
+{
+    const QList<duplicates::Group> groups = duplicates::findDuplicates(machine());
+    QCOMPARE(groups.size(), 1);
+    QCOMPARE(groups.at(0).keep, quint16(4));
+    QCOMPARE(groups.at(0).remove, QList<quint16> {2});
+    QCOMPARE(groups.at(0).description, QString("MX stub (new)"));
+}
+
+void TestDuplicates::findDuplicates_optionalData()
+{
+    const QList<duplicates::Group> groups = duplicates::findDuplicates(machine(), false);
+    QCOMPARE(groups.size(), 1);
+    QCOMPARE(groups.at(0).keep, quint16(4));
+    QCOMPARE(groups.at(0).remove, QList<quint16>({2, 5}));
+}
+
+void TestDuplicates::findDuplicates_unorderedKeepsLowest()
+{
+    Snapshot snapshot = machine();
+    snapshot.variables.removeIf([](const bootsnapshot::Variable &var) { return var.name == "BootOrder"; });
+    const QList<duplicates::Group> groups = duplicates::findDuplicates(snapshot);
+    QCOMPARE(groups.size(), 1);
+    QCOMPARE(groups.at(0).keep, quint16(2));
+    QCOMPARE(groups.at(0).remove, QList<quint16> {4});
+}
+
+void TestDuplicates::withoutEntries_updatesBootOrderAndNext()
+{
+    Snapshot snapshot = machine();
+    snapshot.variables.append({"BootNext", 7, QByteArray::fromHex("0200")});
+    const Snapshot target = duplicates::withoutEntries(snapshot, {2});
+    const QList<bootsnapshot::Change> changes = bootsnapshot::diff(snapshot, target);
+
+    // One BootOrder write, then the entry and the BootNext that pointed at it are deleted
+    QCOMPARE(changes.size(), 3);
+    QCOMPARE(changes.at(0).variable.name, QString("BootOrder"));
+    QCOMPARE(changes.at(0).variable.data, QByteArray::fromHex("040001000500"));
+    QCOMPARE(changes.at(1).variable.name, QString("Boot0002"));
+    QVERIFY(changes.at(1).kind == bootsnapshot::Change::Kind::Delete);
+    QCOMPARE(changes.at(2).variable.name, QString("BootNext"));
+    QVERIFY(changes.at(2).kind == bootsnapshot::Change::Kind::Delete);
+}
+
+void TestDuplicates::findEntry_matchesOptions()
+{
+    const Snapshot snapshot = machine();
+    QCOMPARE(duplicates::findEntry(snapshot, ESP.toUpper(), "\\EFI\\MX\\stub\\vmlinuz", "ro quiet ").value_or(0),
+             quint16(4));
+    QCOMPARE(duplicates::findEntry(snapshot, ESP, "\\EFI\\MX\\stub\\vmlinuz", "ro debug").value_or(0), quint16(5));
+    QVERIFY(!duplicates::findEntry(snapshot, ESP, "\\EFI\\MX\\stub\\vmlinuz", "ro splash").has_value());
+    QVERIFY(!duplicates::findEntry(snapshot, "00000000-0000-0000-0000-000000000001", "\\EFI\\MX\\grubx64.efi", {})
+                 .has_value());
+}
+
+QTEST_MAIN(TestDuplicates)
+#include "test_duplicates.moc"
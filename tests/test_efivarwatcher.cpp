@@ -0,0 +1,97 @@
+#include <QFile>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+#include <QTest>
+#include "efivarwatcher.h"
+
+#include <memory>
+
+class TestEfivarWatcher : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+
+    void scan_onlyWatchedVariables();
+    void changedNames_detectsSameSizeEdit();
+    void poll_reportsEntriesAndGlobals();
+    void poll_quietWithoutChanges();
+
+private:
+    std::unique_ptr<QTemporaryDir> dir;
+    void writeVariable(const QString &name, const QByteArray &data, const QString &guid = EFI_GLOBAL_GUID);
+};
+
+void TestEfivarWatcher::init()
+{
+    dir = std::make_unique<QTemporaryDir>();
+    QVERIFY(dir->isValid());
+    writeVariable("Boot0001", QByteArray::fromHex("0700000001000000"));
+    writeVariable("Boot0002", QByteArray::fromHex("0700000001000000"));
+    writeVariable("BootOrder", QByteArray::fromHex("0700000001000200"));
+    writeVariable("Timeout", QByteArray::fromHex("070000000500"));
+}
+
+void TestEfivarWatcher::writeVariable(const QString &name, const QByteArray &data, const QString &guid)
+{
+    QFile file(dir->filePath(name + '-' + guid));
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    file.write(data);
+}
+
+void TestEfivarWatcher::scan_onlyWatchedVariables()
+{
+    writeVariable("BootCurrent", QByteArray::fromHex("060000000100"));
+    writeVariable("Boot0003", QByteArray::fromHex("07000000"), "00000000-0000-0000-0000-000000000000");
+    const auto fingerprints = EfivarWatcher::scan(dir->path());
+    QCOMPARE(fingerprints.size(), 4);
+    QVERIFY(fingerprints.contains("Boot0001"));
+    QVERIFY(fingerprints.contains("Timeout"));
+    QCOMPARE(fingerprints.value("Timeout").size, qint64(6));
+}
+
+void TestEfivarWatcher::changedNames_detectsSameSizeEdit()
+{
+    const auto before = EfivarWatcher::scan(dir->path());
+    writeVariable("Boot0002", QByteArray::fromHex("0700000000000000")); // same size, now inactive
+    QCOMPARE(EfivarWatcher::changedNames(before, EfivarWatcher::scan(dir->path())), QStringList {"Boot0002"});
+}
+
+void TestEfivarWatcher::poll_reportsEntriesAndGlobals()
+{
+    EfivarWatcher watcher(dir->path());
+    watcher.setInterval(60000);
+    watcher.start();
+    QSignalSpy spy(&watcher, &EfivarWatcher::changed);
+
+    writeVariable("Boot0004", QByteArray::fromHex("0700000001000000"));
+    QVERIFY(QFile::remove(dir->filePath("Boot0001-" + QString(EFI_GLOBAL_GUID))));
+    writeVariable("BootOrder", QByteArray::fromHex("070000000200040000"));
+    watcher.poll();
+
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(spy.at(0).at(0).toStringList(), QStringList({"0001", "0004"}));
+    QVERIFY(spy.at(0).at(1).toBool());
+    watcher.stop();
+}
+
+void TestEfivarWatcher::poll_quietWithoutChanges()
+{
+    EfivarWatcher watcher(dir->path());
+    watcher.start();
+    QSignalSpy spy(&watcher, &EfivarWatcher::changed);
+    watcher.poll();
+    QCOMPARE(spy.count(), 0);
+
+    writeVariable("Boot0001", QByteArray::fromHex("0700000001000001"));
+    watcher.poll();
+    watcher.poll();
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(spy.at(0).at(0).toStringList(), QStringList {"0001"});
+    QVERIFY(!spy.at(0).at(1).toBool());
+    watcher.stop();
+}
+
+QTEST_MAIN(TestEfivarWatcher)
+#include "test_efivarwatcher.moc"
@@ -0,0 +1,360 @@
+#include <QTemporaryFile>
+#include <QTest>
+#include <QtEndian>
+
+#include <cstring>
+
+#include "fatfs.h"
+
+class TestFatfs : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void inspect_fat16();
+    void inspect_fat12();
+    void inspect_fat32();
+    void inspect_survivesLoopingChain();
+    void inspect_rejectsNonFat();
+    void inspectDevice_imageFile();
+    void spaceNeeded_roundsToClusters();
+    void spaceInDirectory_matchesCaseInsensitively();
+    void json_roundTrip();
+};
+
+namespace
+{
+constexpr quint32 SECTOR = 512;
+constexpr quint32 END_OF_CHAIN = 0x0ffffff8;
+
+// A FAT volume with one sector per cluster, written field by field like mkfs.fat would
+struct Image {
+    QByteArray bytes;
+    fatfs::Type type;
+    quint32 reserved;
+    quint32 fatSectors;
+    quint32 rootEntries;
+
+    Image(fatfs::Type type, quint32 totalSectors, quint32 reserved, quint32 fatSectors, quint32 rootEntries)
+        : bytes(qsizetype(totalSectors) * SECTOR, '\0'),
+          type(type),
+          reserved(reserved),
+          fatSectors(fatSectors),
+          rootEntries(rootEntries)
+    {
+        char *bpb = bytes.data();
+        qToLittleEndian<quint16>(SECTOR, bpb + 11);
+        bpb[13] = 1;
+        qToLittleEndian<quint16>(reserved, bpb + 14);
+        bpb[16] = 2;
+        qToLittleEndian<quint16>(rootEntries, bpb + 17);
+        if (type == fatfs::Type::Fat32) {
+            qToLittleEndian<quint32>(totalSectors, bpb + 32);
+            qToLittleEndian<quint32>(fatSectors, bpb + 36);
+            qToLittleEndian<quint32>(2, bpb + 44);
+        } else {
+            qToLittleEndian<quint16>(totalSectors, bpb + 19);
+            qToLittleEndian<quint16>(fatSectors, bpb + 22);
+        }
+        qToLittleEndian<quint16>(0xaa55, bpb + 510);
+    }
+
+    [[nodiscard]] qsizetype rootOffset() const { return qsizetype(reserved + 2 * fatSectors) * SECTOR; }
+    [[nodiscard]] qsizetype dataOffset() const { return rootOffset() + qsizetype(rootEntries) * 32; }
+
+    // Both copies, as the FAT is mirrored
+    void setFat(quint32 cluster, quint32 value)
+    {
+        for (quint32 copy = 0; copy < 2; ++copy) {
+            char *fat = bytes.data() + qsizetype(reserved + copy * fatSectors) * SECTOR;
+            switch (type) {
+            case fatfs::Type::Fat12: {
+                char *pair = fat + cluster + cluster / 2;
+                quint16 old = qFromLittleEndian<quint16>(pair);
+                old = (cluster & 1) ? (old & 0x000f) | quint16((value & 0x0fff) << 4)
+                                    : (old & 0xf000) | quint16(value & 0x0fff);
+                qToLittleEndian(old, pair);
+                break;
+            }
+            case fatfs::Type::Fat16:
+                qToLittleEndian<quint16>(value & 0xffff, fat + cluster * 2);
+                break;
+            case fatfs::Type::Fat32:
+                qToLittleEndian<quint32>(value, fat + qsizetype(cluster) * 4);
+                break;
+            }
+        }
+    }
+
+    // Links the clusters in order and ends the chain
+    void chain(const QList<quint32> &clusters)
+    {
+        for (qsizetype i = 0; i < clusters.size(); ++i) {
+            setFat(clusters.at(i), i + 1 < clusters.size() ? clusters.at(i + 1) : END_OF_CHAIN);
+        }
+    }
+
+    // Spreads data over the clusters, one sector each
+    void write(const QList<quint32> &clusters, const QByteArray &data)
+    {
+        for (qsizetype i = 0; i < clusters.size() && i * SECTOR < data.size(); ++i) {
+            const QByteArray part = data.mid(i * SECTOR, SECTOR);
+            bytes.replace(dataOffset() + qsizetype(clusters.at(i) - 2) * SECTOR, part.size(), part);
+        }
+    }
+
+    void writeRoot(const QByteArray &entries) { bytes.replace(rootOffset(), entries.size(), entries); }
+};
+
+// name11 is the padded 8.3 name, e.g. "BOOTX64 EFI"
+QByteArray shortEntry(const char *name11, quint8 attributes, quint32 cluster = 0, quint32 size = 0,
+                      quint8 caseFlags = 0)
+{
+    QByteArray entry(32, '\0');
+    memcpy(entry.data(), name11, 11);
+    entry[11] = static_cast<char>(attributes);
+    entry[12] = static_cast<char>(caseFlags);
+    qToLittleEndian<quint16>(cluster >> 16, entry.data() + 20);
+    qToLittleEndian<quint16>(cluster & 0xffff, entry.data() + 26);
+    qToLittleEndian(size, entry.data() + 28);
+    return entry;
+}
+
+QByteArray fileEntry(const char *name11, quint32 cluster, quint32 size, quint8 caseFlags = 0)
+{
+    return shortEntry(name11, 0x20, cluster, size, caseFlags);
+}
+
+QByteArray dirEntry(const char *name11, quint32 cluster)
+{
+    return shortEntry(name11, 0x10, cluster);
+}
+
+quint8 checksum(const char *name11)
+{
+    quint8 sum = 0;
+    for (int i = 0; i < 11; ++i) {
+        sum = static_cast<quint8>(((sum & 1) << 7) + (sum >> 1) + static_cast<quint8>(name11[i]));
+    }
+    return sum;
+}
+
+// The long name entries that go before the short entry, last part first
+QByteArray longEntries(const QString &name, quint8 checksum)
+{
+    static constexpr int offsets[13] {1, 3, 5, 7, 9, 14, 16, 18, 20, 22, 24, 28, 30};
+    const int count = int((name.size() + 12) / 13);
+    QByteArray entries;
+    for (int sequence = count; sequence >= 1; --sequence) {
+        QByteArray entry(32, '\0');
+        entry[0] = static_cast<char>(sequence == count ? sequence | 0x40 : sequence);
+        entry[11] = 0x0f;
+        entry[13] = static_cast<char>(checksum);
+        for (int i = 0; i < 13; ++i) {
+            const qsizetype index = qsizetype(sequence - 1) * 13 + i;
+            const quint16 unit = index < name.size() ? name.at(index).unicode() : index == name.size() ? 0 : 0xffff;
+            qToLittleEndian(unit, entry.data() + offsets[i]);
+        }
+        entries += entry;
+    }
+    return entries;
+}
+
+QByteArray deletedEntry(const char *name11)
+{
+    QByteArray entry = fileEntry(name11, 0, 0);
+    entry[0] = static_cast<char>(0xe5);
+    return entry;
+}
+
+fatfs::ByteReader readerFor(const QByteArray &image)
+{
+    return [image](quint64 offset, quint32 length) { return image.mid(qsizetype(offset), length); };
+}
+
+// 8095 clusters of 512 bytes. The EFI directory spans two clusters that are not adjacent, and the files
+// cover a long name, a long name whose checksum no longer matches, NT lowercase flags and deleted entries.
+Image fat16Image()
+{
+    Image image(fatfs::Type::Fat16, 8192, 1, 32, 512);
+    image.writeRoot(shortEntry("ESP        ", 0x08) + deletedEntry("OLDFILE TXT") + dirEntry("EFI        ", 2));
+
+    QByteArray efi = dirEntry("BOOT       ", 4);
+    while (efi.size() < SECTOR) {
+        efi += deletedEntry("GONE    EFI");
+    }
+    efi += dirEntry("MX         ", 5);
+    image.chain({2, 10});
+    image.write({2, 10}, efi);
+
+    image.chain({4});
+    image.write({4}, fileEntry("BOOTX64 EFI", 6, 1500) + fileEntry("GRUBX64 EFI", 9, 10, 0x18));
+    image.chain({6, 7, 8});
+    image.chain({9});
+
+    const QByteArray mx = dirEntry(".          ", 5) + dirEntry("..         ", 0)
+                          + longEntries("shimx64-signed.efi", checksum("SHIMX6~1EFI"))
+                          + fileEntry("SHIMX6~1EFI", 11, 700)
+                          + longEntries("orphan-name.efi", quint8(checksum("ORPHAN  EFI") + 1))
+                          + fileEntry("ORPHAN  EFI", 0, 0)
+                          + dirEntry("STUB       ", 13);
+    image.chain({5});
+    image.write({5}, mx);
+    image.chain({11, 12});
+
+    image.chain({13});
+    image.write({13}, fileEntry("VMLINUZ    ", 14, 2000) + fileEntry("INITRD  IMG", 18, 513));
+    image.chain({14, 15, 16, 17});
+    image.chain({18, 19});
+    return image;
+}
+} // namespace
+
+void TestFatfs::inspect_fat16()
+{
+    QString error;
+    const auto summary = fatfs::inspect(readerFor(fat16Image().bytes), &error);
+    QVERIFY2(summary, qPrintable(error));
+    QCOMPARE(summary->type, fatfs::Type::Fat16);
+    QCOMPARE(summary->label, QString("ESP"));
+    QCOMPARE(summary->clusterSize, SECTOR);
+    QCOMPARE(summary->clusterCount, quint32(8095));
+    QCOMPARE(summary->freeClusters, quint32(8095 - 17));
+    QCOMPARE(summary->freeBytes(), quint64(8095 - 17) * SECTOR);
+
+    const QList<fatfs::Entry> expected {
+        {"/EFI", true, 0},
+        {"/EFI/BOOT", true, 0},
+        {"/EFI/BOOT/BOOTX64.EFI", false, 1500},
+        {"/EFI/BOOT/grubx64.efi", false, 10},
+        {"/EFI/MX", true, 0},
+        {"/EFI/MX/shimx64-signed.efi", false, 700},
+        {"/EFI/MX/ORPHAN.EFI", false, 0},
+        {"/EFI/MX/STUB", true, 0},
+        {"/EFI/MX/STUB/VMLINUZ", false, 2000},
+        {"/EFI/MX/STUB/INITRD.IMG", false, 513},
+    };
+    QCOMPARE(summary->efiTree, expected);
+}
+
+void TestFatfs::inspect_fat12()
+{
+    // 2003 clusters; the EFI directory on an odd cluster and a file across odd and even ones
+    Image image(fatfs::Type::Fat12, 2048, 1, 6, 512);
+    image.writeRoot(dirEntry("EFI        ", 3));
+    image.chain({3});
+    image.write({3}, fileEntry("A       EFI", 4, 1536));
+    image.chain({4, 5, 6});
+
+    const auto summary = fatfs::inspect(readerFor(image.bytes));
+    QVERIFY(summary);
+    QCOMPARE(summary->type, fatfs::Type::Fat12);
+    QCOMPARE(summary->clusterCount, quint32(2003));
+    QCOMPARE(summary->freeClusters, quint32(2003 - 4));
+    QCOMPARE(summary->efiTree.size(), 2);
+    QCOMPARE(summary->efiTree.at(1), (fatfs::Entry {"/EFI/A.EFI", false, 1536}));
+}
+
+void TestFatfs::inspect_fat32()
+{
+    // 66000 clusters, enough for FAT32; the EFI directory needs the high word of its cluster number
+    Image image(fatfs::Type::Fat32, 67072, 32, 520, 0);
+    image.chain({2});
+    image.write({2}, shortEntry("EFI-VOL    ", 0x08) + dirEntry("EFI        ", 65600));
+    image.chain({65600});
+    image.write({65600}, fileEntry("BIG     EFI", 65601, 1200));
+    image.chain({65601, 65602, 65603});
+    image.setFat(100, 0xf0000000); // the top four bits are reserved, so still free
+
+    QString error;
+    const auto summary = fatfs::inspect(readerFor(image.bytes), &error);
+    QVERIFY2(summary, qPrintable(error));
+    QCOMPARE(summary->type, fatfs::Type::Fat32);
+    QCOMPARE(summary->label, QString("EFI-VOL"));
+    QCOMPARE(summary->clusterCount, quint32(66000));
+    QCOMPARE(summary->freeClusters, quint32(66000 - 5));
+    QCOMPARE(summary->efiTree.size(), 2);
+    QCOMPARE(summary->efiTree.at(1), (fatfs::Entry {"/EFI/BIG.EFI", false, 1200}));
+}
+
+void TestFatfs::inspect_survivesLoopingChain()
+{
+    Image image = fat16Image();
+    image.setFat(4, 4); // /EFI/BOOT points back at itself
+    const auto summary = fatfs::inspect(readerFor(image.bytes));
+    QVERIFY(summary);
+    QVERIFY(summary->efiTree.size() <= 10000);
+    QCOMPARE(summary->efiTree.constFirst().path, QString("/EFI"));
+}
+
+void TestFatfs::inspect_rejectsNonFat()
+{
+    QString error;
+    QVERIFY(!fatfs::inspect(readerFor(QByteArray(4096, '\0')), &error));
+    QVERIFY(!error.isEmpty());
+
+    // A boot signature without a BPB, as on an MBR
+    QByteArray sector(4096, '\0');
+    qToLittleEndian<quint16>(0xaa55, sector.data() + 510);
+    QVERIFY(!fatfs::inspect(readerFor(sector)));
+
+    // A FAT too small for the clusters the volume claims
+    Image image = fat16Image();
+    qToLittleEndian<quint16>(8, image.bytes.data() + 22);
+    QVERIFY(!fatfs::inspect(readerFor(image.bytes)));
+
+    QVERIFY(!fatfs::inspect(readerFor(fat16Image().bytes.first(SECTOR))));
+}
+
+void TestFatfs::inspectDevice_imageFile()
+{
+    const QByteArray bytes = fat16Image().bytes;
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    QCOMPARE(file.write(bytes), qint64(bytes.size()));
+    file.close();
+    const auto summary = fatfs::inspectDevice(file.fileName());
+    QVERIFY(summary);
+    QCOMPARE(summary->label, QString("ESP"));
+    QCOMPARE(summary->efiTree.size(), 10);
+
+    QString error;
+    QVERIFY(!fatfs::inspectDevice(file.fileName() + ".missing", &error));
+    QVERIFY(!error.isEmpty());
+}
+
+void TestFatfs::spaceNeeded_roundsToClusters()
+{
+    QCOMPARE(fatfs::spaceNeeded({}, 4096), quint64(0));
+    QCOMPARE(fatfs::spaceNeeded({1, 4096, 4097, 0, -5}, 4096), quint64(4096 + 4096 + 8192));
+    QCOMPARE(fatfs::spaceNeeded({1, 4097}, 0), quint64(4098));
+}
+
+void TestFatfs::spaceInDirectory_matchesCaseInsensitively()
+{
+    const auto summary = fatfs::inspect(readerFor(fat16Image().bytes));
+    QVERIFY(summary);
+    QCOMPARE(fatfs::spaceInDirectory(*summary, "/efi/mx/stub"), quint64(4 + 2) * SECTOR);
+    // Only files directly inside, not those of subdirectories
+    QCOMPARE(fatfs::spaceInDirectory(*summary, "/EFI/MX"), quint64(2) * SECTOR);
+    QCOMPARE(fatfs::spaceInDirectory(*summary, "/EFI/debian"), quint64(0));
+}
+
+void TestFatfs::json_roundTrip()
+{
+    const auto summary = fatfs::inspect(readerFor(fat16Image().bytes));
+    QVERIFY(summary);
+    const auto back = fatfs::fromJson(fatfs::toJson(*summary));
+    QVERIFY(back);
+    QCOMPARE(back->type, summary->type);
+    QCOMPARE(back->label, summary->label);
+    QCOMPARE(back->clusterSize, summary->clusterSize);
+    QCOMPARE(back->clusterCount, summary->clusterCount);
+    QCOMPARE(back->freeClusters, summary->freeClusters);
+    QCOMPARE(back->efiTree, summary->efiTree);
+    QVERIFY(!fatfs::fromJson({}));
+    QVERIFY(!fatfs::fromJson({{"error", "Not a block device"}}));
+}
+
+QTEST_MAIN(TestFatfs)
+#include "test_fatfs.moc"
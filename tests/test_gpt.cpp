@@ -0,0 +1,295 @@
+#include <QTemporaryFile>
+#include <QTest>
+#include <QUuid>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstring>
+
+#include "gpt.h"
+
+class TestGpt : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void crc32_matchesReference();
+    void read_partitions();
+    void read_fallsBackToBackup();
+    void read_rejectsDamagedTables();
+    void read_mbr();
+    void read_mbrLogicalPartitions();
+    void readDevice_imageFile();
+    void json_roundTrip();
+};
+
+namespace
+{
+constexpr quint32 SECTOR = 512;
+constexpr quint64 SECTORS = 8192;
+constexpr quint32 ENTRY_COUNT = 128;
+constexpr quint32 ENTRY_SIZE = 128;
+constexpr quint64 ENTRY_SECTORS = ENTRY_COUNT * ENTRY_SIZE / SECTOR;
+
+const QString ESP_TYPE = "c12a7328-f81f-11d2-ba4b-00a0c93ec93b";
+const QString LINUX_TYPE = "0fc63daf-8483-4772-8e79-3d69d8477de4";
+const QString ESP_UUID = "7d1a2c3b-5e6f-4a1b-8c2d-00000000abcd";
+const QString ROOT_UUID = "0b5e2f7a-1c3d-4e8f-9a0b-123456789abc";
+const QString DISK_GUID = "f3b6a7c8-2d1e-4f5a-b6c7-d8e9fa0b1c2d";
+
+// Bit-at-a-time CRC-32, the definition the table-driven version must agree with
+quint32 referenceCrc32(const QByteArray &data)
+{
+    quint32 crc = 0xffffffff;
+    for (const char c : data) {
+        crc ^= static_cast<uchar>(c);
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0xedb88320 : crc >> 1;
+        }
+    }
+    return ~crc;
+}
+
+// GUIDs are stored with their first three fields little-endian
+QByteArray guidBytes(const QString &uuid)
+{
+    QByteArray bytes = QUuid::fromString(uuid).toRfc4122();
+    std::reverse(bytes.begin(), bytes.begin() + 4);
+    std::reverse(bytes.begin() + 4, bytes.begin() + 6);
+    std::reverse(bytes.begin() + 6, bytes.begin() + 8);
+    return bytes;
+}
+
+QByteArray entryArray()
+{
+    QByteArray entries(ENTRY_COUNT * ENTRY_SIZE, '\0');
+    const auto put = [&entries](int index, const QString &type, const QString &uuid, quint64 first, quint64 last,
+                                const QString &name) {
+        char *entry = entries.data() + index * ENTRY_SIZE;
+        memcpy(entry, guidBytes(type).constData(), 16);
+        memcpy(entry + 16, guidBytes(uuid).constData(), 16);
+        qToLittleEndian(first, entry + 32);
+        qToLittleEndian(last, entry + 40);
+        for (qsizetype i = 0; i < name.size(); ++i) {
+            qToLittleEndian(name.at(i).unicode(), entry + 56 + i * 2);
+        }
+    };
+    put(0, ESP_TYPE, ESP_UUID, 2048, 4095, "EFI System");
+    // Entry 2 left empty: numbering follows the entry index, not the count
+    put(2, LINUX_TYPE, ROOT_UUID, 4096, SECTORS - 34, "root");
+    return entries;
+}
+
+QByteArray header(quint64 myLba, quint64 alternateLba, quint64 entriesLba, const QByteArray &entries)
+{
+    QByteArray sector(SECTOR, '\0');
+    char *h = sector.data();
+    memcpy(h, "EFI PART", 8);
+    qToLittleEndian<quint32>(0x00010000, h + 8);
+    qToLittleEndian<quint32>(92, h + 12);
+    qToLittleEndian(myLba, h + 24);
+    qToLittleEndian(alternateLba, h + 32);
+    qToLittleEndian<quint64>(2 + ENTRY_SECTORS, h + 40);
+    qToLittleEndian<quint64>(SECTORS - 2 - ENTRY_SECTORS, h + 48);
+    memcpy(h + 56, guidBytes(DISK_GUID).constData(), 16);
+    qToLittleEndian(entriesLba, h + 72);
+    qToLittleEndian(ENTRY_COUNT, h + 80);
+    qToLittleEndian(ENTRY_SIZE, h + 84);
+    qToLittleEndian(gpt::crc32(entries), h + 88);
+    qToLittleEndian(gpt::crc32(sector.first(92)), h + 16);
+    return sector;
+}
+
+// Protective MBR, primary header and entries at the start, backup entries and header at the end
+QByteArray gptDisk()
+{
+    QByteArray disk(SECTORS * SECTOR, '\0');
+    disk[446 + 4] = static_cast<char>(0xee);
+    qToLittleEndian<quint16>(0xaa55, disk.data() + 510);
+    const QByteArray entries = entryArray();
+    disk.replace(SECTOR, SECTOR, header(1, SECTORS - 1, 2, entries));
+    disk.replace(2 * SECTOR, entries.size(), entries);
+    const quint64 backupEntries = SECTORS - 1 - ENTRY_SECTORS;
+    disk.replace(backupEntries * SECTOR, entries.size(), entries);
+    disk.replace((SECTORS - 1) * SECTOR, SECTOR, header(SECTORS - 1, 1, backupEntries, entries));
+    return disk;
+}
+
+gpt::SectorReader readerFor(const QByteArray &disk)
+{
+    return [disk](quint64 lba, quint32 count) { return disk.mid(lba * SECTOR, qsizetype(count) * SECTOR); };
+}
+} // namespace
+
+void TestGpt::crc32_matchesReference()
+{
+    QCOMPARE(gpt::crc32(QByteArray("123456789")), quint32(0xcbf43926));
+    QCOMPARE(gpt::crc32(QByteArray()), quint32(0));
+
+    // Every alignment and tail length of the eight-byte loop
+    QByteArray data;
+    for (int i = 0; i < 1000; ++i) {
+        data += static_cast<char>(i * 7 + 3);
+    }
+    for (qsizetype offset = 0; offset < 8; ++offset) {
+        for (qsizetype length : {0, 1, 7, 8, 9, 63, 511, 992}) {
+            const QByteArray part = data.mid(offset, length);
+            QCOMPARE(gpt::crc32(part), referenceCrc32(part));
+        }
+    }
+    QCOMPARE(gpt::crc32(data.mid(300), gpt::crc32(data.first(300))), gpt::crc32(data));
+}
+
+void TestGpt::read_partitions()
+{
+    QString error;
+    const auto table = gpt::read(readerFor(gptDisk()), SECTOR, SECTORS, &error);
+    QVERIFY2(table, qPrintable(error));
+    QCOMPARE(table->scheme, gpt::Scheme::Gpt);
+    QCOMPARE(table->diskGuid, DISK_GUID);
+    QVERIFY(table->primaryValid);
+    QVERIFY(table->backupValid);
+    QCOMPARE(table->partitions.size(), 2);
+
+    const gpt::Partition *esp = table->find(1);
+    QVERIFY(esp);
+    QCOMPARE(esp->type, ESP_TYPE);
+    QCOMPARE(esp->partuuid, ESP_UUID);
+    QCOMPARE(esp->start, quint64(2048));
+    QCOMPARE(esp->size, quint64(2048));
+    QCOMPARE(esp->name, QString("EFI System"));
+    QVERIFY(!table->find(2));
+    QCOMPARE(table->find(3)->partuuid, ROOT_UUID);
+}
+
+void TestGpt::read_fallsBackToBackup()
+{
+    QByteArray disk = gptDisk();
+    disk[SECTOR + 40] = 'x'; // primary header CRC no longer matches
+    auto table = gpt::read(readerFor(disk), SECTOR, SECTORS);
+    QVERIFY(table);
+    QVERIFY(!table->primaryValid);
+    QVERIFY(table->backupValid);
+    QCOMPARE(table->find(1)->partuuid, ESP_UUID);
+
+    // A damaged primary entry array invalidates the primary copy too
+    disk = gptDisk();
+    disk[2 * SECTOR + 60] = 'x';
+    table = gpt::read(readerFor(disk), SECTOR, SECTORS);
+    QVERIFY(table);
+    QVERIFY(!table->primaryValid);
+    QCOMPARE(table->find(1)->name, QString("EFI System"));
+}
+
+void TestGpt::read_rejectsDamagedTables()
+{
+    QByteArray disk = gptDisk();
+    disk[2 * SECTOR + 60] = 'x';
+    disk[(SECTORS - 1 - ENTRY_SECTORS) * SECTOR + 60] = 'x';
+    QString error;
+    QVERIFY(!gpt::read(readerFor(disk), SECTOR, SECTORS, &error));
+    QVERIFY(!error.isEmpty());
+
+    // A header asking for more entries than any disk uses
+    disk = QByteArray(SECTORS * SECTOR, '\0');
+    const QByteArray huge(16, '\0');
+    QByteArray sector = header(1, SECTORS - 1, 2, huge);
+    qToLittleEndian<quint32>(0x1000000, sector.data() + 80);
+    qToLittleEndian<quint32>(0, sector.data() + 16);
+    qToLittleEndian(gpt::crc32(sector.first(92)), sector.data() + 16);
+    disk.replace(SECTOR, SECTOR, sector);
+    QVERIFY(!gpt::read(readerFor(disk), SECTOR, SECTORS));
+
+    QVERIFY(!gpt::read(readerFor(QByteArray(SECTOR, '\0')), SECTOR, 1));
+}
+
+void TestGpt::read_mbr()
+{
+    QByteArray disk(SECTORS * SECTOR, '\0');
+    qToLittleEndian<quint32>(0x1a2b3c4d, disk.data() + 440);
+    char *second = disk.data() + 446 + 16;
+    second[4] = static_cast<char>(0xef);
+    qToLittleEndian<quint32>(2048, second + 8);
+    qToLittleEndian<quint32>(204800, second + 12);
+    qToLittleEndian<quint16>(0xaa55, disk.data() + 510);
+
+    const auto table = gpt::read(readerFor(disk), SECTOR, SECTORS);
+    QVERIFY(table);
+    QCOMPARE(table->scheme, gpt::Scheme::Mbr);
+    QCOMPARE(table->partitions.size(), 1);
+    const gpt::Partition &esp = table->partitions.constFirst();
+    QCOMPARE(esp.number, quint32(2));
+    QCOMPARE(esp.type, QString("0xef"));
+    QCOMPARE(esp.partuuid, QString("1a2b3c4d-02"));
+    QCOMPARE(esp.start, quint64(2048));
+    QCOMPARE(esp.size, quint64(204800));
+}
+
+void TestGpt::read_mbrLogicalPartitions()
+{
+    QByteArray disk(SECTORS * SECTOR, '\0');
+    const auto put = [&disk](quint64 sector, int slot, quint8 type, quint32 start, quint32 size) {
+        char *entry = disk.data() + sector * SECTOR + 446 + slot * 16;
+        entry[4] = static_cast<char>(type);
+        qToLittleEndian<quint32>(start, entry + 8);
+        qToLittleEndian<quint32>(size, entry + 12);
+        qToLittleEndian<quint16>(0xaa55, disk.data() + sector * SECTOR + 510);
+    };
+    qToLittleEndian<quint32>(0x1a2b3c4d, disk.data() + 440);
+    put(0, 0, 0x83, 2048, 2048);
+    put(0, 1, 0x0f, 4096, 4096);
+    // EBRs at 4096 and 6144: the partition is relative to its EBR, the link to the extended partition
+    put(4096, 0, 0x83, 64, 1984);
+    put(4096, 1, 0x05, 2048, 2048);
+    put(6144, 0, 0x82, 64, 1984);
+
+    const auto table = gpt::read(readerFor(disk), SECTOR, SECTORS);
+    QVERIFY(table);
+    QCOMPARE(table->partitions.size(), 4);
+    const gpt::Partition *fifth = table->find(5);
+    QVERIFY(fifth);
+    QCOMPARE(fifth->type, QString("0x83"));
+    QCOMPARE(fifth->partuuid, QString("1a2b3c4d-05"));
+    QCOMPARE(fifth->start, quint64(4096 + 64));
+    const gpt::Partition *sixth = table->find(6);
+    QVERIFY(sixth);
+    QCOMPARE(sixth->type, QString("0x82"));
+    QCOMPARE(sixth->start, quint64(6144 + 64));
+    QCOMPARE(sixth->size, quint64(1984));
+
+    // A chain that links back to its first EBR ends instead of looping
+    put(6144, 1, 0x05, 0, 2048);
+    const auto looped = gpt::read(readerFor(disk), SECTOR, SECTORS);
+    QVERIFY(looped);
+    QCOMPARE(looped->partitions.size(), 4);
+}
+
+void TestGpt::readDevice_imageFile()
+{
+    QTemporaryFile image;
+    QVERIFY(image.open());
+    QCOMPARE(image.write(gptDisk()), qint64(SECTORS * SECTOR));
+    image.close();
+    const auto table = gpt::readDevice(image.fileName());
+    QVERIFY(table);
+    QCOMPARE(table->partitions.size(), 2);
+
+    QString error;
+    QVERIFY(!gpt::readDevice(image.fileName() + ".missing", &error));
+    QVERIFY(!error.isEmpty());
+}
+
+void TestGpt::json_roundTrip()
+{
+    auto table = gpt::read(readerFor(gptDisk()), SECTOR, SECTORS);
+    QVERIFY(table);
+    table->partitions[0].attributes = 0x8000000000000001ULL; // beyond a double's exact range
+    const auto back = gpt::fromJson(gpt::toJson(*table));
+    QVERIFY(back);
+    QCOMPARE(back->diskGuid, table->diskGuid);
+    QCOMPARE(back->partitions, table->partitions);
+    QVERIFY(!gpt::fromJson({}));
+}
+
+QTEST_MAIN(TestGpt)
+#include "test_gpt.moc"
@@ -47,6 +47,36 @@ expect_err_msg() {
     fi
 }
 
+# Check that a batch read from stdin fails with a specific error message.
+#   expect_batch_err_msg <description> <pattern> <json>
+expect_batch_err_msg() {
+    local desc="$1"; shift
+    local pattern="$1"; shift
+    local stderr
+    stderr="$(printf '%s' "$1" | "$HELPER" batch 2>&1 >/dev/null || true)"
+    if [[ "$stderr" == *"$pattern"* ]]; then
+        ((++PASS))
+    else
+        echo "FAIL (expected '$pattern' in stderr): $desc — got: $stderr" >&2
+        ((++FAIL))
+    fi
+}
+
+# Check that efivar operations read from stdin fail with a specific error message.
+#   expect_efivar_err_msg <description> <pattern> <json>
+expect_efivar_err_msg() {
+    local desc="$1"; shift
+    local pattern="$1"; shift
+    local stderr
+    stderr="$(printf '%s' "$1" | "$HELPER" efivar 2>&1 >/dev/null || true)"
+    if [[ "$stderr" == *"$pattern"* ]]; then
+        ((++PASS))
+    else
+        echo "FAIL (expected '$pattern' in stderr): $desc — got: $stderr" >&2
+        ((++FAIL))
+    fi
+}
+
 echo "=== Exec action tests ==="
 
 expect_ok   "allowed command: lsblk"          exec lsblk --version
@@ -77,6 +107,70 @@ else
     ((++PASS))
 fi
 
+echo "=== Batch action tests ==="
+
+expect_batch_err_msg "batch with empty input" "batch requires a JSON array of commands" ''
+expect_batch_err_msg "batch with invalid JSON" "batch requires a JSON array of commands" '{"cmd":"lsblk"}'
+expect_batch_err_msg "batch with disallowed command" "Command is not allowed" '[["lsblk","--version"],["bash","-c","echo hi"]]'
+expect_batch_err_msg "batch with empty entry" "batch entries must be non-empty command arrays" '[[]]'
+expect_batch_err_msg "batch with non-string argument" "batch arguments must be strings" '[["lsblk",1]]'
+expect_err_msg "batch with arguments" "batch reads its commands from stdin" batch lsblk
+
+if printf '%s' '[["lsblk","--version"],["findmnt","--version"]]' | "$HELPER" batch >/dev/null 2>&1; then
+    ((++PASS))
+else
+    echo "FAIL (expected ok): batch of allowed commands" >&2
+    ((++FAIL))
+fi
+
+echo "=== Efivar action tests ==="
+
+expect_efivar_err_msg "efivar with empty input" "efivar requires a JSON array of operations" ''
+expect_efivar_err_msg "efivar with object input" "efivar requires a JSON array of operations" '{"op":"delete"}'
+expect_efivar_err_msg "efivar on Secure Boot variable" "Variable is not allowed: PK" '[{"op":"delete","name":"PK"}]'
+expect_efivar_err_msg "efivar on lowercase boot entry" "Variable is not allowed" '[{"op":"delete","name":"Boot000a"}]'
+expect_efivar_err_msg "efivar with path in name" "Variable is not allowed" '[{"op":"delete","name":"../Boot0001"}]'
+expect_efivar_err_msg "efivar with unknown op" "Unsupported efivar operation: append" '[{"op":"append","name":"Boot0001"}]'
+expect_efivar_err_msg "efivar with authenticated attributes" "Unsupported variable attributes" '[{"op":"write","name":"Boot0001","attributes":39,"data":"AQAAAA=="}]'
+expect_efivar_err_msg "efivar with volatile attributes" "Unsupported variable attributes" '[{"op":"write","name":"BootNext","attributes":6,"data":"AQA="}]'
+expect_efivar_err_msg "efivar with invalid data" "Invalid variable data for Timeout" '[{"op":"write","name":"Timeout","attributes":7,"data":"!!"}]'
+expect_efivar_err_msg "efivar with malformed version" "Invalid expected version for BootOrder" '[{"op":"delete","name":"BootOrder","expect":"abc"}]'
+expect_efivar_err_msg "efivar with numeric version" "Invalid expected version for Timeout" '[{"op":"delete","name":"Timeout","expect":1}]'
+expect_efivar_err_msg "efivar validates before writing" "Variable is not allowed: db" '[{"op":"delete","name":"Boot0001"},{"op":"delete","name":"db"}]'
+expect_err_msg "efivar with arguments" "efivar reads its operations from stdin" efivar Boot0001
+
+echo "=== Partition table reads ==="
+
+expect_err_msg "gpt without disks" "gpt requires at least one device" gpt
+expect_err_msg "fat without partitions" "fat requires at least one device" fat
+expect_err_msg "fat with a regular file" "Not a block device: /etc/hostname" fat /etc/hostname
+expect_err_msg "luks without partitions" "luks requires at least one device" luks
+expect_err_msg "luks with a regular file" "Not a block device: /etc/hostname" luks /etc/hostname
+expect_err_msg "root without partitions" "root requires at least one device" root
+expect_err_msg "root with a directory" "Not a block device: /dev" root /dev
+expect_err_msg "gpt with a regular file" "Not a block device: /etc/hostname" gpt /etc/hostname
+expect_err_msg "gpt with a path outside /dev" "Not a block device: /tmp/disk.img" gpt /tmp/disk.img
+expect_err_msg "gpt with a relative path" "Not a block device: sda" gpt sda
+expect_err_msg "gpt with a character device" "Not a block device: /dev/null" gpt /dev/null
+
+echo "=== LUKS unlock ==="
+
+expect_err_msg "unlock without containers" "unlock requires pairs of a device and a mapping name" unlock
+expect_err_msg "unlock without a mapping name" "unlock requires pairs of a device and a mapping name" unlock /dev/null
+expect_err_msg "unlock a regular file" "Not a block device: /etc/hostname" unlock /etc/hostname luks-1
+
+echo "=== Root-only file reads ==="
+
+expect_err_msg "file without paths" "file requires at least one path" file
+expect_err_msg "file outside the allowlist" "File is not allowed: /etc/shadow" file /etc/shadow
+expect_err_msg "file escaping the FPDT directory" "File is not allowed" file /sys/firmware/acpi/fpdt/boot/../../tables/DSDT
+expect_err_msg "file with a nested FPDT path" "File is not allowed" file /sys/firmware/acpi/fpdt/boot/x/y
+expect_err_msg "file that rootfs doesn't read" "File is not allowed: /etc/hostname" file /etc/hostname
+expect_ok "file that rootfs reads from the running root" file /etc/os-release
+expect_err_msg "file with a dot-dot in a root path" "File is not allowed" file /boot/../etc/fstab
+expect_err_msg "exec of grep" "Command is not allowed: grep" exec grep -r . /root
+expect_err_msg "file validates every path first" "File is not allowed: /etc/shadow" file /sys/firmware/acpi/fpdt/boot/reset_end /etc/shadow
+
 echo "=== Single-string shell commands are rejected ==="
 
 expect_err_msg "single-arg pipeline string" "Command is not allowed" exec 'grep --version | cut -d" " -f1'
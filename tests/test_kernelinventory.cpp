@@ -0,0 +1,200 @@
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#include "kernelinventory.h"
+
+class TestKernelInventory : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void setDirectory_skipsOtherFiles();
+    void kernel_debianNames();
+    void kernel_initramfsNames();
+    void kernel_archFallback();
+    void kernel_frugal();
+    void kernel_missingFiles();
+    void scan_followsSymlinks();
+    void setDirectory_rescans();
+    void setDirectory_skipsUnchanged();
+};
+
+namespace
+{
+void setModified(const QString &dir, time_t seconds)
+{
+    const timespec times[2] {{seconds, 0}, {seconds, 0}};
+    QVERIFY(::utimensat(AT_FDCWD, QFile::encodeName(dir).constData(), times, 0) == 0);
+}
+
+void writeFile(const QString &path, qint64 size)
+{
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    QVERIFY(file.write(QByteArray(size, 'x')) == size);
+}
+} // namespace
+
+void TestKernelInventory::setDirectory_skipsOtherFiles()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    writeFile(dir.filePath("vmlinuz-6.1.0-28-amd64"), 10);
+    writeFile(dir.filePath("vmlinuz-6.12.8-1-liquorix-amd64"), 10);
+    writeFile(dir.filePath("vmlinuz-5.10.0-32-amd64"), 10);
+    writeFile(dir.filePath("config-6.1.0-28-amd64"), 10);
+    writeFile(dir.filePath("System.map-6.1.0-28-amd64"), 10);
+    QVERIFY(QDir(dir.path()).mkdir("vmlinuz-not-a-kernel"));
+
+    KernelInventory inventory;
+    inventory.setDirectory(dir.path(), false);
+    QCOMPARE(inventory.directory(), dir.path());
+    QVERIFY(inventory.file("vmlinuz-6.12.8-1-liquorix-amd64").exists());
+    QVERIFY(inventory.file("vmlinuz-5.10.0-32-amd64").exists());
+    QVERIFY(!inventory.file("vmlinuz-not-a-kernel").exists());
+    QVERIFY(!KernelInventory::scan(dir.path()).contains("config-6.1.0-28-amd64"));
+}
+
+void TestKernelInventory::kernel_debianNames()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    writeFile(dir.filePath("vmlinuz-6.1.0-28-amd64"), 8);
+    writeFile(dir.filePath("initrd.img-6.1.0-28-amd64"), 32);
+    writeFile(dir.filePath("intel-ucode.img"), 4);
+
+    KernelInventory inventory;
+    inventory.setDirectory(dir.path(), false);
+    const KernelInventory::Kernel kernel = inventory.kernel("6.1.0-28-amd64");
+    QCOMPARE(kernel.vmlinuz.path, dir.filePath("vmlinuz-6.1.0-28-amd64"));
+    QCOMPARE(kernel.vmlinuz.size, qint64(8));
+    QCOMPARE(kernel.initrd.path, dir.filePath("initrd.img-6.1.0-28-amd64"));
+    QCOMPARE(kernel.initrd.size, qint64(32));
+    QVERIFY(!kernel.amdUcode.exists());
+    QCOMPARE(kernel.intelUcode.size, qint64(4));
+}
+
+void TestKernelInventory::kernel_initramfsNames()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    writeFile(dir.filePath("vmlinuz-6.11.4-201.fc40.x86_64"), 8);
+    writeFile(dir.filePath("initramfs-6.11.4-201.fc40.x86_64.img"), 16);
+
+    KernelInventory inventory;
+    inventory.setDirectory(dir.path(), false);
+    const KernelInventory::Kernel kernel = inventory.kernel("6.11.4-201.fc40.x86_64");
+    QCOMPARE(kernel.initrd.path, dir.filePath("initramfs-6.11.4-201.fc40.x86_64.img"));
+    QCOMPARE(kernel.initrd.size, qint64(16));
+}
+
+void TestKernelInventory::kernel_archFallback()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    writeFile(dir.filePath("vmlinuz-linux"), 8);
+    writeFile(dir.filePath("initramfs-linux.img"), 16);
+    writeFile(dir.filePath("amd-ucode.img"), 2);
+
+    KernelInventory inventory;
+    inventory.setDirectory(dir.path(), false);
+    const KernelInventory::Kernel kernel = inventory.kernel("6.11.5-arch1-1");
+    QCOMPARE(kernel.vmlinuz.path, dir.filePath("vmlinuz-linux"));
+    QCOMPARE(kernel.initrd.path, dir.filePath("initramfs-linux.img"));
+    QCOMPARE(kernel.amdUcode.size, qint64(2));
+}
+
+void TestKernelInventory::kernel_frugal()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    writeFile(dir.filePath("vmlinuz"), 8);
+    writeFile(dir.filePath("initrd.gz"), 16);
+
+    KernelInventory inventory;
+    inventory.setDirectory(dir.path(), true);
+    const KernelInventory::Kernel kernel = inventory.kernel("6.1.0-28-amd64");
+    QCOMPARE(kernel.vmlinuz.path, dir.filePath("vmlinuz"));
+    QCOMPARE(kernel.initrd.path, dir.filePath("initrd.gz"));
+
+    // The same directory read as an installed system's /boot
+    inventory.setDirectory(dir.path(), false);
+    QVERIFY(!inventory.kernel("6.1.0-28-amd64").vmlinuz.exists());
+}
+
+void TestKernelInventory::kernel_missingFiles()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    KernelInventory inventory;
+    inventory.setDirectory(dir.path(), false);
+    const KernelInventory::Kernel kernel = inventory.kernel("6.1.0-28-amd64");
+    QVERIFY(!kernel.vmlinuz.exists());
+    QCOMPARE(kernel.vmlinuz.size, qint64(-1));
+    QCOMPARE(kernel.vmlinuz.path, dir.filePath("vmlinuz-linux"));
+    QCOMPARE(kernel.initrd.path, dir.filePath("initramfs-6.1.0-28-amd64.img"));
+
+    inventory.setDirectory(dir.filePath("missing"), false);
+    QVERIFY(!inventory.file("vmlinuz-6.1.0-28-amd64").exists());
+}
+
+void TestKernelInventory::scan_followsSymlinks()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    writeFile(dir.filePath("vmlinuz-6.1.0-28-amd64"), 8);
+    QVERIFY(QFile::link("vmlinuz-6.1.0-28-amd64", dir.filePath("vmlinuz")));
+    QVERIFY(QFile::link("initrd.img-gone", dir.filePath("initrd.img")));
+
+    const QHash<QString, qint64> files = KernelInventory::scan(dir.path());
+    QCOMPARE(files.value("vmlinuz", -1), qint64(8));
+    QVERIFY(!files.contains("initrd.img"));
+}
+
+void TestKernelInventory::setDirectory_rescans()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    writeFile(dir.filePath("vmlinuz-6.1.0-28-amd64"), 8);
+
+    KernelInventory inventory;
+    inventory.setDirectory(dir.path(), false);
+    QVERIFY(inventory.kernel("6.1.0-28-amd64").vmlinuz.exists());
+
+    // A kernel package installed and the old one removed while the window is open
+    writeFile(dir.filePath("vmlinuz-6.1.0-29-amd64"), 8);
+    QVERIFY(QFile::remove(dir.filePath("vmlinuz-6.1.0-28-amd64")));
+    QVERIFY(!inventory.kernel("6.1.0-29-amd64").vmlinuz.exists());
+    inventory.setDirectory(dir.path(), false);
+    QVERIFY(inventory.kernel("6.1.0-29-amd64").vmlinuz.exists());
+    QVERIFY(!inventory.file("vmlinuz-6.1.0-28-amd64").exists());
+}
+
+void TestKernelInventory::setDirectory_skipsUnchanged()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    writeFile(dir.filePath("vmlinuz-6.1.0-28-amd64"), 8);
+    setModified(dir.path(), 1'700'000'000);
+
+    KernelInventory inventory;
+    inventory.setDirectory(dir.path(), false);
+    // A directory whose modification time stayed put isn't read again
+    writeFile(dir.filePath("vmlinuz-6.1.0-29-amd64"), 8);
+    setModified(dir.path(), 1'700'000'000);
+    inventory.setDirectory(dir.path(), false);
+    QVERIFY(!inventory.file("vmlinuz-6.1.0-29-amd64").exists());
+
+    setModified(dir.path(), 1'700'000'060);
+    inventory.setDirectory(dir.path(), false);
+    QVERIFY(inventory.file("vmlinuz-6.1.0-29-amd64").exists());
+}
+
+QTEST_MAIN(TestKernelInventory)
+#include "test_kernelinventory.moc"
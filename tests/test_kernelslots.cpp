@@ -0,0 +1,162 @@
+#include <QTest>
+#include "kernelslots.h"
+#include "loadoption.h"
+
+using bootsnapshot::Snapshot;
+using kernelslots::Slot;
+
+class TestKernelSlots : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void findSlots_readsSlotEntries();
+    void pickSlot_fillsFreeSlotsFirst();
+    void pickSlot_neverOverwritesRunningKernel();
+    void placeFile_sharesIdenticalImages();
+    void unreferencedFiles_listsReplacedImages();
+    void stage_triesNewEntryThroughBootNext();
+    void promote_isOneBootOrderWrite();
+};
+
+namespace
+{
+constexpr quint32 ATTRIBUTES = bootsnapshot::BOOT_VARIABLE_ATTRIBUTES;
+
+QByteArray entry(const QString &label, const QString &loader, const QString &options)
+{
+    loadoption::LoadOption option;
+    option.description = label;
+    loadoption::HardDriveMedia media;
+    media.partition = 1;
+    media.start = 2048;
+    media.size = 1048576;
+    media.partuuid = "7d1a2c3b-0000-4000-8000-00000000abcd";
+    media.loaderPath = loader;
+    option.filePathList = loadoption::hardDriveFilePath(media);
+    option.optionalData = loadoption::optionalDataFromString(options);
+    return loadoption::encode(option);
+}
+
+// Boot0000 GRUB, Boot0003 slot A (default), Boot0004 slot B, tried through BootNext
+Snapshot sampleSnapshot()
+{
+    Snapshot snapshot;
+    snapshot.variables = {
+        {"Boot0000", ATTRIBUTES, entry("MX", "\\EFI\\MX\\grubx64.efi", {})},
+        {"Boot0003", ATTRIBUTES,
+         entry("MX (slot A)", "\\EFI\\MX\\slot-a\\vmlinuz-aaaaaaaaaaaa",
+               "quiet initrd=\\EFI\\MX\\slot-a\\intucode-cccccccccccc.img "
+               "initrd=\\EFI\\MX\\slot-a\\initrd-111111111111.img")},
+        {"Boot0004", ATTRIBUTES,
+         entry("MX (slot B)", "\\EFI\\MX\\slot-b\\vmlinuz-bbbbbbbbbbbb",
+               "quiet initrd=\\EFI\\MX\\slot-a\\intucode-cccccccccccc.img "
+               "initrd=\\EFI\\MX\\slot-b\\initrd-222222222222.img")},
+        {"BootNext", ATTRIBUTES, bootsnapshot::encodeUint16List({4})},
+        {"BootOrder", ATTRIBUTES, bootsnapshot::encodeUint16List({3, 0, 4})},
+    };
+    return snapshot;
+}
+
+const QStringList ESP_FILES {"\\EFI\\MX\\slot-a\\vmlinuz-aaaaaaaaaaaa", "\\EFI\\MX\\slot-a\\intucode-cccccccccccc.img",
+                             "\\EFI\\MX\\slot-a\\initrd-111111111111.img", "\\EFI\\MX\\slot-b\\vmlinuz-bbbbbbbbbbbb",
+                             "\\EFI\\MX\\slot-b\\initrd-222222222222.img"};
+
+std::optional<quint16> first(const Snapshot &snapshot, const QString &name)
+{
+    const bootsnapshot::Variable *var = snapshot.find(name);
+    const QList<quint16> numbers = var ? bootsnapshot::decodeUint16List(var->data) : QList<quint16>();
+    return numbers.isEmpty() ? std::nullopt : std::optional(numbers.constFirst());
+}
+} // namespace
+
+void TestKernelSlots::findSlots_readsSlotEntries()
+{
+    const QList<Slot> found = kernelslots::findSlots(sampleSnapshot(), "MX");
+    QCOMPARE(found.size(), 2);
+    QCOMPARE(found.at(0).letter, QChar('a'));
+    QCOMPARE(found.at(0).bootNumber, quint16(3));
+    QCOMPARE(found.at(0).orderRank, 0);
+    QCOMPARE(found.at(0).kernelOptions, QString("quiet"));
+    QCOMPARE(found.at(0).initrds, (QStringList {"\\EFI\\MX\\slot-a\\intucode-cccccccccccc.img",
+                                                "\\EFI\\MX\\slot-a\\initrd-111111111111.img"}));
+    QCOMPARE(found.at(1).letter, QChar('b'));
+    QCOMPARE(found.at(1).orderRank, 2);
+
+    QCOMPARE(kernelslots::findSlots(sampleSnapshot(), {}).size(), 2);
+    QVERIFY(kernelslots::findSlots(sampleSnapshot(), "antiX").isEmpty());
+}
+
+void TestKernelSlots::pickSlot_fillsFreeSlotsFirst()
+{
+    const QList<Slot> found = kernelslots::findSlots(sampleSnapshot(), "MX");
+    QCOMPARE(kernelslots::pickSlot({}, 2, std::nullopt), QChar('a'));
+    QCOMPARE(kernelslots::pickSlot(found, 3, std::nullopt), QChar('c'));
+    // Both used: replace the one furthest back in BootOrder, keeping the default
+    QCOMPARE(kernelslots::pickSlot(found, 2, quint16(0)), QChar('b'));
+}
+
+void TestKernelSlots::pickSlot_neverOverwritesRunningKernel()
+{
+    const QList<Slot> found = kernelslots::findSlots(sampleSnapshot(), "MX");
+    QCOMPARE(kernelslots::pickSlot(found, 2, quint16(4)), QChar('a'));
+}
+
+void TestKernelSlots::placeFile_sharesIdenticalImages()
+{
+    QCOMPARE(kernelslots::placeFile("intucode-cccccccccccc.img", "MX", 'b', ESP_FILES),
+             QString("\\EFI\\MX\\slot-a\\intucode-cccccccccccc.img"));
+    QCOMPARE(kernelslots::placeFile("initrd-333333333333.img", "MX", 'b', ESP_FILES),
+             QString("\\EFI\\MX\\slot-b\\initrd-333333333333.img"));
+    QCOMPARE(kernelslots::hashedName("initrd", QByteArray::fromHex("0123456789abcdef0123"), "img"),
+             QString("initrd-0123456789ab.img"));
+}
+
+void TestKernelSlots::unreferencedFiles_listsReplacedImages()
+{
+    QVERIFY(kernelslots::unreferencedFiles(kernelslots::findSlots(sampleSnapshot(), "MX"), ESP_FILES).isEmpty());
+
+    // Slot B replaced by a kernel sharing slot A's initrd; slot A's microcode is still used by A
+    Snapshot snapshot = sampleSnapshot();
+    snapshot.variables[2].data = entry("MX (slot B)", "\\EFI\\MX\\slot-b\\vmlinuz-dddddddddddd",
+                                       "quiet initrd=\\EFI\\MX\\slot-a\\initrd-111111111111.img");
+    QCOMPARE(kernelslots::unreferencedFiles(kernelslots::findSlots(snapshot, "MX"), ESP_FILES),
+             (QStringList {"\\EFI\\MX\\slot-b\\vmlinuz-bbbbbbbbbbbb", "\\EFI\\MX\\slot-b\\initrd-222222222222.img"}));
+}
+
+void TestKernelSlots::stage_triesNewEntryThroughBootNext()
+{
+    Snapshot current = sampleSnapshot();
+    current.variables.removeIf([](const bootsnapshot::Variable &var) { return var.name == "BootNext"; });
+    const QByteArray option = entry("MX (slot C)", "\\EFI\\MX\\slot-c\\vmlinuz-eeeeeeeeeeee", "quiet");
+
+    quint16 number = 0;
+    const Snapshot added = kernelslots::stage(current, std::nullopt, option, &number);
+    QCOMPARE(number, quint16(1));
+    QCOMPARE(added.find("Boot0001")->data, option);
+    QCOMPARE(bootsnapshot::decodeUint16List(added.find("BootOrder")->data), (QList<quint16> {3, 0, 4, 1}));
+    QCOMPARE(first(added, "BootNext"), std::optional<quint16>(1));
+
+    // Rewriting a slot keeps its number and its place in BootOrder
+    const Snapshot replaced = kernelslots::stage(current, quint16(4), option, &number);
+    QCOMPARE(number, quint16(4));
+    QCOMPARE(replaced.find("BootOrder")->data, current.find("BootOrder")->data);
+    const QList<bootsnapshot::Change> changes = bootsnapshot::diff(current, replaced);
+    QCOMPARE(changes.size(), 2);
+}
+
+void TestKernelSlots::promote_isOneBootOrderWrite()
+{
+    const Snapshot current = sampleSnapshot();
+    const Snapshot promoted = kernelslots::promote(current, 4);
+    QCOMPARE(bootsnapshot::decodeUint16List(promoted.find("BootOrder")->data), (QList<quint16> {4, 3, 0}));
+    QVERIFY(!promoted.find("BootNext"));
+
+    // Rolling back to slot A touches BootOrder only
+    const QList<bootsnapshot::Change> changes = bootsnapshot::diff(promoted, kernelslots::promote(promoted, 3));
+    QCOMPARE(changes.size(), 1);
+    QCOMPARE(changes.at(0).variable.name, QString("BootOrder"));
+}
+
+QTEST_MAIN(TestKernelSlots)
+#include "test_kernelslots.moc"
@@ -0,0 +1,159 @@
+#include <QRegularExpression>
+#include <QTest>
+
+#include <algorithm>
+
+#include "kernelversion.h"
+#include "utils.h"
+
+// Parsing and ordering are checked at compile time as well
+static_assert(KernelVersion::parse(u"vmlinuz-6.1.0-28-amd64").valid);
+static_assert(KernelVersion::parse(u"vmlinuz-6.1.0-28-amd64").numbers == std::array<quint32, 3> {6, 1, 0});
+static_assert(KernelVersion::parse(u"initrd.img-5.10").numbers == std::array<quint32, 3> {5, 10, 0});
+static_assert(!KernelVersion::parse(u"vmlinuz-linux").valid);
+static_assert(KernelVersion::parse(u"6.1.0-3-amd64") < KernelVersion::parse(u"6.1.0-28-amd64"));
+static_assert(KernelVersion::parse(u"6.9.12") < KernelVersion::parse(u"6.10.1"));
+static_assert(KernelVersion::parse(u"6.12.0~rc1") < KernelVersion::parse(u"6.12.0"));
+static_assert(KernelVersion::compareSuffix(u"-1a", u"-1+") < 0);
+
+class TestKernelVersion : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void parse_findsFirstVersion();
+    void parse_saturates();
+    void compare_dpkgSuffixes();
+    void compare_withoutVersion();
+    void sort_numericAbiNumbers();
+
+    void benchmark_regexSort();
+    void benchmark_keySort();
+};
+
+namespace
+{
+// 1,000 names in the shapes /boot holds, in no particular order
+QStringList kernelNames()
+{
+    static const QStringList flavours {"-amd64", "-rt-amd64", "-liquorix-amd64", ".fc40.x86_64", "-arch1-1"};
+    QStringList names;
+    names.reserve(1000);
+    for (int i = 0; i < 1000; ++i) {
+        const int n = (i * 7919) % 1000;
+        names.append(QString("vmlinuz-%1.%2.%3-%4%5")
+                         .arg(4 + n % 3)
+                         .arg(n % 20)
+                         .arg(n % 97)
+                         .arg(n % 31)
+                         .arg(flavours.at(n % flavours.size())));
+    }
+    return names;
+}
+
+// The regex comparator sortKernelVersions used before keys were precomputed, as a baseline
+QStringList regexSort(const QStringList &kernelFiles)
+{
+    static const QRegularExpression regex(R"((\d+)\.(\d+)(?:\.(\d+))?(-([a-z0-9]+[^-]*)?)?(-.*)?)");
+    QStringList sorted = kernelFiles;
+    std::sort(sorted.begin(), sorted.end(), [](const QString &a, const QString &b) {
+        const QRegularExpressionMatch matchA = regex.match(a);
+        const QRegularExpressionMatch matchB = regex.match(b);
+        if (!matchA.hasMatch() || !matchB.hasMatch()) {
+            return matchA.hasMatch() < matchB.hasMatch() || (!matchA.hasMatch() && a > b);
+        }
+        for (int group = 1; group <= 3; ++group) {
+            const int numberA = matchA.captured(group).toInt();
+            const int numberB = matchB.captured(group).toInt();
+            if (numberA != numberB) {
+                return numberA > numberB;
+            }
+        }
+        return matchA.captured(4) > matchB.captured(4);
+    });
+    return sorted;
+}
+} // namespace
+
+void TestKernelVersion::parse_findsFirstVersion()
+{
+    const QString name = "initramfs-6.11.4-201.fc40.x86_64.img";
+    const KernelVersion version = KernelVersion::parse(name);
+    QVERIFY(version.valid);
+    QVERIFY((version.numbers == std::array<quint32, 3> {6, 11, 4}));
+    QCOMPARE(version.suffix.toString(), QString("-201.fc40.x86_64.img"));
+    QCOMPARE(version.text.toString(), name);
+
+    // A number without a dot ahead of the version is skipped
+    QVERIFY((KernelVersion::parse(u"x86_64-6.1").numbers == std::array<quint32, 3> {6, 1, 0}));
+    QVERIFY(!KernelVersion::parse(u"vmlinuz-6.").valid);
+    QVERIFY(!KernelVersion::parse(u"").valid);
+}
+
+void TestKernelVersion::parse_saturates()
+{
+    const KernelVersion version = KernelVersion::parse(u"99999999999.1");
+    QVERIFY(version.valid);
+    QCOMPARE(version.numbers[0], std::numeric_limits<quint32>::max());
+    QVERIFY(KernelVersion::parse(u"4294967294.1") < version);
+}
+
+void TestKernelVersion::compare_dpkgSuffixes()
+{
+    // As dpkg --compare-versions orders them
+    QVERIFY(KernelVersion::compareSuffix(u"", u"-1") < 0);
+    QVERIFY(KernelVersion::compareSuffix(u"~rc1", u"") < 0);
+    QVERIFY(KernelVersion::compareSuffix(u"~rc1", u"~rc2") < 0);
+    QVERIFY(KernelVersion::compareSuffix(u"-9-amd64", u"-10-amd64") < 0);
+    QVERIFY(KernelVersion::compareSuffix(u"-010", u"-10") == 0);
+    QVERIFY(KernelVersion::compareSuffix(u"-28-amd64", u"-28-rt-amd64") < 0);
+    QVERIFY(KernelVersion::compareSuffix(u".2-microsoft", u"-2") > 0);
+    QVERIFY(KernelVersion::compareSuffix(u"-1.fc40", u"-1.fc40") == 0);
+}
+
+void TestKernelVersion::compare_withoutVersion()
+{
+    const KernelVersion arch = KernelVersion::parse(u"vmlinuz-linux");
+    QVERIFY(KernelVersion::parse(u"vmlinuz-6.1.0") < arch);
+    QVERIFY(arch < KernelVersion::parse(u"vmlinuz-linux-lts"));
+    QVERIFY(KernelVersion::parse(u"vmlinuz-linux") == arch);
+}
+
+void TestKernelVersion::sort_numericAbiNumbers()
+{
+    // The ABI number used to compare as text, putting -3 ahead of -28
+    const QStringList input {"6.1.0-3-amd64", "6.1.0-28-amd64", "6.1.0-10-amd64"};
+    QCOMPARE(utils::sortKernelVersions(input), QStringList({"6.1.0-28-amd64", "6.1.0-10-amd64", "6.1.0-3-amd64"}));
+    QCOMPARE(utils::sortKernelVersions(input, false),
+             QStringList({"6.1.0-3-amd64", "6.1.0-10-amd64", "6.1.0-28-amd64"}));
+
+    const QStringList names = kernelNames();
+    const QStringList sorted = utils::sortKernelVersions(names);
+    QCOMPARE(sorted.size(), names.size());
+    for (qsizetype i = 1; i < sorted.size(); ++i) {
+        QVERIFY(!(KernelVersion::parse(sorted.at(i - 1)) < KernelVersion::parse(sorted.at(i))));
+    }
+}
+
+void TestKernelVersion::benchmark_regexSort()
+{
+    const QStringList names = kernelNames();
+    QStringList sorted;
+    QBENCHMARK {
+        sorted = regexSort(names);
+    }
+    QCOMPARE(sorted.size(), names.size());
+}
+
+void TestKernelVersion::benchmark_keySort()
+{
+    const QStringList names = kernelNames();
+    QStringList sorted;
+    QBENCHMARK {
+        sorted = utils::sortKernelVersions(names);
+    }
+    QCOMPARE(sorted.size(), names.size());
+}
+
+QTEST_MAIN(TestKernelVersion)
+#include "test_kernelversion.moc"
@@ -0,0 +1,125 @@
+#include <QTest>
+#include "loadoption.h"
+
+class TestLoadOption : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void encode_decodeRoundTrip();
+    void decode_rejectsTruncated();
+    void hardDriveFilePath_layout();
+    void hardDriveMedia_roundTrip();
+    void hardDriveMedia_notDisk();
+    void optionalData_ucs2();
+    void optionalData_ascii();
+    void optionalData_binary();
+    void normalizeLoaderPath();
+};
+
+namespace
+{
+const QString PARTUUID = "2f2c1b8e-5f6a-4b2c-9d3e-0123456789ab";
+
+loadoption::HardDriveMedia sampleMedia()
+{
+    return {1, 0x800, 0x100000, PARTUUID, "\\EFI\\MX\\grubx64.efi"};
+}
+} // namespace
+
+void TestLoadOption::encode_decodeRoundTrip()
+{
+    loadoption::LoadOption option;
+    option.description = "MX Linux";
+    option.filePathList = loadoption::hardDriveFilePath(sampleMedia());
+    option.optionalData = loadoption::optionalDataFromString("quiet splash");
+
+    const QByteArray data = loadoption::encode(option);
+    QCOMPARE(data.left(4), QByteArray::fromHex("01000000"));
+    const auto decoded = loadoption::decode(data);
+    QVERIFY(decoded.has_value());
+    QVERIFY(decoded->isActive());
+    QCOMPARE(decoded->description, QString("MX Linux"));
+    QCOMPARE(decoded->filePathList, option.filePathList);
+    QCOMPARE(decoded->optionalData, option.optionalData);
+    QCOMPARE(loadoption::encode(*decoded), data);
+}
+
+void TestLoadOption::decode_rejectsTruncated()
+{
+    loadoption::LoadOption option;
+    option.description = "MX Linux";
+    option.filePathList = loadoption::hardDriveFilePath(sampleMedia());
+    const QByteArray data = loadoption::encode(option);
+    QVERIFY(!loadoption::decode(data.left(data.size() - 1)).has_value());
+    QVERIFY(!loadoption::decode(data.left(10)).has_value());
+    QVERIFY(!loadoption::decode({}).has_value());
+}
+
+void TestLoadOption::hardDriveFilePath_layout()
+{
+    const QByteArray path = loadoption::hardDriveFilePath(sampleMedia());
+    QCOMPARE(path.left(4), QByteArray::fromHex("04012a00"));
+    // EFI_GUID stores the first three fields little-endian
+    QCOMPARE(path.mid(24, 16), QByteArray::fromHex("8e1b2c2f6a5f2c4b9d3e0123456789ab"));
+    QCOMPARE(path.mid(40, 2), QByteArray::fromHex("0202"));
+    QCOMPARE(path.right(4), QByteArray::fromHex("7fff0400"));
+}
+
+void TestLoadOption::hardDriveMedia_roundTrip()
+{
+    const auto media = loadoption::hardDriveMedia(loadoption::hardDriveFilePath(sampleMedia()));
+    QVERIFY(media.has_value());
+    QCOMPARE(media->partition, quint32(1));
+    QCOMPARE(media->start, quint64(0x800));
+    QCOMPARE(media->size, quint64(0x100000));
+    QCOMPARE(media->partuuid, PARTUUID);
+    QCOMPARE(media->loaderPath, QString("\\EFI\\MX\\grubx64.efi"));
+}
+
+void TestLoadOption::hardDriveMedia_notDisk()
+{
+    // PciRoot(0x0)/Pci(0x1f,0x6) followed by the end node
+    const QByteArray network = QByteArray::fromHex("02010c00d041030a00000000"
+                                                   "01010600061f"
+                                                   "7fff0400");
+    QVERIFY(!loadoption::hardDriveMedia(network).has_value());
+    QVERIFY(!loadoption::hardDriveMedia({}).has_value());
+}
+
+void TestLoadOption::optionalData_ucs2()
+{
+    bool ok = false;
+    const QByteArray data = loadoption::optionalDataFromString("root=UUID=1234 ro");
+    QCOMPARE(data.size(), 34);
+    QCOMPARE(loadoption::optionalDataToString(data, &ok), QString("root=UUID=1234 ro"));
+    QVERIFY(ok);
+    // A trailing NUL, as some tools write, is not part of the text
+    QCOMPARE(loadoption::optionalDataToString(data + QByteArray(2, '\0'), &ok), QString("root=UUID=1234 ro"));
+    QVERIFY(ok);
+}
+
+void TestLoadOption::optionalData_ascii()
+{
+    bool ok = false;
+    QCOMPARE(loadoption::optionalDataToString("initrd=\\initrd.img ro", &ok), QString("initrd=\\initrd.img ro"));
+    QVERIFY(ok);
+    QCOMPARE(loadoption::optionalDataToString({}, &ok), QString());
+    QVERIFY(ok);
+}
+
+void TestLoadOption::optionalData_binary()
+{
+    bool ok = true;
+    QVERIFY(loadoption::optionalDataToString(QByteArray::fromHex("4d53574e8a01ff00"), &ok).isEmpty());
+    QVERIFY(!ok);
+}
+
+void TestLoadOption::normalizeLoaderPath()
+{
+    QCOMPARE(loadoption::normalizeLoaderPath("EFI/MX/grubx64.efi"), QString("\\EFI\\MX\\grubx64.efi"));
+    QCOMPARE(loadoption::normalizeLoaderPath(" \\EFI\\BOOT\\BOOTX64.EFI "), QString("\\EFI\\BOOT\\BOOTX64.EFI"));
+}
+
+QTEST_MAIN(TestLoadOption)
+#include "test_loadoption.moc"
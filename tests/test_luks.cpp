@@ -0,0 +1,194 @@
+#include <QCryptographicHash>
+#include <QTemporaryFile>
+#include <QTest>
+#include <QtEndian>
+
+#include <cstring>
+
+#include "luks.h"
+
+class TestLuks : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void read_luks1();
+    void read_luks2();
+    void read_luks2FallsBackToSecondary();
+    void read_rejectsDamagedHeaders();
+    void readDevice_imageFile();
+    void json_roundTrip();
+};
+
+namespace
+{
+constexpr quint64 HEADER_SIZE = 0x4000;
+const char LUKS1_UUID[] = "3f6d8a2c-9b1e-4c57-a0d4-6e2f1b8c9a70";
+const char LUKS2_UUID[] = "c41a7e9b-2d58-4f0c-9e36-b8a1d5f7e024";
+
+luks::ByteReader readerFor(const QByteArray &image)
+{
+    return [image](quint64 offset, quint32 length) { return image.mid(qsizetype(offset), length); };
+}
+
+// Two of eight key slots in use, payload at 4096 sectors
+QByteArray luks1Image()
+{
+    QByteArray image(0x2000, '\0');
+    char *header = image.data();
+    memcpy(header, "LUKS\xba\xbe", 6);
+    qToBigEndian<quint16>(1, header + 6);
+    memcpy(header + 8, "aes", 3);
+    memcpy(header + 40, "xts-plain64", 11);
+    memcpy(header + 72, "sha256", 6);
+    qToBigEndian<quint32>(4096, header + 104);
+    memcpy(header + 168, LUKS1_UUID, sizeof(LUKS1_UUID) - 1);
+    for (int slot = 0; slot < 8; ++slot) {
+        qToBigEndian<quint32>(slot == 0 || slot == 3 ? 0x00ac71f3 : 0x0000dead, header + 208 + slot * 48);
+    }
+    return image;
+}
+
+QByteArray luks2Metadata(const char *cipher)
+{
+    return QByteArray(R"({"keyslots":{"0":{"type":"luks2"},"1":{"type":"luks2"},"2":{"type":"luks2"}},)")
+           + R"("segments":{"0":{"type":"crypt","offset":"16777216","size":"dynamic","encryption":")" + cipher
+           + R"("}},"digests":{},"config":{"json_size":"12288","keyslots_size":"16744448"}})";
+}
+
+// One copy of the header area at offset, its checksum filled in
+void writeLuks2(QByteArray *image, quint64 offset, quint64 seqid, const QByteArray &metadata)
+{
+    QByteArray area(qsizetype(HEADER_SIZE), '\0');
+    char *header = area.data();
+    memcpy(header, offset == 0 ? "LUKS\xba\xbe" : "SKUL\xba\xbe", 6);
+    qToBigEndian<quint16>(2, header + 6);
+    qToBigEndian<quint64>(HEADER_SIZE, header + 8);
+    qToBigEndian<quint64>(seqid, header + 16);
+    memcpy(header + 24, "cryptroot", 9);
+    memcpy(header + 72, "sha256", 6);
+    memcpy(header + 168, LUKS2_UUID, sizeof(LUKS2_UUID) - 1);
+    qToBigEndian<quint64>(offset, header + 256);
+    area.replace(4096, metadata.size(), metadata);
+    const QByteArray digest = QCryptographicHash::hash(area, QCryptographicHash::Sha256);
+    area.replace(448, digest.size(), digest);
+    image->replace(qsizetype(offset), area.size(), area);
+}
+
+QByteArray luks2Image()
+{
+    QByteArray image(qsizetype(2 * HEADER_SIZE + 0x1000), '\0');
+    writeLuks2(&image, 0, 7, luks2Metadata("aes-xts-plain64"));
+    writeLuks2(&image, HEADER_SIZE, 7, luks2Metadata("aes-xts-plain64"));
+    return image;
+}
+} // namespace
+
+void TestLuks::read_luks1()
+{
+    QString error;
+    const auto header = luks::read(readerFor(luks1Image()), &error);
+    QVERIFY2(header, qPrintable(error));
+    QCOMPARE(header->version, 1);
+    QCOMPARE(header->uuid, QString(LUKS1_UUID));
+    QCOMPARE(header->cipher, QString("aes-xts-plain64"));
+    QCOMPARE(header->keyslots, 2);
+    QCOMPARE(header->payloadOffset, quint64(4096) * 512);
+    QVERIFY(header->label.isEmpty());
+    QCOMPARE(luks::mapperName(*header), QString("luks-") + LUKS1_UUID);
+}
+
+void TestLuks::read_luks2()
+{
+    QString error;
+    const auto header = luks::read(readerFor(luks2Image()), &error);
+    QVERIFY2(header, qPrintable(error));
+    QCOMPARE(header->version, 2);
+    QCOMPARE(header->uuid, QString(LUKS2_UUID));
+    QCOMPARE(header->label, QString("cryptroot"));
+    QCOMPARE(header->cipher, QString("aes-xts-plain64"));
+    QCOMPARE(header->keyslots, 3);
+    QCOMPARE(header->payloadOffset, quint64(16777216));
+}
+
+void TestLuks::read_luks2FallsBackToSecondary()
+{
+    // A primary whose JSON no longer matches its checksum, as after an interrupted update
+    QByteArray image = luks2Image();
+    writeLuks2(&image, HEADER_SIZE, 8, luks2Metadata("serpent-xts-plain64"));
+    image[4096 + 10] = 'X';
+    const auto header = luks::read(readerFor(image));
+    QVERIFY(header);
+    QCOMPARE(header->cipher, QString("serpent-xts-plain64"));
+
+    // A primary whose magic was overwritten is found through the secondary alone
+    image = luks2Image();
+    image.replace(0, 6, QByteArray(6, '\0'));
+    QString error;
+    const auto byMagic = luks::read(readerFor(image), &error);
+    QVERIFY2(byMagic, qPrintable(error));
+    QCOMPARE(byMagic->version, 2);
+    QCOMPARE(byMagic->uuid, QString(LUKS2_UUID));
+
+    // Without a secondary there is nothing left to trust
+    image.replace(qsizetype(HEADER_SIZE), 6, QByteArray(6, '\0'));
+    QVERIFY(!luks::read(readerFor(image), &error));
+    QVERIFY(!error.isEmpty());
+}
+
+void TestLuks::read_rejectsDamagedHeaders()
+{
+    QString error;
+    QVERIFY(!luks::read(readerFor(QByteArray(0x8000, '\0')), &error));
+    QVERIFY(!error.isEmpty());
+    QVERIFY(!luks::read(readerFor(QByteArray())));
+    QVERIFY(!luks::read(readerFor(luks1Image().first(100))));
+
+    QByteArray image = luks1Image();
+    qToBigEndian<quint16>(3, image.data() + 6);
+    QVERIFY(!luks::read(readerFor(image)));
+
+    // A LUKS1 header without a UUID, as a wiped one
+    image = luks1Image();
+    image.replace(168, 40, QByteArray(40, '\0'));
+    QVERIFY(!luks::read(readerFor(image)));
+
+    // A header size cryptsetup never writes
+    image = luks2Image();
+    qToBigEndian<quint64>(0x5000, image.data() + 8);
+    image.replace(qsizetype(HEADER_SIZE), 6, QByteArray(6, '\0'));
+    QVERIFY(!luks::read(readerFor(image)));
+
+    // An area too short for the header size it claims
+    QVERIFY(!luks::read(readerFor(luks2Image().first(0x2000))));
+}
+
+void TestLuks::readDevice_imageFile()
+{
+    const QByteArray bytes = luks2Image();
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    QCOMPARE(file.write(bytes), qint64(bytes.size()));
+    file.close();
+    const auto header = luks::readDevice(file.fileName());
+    QVERIFY(header);
+    QCOMPARE(header->uuid, QString(LUKS2_UUID));
+
+    QString error;
+    QVERIFY(!luks::readDevice(file.fileName() + ".missing", &error));
+    QVERIFY(!error.isEmpty());
+}
+
+void TestLuks::json_roundTrip()
+{
+    for (const QByteArray &image : {luks1Image(), luks2Image()}) {
+        const auto header = luks::read(readerFor(image));
+        QVERIFY(header);
+        QCOMPARE(luks::fromJson(luks::toJson(*header)).value_or(luks::Header()), *header);
+    }
+    QVERIFY(!luks::fromJson({}));
+    QVERIFY(!luks::fromJson({{"error", "No LUKS header was found."}}));
+}
+
+QTEST_MAIN(TestLuks)
+#include "test_luks.moc"
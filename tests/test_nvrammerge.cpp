@@ -0,0 +1,160 @@
+#include <QTest>
+#include "loadoption.h"
+#include "nvrammerge.h"
+
+using bootsnapshot::Change;
+using bootsnapshot::Snapshot;
+
+class TestNvramMerge : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void mergeBootOrder_keepsEntriesAddedElsewhere();
+    void mergeBootOrder_dropsEntriesRemovedElsewhere();
+
+    void plan_unchangedBase();
+    void plan_mergesOrderAndActive();
+    void plan_reportsScalarConflict();
+    void plan_reportsRemovedEntry();
+
+    void planRemoval_updatesOrderAndNext();
+    void planRemoval_refusesChangedEntry();
+};
+
+namespace
+{
+QByteArray entry(const QString &label, bool active = true)
+{
+    loadoption::LoadOption option;
+    option.attributes = active ? loadoption::LOAD_OPTION_ACTIVE : 0;
+    option.description = label;
+    option.filePathList = QByteArray::fromHex("7fff0400");
+    return loadoption::encode(option);
+}
+
+Snapshot base()
+{
+    return Snapshot {{{"Boot0001", 7, entry("MX")},
+                      {"Boot0002", 7, entry("Debian")},
+                      {"Boot0003", 7, entry("Shell")},
+                      {"BootOrder", 7, QByteArray::fromHex("010002000300")},
+                      {"Timeout", 7, QByteArray::fromHex("0500")}}};
+}
+
+bootsnapshot::Variable *find(Snapshot *snapshot, const QString &name)
+{
+    for (bootsnapshot::Variable &var : snapshot->variables) {
+        if (var.name == name) {
+            return &var;
+        }
+    }
+    return nullptr;
+}
+} // namespace
+
+void TestNvramMerge::mergeBootOrder_keepsEntriesAddedElsewhere()
+{
+    QCOMPARE(nvrammerge::mergeBootOrder({"0003", "0001", "0002"}, {"0001", "0004", "0002", "0003"}),
+             QStringList({"0003", "0001", "0004", "0002"}));
+    QCOMPARE(nvrammerge::mergeBootOrder({"0002", "0001"}, {"0005", "0001", "0002"}),
+             QStringList({"0005", "0002", "0001"}));
+}
+
+void TestNvramMerge::mergeBootOrder_dropsEntriesRemovedElsewhere()
+{
+    QCOMPARE(nvrammerge::mergeBootOrder({"0003", "0002", "0001"}, {"0001", "0003"}), QStringList({"0003", "0001"}));
+}
+
+void TestNvramMerge::plan_unchangedBase()
+{
+    nvrammerge::Edit edit;
+    edit.bootOrder = QStringList {"0002", "0001", "0003"};
+    edit.timeout = 2;
+    const nvrammerge::Plan plan = nvrammerge::plan(base(), base(), edit);
+    QVERIFY(plan.conflicts.isEmpty());
+    QCOMPARE(plan.changes.size(), 2);
+    QCOMPARE(plan.changes.at(0).variable.data, QByteArray::fromHex("020001000300"));
+    QCOMPARE(plan.changes.at(0).expectedVersion.value_or(QString()), bootsnapshot::version(base().find("BootOrder")));
+    QCOMPARE(plan.changes.at(1).variable.name, QString("Timeout"));
+    QCOMPARE(plan.changes.at(1).variable.data, QByteArray::fromHex("0200"));
+}
+
+void TestNvramMerge::plan_mergesOrderAndActive()
+{
+    // Meanwhile another program renamed Boot0002 and added Boot0004 after Boot0001
+    Snapshot current = base();
+    find(&current, "Boot0002")->data = entry("Debian 13");
+    current.variables.append({"Boot0004", 7, entry("Windows")});
+    find(&current, "BootOrder")->data = QByteArray::fromHex("0100040002000300");
+
+    nvrammerge::Edit edit;
+    edit.bootOrder = QStringList {"0003", "0001", "0002"};
+    edit.active.insert("0002", false);
+    const nvrammerge::Plan plan = nvrammerge::plan(base(), current, edit);
+    QVERIFY(plan.conflicts.isEmpty());
+    QCOMPARE(plan.changes.size(), 2);
+
+    const auto updated = loadoption::decode(plan.changes.at(0).variable.data);
+    QVERIFY(updated.has_value());
+    QCOMPARE(updated->description, QString("Debian 13"));
+    QVERIFY(!updated->isActive());
+    QCOMPARE(plan.changes.at(0).expectedVersion.value_or(QString()),
+             bootsnapshot::version(current.find("Boot0002")));
+    QCOMPARE(plan.changes.at(1).variable.data, QByteArray::fromHex("0300010004000200"));
+}
+
+void TestNvramMerge::plan_reportsScalarConflict()
+{
+    Snapshot current = base();
+    find(&current, "Timeout")->data = QByteArray::fromHex("0a00");
+    current.variables.append({"BootNext", 7, QByteArray::fromHex("0300")});
+
+    nvrammerge::Edit edit;
+    edit.timeout = 2;
+    edit.bootNext = QString("0003"); // same value as the other program, not a conflict
+    const nvrammerge::Plan plan = nvrammerge::plan(base(), current, edit);
+    QVERIFY(plan.changes.isEmpty());
+    QCOMPARE(plan.conflicts.size(), 1);
+    QVERIFY(plan.conflicts.at(0).contains("Timeout"));
+}
+
+void TestNvramMerge::plan_reportsRemovedEntry()
+{
+    Snapshot current = base();
+    current.variables.removeIf([](const bootsnapshot::Variable &var) { return var.name == "Boot0003"; });
+
+    nvrammerge::Edit edit;
+    edit.active.insert("0003", false);
+    const nvrammerge::Plan plan = nvrammerge::plan(base(), current, edit);
+    QVERIFY(plan.changes.isEmpty());
+    QCOMPARE(plan.conflicts.size(), 1);
+    QVERIFY(plan.conflicts.at(0).contains("Boot0003"));
+}
+
+void TestNvramMerge::planRemoval_updatesOrderAndNext()
+{
+    Snapshot current = base();
+    current.variables.append({"BootNext", 7, QByteArray::fromHex("0200")});
+    const nvrammerge::Plan plan = nvrammerge::planRemoval(base(), current, "0002");
+    QVERIFY(plan.conflicts.isEmpty());
+    QCOMPARE(plan.changes.size(), 3);
+    QCOMPARE(plan.changes.at(0).variable.data, QByteArray::fromHex("01000300"));
+    QCOMPARE(plan.changes.at(1).variable.name, QString("BootNext"));
+    QVERIFY(plan.changes.at(1).kind == Change::Kind::Delete);
+    QCOMPARE(plan.changes.at(2).variable.name, QString("Boot0002"));
+    QVERIFY(plan.changes.at(2).kind == Change::Kind::Delete);
+    QCOMPARE(plan.changes.at(2).expectedVersion.value_or(QString()), bootsnapshot::version(base().find("Boot0002")));
+}
+
+void TestNvramMerge::planRemoval_refusesChangedEntry()
+{
+    Snapshot current = base();
+    find(&current, "Boot0002")->data = entry("Debian 13");
+    const nvrammerge::Plan plan = nvrammerge::planRemoval(base(), current, "0002");
+    QVERIFY(plan.changes.isEmpty());
+    QCOMPARE(plan.conflicts.size(), 1);
+}
+
+QTEST_MAIN(TestNvramMerge)
+#include "test_nvrammerge.moc"
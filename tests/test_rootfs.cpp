@@ -0,0 +1,623 @@
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTemporaryFile>
+#include <QTest>
+#include <QUuid>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstring>
+#include <tuple>
+
+#include "rootfs.h"
+
+class TestRootfs : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void read_ext4();
+    void read_btrfs();
+    void read_rejectsOtherFilesystems();
+    void readDevice_imageFile();
+    void readDirectory_mountedTree();
+    void bootSource_findsBootMount();
+    void json_roundTrip();
+};
+
+namespace
+{
+const QUuid EXT_UUID("0b4e2f8a-6b1c-4c9e-9d0f-2a5e7c3b1d64");
+const QUuid BTRFS_UUID("7d1f0c2e-3a94-4b58-a6e1-5c0b9f8d2e37");
+
+rootfs::ByteReader readerFor(const QByteArray &image)
+{
+    return [image](quint64 offset, quint32 length) { return image.mid(qsizetype(offset), length); };
+}
+
+// ext4 with 1 KiB blocks and a single group: superblock in block 1, descriptors in 2, inodes from 3
+constexpr quint32 BLOCK = 1024;
+constexpr quint32 INODE_SIZE = 256;
+constexpr quint32 INODE_TABLE = 3;
+constexpr quint32 EXTENTS_FL = 0x80000;
+constexpr quint32 INDEX_FL = 0x1000;
+constexpr quint32 INLINE_DATA_FL = 0x10000000;
+constexpr quint16 MODE_DIR = 0x41ed;
+constexpr quint16 MODE_FILE = 0x81a4;
+constexpr quint16 MODE_LINK = 0xa1ff;
+constexpr quint8 FT_FILE = 1;
+constexpr quint8 FT_DIR = 2;
+constexpr quint8 FT_LINK = 7;
+
+struct Ext4Image {
+    QByteArray bytes = QByteArray(64 * BLOCK, '\0');
+
+    Ext4Image()
+    {
+        char *sb = block(1);
+        qToLittleEndian<quint32>(32, sb);      // inodes
+        qToLittleEndian<quint32>(64, sb + 4);  // blocks
+        qToLittleEndian<quint32>(1, sb + 20);  // first data block
+        qToLittleEndian<quint32>(32, sb + 40); // inodes per group
+        qToLittleEndian<quint16>(0xef53, sb + 56);
+        qToLittleEndian<quint32>(1, sb + 76); // dynamic revision
+        qToLittleEndian<quint16>(INODE_SIZE, sb + 88);
+        qToLittleEndian<quint32>(0x2 | 0x40 | 0x8000, sb + 96); // filetype, extents, inline data
+        const QByteArray uuid = EXT_UUID.toRfc4122();
+        memcpy(sb + 104, uuid.constData(), 16);
+        memcpy(sb + 120, "mxroot", 6);
+        qToLittleEndian<quint32>(INODE_TABLE, block(2) + 8);
+    }
+
+    char *block(quint32 number) { return bytes.data() + qsizetype(number) * BLOCK; }
+
+    void setInode(quint32 number, quint16 mode, quint64 size, quint32 flags, const QByteArray &iblock)
+    {
+        char *inode = block(INODE_TABLE) + qsizetype(number - 1) * INODE_SIZE;
+        qToLittleEndian(mode, inode);
+        qToLittleEndian<quint32>(size & 0xffffffff, inode + 4);
+        qToLittleEndian(flags, inode + 32);
+        memcpy(inode + 40, iblock.constData(), std::min<qsizetype>(iblock.size(), 60));
+        qToLittleEndian<quint32>(size >> 32, inode + 108);
+    }
+
+    void write(quint32 number, const QByteArray &data) { bytes.replace(qsizetype(number) * BLOCK, data.size(), data); }
+};
+
+QByteArray extentHeader(quint16 entries, quint16 depth)
+{
+    QByteArray header(12, '\0');
+    qToLittleEndian<quint16>(0xf30a, header.data());
+    qToLittleEndian(entries, header.data() + 2);
+    qToLittleEndian<quint16>(4, header.data() + 4);
+    qToLittleEndian(depth, header.data() + 6);
+    return header;
+}
+
+QByteArray extent(quint32 first, quint16 length, quint32 start)
+{
+    QByteArray entry(12, '\0');
+    qToLittleEndian(first, entry.data());
+    qToLittleEndian(length, entry.data() + 4);
+    qToLittleEndian(start, entry.data() + 8);
+    return entry;
+}
+
+QByteArray extentIndex(quint32 first, quint32 leaf)
+{
+    QByteArray entry(12, '\0');
+    qToLittleEndian(first, entry.data());
+    qToLittleEndian(leaf, entry.data() + 4);
+    return entry;
+}
+
+struct DirRecord {
+    quint32 inode;
+    quint8 type;
+    QByteArray name;
+};
+
+// The last record stretches to the end of the block
+QByteArray dirBlock(const QList<DirRecord> &records)
+{
+    QByteArray block(BLOCK, '\0');
+    qsizetype pos = 0;
+    for (qsizetype i = 0; i < records.size(); ++i) {
+        const DirRecord &record = records.at(i);
+        const qsizetype length = i + 1 < records.size() ? (8 + record.name.size() + 3) & ~3 : BLOCK - pos;
+        qToLittleEndian(record.inode, block.data() + pos);
+        qToLittleEndian<quint16>(length, block.data() + pos + 4);
+        block[pos + 6] = static_cast<char>(record.name.size());
+        block[pos + 7] = static_cast<char>(record.type);
+        block.replace(pos + 8, record.name.size(), record.name);
+        pos += length;
+    }
+    return block;
+}
+
+QByteArray extOsRelease()
+{
+    return "ID=debian\n" + QByteArray("# padding\n").repeated(120) + "PRETTY_NAME=\"Debian GNU/Linux 12\"\n";
+}
+
+const QByteArray EXT_FSTAB = "UUID=4f1a /boot ext4 defaults 0 2\n";
+
+// /etc is hashed, os-release has a two-level extent tree, mx-version an ext3 block map with an indirect
+// block, fstab is inline and /lib and /sbin/init are fast symlinks
+Ext4Image ext4Image()
+{
+    Ext4Image image;
+    image.setInode(2, MODE_DIR, BLOCK, EXTENTS_FL, extentHeader(1, 0) + extent(0, 1, 11));
+    image.write(11, dirBlock({{2, FT_DIR, "."},
+                              {2, FT_DIR, ".."},
+                              {12, FT_DIR, "etc"},
+                              {15, FT_DIR, "boot"},
+                              {18, FT_DIR, "sbin"},
+                              {20, FT_LINK, "lib"},
+                              {21, FT_DIR, "usr"}}));
+
+    // dx_root: ".." covers the hash index that fills the rest of the block
+    image.setInode(12, MODE_DIR, 2 * BLOCK, EXTENTS_FL | INDEX_FL, extentHeader(1, 0) + extent(0, 2, 12));
+    QByteArray dxRoot = dirBlock({{12, FT_DIR, "."}, {2, FT_DIR, ".."}});
+    dxRoot[24 + 4] = 1; // half MD4
+    dxRoot[24 + 5] = 8;
+    qToLittleEndian<quint16>((BLOCK - 32) / 8, dxRoot.data() + 32);
+    qToLittleEndian<quint16>(1, dxRoot.data() + 34);
+    qToLittleEndian<quint32>(1, dxRoot.data() + 36);
+    image.write(12, dxRoot);
+    image.write(13, dirBlock({{13, FT_FILE, "os-release"}, {14, FT_FILE, "fstab"}, {25, FT_FILE, "mx-version"}}));
+
+    const QByteArray osRelease = extOsRelease();
+    image.setInode(13, MODE_FILE, osRelease.size(), EXTENTS_FL, extentHeader(1, 1) + extentIndex(0, 14));
+    image.write(14, extentHeader(1, 0) + extent(0, 2, 15));
+    image.write(15, osRelease);
+
+    image.setInode(14, MODE_FILE, EXT_FSTAB.size(), INLINE_DATA_FL, EXT_FSTAB);
+
+    QByteArray blockMap(60, '\0');
+    qToLittleEndian<quint32>(18, blockMap.data());
+    qToLittleEndian<quint32>(17, blockMap.data() + 12 * 4);
+    image.setInode(25, MODE_FILE, 12 * BLOCK + 5, 0, blockMap);
+    QByteArray indirect(BLOCK, '\0');
+    qToLittleEndian<quint32>(19, indirect.data());
+    image.write(17, indirect);
+    image.write(18, "MX-23\n");
+    image.write(19, "tail\n");
+
+    image.setInode(15, MODE_DIR, BLOCK, EXTENTS_FL, extentHeader(1, 0) + extent(0, 1, 20));
+    image.write(20, dirBlock({{15, FT_DIR, "."},
+                              {2, FT_DIR, ".."},
+                              {16, FT_FILE, "vmlinuz-6.1.0-13-amd64"},
+                              {17, FT_FILE, "vmlinuz-6.6.0-1-amd64"},
+                              {26, FT_FILE, "config-6.6.0-1-amd64"}}));
+    image.setInode(16, MODE_FILE, 8 * 1024 * 1024, EXTENTS_FL, extentHeader(0, 0));
+    image.setInode(17, MODE_FILE, 9 * 1024 * 1024, EXTENTS_FL, extentHeader(0, 0));
+    image.setInode(26, MODE_FILE, 250000, EXTENTS_FL, extentHeader(0, 0));
+
+    image.setInode(18, MODE_DIR, BLOCK, EXTENTS_FL, extentHeader(1, 0) + extent(0, 1, 21));
+    image.write(21, dirBlock({{18, FT_DIR, "."}, {2, FT_DIR, ".."}, {19, FT_LINK, "init"}}));
+    image.setInode(19, MODE_LINK, 22, 0, "../lib/systemd/systemd");
+    image.setInode(20, MODE_LINK, 7, 0, "usr/lib");
+
+    image.setInode(21, MODE_DIR, BLOCK, EXTENTS_FL, extentHeader(1, 0) + extent(0, 1, 22));
+    image.write(22, dirBlock({{21, FT_DIR, "."}, {2, FT_DIR, ".."}, {22, FT_DIR, "lib"}}));
+    image.setInode(22, MODE_DIR, BLOCK, EXTENTS_FL, extentHeader(1, 0) + extent(0, 1, 23));
+    image.write(23, dirBlock({{22, FT_DIR, "."}, {21, FT_DIR, ".."}, {23, FT_DIR, "systemd"}}));
+    image.setInode(23, MODE_DIR, BLOCK, EXTENTS_FL, extentHeader(1, 0) + extent(0, 1, 24));
+    image.write(24, dirBlock({{23, FT_DIR, "."}, {22, FT_DIR, ".."}, {24, FT_FILE, "systemd"}}));
+    image.setInode(24, MODE_FILE, 0, EXTENTS_FL, extentHeader(0, 0));
+    return image;
+}
+
+// btrfs with 4 KiB nodes. The system chunk maps logical 1 MiB to 128 KiB and is only in the superblock;
+// the chunk for everything else maps logical 2 MiB to 192 KiB and is only in the chunk tree.
+constexpr quint32 NODE = 4096;
+constexpr quint64 SYSTEM_LOGICAL = 0x100000;
+constexpr quint64 SYSTEM_PHYSICAL = 0x20000;
+constexpr quint64 DATA_LOGICAL = 0x200000;
+constexpr quint64 DATA_PHYSICAL = 0x30000;
+constexpr quint64 DATA_LENGTH = 0x40000;
+constexpr quint64 ROOT_TREE = DATA_LOGICAL;
+constexpr quint64 FS_TREE_NODE = DATA_LOGICAL + NODE;
+constexpr quint64 SUBVOLUME_NODE = DATA_LOGICAL + 2 * NODE;
+constexpr quint64 SUBVOLUME_LEAF_A = DATA_LOGICAL + 3 * NODE;
+constexpr quint64 SUBVOLUME_LEAF_B = DATA_LOGICAL + 4 * NODE;
+constexpr quint64 FSTAB_EXTENT = DATA_LOGICAL + 5 * NODE;
+constexpr quint64 SUBVOLUME = 256;
+constexpr quint8 INODE_ITEM = 1;
+constexpr quint8 DIR_ITEM = 84;
+constexpr quint8 DIR_INDEX = 96;
+constexpr quint8 EXTENT_DATA = 108;
+constexpr quint8 ROOT_ITEM = 132;
+constexpr quint8 ROOT_BACKREF = 144;
+constexpr quint8 CHUNK_ITEM = 228;
+
+struct BtrfsItem {
+    quint64 objectid;
+    quint8 type;
+    quint64 offset;
+    QByteArray data;
+};
+
+QByteArray btrfsKey(quint64 objectid, quint8 type, quint64 offset)
+{
+    QByteArray key(17, '\0');
+    qToLittleEndian(objectid, key.data());
+    key[8] = static_cast<char>(type);
+    qToLittleEndian(offset, key.data() + 9);
+    return key;
+}
+
+QByteArray btrfsHeader(quint64 bytenr, quint32 items, quint8 level)
+{
+    QByteArray node(NODE, '\0');
+    const QByteArray fsid = BTRFS_UUID.toRfc4122();
+    node.replace(0x20, fsid.size(), fsid);
+    qToLittleEndian(bytenr, node.data() + 0x30);
+    qToLittleEndian(items, node.data() + 0x60);
+    node[0x64] = static_cast<char>(level);
+    return node;
+}
+
+// Item headers from the front, their data packed from the back, as btrfs lays out leaves
+QByteArray btrfsLeaf(quint64 bytenr, QList<BtrfsItem> items)
+{
+    std::sort(items.begin(), items.end(), [](const BtrfsItem &a, const BtrfsItem &b) {
+        return std::tie(a.objectid, a.type, a.offset) < std::tie(b.objectid, b.type, b.offset);
+    });
+    QByteArray node = btrfsHeader(bytenr, items.size(), 0);
+    qsizetype dataEnd = NODE;
+    for (qsizetype i = 0; i < items.size(); ++i) {
+        const BtrfsItem &item = items.at(i);
+        dataEnd -= item.data.size();
+        char *header = node.data() + 0x65 + i * 25;
+        memcpy(header, btrfsKey(item.objectid, item.type, item.offset).constData(), 17);
+        qToLittleEndian<quint32>(dataEnd - 0x65, header + 17);
+        qToLittleEndian<quint32>(item.data.size(), header + 21);
+        node.replace(dataEnd, item.data.size(), item.data);
+    }
+    return node;
+}
+
+QByteArray btrfsChunk(quint64 length, quint64 type, quint64 physical)
+{
+    QByteArray chunk(48 + 32, '\0');
+    qToLittleEndian(length, chunk.data());
+    qToLittleEndian<quint64>(2, chunk.data() + 8);
+    qToLittleEndian<quint64>(0x10000, chunk.data() + 16);
+    qToLittleEndian(type, chunk.data() + 24);
+    qToLittleEndian<quint32>(NODE, chunk.data() + 40);
+    qToLittleEndian<quint16>(1, chunk.data() + 44);
+    qToLittleEndian<quint64>(1, chunk.data() + 48);
+    qToLittleEndian(physical, chunk.data() + 56);
+    return chunk;
+}
+
+QByteArray btrfsRootItem(quint64 bytenr, quint8 level)
+{
+    QByteArray item(439, '\0');
+    qToLittleEndian(bytenr, item.data() + 176);
+    item[238] = static_cast<char>(level);
+    return item;
+}
+
+BtrfsItem btrfsInode(quint64 objectid, quint32 mode, quint64 size)
+{
+    QByteArray inode(160, '\0');
+    qToLittleEndian(size, inode.data() + 16);
+    qToLittleEndian(mode, inode.data() + 52);
+    return {objectid, INODE_ITEM, 0, inode};
+}
+
+QByteArray btrfsDirData(const QByteArray &location, quint8 type, const QByteArray &name)
+{
+    QByteArray item(30, '\0');
+    item.replace(0, location.size(), location);
+    qToLittleEndian<quint16>(name.size(), item.data() + 27);
+    item[29] = static_cast<char>(type);
+    return item + name;
+}
+
+BtrfsItem btrfsEntry(quint64 dir, quint64 index, quint64 inode, quint8 type, const QByteArray &name)
+{
+    return {dir, DIR_INDEX, index, btrfsDirData(btrfsKey(inode, INODE_ITEM, 0), type, name)};
+}
+
+BtrfsItem btrfsInline(quint64 inode, const QByteArray &data, quint8 compression = 0, quint64 ramBytes = 0)
+{
+    QByteArray item(21, '\0');
+    qToLittleEndian<quint64>(ramBytes ? ramBytes : data.size(), item.data() + 8);
+    item[16] = static_cast<char>(compression);
+    return {inode, EXTENT_DATA, 0, item + data};
+}
+
+BtrfsItem btrfsExtent(quint64 inode, quint64 diskBytenr, quint64 offset, quint64 numBytes)
+{
+    QByteArray item(53, '\0');
+    qToLittleEndian<quint64>(NODE, item.data() + 8);
+    item[20] = 1;
+    qToLittleEndian(diskBytenr, item.data() + 21);
+    qToLittleEndian<quint64>(NODE, item.data() + 29);
+    qToLittleEndian(offset, item.data() + 37);
+    qToLittleEndian(numBytes, item.data() + 45);
+    return {inode, EXTENT_DATA, 0, item};
+}
+
+const QByteArray BTRFS_OS_RELEASE = "PRETTY_NAME=\"openSUSE Tumbleweed\"\nID=\"opensuse-tumbleweed\"\n";
+const QByteArray BTRFS_FSTAB = "UUID=7d1f0c2e / btrfs defaults 0 0\nUUID=12AB-34CD /boot/efi vfat defaults 0 2\n";
+const QByteArray BTRFS_DEFAULT_GRUB = QByteArray("GRUB_CMDLINE_LINUX_DEFAULT=\"quiet splash\"\n").repeated(20);
+
+// The default subvolume is the top level, which holds "@" with the installation. Its tree is an internal
+// node over two leaves; /etc/default/grub is zlib-compressed inline, /etc/lsb-release lzo-compressed.
+QByteArray btrfsImage()
+{
+    QByteArray bytes(qsizetype(DATA_PHYSICAL + DATA_LENGTH), '\0');
+    const auto place = [&bytes](quint64 logical, const QByteArray &data) {
+        const quint64 physical = logical >= DATA_LOGICAL ? logical - DATA_LOGICAL + DATA_PHYSICAL
+                                                         : logical - SYSTEM_LOGICAL + SYSTEM_PHYSICAL;
+        bytes.replace(qsizetype(physical), data.size(), data);
+    };
+
+    char *sb = bytes.data() + 0x10000;
+    const QByteArray fsid = BTRFS_UUID.toRfc4122();
+    memcpy(sb + 0x20, fsid.constData(), 16);
+    memcpy(sb + 0x40, "_BHRfS_M", 8);
+    qToLittleEndian<quint64>(ROOT_TREE, sb + 0x50);
+    qToLittleEndian<quint64>(SYSTEM_LOGICAL, sb + 0x58);
+    qToLittleEndian<quint64>(6, sb + 0x80);
+    qToLittleEndian<quint64>(1, sb + 0x88);
+    qToLittleEndian<quint32>(NODE, sb + 0x90);
+    qToLittleEndian<quint32>(NODE, sb + 0x94);
+    memcpy(sb + 0x12b, "tumbleweed", 10);
+    const QByteArray sysChunk = btrfsKey(256, CHUNK_ITEM, SYSTEM_LOGICAL) + btrfsChunk(0x10000, 0x2, SYSTEM_PHYSICAL);
+    qToLittleEndian<quint32>(sysChunk.size(), sb + 0xa0);
+    memcpy(sb + 0x32b, sysChunk.constData(), sysChunk.size());
+
+    const QByteArray dataChunk = btrfsChunk(DATA_LENGTH, 0x1 | 0x4, DATA_PHYSICAL);
+    place(SYSTEM_LOGICAL, btrfsLeaf(SYSTEM_LOGICAL, {{256, CHUNK_ITEM, DATA_LOGICAL, dataChunk}}));
+
+    QByteArray backref(18, '\0');
+    qToLittleEndian<quint64>(256, backref.data());
+    qToLittleEndian<quint16>(1, backref.data() + 16);
+    const QList<BtrfsItem> rootItems {
+        {5, ROOT_ITEM, 0, btrfsRootItem(FS_TREE_NODE, 0)},
+        {6, DIR_ITEM, 0x8dbfc2d2, btrfsDirData(btrfsKey(5, ROOT_ITEM, UINT64_MAX), FT_DIR, "default")},
+        {SUBVOLUME, ROOT_ITEM, 0, btrfsRootItem(SUBVOLUME_NODE, 1)},
+        {SUBVOLUME, ROOT_BACKREF, 5, backref + "@"},
+    };
+    place(ROOT_TREE, btrfsLeaf(ROOT_TREE, rootItems));
+
+    const QList<BtrfsItem> topLevelItems {
+        btrfsInode(256, 040755, 2),
+        {256, DIR_INDEX, 2, btrfsDirData(btrfsKey(SUBVOLUME, ROOT_ITEM, UINT64_MAX), FT_DIR, "@")},
+    };
+    place(FS_TREE_NODE, btrfsLeaf(FS_TREE_NODE, topLevelItems));
+
+    QByteArray internal = btrfsHeader(SUBVOLUME_NODE, 2, 1);
+    const QList<QPair<QByteArray, quint64>> children {{btrfsKey(256, 0, 0), SUBVOLUME_LEAF_A},
+                                                      {btrfsKey(263, 0, 0), SUBVOLUME_LEAF_B}};
+    for (qsizetype i = 0; i < children.size(); ++i) {
+        char *pointer = internal.data() + 0x65 + i * 33;
+        memcpy(pointer, children.at(i).first.constData(), 17);
+        qToLittleEndian(children.at(i).second, pointer + 17);
+    }
+    place(SUBVOLUME_NODE, internal);
+
+    const QList<BtrfsItem> leafA {
+        btrfsInode(256, 040755, 24),
+        btrfsEntry(256, 2, 257, FT_DIR, "boot"),
+        btrfsEntry(256, 3, 258, FT_DIR, "etc"),
+        btrfsEntry(256, 4, 259, FT_LINK, "sbin"),
+        btrfsEntry(256, 5, 260, FT_DIR, "usr"),
+        btrfsInode(257, 040755, 44),
+        btrfsEntry(257, 2, 261, FT_FILE, "vmlinuz-6.11.5-1-default"),
+        btrfsInode(258, 040755, 60),
+        btrfsEntry(258, 2, 262, FT_FILE, "os-release"),
+        btrfsEntry(258, 3, 263, FT_FILE, "fstab"),
+        btrfsEntry(258, 4, 264, FT_DIR, "default"),
+        btrfsEntry(258, 5, 268, FT_FILE, "lsb-release"),
+        btrfsInode(259, 0120777, 8),
+        btrfsInline(259, "usr/sbin"),
+        btrfsInode(260, 040755, 8),
+        btrfsEntry(260, 2, 266, FT_DIR, "sbin"),
+        btrfsInode(261, 0100644, 12000000),
+        btrfsInode(262, 0100644, BTRFS_OS_RELEASE.size()),
+        btrfsInline(262, BTRFS_OS_RELEASE),
+    };
+    place(SUBVOLUME_LEAF_A, btrfsLeaf(SUBVOLUME_LEAF_A, leafA));
+
+    const QByteArray grubCompressed = qCompress(BTRFS_DEFAULT_GRUB).mid(4); // without Qt's size prefix
+    const QList<BtrfsItem> leafB {
+        btrfsInode(263, 0100644, BTRFS_FSTAB.size()),
+        btrfsExtent(263, FSTAB_EXTENT, 16, BTRFS_FSTAB.size()),
+        btrfsInode(264, 040755, 8),
+        btrfsEntry(264, 2, 265, FT_FILE, "grub"),
+        btrfsInode(265, 0100644, BTRFS_DEFAULT_GRUB.size()),
+        btrfsInline(265, grubCompressed, 1, BTRFS_DEFAULT_GRUB.size()),
+        btrfsInode(266, 040755, 8),
+        btrfsEntry(266, 2, 267, FT_LINK, "init"),
+        btrfsInode(267, 0120777, 20),
+        btrfsInline(267, "/lib/systemd/systemd"),
+        btrfsInode(268, 0100644, 30),
+        btrfsInline(268, QByteArray(20, 'x'), 2, 30),
+    };
+    place(SUBVOLUME_LEAF_B, btrfsLeaf(SUBVOLUME_LEAF_B, leafB));
+    place(FSTAB_EXTENT + 16, BTRFS_FSTAB);
+    return bytes;
+}
+
+QStringList names(const QList<rootfs::DirEntry> &entries)
+{
+    QStringList result;
+    for (const rootfs::DirEntry &entry : entries) {
+        result.append(entry.name);
+    }
+    return result;
+}
+} // namespace
+
+void TestRootfs::read_ext4()
+{
+    QString error;
+    const auto snapshot = rootfs::read(readerFor(ext4Image().bytes), &error);
+    QVERIFY2(snapshot, qPrintable(error));
+    QCOMPARE(snapshot->fsType, QString("ext4"));
+    QCOMPARE(snapshot->uuid, EXT_UUID.toString(QUuid::WithoutBraces));
+    QCOMPARE(snapshot->label, QString("mxroot"));
+    QVERIFY(snapshot->subvolume.isEmpty());
+    QVERIFY(snapshot->isComplete());
+
+    QCOMPARE(snapshot->contents("/etc/os-release"), extOsRelease());
+    QCOMPARE(snapshot->contents("/etc/fstab"), EXT_FSTAB);
+    // A hole between the first direct block and the one behind the indirect block
+    QCOMPARE(snapshot->contents("/etc/mx-version"),
+             QByteArray("MX-23\n").leftJustified(12 * BLOCK, '\0') + QByteArray("tail\n"));
+    QVERIFY(!snapshot->exists("/etc/lsb-release"));
+
+    const rootfs::Node init = snapshot->files.value("/sbin/init");
+    QCOMPARE(init.kind, rootfs::Kind::Symlink);
+    QCOMPARE(init.target, QString("../lib/systemd/systemd"));
+    // Reached through the /lib symlink
+    QCOMPARE(snapshot->files.value("/lib/systemd/systemd").kind, rootfs::Kind::File);
+    QVERIFY(!snapshot->exists("/bin/init"));
+
+    QCOMPARE(names(snapshot->directories.value("/")), QStringList({"boot", "etc", "lib", "sbin", "usr"}));
+    QCOMPARE(snapshot->directories.value("/").at(2).kind, rootfs::Kind::Symlink);
+    QVERIFY(snapshot->isDirectory("/boot"));
+    QCOMPARE(snapshot->list("/boot", "vmlinuz-"), QStringList({"vmlinuz-6.1.0-13-amd64", "vmlinuz-6.6.0-1-amd64"}));
+    QCOMPARE(snapshot->directories.value("/boot").constLast(),
+             rootfs::DirEntry({"vmlinuz-6.6.0-1-amd64", rootfs::Kind::File, 9 * 1024 * 1024}));
+}
+
+void TestRootfs::read_btrfs()
+{
+    QString error;
+    const auto snapshot = rootfs::read(readerFor(btrfsImage()), &error);
+    QVERIFY2(snapshot, qPrintable(error));
+    QCOMPARE(snapshot->fsType, QString("btrfs"));
+    QCOMPARE(snapshot->uuid, BTRFS_UUID.toString(QUuid::WithoutBraces));
+    QCOMPARE(snapshot->label, QString("tumbleweed"));
+    QCOMPARE(snapshot->subvolume, QString("@"));
+
+    QCOMPARE(snapshot->contents("/etc/os-release"), BTRFS_OS_RELEASE);
+    QCOMPARE(snapshot->contents("/etc/fstab"), BTRFS_FSTAB);
+    QCOMPARE(snapshot->contents("/etc/default/grub"), BTRFS_DEFAULT_GRUB);
+    // lzo cannot be undone, so the snapshot is not enough to go without mounting
+    QVERIFY(snapshot->exists("/etc/lsb-release"));
+    QVERIFY(!snapshot->files.value("/etc/lsb-release").readable);
+    QVERIFY(!snapshot->isComplete());
+
+    // /sbin is a symlink to usr/sbin
+    const rootfs::Node init = snapshot->files.value("/sbin/init");
+    QCOMPARE(init.kind, rootfs::Kind::Symlink);
+    QCOMPARE(init.target, QString("/lib/systemd/systemd"));
+    QVERIFY(!snapshot->exists("/lib/systemd/systemd"));
+
+    QCOMPARE(names(snapshot->directories.value("/")), QStringList({"boot", "etc", "sbin", "usr"}));
+    QCOMPARE(snapshot->list("/boot", "vmlinuz-"), QStringList({"vmlinuz-6.11.5-1-default"}));
+    QCOMPARE(snapshot->directories.value("/boot").constFirst().size, quint64(12000000));
+}
+
+void TestRootfs::read_rejectsOtherFilesystems()
+{
+    QString error;
+    QVERIFY(!rootfs::read(readerFor(QByteArray(0x20000, '\0')), &error));
+    QVERIFY(!error.isEmpty());
+    QVERIFY(!rootfs::read(readerFor(QByteArray())));
+
+    // Features that change the on-disk layout
+    Ext4Image image = ext4Image();
+    qToLittleEndian<quint32>(0x2 | 0x10, image.block(1) + 96);
+    QVERIFY(!rootfs::read(readerFor(image.bytes), &error));
+
+    // A second device would hold part of the chunks
+    QByteArray btrfs = btrfsImage();
+    qToLittleEndian<quint64>(2, btrfs.data() + 0x10000 + 0x88);
+    QVERIFY(!rootfs::read(readerFor(btrfs)));
+
+    // Nodes of another file system
+    btrfs = btrfsImage();
+    btrfs[qsizetype(DATA_PHYSICAL + 0x20)] ^= 1;
+    QVERIFY(!rootfs::read(readerFor(btrfs)));
+
+    // Two children sharing a leaf; listing /etc would reach it twice
+    btrfs = btrfsImage();
+    char *second = btrfs.data() + DATA_PHYSICAL + (SUBVOLUME_NODE - DATA_LOGICAL) + 0x65 + 33;
+    memcpy(second, btrfsKey(258, DIR_INDEX, 3).constData(), 17);
+    qToLittleEndian<quint64>(SUBVOLUME_LEAF_A, second + 17);
+    const auto shared = rootfs::read(readerFor(btrfs));
+    QVERIFY(!shared || !shared->exists("/etc/fstab"));
+}
+
+void TestRootfs::readDevice_imageFile()
+{
+    const QByteArray bytes = ext4Image().bytes;
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    QCOMPARE(file.write(bytes), qint64(bytes.size()));
+    file.close();
+    const auto snapshot = rootfs::readDevice(file.fileName());
+    QVERIFY(snapshot);
+    QCOMPARE(snapshot->contents("/etc/fstab"), EXT_FSTAB);
+
+    QString error;
+    QVERIFY(!rootfs::readDevice(file.fileName() + ".missing", &error));
+    QVERIFY(!error.isEmpty());
+}
+
+void TestRootfs::readDirectory_mountedTree()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QDir root(dir.path());
+    QVERIFY(root.mkpath("etc") && root.mkpath("boot") && root.mkpath("sbin") && root.mkpath("lib/systemd"));
+    const auto write = [&root](const QString &path, const QByteArray &data) {
+        QFile file(root.filePath(path));
+        return file.open(QIODevice::WriteOnly) && file.write(data) == data.size();
+    };
+    QVERIFY(write("etc/fstab", EXT_FSTAB));
+    QVERIFY(write("boot/vmlinuz-6.6.0-1-amd64", "kernel"));
+    QVERIFY(write("lib/systemd/systemd", ""));
+    QVERIFY(QFile::link(root.filePath("lib/systemd/systemd"), root.filePath("sbin/init")));
+
+    const rootfs::Snapshot snapshot = rootfs::readDirectory(dir.path());
+    QCOMPARE(snapshot.mountPoint, dir.path());
+    QVERIFY(snapshot.fsType.isEmpty());
+    QCOMPARE(snapshot.contents("/etc/fstab"), EXT_FSTAB);
+    QCOMPARE(snapshot.files.value("/sbin/init").target, QString("/lib/systemd/systemd"));
+    QCOMPARE(snapshot.list("/boot", "vmlinuz-"), QStringList({"vmlinuz-6.6.0-1-amd64"}));
+    QCOMPARE(snapshot.directories.value("/boot").constFirst().size, quint64(6));
+    QVERIFY(snapshot.isComplete());
+}
+
+void TestRootfs::bootSource_findsBootMount()
+{
+    QCOMPARE(rootfs::bootSource(EXT_FSTAB), QString("UUID=4f1a"));
+    QCOMPARE(rootfs::bootSource("# /boot was on /dev/sda1\n"
+                                "LABEL=root / ext4 defaults 0 1\n"
+                                "LABEL=my\\040boot\t/boot  ext4 defaults 0 2\n"),
+             QString("LABEL=my boot"));
+    QVERIFY(rootfs::bootSource(BTRFS_FSTAB).isEmpty());
+    QVERIFY(rootfs::bootSource("/dev/sda1 /boot\n").isEmpty());
+    QVERIFY(rootfs::bootSource({}).isEmpty());
+}
+
+void TestRootfs::json_roundTrip()
+{
+    const auto snapshot = rootfs::read(readerFor(btrfsImage()));
+    QVERIFY(snapshot);
+    const auto back = rootfs::fromJson(rootfs::toJson(*snapshot));
+    QVERIFY(back);
+    QCOMPARE(back->fsType, snapshot->fsType);
+    QCOMPARE(back->uuid, snapshot->uuid);
+    QCOMPARE(back->label, snapshot->label);
+    QCOMPARE(back->subvolume, snapshot->subvolume);
+    QCOMPARE(back->files, snapshot->files);
+    QCOMPARE(back->directories, snapshot->directories);
+    QVERIFY(!rootfs::fromJson({}));
+    QVERIFY(!rootfs::fromJson({{"error", "Not a block device"}}));
+}
+
+QTEST_MAIN(TestRootfs)
+#include "test_rootfs.moc"
@@ -0,0 +1,159 @@
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include "rootprefetch.h"
+
+using Device = BlockDeviceModel::Device;
+
+class TestRootPrefetch : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void rank_likeliestFirst();
+    void rank_capped();
+    void prefetch_mountedTree();
+    void prefetch_unreadableDevice();
+    void cancel_dropsResults();
+};
+
+namespace
+{
+Device partition(const QString &name, const QString &fstype, const QString &parttype, const QString &label = {},
+                 const QString &mountpoint = {})
+{
+    Device device;
+    device.name = name;
+    device.drive = "sda";
+    device.fstype = fstype;
+    device.parttype = parttype;
+    device.label = label;
+    device.mountpoint = mountpoint;
+    return device;
+}
+
+QStringList names(const QList<const Device *> &devices)
+{
+    QStringList result;
+    for (const Device *device : devices) {
+        result.append(device->name);
+    }
+    return result;
+}
+
+const QString LINUX_FS = "0fc63daf-8483-4772-8e79-3d69d8477de4";
+const QString ROOT_X86_64 = "4f68bce3-e8cd-4db1-96e7-fbcaf984b709";
+
+struct Results {
+    QStringList devices;
+    QList<std::optional<rootfs::Snapshot>> snapshots;
+};
+
+void collect(RootPrefetcher *prefetcher, Results *results)
+{
+    QObject::connect(prefetcher, &RootPrefetcher::finished, prefetcher,
+                     [results](const QString &device, const std::optional<rootfs::Snapshot> &snapshot) {
+                         results->devices.append(device);
+                         results->snapshots.append(snapshot);
+                     });
+}
+} // namespace
+
+void TestRootPrefetch::rank_likeliestFirst()
+{
+    const QList<Device> devices {
+        partition("sda1", "ext4", LINUX_FS, "home"),
+        partition("sda2", "xfs", LINUX_FS),             // unmounted, and rootfs can't read xfs
+        partition("sda3", "xfs", LINUX_FS, {}, "/"),    // mounted, so read as a tree
+        partition("sda4", "btrfs", ROOT_X86_64),
+        partition("sda5", "ext4", LINUX_FS, "rootMX23"),
+        partition("sda6", "ext4", "ebd0a0a2-b9e5-4433-87c0-68b6b72699c7"), // Microsoft basic data
+    };
+    QList<const Device *> pointers;
+    for (const Device &device : devices) {
+        pointers.append(&device);
+    }
+
+    QCOMPARE(names(RootPrefetcher::rank(pointers, "sda3")), QStringList({"sda3", "sda5", "sda4", "sda1"}));
+    QCOMPARE(names(RootPrefetcher::rank(pointers, "nvme0n1p2")), QStringList({"sda5", "sda4", "sda1", "sda3"}));
+}
+
+void TestRootPrefetch::rank_capped()
+{
+    QList<Device> devices;
+    for (int i = 1; i <= RootPrefetcher::MAX_CANDIDATES + 2; ++i) {
+        devices.append(partition(QString("sda%1").arg(i), "ext4", "0x83"));
+    }
+    QList<const Device *> pointers;
+    for (const Device &device : std::as_const(devices)) {
+        pointers.append(&device);
+    }
+    const QList<const Device *> ranked = RootPrefetcher::rank(pointers, {});
+    QVERIFY(ranked.size() == RootPrefetcher::MAX_CANDIDATES);
+    QCOMPARE(ranked.constFirst()->name, QString("sda1"));
+}
+
+void TestRootPrefetch::prefetch_mountedTree()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QVERIFY(QDir(dir.path()).mkpath("etc"));
+    QVERIFY(QDir(dir.path()).mkpath("boot"));
+    QFile fstab(dir.filePath("etc/fstab"));
+    QVERIFY(fstab.open(QIODevice::WriteOnly));
+    fstab.write("UUID=f00d / ext4 defaults 0 1\n");
+    fstab.close();
+    QFile kernel(dir.filePath("boot/vmlinuz-6.1.0-28-amd64"));
+    QVERIFY(kernel.open(QIODevice::WriteOnly));
+    kernel.close();
+
+    RootPrefetcher prefetcher;
+    Results results;
+    collect(&prefetcher, &results);
+    prefetcher.prefetch({{"/dev/sdz2", dir.path()}});
+    QVERIFY(prefetcher.isPending("/dev/sdz2"));
+    // Already being read
+    prefetcher.prefetch({{"/dev/sdz2", dir.path()}});
+
+    QTRY_COMPARE(results.devices, QStringList({"/dev/sdz2"}));
+    QVERIFY(!prefetcher.isPending("/dev/sdz2"));
+    const std::optional<rootfs::Snapshot> &snapshot = results.snapshots.constFirst();
+    QVERIFY(snapshot);
+    QCOMPARE(snapshot->mountPoint, dir.path());
+    QCOMPARE(snapshot->contents("/etc/fstab"), QByteArray("UUID=f00d / ext4 defaults 0 1\n"));
+    QCOMPARE(snapshot->list("/boot", "vmlinuz-"), QStringList({"vmlinuz-6.1.0-28-amd64"}));
+}
+
+void TestRootPrefetch::prefetch_unreadableDevice()
+{
+    RootPrefetcher prefetcher;
+    Results results;
+    collect(&prefetcher, &results);
+    prefetcher.prefetch({{"/dev/does-not-exist", {}}});
+    QTRY_VERIFY(results.devices.size() == 1);
+    QVERIFY(!results.snapshots.constFirst());
+}
+
+void TestRootPrefetch::cancel_dropsResults()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    RootPrefetcher prefetcher;
+    Results results;
+    collect(&prefetcher, &results);
+    prefetcher.prefetch({{"/dev/sdz2", dir.path()}, {"/dev/sdz3", dir.path()}, {"/dev/sdz4", dir.path()}});
+    prefetcher.cancel();
+    QVERIFY(!prefetcher.isPending("/dev/sdz2"));
+
+    // A read started after the cancel is reported, those before it never are
+    prefetcher.prefetch({{"/dev/sdz5", dir.path()}});
+    QTRY_COMPARE(results.devices, QStringList({"/dev/sdz5"}));
+    QTest::qWait(50);
+    QCOMPARE(results.devices, QStringList({"/dev/sdz5"}));
+}
+
+QTEST_MAIN(TestRootPrefetch)
+#include "test_rootprefetch.moc"
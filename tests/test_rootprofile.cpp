@@ -0,0 +1,148 @@
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include "rootfs.h"
+#include "rootprofile.h"
+
+class TestRootProfile : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void read_osRelease();
+    void read_mxUsesLsbRelease();
+    void read_bootAndCrypttab();
+    void read_init();
+    void distroName_fallbacks();
+    void isCurrent_mountedRoot();
+};
+
+namespace
+{
+rootfs::Node file(const QByteArray &contents)
+{
+    rootfs::Node node;
+    node.kind = rootfs::Kind::File;
+    node.size = contents.size();
+    node.contents = contents;
+    return node;
+}
+
+rootfs::Node symlink(const QString &target)
+{
+    rootfs::Node node;
+    node.kind = rootfs::Kind::Symlink;
+    node.target = target;
+    return node;
+}
+
+void writeFile(const QString &path, const QByteArray &contents)
+{
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    QVERIFY(file.write(contents) == contents.size());
+}
+} // namespace
+
+void TestRootProfile::read_osRelease()
+{
+    rootfs::Snapshot root;
+    root.device = "/dev/sda2";
+    root.files.insert("/etc/os-release", file("PRETTY_NAME=\"Debian GNU/Linux 12 (bookworm)\"\nID=debian\n"));
+    root.files.insert("/etc/lsb-release", file("PRETTY_NAME=\"Not used\"\n"));
+
+    const RootProfile profile = RootProfile::read(root);
+    QCOMPARE(profile.entryName, QString("Debian 12 (bookworm)"));
+    QCOMPARE(profile.distro, QString("debian"));
+    QVERIFY(profile.mountPoint.isEmpty());
+    QVERIFY(profile.stamps.isEmpty());
+    QVERIFY(profile.isCurrent());
+}
+
+void TestRootProfile::read_mxUsesLsbRelease()
+{
+    rootfs::Snapshot root;
+    root.files.insert("/etc/mx-version", file("MX-23.5_x64 Libretto\n"));
+    root.files.insert("/etc/os-release", file("PRETTY_NAME=\"Debian GNU/Linux 12 (bookworm)\"\nID=debian\n"));
+    root.files.insert("/etc/lsb-release", file("PRETTY_NAME=\"MX 23.5 Libretto\"\n"));
+    root.files.insert("/etc/initrd_release", file("NAME=\"MX\"\n"));
+
+    const RootProfile profile = RootProfile::read(root);
+    QCOMPARE(profile.entryName, QString("MX 23.5 Libretto"));
+    QCOMPARE(profile.distro, QString("MX"));
+}
+
+void TestRootProfile::read_bootAndCrypttab()
+{
+    rootfs::Snapshot root;
+    root.directories.insert("/boot", {});
+    root.files.insert("/etc/fstab", file("UUID=f00d / ext4 defaults 0 1\n"
+                                         "UUID=beef /boot ext4 defaults 0 2\n"));
+    root.files.insert("/etc/crypttab", file("# <target> <source> <key> <options>\n"
+                                            "\n"
+                                            "swap_crypt PARTUUID=0a1b-03 /dev/urandom swap\n"
+                                            "sda2_crypt UUID=c0ffee none luks,discard\n"));
+
+    const RootProfile profile = RootProfile::read(root);
+    QVERIFY(profile.hasFstab);
+    QCOMPARE(profile.bootSource, QString("UUID=beef"));
+    QVERIFY(profile.hasBootDirectory);
+    const QList<RootProfile::CryptEntry> expected {{"swap_crypt", "PARTUUID=0a1b-03"}, {"sda2_crypt", "UUID=c0ffee"}};
+    QCOMPARE(profile.crypttab, expected);
+    QCOMPARE(profile.mapperName({"sda2", "UUID=c0ffee", "PARTUUID=0a1b-02"}), QString("sda2_crypt"));
+    QVERIFY(profile.mapperName({"sdb1", "UUID=dead"}).isEmpty());
+
+    QVERIFY(!RootProfile::read({}).hasFstab);
+    QVERIFY(RootProfile::read({}).crypttab.isEmpty());
+}
+
+void TestRootProfile::read_init()
+{
+    rootfs::Snapshot root;
+    root.files.insert("/lib/systemd/systemd", file({}));
+    root.files.insert("/sbin/init", symlink("/lib/systemd/systemd"));
+    QVERIFY(!RootProfile::read(root).needsInitSystemd);
+
+    // antiX and MX ship sysvinit as /sbin/init next to systemd
+    root.files.insert("/sbin/init", file("ELF"));
+    QVERIFY(RootProfile::read(root).needsInitSystemd);
+    root.files.insert("/sbin/init", symlink("/sbin/openrc-init"));
+    QVERIFY(RootProfile::read(root).needsInitSystemd);
+
+    root.files.remove("/lib/systemd/systemd");
+    QVERIFY(!RootProfile::read(root).needsInitSystemd);
+}
+
+void TestRootProfile::distroName_fallbacks()
+{
+    QCOMPARE(RootProfile::distroName(true, "os-release", std::nullopt), QString("MX Linux"));
+    QCOMPARE(RootProfile::distroName(false, "initrd_release", std::nullopt), QString("MX"));
+    QCOMPARE(RootProfile::distroName(false, "os-release", QByteArray("NAME=Arch\n")), QString("Linux"));
+    QCOMPARE(RootProfile::distroName(false, "lsb-release", QByteArray("DISTRIB_DESCRIPTION=\"antiX 23\"\n")),
+             QString("antiX 23"));
+}
+
+void TestRootProfile::isCurrent_mountedRoot()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QVERIFY(QDir(dir.path()).mkpath("etc"));
+    writeFile(dir.filePath("etc/fstab"), "UUID=f00d / ext4 defaults 0 1\n");
+    writeFile(dir.filePath("etc/os-release"), "PRETTY_NAME=\"Fedora Linux 40\"\nID=fedora\n");
+
+    const RootProfile profile = RootProfile::read(rootfs::readDirectory(dir.path()));
+    QCOMPARE(profile.mountPoint, dir.path());
+    QCOMPARE(profile.entryName, QString("Fedora 40"));
+    QVERIFY(profile.bootSource.isEmpty());
+    QVERIFY(profile.isCurrent());
+
+    // A separate /boot added to fstab since
+    writeFile(dir.filePath("etc/fstab"), "UUID=f00d / ext4 defaults 0 1\nUUID=beef /boot ext4 defaults 0 2\n");
+    QVERIFY(!profile.isCurrent());
+    QCOMPARE(RootProfile::read(rootfs::readDirectory(dir.path())).bootSource, QString("UUID=beef"));
+}
+
+QTEST_MAIN(TestRootProfile)
+#include "test_rootprofile.moc"
@@ -0,0 +1,195 @@
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include "scancache.h"
+
+class TestScanCache : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void json_roundTrip();
+    void json_otherVersion();
+    void prune_byIdentity();
+    void stamps_detectChanges();
+    void mountedStamps_underMountPoint();
+    void saveLoad_file();
+    void currentBootId_trimmed();
+};
+
+namespace
+{
+QJsonObject partition(const QString &name, const QString &partuuid, const QString &uuid)
+{
+    return {{"name", name}, {"path", "/dev/" + name}, {"type", "part"}, {"partuuid", partuuid}, {"uuid", uuid}};
+}
+
+scancache::Snapshot sample()
+{
+    scancache::Snapshot snapshot;
+    snapshot.bootId = "3f1c0e2a-5b7d-4c1e-9f00-1234567890ab";
+    snapshot.rootDevicePath = "/dev/nvme0n1p2";
+    snapshot.rootPartition = "nvme0n1p2";
+    snapshot.rootDrive = "nvme0n1";
+    snapshot.devices = {partition("nvme0n1p2", "0A1B2C3D-0000-4000-8000-000000000002", "F00D-CAFE")};
+    snapshot.efivars.insert("Boot0001", {88, 0xFFFF'FFFF'FFFF'FFF0ULL});
+    snapshot.efivars.insert("BootOrder", {10, 42});
+    snapshot.efibootmgr = "BootCurrent: 0001\nBootOrder: 0001\nBoot0001* MX\tHD(2,GPT,...)";
+    scancache::KernelChoice choice {{"6.12.8-1-liquorix-amd64", "6.1.0-28-amd64"},
+                                    "6.1.0-28-amd64",
+                                    "root=UUID=f00d-cafe ro quiet",
+                                    "MX 23.5 Libretto",
+                                    "MX23"};
+    snapshot.kernels.insert("nvme0n1p2", {"0a1b2c3d-0000-4000-8000-000000000002", "f00d-cafe",
+                                          {{"/boot", 4096, 1700000000000}, {"/etc/lsb-release", -1, 0}}, choice});
+    return snapshot;
+}
+
+void compare(const scancache::Snapshot &actual, const scancache::Snapshot &expected)
+{
+    QCOMPARE(actual.bootId, expected.bootId);
+    QCOMPARE(actual.rootDevicePath, expected.rootDevicePath);
+    QCOMPARE(actual.rootPartition, expected.rootPartition);
+    QCOMPARE(actual.rootDrive, expected.rootDrive);
+    QCOMPARE(actual.devices, expected.devices);
+    QVERIFY(actual.efivars == expected.efivars);
+    QCOMPARE(actual.efibootmgr, expected.efibootmgr);
+    QCOMPARE(actual.kernels.keys(), expected.kernels.keys());
+    for (auto it = expected.kernels.cbegin(); it != expected.kernels.cend(); ++it) {
+        const scancache::CachedKernels &cached = actual.kernels.value(it.key());
+        QCOMPARE(cached.partuuid, it->partuuid);
+        QCOMPARE(cached.uuid, it->uuid);
+        QVERIFY(cached.stamps == it->stamps);
+        QVERIFY(cached.choice == it->choice);
+    }
+}
+
+void writeFile(const QString &path, const QByteArray &contents)
+{
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    QVERIFY(file.write(contents) == contents.size());
+}
+} // namespace
+
+void TestScanCache::json_roundTrip()
+{
+    const scancache::Snapshot snapshot = sample();
+    const auto restored = scancache::fromJson(scancache::toJson(snapshot));
+    QVERIFY(restored);
+    compare(*restored, snapshot);
+}
+
+void TestScanCache::json_otherVersion()
+{
+    QJsonObject object = scancache::toJson(sample());
+    object.insert("version", scancache::FORMAT_VERSION + 1);
+    QVERIFY(!scancache::fromJson(object));
+    QVERIFY(!scancache::fromJson({}));
+}
+
+void TestScanCache::prune_byIdentity()
+{
+    scancache::Snapshot snapshot;
+    const scancache::KernelChoice choice {{"6.1.0-28-amd64"}, "6.1.0-28-amd64", "ro", {}, "debian"};
+    snapshot.kernels.insert("sda2", {"1111", "aaaa", {}, choice});
+    snapshot.kernels.insert("sda3", {"3333", "cccc", {}, choice}); // reformatted since
+    snapshot.kernels.insert("sda4", {"4444", "dddd", {}, choice}); // gone
+    snapshot.kernels.insert("sdb1", {"5555", "eeee", {}, choice}); // now another partition's PARTUUID
+    snapshot.devices = {partition("sda2", "1111", "AAAA"), partition("sda3", "3333", "ffff"),
+                        partition("sdb1", "6666", "eeee")};
+
+    QCOMPARE(scancache::identity(snapshot.devices, "sda2"), qMakePair(QString("1111"), QString("aaaa")));
+    QCOMPARE(scancache::identity(snapshot.devices, "sda4"), qMakePair(QString(), QString()));
+
+    scancache::prune(&snapshot);
+    QCOMPARE(snapshot.kernels.keys(), QStringList({"sda2"}));
+
+    snapshot.devices = {};
+    scancache::prune(&snapshot);
+    QVERIFY(snapshot.kernels.isEmpty());
+}
+
+void TestScanCache::stamps_detectChanges()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("grub.cfg");
+    writeFile(path, "menuentry 'MX' {}\n");
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QVERIFY(file.setFileTime(QDateTime::fromMSecsSinceEpoch(1700000000000), QFileDevice::FileModificationTime));
+    file.close();
+
+    const QList<scancache::Stamp> stamps {scancache::stamp(path)};
+    QCOMPARE(stamps.constFirst().size, qint64(18));
+    QCOMPARE(stamps.constFirst().mtime, qint64(1700000000000));
+    QVERIFY(scancache::isCurrent(stamps));
+
+    // Same size, newer file
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QVERIFY(file.setFileTime(QDateTime::fromMSecsSinceEpoch(1700000001000), QFileDevice::FileModificationTime));
+    file.close();
+    QVERIFY(!scancache::isCurrent(stamps));
+
+    const QString missing = dir.filePath("lsb-release");
+    const QList<scancache::Stamp> missingStamps {scancache::stamp(missing)};
+    QCOMPARE(missingStamps.constFirst().size, qint64(-1));
+    QVERIFY(scancache::isCurrent(missingStamps));
+    writeFile(missing, {});
+    QVERIFY(!scancache::isCurrent(missingStamps));
+
+    QVERIFY(!scancache::isCurrent({}));
+}
+
+void TestScanCache::mountedStamps_underMountPoint()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    QVERIFY(QDir(dir.path()).mkpath("boot/grub"));
+    writeFile(dir.filePath("boot/grub/grub.cfg"), "set timeout=5\n");
+
+    const QList<scancache::Stamp> stamps = scancache::mountedStamps(dir.path() + '/');
+    QVERIFY(!stamps.isEmpty());
+    QCOMPARE(stamps.constFirst().path, dir.filePath("boot"));
+    QCOMPARE(stamps.at(1).path, dir.filePath("boot/grub/grub.cfg"));
+    QCOMPARE(stamps.at(1).size, qint64(14));
+    QCOMPARE(stamps.last().size, qint64(-1));
+    QVERIFY(scancache::isCurrent(stamps));
+
+    // update-grub ran since
+    writeFile(dir.filePath("boot/grub/grub.cfg"), "set timeout=10\n");
+    QVERIFY(!scancache::isCurrent(stamps));
+}
+
+void TestScanCache::saveLoad_file()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString path = dir.filePath("cache/uefi-manager/scan.json");
+    QVERIFY(!scancache::load(path));
+
+    QVERIFY(scancache::save(path, sample()));
+    const auto loaded = scancache::load(path);
+    QVERIFY(loaded);
+    compare(*loaded, sample());
+
+    writeFile(path, "{\"version\": 1, \"devices\": [");
+    QVERIFY(!scancache::load(path));
+}
+
+void TestScanCache::currentBootId_trimmed()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    writeFile(dir.filePath("boot_id"), "3f1c0e2a-5b7d-4c1e-9f00-1234567890ab\n");
+    QCOMPARE(scancache::currentBootId(dir.filePath("boot_id")), QString("3f1c0e2a-5b7d-4c1e-9f00-1234567890ab"));
+    QVERIFY(scancache::currentBootId(dir.filePath("missing")).isEmpty());
+}
+
+QTEST_MAIN(TestScanCache)
+#include "test_scancache.moc"
@@ -0,0 +1,181 @@
+#include <QTest>
+#include <QtEndian>
+#include "varsfile.h"
+
+using bootsnapshot::Change;
+using bootsnapshot::Snapshot;
+
+class TestVarsFile : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void parse_readsLiveVariables();
+    void parse_rejectsForeignFile();
+    void parse_rejectsLostSync();
+    void apply_rewritesOnlyTheStore();
+    void apply_failsWhenFull();
+};
+
+namespace
+{
+const QByteArray GLOBAL_GUID = QByteArray::fromHex("61dfe48bca93d211aa0d00e098032b8c");
+const QByteArray IMAGE_SECURITY_GUID = QByteArray::fromHex("cbb219d73a3d9645a3bcdad00e67656f");
+const QByteArray SYSTEM_NV_DATA_FV_GUID = QByteArray::fromHex("8d2bf1ff96768b4ca9852747075b4f50");
+constexpr qsizetype FV_HEADER_LENGTH = 0x48;
+constexpr quint8 ADDED = 0x3f;
+constexpr quint8 DELETED = 0x3c;
+constexpr quint8 IN_TRANSITION = 0x3e;
+
+// AUTHENTICATED_VARIABLE_HEADER followed by the name and the data, with nothing between them
+QByteArray record(const QByteArray &guid, const QString &name, const QByteArray &data, quint8 state,
+                  quint64 monotonicCount = 0)
+{
+    QByteArray nameBytes;
+    for (QChar c : name) {
+        nameBytes.append(static_cast<char>(c.unicode()));
+        nameBytes.append('\0');
+    }
+    nameBytes.append(2, '\0');
+    QByteArray header(60, '\0');
+    qToLittleEndian<quint16>(0x55aa, header.data());
+    header[2] = static_cast<char>(state);
+    qToLittleEndian<quint32>(7, header.data() + 4);
+    qToLittleEndian(monotonicCount, header.data() + 8);
+    qToLittleEndian<quint32>(nameBytes.size(), header.data() + 36);
+    qToLittleEndian<quint32>(data.size(), header.data() + 40);
+    header.replace(44, 16, guid);
+    return header + nameBytes + data;
+}
+
+// Laid out like OVMF_VARS.fd: the firmware volume header with a single block map entry, the
+// authenticated variable store at 0x48 with its first variable at 0x64, then a fake FTW area
+QByteArray image(const QList<QByteArray> &records, qsizetype storeSize = 0x400)
+{
+    const qsizetype fvLength = FV_HEADER_LENGTH + storeSize + 0x40;
+    QByteArray fv(FV_HEADER_LENGTH, '\0');
+    fv.replace(16, 16, SYSTEM_NV_DATA_FV_GUID);
+    qToLittleEndian<quint64>(fvLength, fv.data() + 32);
+    fv.replace(40, 4, "_FVH");
+    qToLittleEndian<quint32>(0x4feff, fv.data() + 44);
+    qToLittleEndian<quint16>(FV_HEADER_LENGTH, fv.data() + 48);
+    fv[55] = 2; // revision
+    qToLittleEndian<quint32>(1, fv.data() + 56);
+    qToLittleEndian<quint32>(fvLength, fv.data() + 60);
+    quint16 sum = 0;
+    for (qsizetype i = 0; i < FV_HEADER_LENGTH; i += 2) {
+        sum += qFromLittleEndian<quint16>(fv.constData() + i);
+    }
+    qToLittleEndian(static_cast<quint16>(-sum), fv.data() + 50);
+
+    QByteArray store = QByteArray::fromHex("782cf3aa7b949a43a1802e144ec37792");
+    store.append(4, '\0');
+    qToLittleEndian<quint32>(storeSize, store.data() + 16);
+    store += QByteArray::fromHex("5afe000000000000");
+    for (const QByteArray &rec : records) {
+        store += rec;
+        store.append((4 - store.size() % 4) % 4, '\xff');
+    }
+    store.append(storeSize - store.size(), '\xff');
+    return fv + store + QByteArray(0x40, '\x2b');
+}
+
+QList<QByteArray> sampleRecords()
+{
+    return {record(GLOBAL_GUID, "Boot0001", QByteArray::fromHex("0100000004004d0058000000"), ADDED),
+            record(GLOBAL_GUID, "Boot0002", QByteArray::fromHex("010000000400440000007fff0400"), DELETED),
+            record(IMAGE_SECURITY_GUID, "db", QByteArray(40, '\x11'), ADDED, 42),
+            record(GLOBAL_GUID, "BootOrder", QByteArray::fromHex("01000200"), IN_TRANSITION),
+            record(GLOBAL_GUID, "BootOrder", QByteArray::fromHex("0100"), ADDED),
+            record(GLOBAL_GUID, "Timeout", QByteArray::fromHex("0500"), IN_TRANSITION)};
+}
+} // namespace
+
+void TestVarsFile::parse_readsLiveVariables()
+{
+    varsfile::Image parsed;
+    QString error;
+    QVERIFY2(varsfile::parse(image(sampleRecords()), &parsed, &error), qPrintable(error));
+    QCOMPARE(parsed.records.size(), 4);
+    // "Boot0001" takes 18 bytes, so its data and the next header are where OVMF puts them
+    QCOMPARE(parsed.records.at(0).raw.size(), qsizetype(60 + 18 + 12));
+    QCOMPARE(parsed.records.at(0).data, QByteArray::fromHex("0100000004004d0058000000"));
+    QCOMPARE(parsed.records.at(1).name, QString("db"));
+    QCOMPARE(parsed.records.at(1).data, QByteArray(40, '\x11'));
+
+    // Deleted variables and superseded copies are skipped, a lone copy in transition counts
+    const Snapshot snapshot = varsfile::capture(parsed);
+    QCOMPARE(snapshot.variables.size(), 3);
+    QVERIFY(snapshot.find("Boot0001"));
+    QVERIFY(!snapshot.find("Boot0002"));
+    QCOMPARE(snapshot.find("BootOrder")->data, QByteArray::fromHex("0100"));
+    QCOMPARE(snapshot.find("Timeout")->data, QByteArray::fromHex("0500"));
+}
+
+void TestVarsFile::parse_rejectsForeignFile()
+{
+    varsfile::Image parsed;
+    QString error;
+    QVERIFY(!varsfile::parse(QByteArray(0x200, '\0'), &parsed, &error));
+    QVERIFY(!error.isEmpty());
+
+    QByteArray damaged = image(sampleRecords());
+    damaged[FV_HEADER_LENGTH + 20] = 0; // store not formatted
+    QVERIFY(!varsfile::parse(damaged, &parsed, &error));
+}
+
+void TestVarsFile::parse_rejectsLostSync()
+{
+    // Neither a variable nor erased space where the second header should start
+    QByteArray bytes = image(sampleRecords());
+    const qsizetype second = FV_HEADER_LENGTH + 28 + 92;
+    QCOMPARE(qFromLittleEndian<quint16>(bytes.constData() + second), quint16(0x55aa));
+    qToLittleEndian<quint16>(0x1234, bytes.data() + second);
+    varsfile::Image parsed;
+    QString error;
+    QVERIFY(!varsfile::parse(bytes, &parsed, &error));
+    QVERIFY(!error.isEmpty());
+}
+
+void TestVarsFile::apply_rewritesOnlyTheStore()
+{
+    const QByteArray original = image(sampleRecords());
+    varsfile::Image parsed;
+    QVERIFY(varsfile::parse(original, &parsed));
+
+    const QByteArray boot3 = QByteArray::fromHex("0100000004005300680065006c006c0000007fff0400");
+    QVERIFY(varsfile::apply(&parsed, {{Change::Kind::Write, {"Boot0003", 7, boot3}},
+                                      {Change::Kind::Write, {"BootOrder", 7, QByteArray::fromHex("03000100")}},
+                                      {Change::Kind::Delete, {"Timeout", 0, {}}}}));
+    QCOMPARE(parsed.bytes.size(), original.size());
+    QCOMPARE(parsed.bytes.left(FV_HEADER_LENGTH + 28), original.left(FV_HEADER_LENGTH + 28));
+    QCOMPARE(parsed.bytes.right(0x40), original.right(0x40));
+
+    varsfile::Image reread;
+    QVERIFY(varsfile::parse(parsed.bytes, &reread));
+    const Snapshot snapshot = varsfile::capture(reread);
+    QCOMPARE(snapshot.variables.size(), 3);
+    QCOMPARE(snapshot.find("Boot0003")->data, boot3);
+    QCOMPARE(snapshot.find("BootOrder")->data, QByteArray::fromHex("03000100"));
+    QVERIFY(!snapshot.find("Timeout"));
+
+    // Variables we don't manage keep their authentication fields
+    const auto db = std::find_if(reread.records.cbegin(), reread.records.cend(),
+                                 [](const varsfile::Record &rec) { return rec.name == "db"; });
+    QVERIFY(db != reread.records.cend());
+    QCOMPARE(db->raw, record(IMAGE_SECURITY_GUID, "db", QByteArray(40, '\x11'), ADDED, 42));
+}
+
+void TestVarsFile::apply_failsWhenFull()
+{
+    varsfile::Image parsed;
+    QVERIFY(varsfile::parse(image(sampleRecords()), &parsed));
+    const QByteArray before = parsed.bytes;
+    QString error;
+    QVERIFY(!varsfile::apply(&parsed, {{Change::Kind::Write, {"Boot0004", 7, QByteArray(0x400, '\x01')}}}, &error));
+    QVERIFY(!error.isEmpty());
+    QCOMPARE(parsed.bytes, before);
+}
+
+QTEST_MAIN(TestVarsFile)
+#include "test_varsfile.moc"